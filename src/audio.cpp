@@ -4,12 +4,14 @@
 
 #include "audio.h"
 
+#include <algorithm>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "ring_buffer.h"
+#include "snapshot.h"
 #include "vera/vera_pcm.h"
 #include "vera/vera_psg.h"
 #include "ym2151/ym2151.h"
@@ -26,23 +28,15 @@ struct audio_buffer {
 	int16_t data[SAMPLES_PER_BUFFER * 2];
 };
 
+// Filled by the emulation thread and drained by the SDL audio callback, without either one locking.
 #define BACKBUFFER_COUNT (SAMPLERATE / (SAMPLES_PER_BUFFER * 5))
-static ring_allocator<audio_buffer, BACKBUFFER_COUNT> Audio_backbuffer;
+static spsc_ring_buffer<audio_buffer, BACKBUFFER_COUNT> Audio_backbuffer;
 
 static constexpr size_t Low_buffer_threshold = 2;
 static int              Clocks_rendered      = 0;
+static bool             Render_ahead         = true;
 
-static volatile audio_render_callback Render_callback = nullptr;
-
-audio_lock_scope::audio_lock_scope()
-{
-	SDL_LockAudio();
-}
-
-audio_lock_scope::~audio_lock_scope()
-{
-	SDL_UnlockAudio();
-}
+static audio_render_callback Render_callback = nullptr;
 
 static void audio_callback_nop(const int16_t *, const int)
 {
@@ -59,11 +53,11 @@ static void audio_render_buffer()
 	SDL_MixAudioFormat(reinterpret_cast<uint8_t *>(buffer), reinterpret_cast<uint8_t *>(Psg_buffer), AUDIO_S16, sizeof(Psg_buffer), SDL_MIX_MAXVOLUME);
 	SDL_MixAudioFormat(reinterpret_cast<uint8_t *>(buffer), reinterpret_cast<uint8_t *>(Pcm_buffer), AUDIO_S16, sizeof(Pcm_buffer), SDL_MIX_MAXVOLUME);
 
-	// Commit to the backbuffer
-	{
-		audio_lock_scope lock;
-		audio_buffer *   backbuffer = Audio_backbuffer.allocate();
+	// Commit to the backbuffer. If the callback is a whole backbuffer behind (e.g. in warp mode),
+	// this buffer is dropped, since only the callback may free the ones it hasn't played yet.
+	if (audio_buffer *backbuffer = Audio_backbuffer.begin_write(); backbuffer != nullptr) {
 		memcpy(backbuffer->data, buffer, sizeof(buffer));
+		Audio_backbuffer.end_write();
 	}
 
 	Render_callback(reinterpret_cast<int16_t *>(buffer), SAMPLES_PER_BUFFER);
@@ -78,8 +72,13 @@ static void audio_callback(void *, Uint8 *stream, int len)
 	}
 
 	const audio_buffer *buffer = Audio_backbuffer.get_oldest();
+	if (buffer == nullptr) {
+		memset(stream, 0, len);
+		return;
+	}
 	memcpy(stream, buffer->data, len);
 
+	// Keep repeating the newest buffer rather than run dry.
 	if (Audio_backbuffer.count() > 1) {
 		Audio_backbuffer.free_oldest();
 	}
@@ -118,9 +117,9 @@ void audio_init(const char *dev_name, int /*num_audio_buffers*/)
 	printf("INFO: Audio buffer is %d bytes\n", obtained.size);
 
 	// Prime the buffer
-	{
-		auto backbuffer = Audio_backbuffer.allocate();
+	if (audio_buffer *backbuffer = Audio_backbuffer.begin_write(); backbuffer != nullptr) {
 		memset(backbuffer->data, 0, sizeof(backbuffer->data));
+		Audio_backbuffer.end_write();
 	}
 
 	// Start playback
@@ -137,6 +136,31 @@ void audio_close(void)
 	Audio_dev = 0;
 }
 
+int audio_get_render_position()
+{
+	if (Audio_dev == 0) {
+		return -1;
+	}
+	return std::min(Clocks_rendered / Clocks_per_sample, SAMPLES_PER_BUFFER - 1);
+}
+
+uint32_t audio_clocks_until_event()
+{
+	if (Audio_dev == 0) {
+		return UINT32_MAX;
+	}
+
+	// The PCM FIFO drains one sample at a time, so AFLOW can't assert before the sample that
+	// could first take it below the threshold.
+	const uint32_t samples = pcm_samples_until_almost_empty();
+	if (samples == UINT32_MAX) {
+		return UINT32_MAX;
+	}
+
+	const uint64_t sample_clock = ((uint64_t)(Clocks_rendered / Clocks_per_sample) + samples) * Clocks_per_sample;
+	return (uint32_t)std::clamp<uint64_t>(sample_clock - Clocks_rendered, 1, UINT32_MAX);
+}
+
 void audio_render(int cpu_clocks)
 {
 	YM_prerender(cpu_clocks);
@@ -146,19 +170,68 @@ void audio_render(int cpu_clocks)
 		return;
 	}
 
+	const int samples_stepped = Clocks_rendered / Clocks_per_sample;
 	Clocks_rendered += cpu_clocks;
 	int samples_to_render = Clocks_rendered / Clocks_per_sample;
+	pcm_step(samples_to_render - samples_stepped);
+
 	while (samples_to_render >= SAMPLES_PER_BUFFER) {
 		audio_render_buffer();
 		samples_to_render -= SAMPLES_PER_BUFFER;
 		Clocks_rendered -= Clocks_per_sample * SAMPLES_PER_BUFFER;
 	}
 
-	while (Audio_backbuffer.count() < Low_buffer_threshold) {
+	while (Render_ahead && Audio_backbuffer.count() < Low_buffer_threshold) {
 		audio_render_buffer();
 	}
 }
 
+void audio_set_render_ahead(bool enabled)
+{
+	Render_ahead = enabled;
+	if (enabled || Audio_dev == 0) {
+		return;
+	}
+
+	// Without rendering ahead, nothing refills the backbuffer while the emulation waits for the
+	// next frame, so start out a frame's worth of silence ahead instead.
+	const size_t frame_buffers = SAMPLERATE / 60 / SAMPLES_PER_BUFFER + 1;
+	while (Audio_backbuffer.count() < Low_buffer_threshold + frame_buffers) {
+		audio_buffer *backbuffer = Audio_backbuffer.begin_write();
+		if (backbuffer == nullptr) {
+			break;
+		}
+		memset(backbuffer->data, 0, sizeof(backbuffer->data));
+		Audio_backbuffer.end_write();
+	}
+}
+
+// The position within the buffer being rendered only means something at the same sample rate,
+// otherwise rendering restarts at the beginning of a buffer.
+void audio_save_state(snapshot_writer &w)
+{
+	w.write(Clocks_per_sample);
+	w.write(Clocks_rendered);
+}
+
+bool audio_check_state(snapshot_reader &r)
+{
+	return r.skip(sizeof(Clocks_per_sample) + sizeof(Clocks_rendered));
+}
+
+bool audio_load_state(snapshot_reader &r)
+{
+	int clocks_per_sample = 0;
+	int clocks_rendered   = 0;
+	r.read(clocks_per_sample);
+	r.read(clocks_rendered);
+	if (!r.ok()) {
+		return false;
+	}
+	Clocks_rendered = (clocks_per_sample == Clocks_per_sample) ? clocks_rendered : 0;
+	return true;
+}
+
 void audio_usage(void)
 {
 	// SDL_GetAudioDeviceName doesn't work if audio isn't initialized.
@@ -179,19 +252,16 @@ void audio_usage(void)
 
 void audio_get_psg_buffer(int16_t *dst)
 {
-	audio_lock_scope lock;
 	memcpy(dst, Psg_buffer, 2 * SAMPLES_PER_BUFFER * sizeof(int16_t));
 }
 
 void audio_get_pcm_buffer(int16_t *dst)
 {
-	audio_lock_scope lock;
 	memcpy(dst, Pcm_buffer, 2 * SAMPLES_PER_BUFFER * sizeof(int16_t));
 }
 
 void audio_get_ym_buffer(int16_t *dst)
 {
-	audio_lock_scope lock;
 	memcpy(dst, Ym_buffer, 2 * SAMPLES_PER_BUFFER * sizeof(int16_t));
 }
 
@@ -202,6 +272,5 @@ int audio_get_sample_rate()
 
 void audio_set_render_callback(audio_render_callback cb)
 {
-	audio_lock_scope lock;
 	Render_callback = cb;
 }
\ No newline at end of file
@@ -14,18 +14,27 @@
 #	define SAMPLES_PER_BUFFER (256)
 #endif
 
-class audio_lock_scope
-{
-public:
-	audio_lock_scope();
-	~audio_lock_scope();
-};
+class snapshot_reader;
+class snapshot_writer;
 
 using audio_render_callback = void (*)(const int16_t *samples, const int num_samples);
 
 void audio_init(const char *dev_name, int num_audio_buffers);
 void audio_close(void);
 void audio_render(int cpu_clocks);
+uint32_t audio_clocks_until_event();
+
+// Rendering ahead of the emulated clock keeps the audio device fed when the emulation falls
+// behind, but it also drains the PCM FIFO and runs the YM2151's timers early by however much the
+// host needed, so it's turned off when the run has to be deterministic.
+void audio_set_render_ahead(bool enabled);
+
+// Sample of the next buffer to be rendered that the emulated clock has reached, or -1 without an audio device.
+int audio_get_render_position();
+
+void audio_save_state(snapshot_writer &w);
+bool audio_check_state(snapshot_reader &r);
+bool audio_load_state(snapshot_reader &r);
 
 void audio_usage(void);
 
@@ -50,9 +50,11 @@ TOTAL_NUMBER_OPCODES = 2 ** 8
 #####################################
 ############# FILENAMES #############
 TABLES_HEADER_FNAME = "tables.h"
+DISPATCH_HEADER_FNAME = "dispatch.h"
 MNEMONICS_DISASSEM_HEADER_FNAME = "mnemonics.h"
 OPCODES_6502_FNAME = "6502.opcodes"
 OPCODES_65c02_FNAME = "65c02.opcodes"
+HANDLER_SOURCE_FNAMES = ["modes.h", "instructions_6502.h", "instructions_65c02.h"]
 
 
 #####################################
@@ -196,6 +198,121 @@ def convertMnemonicMode(opInfo):
     }
     return modeStr[opInfo[MODE_KEY_STR]]
 
+#######################################################################################################################
+#####################################  Load handler bodies from the C++ sources  #####################################
+#######################################################################################################################
+HANDLER_REGEX_STR = "static\\s+void\\s+(?P<name>\\w+)\\s*\\((?P<params>[^)]*)\\)\\s*\\{"
+
+# Addressing modes that can set penaltyaddr
+PENALTY_MODES = ["absx", "absy", "indy"]
+
+
+def loadHandlers(srcFiles):
+    handlers = {}
+    for srcFile in srcFiles:
+        source = open(srcFile).read()
+        for match in re.finditer(HANDLER_REGEX_STR, source):
+            depth = 1
+            pos = match.end()
+            while depth > 0:
+                if source[pos] == "{":
+                    depth += 1
+                elif source[pos] == "}":
+                    depth -= 1
+                pos += 1
+            body = source[match.end():pos - 1]
+            # Drop a trailing comment on the line with the opening brace, e.g. "{ //implied"
+            body = re.sub("^[ \\t]*//[^\\n]*", "", body)
+            assert "return" not in body, "Handler {} returns early".format(match.group("name"))
+            handlers[match.group("name")] = {
+                "params": match.group("params").strip(),
+                "body": body
+            }
+    return handlers
+
+
+def findCallArgs(text, start):
+    # Returns the index just past the parenthesis matching the one at text[start]
+    depth = 0
+    pos = start
+    while True:
+        if text[pos] == "(":
+            depth += 1
+        elif text[pos] == ")":
+            depth -= 1
+            if depth == 0:
+                return pos + 1
+        pos += 1
+
+
+def expandValueAccess(body, mode):
+    if mode == "acc":
+        getter = "((uint16_t)state6502.a)"
+        setter = "state6502.a = (uint8_t)(({}) & 0x00FF)"
+    else:
+        getter = "((uint16_t)read6502(ea))"
+        setter = "write6502(ea, (({}) & 0x00FF))"
+
+    body = body.replace("getvalue()", getter)
+    while "putvalue(" in body:
+        start = body.index("putvalue(")
+        end = findCallArgs(body, start + len("putvalue"))
+        body = body[:start] + setter.format(body[start + len("putvalue("):end - 1]) + body[end:]
+    return body
+
+
+def expandHelperCalls(body, handlers):
+    # Inline calls to parameterized helpers, e.g. bbr(0x01)
+    for name, handler in handlers.items():
+        if handler["params"] == "":
+            continue
+        match = re.search("(?<![\\w.])" + name + "\\(", body)
+        while match is not None:
+            end = findCallArgs(body, match.end() - 1)
+            args = body[match.end():end - 1]
+            assert body[end] == ";", "Helper {} used in an expression".format(name)
+            helper = "{{\n\tconst {} = {};\n{}}}".format(handler["params"], args, handler["body"].strip("\n"))
+            body = body[:match.start()] + helper + body[end + 1:]
+            match = re.search("(?<![\\w.])" + name + "\\(", body)
+    return body
+
+
+def indentBody(body, tabs):
+    lines = [line.rstrip() for line in body.strip("\n").split("\n")]
+    lines = [line for line in lines if line.strip() != ""]
+    if len(lines) == 0:
+        return []
+    # Handler bodies are indented by one tab in their source files
+    return [("\t" * (tabs - 1) + line) if not line.lstrip().startswith("#") else line.lstrip() for line in lines]
+
+
+#######################################################################################################################
+###########################################  Output the fused opcode switch  ##########################################
+#######################################################################################################################
+def generateDispatch(hFileName, handlers):
+    for op in range(0, TOTAL_NUMBER_OPCODES):
+        opInfo = opcodesList[op]
+        mode = opInfo[MODE_KEY_STR]
+        action = replace_and(opInfo[ACTN_KEY_STR])
+
+        hFileName.write("\ncase 0x{0:02X}: {{ // {1} {2}\n".format(op, opInfo[ACTN_KEY_STR], mode))
+        for name in [mode, action]:
+            body = handlers[name]["body"]
+            body = expandHelperCalls(body, handlers)
+            body = expandValueAccess(body, mode)
+            body = re.sub("(?<![\\w.])opcode(?!\\w)", "0x{0:02X}".format(op), body)
+            lines = indentBody(body, 2)
+            if len(lines) > 0:
+                hFileName.write("\t{\n")
+                hFileName.write("\n".join(lines) + "\n")
+                hFileName.write("\t}\n")
+        hFileName.write("\tclockticks6502 += {};\n".format(opInfo[CYCLES_KEY_STR]))
+        if mode in PENALTY_MODES and "penaltyop" in handlers[action]["body"]:
+            hFileName.write("\tif (penaltyop && penaltyaddr)\n")
+            hFileName.write("\t\tclockticks6502++;\n")
+        hFileName.write("} break;\n")
+
+
 #######################################################################################################################
 ##################################################  Load in opcodes  ##################################################
 #######################################################################################################################
@@ -215,6 +332,11 @@ if __name__ == '__main__':
         generateTable(output_h_file, ACTN_CODE_HEADER, ACTN_KEY_STR)
         generateTable(output_h_file, MCHN_CYCLES_HEADER, CYCLES_KEY_STR)
 
+    # Create "DISPATCH_HEADER_FNAME", the body of a switch statement with one fused case per opcode
+    with open(DISPATCH_HEADER_FNAME, "w") as output_h_file:
+        output_h_file.write("/* Generated by buildtables.py */\n")
+        generateDispatch(output_h_file, loadHandlers(HANDLER_SOURCE_FNAMES))
+
     # Create disassembly "MNEMONICS_DISASSEM_HEADER_FNAME" header file.
     mnemonics = [convertMnemonic(opcodesList[x]) for x in range(0, TOTAL_NUMBER_OPCODES)]
     mnemonics_mode = [convertMnemonicMode(opcodesList[x]) for x in range(0, TOTAL_NUMBER_OPCODES)]
@@ -0,0 +1,4491 @@
+/* Generated by buildtables.py */
+
+case 0x00: { // brk imp
+	{
+		state6502.pc++;
+		push16(state6502.pc);                 // push next instruction address onto stack
+		push8(state6502.status | FLAG_BREAK); // push CPU status to stack
+		setinterrupt();                       // set interrupt flag
+		cleardecimal();                       // clear decimal flag (65C02 change)
+		state6502.pc = (uint16_t)read6502(0xFFFE) | ((uint16_t)read6502(0xFFFF) << 8);
+	}
+	clockticks6502 += 7;
+} break;
+
+case 0x01: { // ora indx
+	{
+		uint16_t eahelp;
+		eahelp = (uint16_t)(((uint16_t)read6502(state6502.pc++) + (uint16_t)state6502.x) & 0xFF); // zero-page wraparound for table pointer
+		ea     = (uint16_t)read6502(eahelp & 0x00FF) | ((uint16_t)read6502((eahelp + 1) & 0x00FF) << 8);
+	}
+	{
+		penaltyop = 1;
+		value     = ((uint16_t)read6502(ea));
+		result    = (uint16_t)state6502.a | value;
+		zerocalc(result);
+		signcalc(result);
+		saveaccum(result);
+	}
+	clockticks6502 += 6;
+} break;
+
+case 0x02: { // nop imp
+	{
+		switch (0x02) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x03: { // nop imp
+	{
+		switch (0x03) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x04: { // tsb zp
+	{
+		ea = (uint16_t)read6502((uint16_t)state6502.pc++);
+	}
+	{
+		value  = ((uint16_t)read6502(ea));          // Read memory
+		result = (uint16_t)state6502.a & value; // calculate A & memory
+		zerocalc(result);             // Set Z flag from this.
+		result = value | state6502.a;           // Write back value read, A bits are set.
+		write6502(ea, ((result) & 0x00FF));
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0x05: { // ora zp
+	{
+		ea = (uint16_t)read6502((uint16_t)state6502.pc++);
+	}
+	{
+		penaltyop = 1;
+		value     = ((uint16_t)read6502(ea));
+		result    = (uint16_t)state6502.a | value;
+		zerocalc(result);
+		signcalc(result);
+		saveaccum(result);
+	}
+	clockticks6502 += 3;
+} break;
+
+case 0x06: { // asl zp
+	{
+		ea = (uint16_t)read6502((uint16_t)state6502.pc++);
+	}
+	{
+		value  = ((uint16_t)read6502(ea));
+		result = value << 1;
+		carrycalc(result);
+		zerocalc(result);
+		signcalc(result);
+		write6502(ea, ((result) & 0x00FF));
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0x07: { // rmb0 zp
+	{
+		ea = (uint16_t)read6502((uint16_t)state6502.pc++);
+	}
+	{
+		write6502(ea, ((((uint16_t)read6502(ea)) & ~0x01) & 0x00FF));
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0x08: { // php imp
+	{
+		push8(state6502.status | FLAG_BREAK);
+	}
+	clockticks6502 += 3;
+} break;
+
+case 0x09: { // ora imm
+	{
+		ea = state6502.pc++;
+	}
+	{
+		penaltyop = 1;
+		value     = ((uint16_t)read6502(ea));
+		result    = (uint16_t)state6502.a | value;
+		zerocalc(result);
+		signcalc(result);
+		saveaccum(result);
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x0A: { // asl acc
+	{
+		value  = ((uint16_t)state6502.a);
+		result = value << 1;
+		carrycalc(result);
+		zerocalc(result);
+		signcalc(result);
+		state6502.a = (uint8_t)((result) & 0x00FF);
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x0B: { // nop imp
+	{
+		switch (0x0B) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x0C: { // tsb abso
+	{
+		ea = (uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8);
+		state6502.pc += 2;
+	}
+	{
+		value  = ((uint16_t)read6502(ea));          // Read memory
+		result = (uint16_t)state6502.a & value; // calculate A & memory
+		zerocalc(result);             // Set Z flag from this.
+		result = value | state6502.a;           // Write back value read, A bits are set.
+		write6502(ea, ((result) & 0x00FF));
+	}
+	clockticks6502 += 6;
+} break;
+
+case 0x0D: { // ora abso
+	{
+		ea = (uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8);
+		state6502.pc += 2;
+	}
+	{
+		penaltyop = 1;
+		value     = ((uint16_t)read6502(ea));
+		result    = (uint16_t)state6502.a | value;
+		zerocalc(result);
+		signcalc(result);
+		saveaccum(result);
+	}
+	clockticks6502 += 4;
+} break;
+
+case 0x0E: { // asl abso
+	{
+		ea = (uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8);
+		state6502.pc += 2;
+	}
+	{
+		value  = ((uint16_t)read6502(ea));
+		result = value << 1;
+		carrycalc(result);
+		zerocalc(result);
+		signcalc(result);
+		write6502(ea, ((result) & 0x00FF));
+	}
+	clockticks6502 += 6;
+} break;
+
+case 0x0F: { // bbr0 zprel
+	{
+		ea      = (uint16_t)read6502(state6502.pc);
+		reladdr = (uint16_t)read6502(state6502.pc + 1);
+		if (reladdr & 0x80)
+			reladdr |= 0xFF00;
+		state6502.pc += 2;
+	}
+	{
+		{
+		const uint16_t bitmask = 0x01;
+		if ((((uint16_t)read6502(ea)) & bitmask) == 0) {
+			oldpc = state6502.pc;
+			state6502.pc += reladdr;
+			if ((oldpc & 0xFF00) != (state6502.pc & 0xFF00))
+				clockticks6502 += 2; //check if jump crossed a page boundary
+			else
+				clockticks6502++;
+		}}
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0x10: { // bpl rel
+	{
+		reladdr = (int16_t)((int8_t)read6502(state6502.pc++));
+	}
+	{
+		if ((state6502.status & FLAG_SIGN) == 0) {
+			oldpc = state6502.pc;
+			state6502.pc += reladdr;
+			if ((oldpc & 0xFF00) != (state6502.pc & 0xFF00))
+				clockticks6502 += 2; // check if jump crossed a page boundary
+			else
+				clockticks6502++;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x11: { // ora indy
+	{
+		uint16_t eahelp, eahelp2, startpage;
+		eahelp    = (uint16_t)read6502(state6502.pc++);
+		eahelp2   = (eahelp & 0xFF00) | ((eahelp + 1) & 0x00FF); //zero-page wraparound
+		ea        = (uint16_t)read6502(eahelp) | ((uint16_t)read6502(eahelp2) << 8);
+		startpage = ea & 0xFF00;
+		ea += (uint16_t)state6502.y;
+		if (startpage != (ea & 0xFF00)) { //one cycle penlty for page-crossing on some opcodes
+			penaltyaddr = 1;
+		}
+	}
+	{
+		penaltyop = 1;
+		value     = ((uint16_t)read6502(ea));
+		result    = (uint16_t)state6502.a | value;
+		zerocalc(result);
+		signcalc(result);
+		saveaccum(result);
+	}
+	clockticks6502 += 5;
+	if (penaltyop && penaltyaddr)
+		clockticks6502++;
+} break;
+
+case 0x12: { // ora ind0
+	{
+		uint16_t eahelp, eahelp2;
+		eahelp  = (uint16_t)read6502(state6502.pc++);
+		eahelp2 = (eahelp & 0xFF00) | ((eahelp + 1) & 0x00FF); //zero-page wraparound
+		ea      = (uint16_t)read6502(eahelp) | ((uint16_t)read6502(eahelp2) << 8);
+	}
+	{
+		penaltyop = 1;
+		value     = ((uint16_t)read6502(ea));
+		result    = (uint16_t)state6502.a | value;
+		zerocalc(result);
+		signcalc(result);
+		saveaccum(result);
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0x13: { // nop imp
+	{
+		switch (0x13) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x14: { // trb zp
+	{
+		ea = (uint16_t)read6502((uint16_t)state6502.pc++);
+	}
+	{
+		value  = ((uint16_t)read6502(ea));          // Read memory
+		result = (uint16_t)state6502.a & value; // calculate A & memory
+		zerocalc(result);             // Set Z flag from this.
+		result = value & (state6502.a ^ 0xFF);  // Write back value read, A bits are clear.
+		write6502(ea, ((result) & 0x00FF));
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0x15: { // ora zpx
+	{
+		ea = ((uint16_t)read6502((uint16_t)state6502.pc++) + (uint16_t)state6502.x) & 0xFF; // zero-page wraparound
+	}
+	{
+		penaltyop = 1;
+		value     = ((uint16_t)read6502(ea));
+		result    = (uint16_t)state6502.a | value;
+		zerocalc(result);
+		signcalc(result);
+		saveaccum(result);
+	}
+	clockticks6502 += 4;
+} break;
+
+case 0x16: { // asl zpx
+	{
+		ea = ((uint16_t)read6502((uint16_t)state6502.pc++) + (uint16_t)state6502.x) & 0xFF; // zero-page wraparound
+	}
+	{
+		value  = ((uint16_t)read6502(ea));
+		result = value << 1;
+		carrycalc(result);
+		zerocalc(result);
+		signcalc(result);
+		write6502(ea, ((result) & 0x00FF));
+	}
+	clockticks6502 += 6;
+} break;
+
+case 0x17: { // rmb1 zp
+	{
+		ea = (uint16_t)read6502((uint16_t)state6502.pc++);
+	}
+	{
+		write6502(ea, ((((uint16_t)read6502(ea)) & ~0x02) & 0x00FF));
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0x18: { // clc imp
+	{
+		clearcarry();
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x19: { // ora absy
+	{
+		uint16_t startpage;
+		ea        = ((uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8));
+		startpage = ea & 0xFF00;
+		ea += (uint16_t)state6502.y;
+		if (startpage != (ea & 0xFF00)) { //one cycle penlty for page-crossing on some opcodes
+			penaltyaddr = 1;
+		}
+		state6502.pc += 2;
+	}
+	{
+		penaltyop = 1;
+		value     = ((uint16_t)read6502(ea));
+		result    = (uint16_t)state6502.a | value;
+		zerocalc(result);
+		signcalc(result);
+		saveaccum(result);
+	}
+	clockticks6502 += 4;
+	if (penaltyop && penaltyaddr)
+		clockticks6502++;
+} break;
+
+case 0x1A: { // inc acc
+	{
+		value  = ((uint16_t)state6502.a);
+		result = value + 1;
+		zerocalc(result);
+		signcalc(result);
+		state6502.a = (uint8_t)((result) & 0x00FF);
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x1B: { // nop imp
+	{
+		switch (0x1B) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x1C: { // trb abso
+	{
+		ea = (uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8);
+		state6502.pc += 2;
+	}
+	{
+		value  = ((uint16_t)read6502(ea));          // Read memory
+		result = (uint16_t)state6502.a & value; // calculate A & memory
+		zerocalc(result);             // Set Z flag from this.
+		result = value & (state6502.a ^ 0xFF);  // Write back value read, A bits are clear.
+		write6502(ea, ((result) & 0x00FF));
+	}
+	clockticks6502 += 6;
+} break;
+
+case 0x1D: { // ora absx
+	{
+		uint16_t startpage;
+		ea        = ((uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8));
+		startpage = ea & 0xFF00;
+		ea += (uint16_t)state6502.x;
+		if (startpage != (ea & 0xFF00)) { //one cycle penlty for page-crossing on some opcodes
+			penaltyaddr = 1;
+		}
+		state6502.pc += 2;
+	}
+	{
+		penaltyop = 1;
+		value     = ((uint16_t)read6502(ea));
+		result    = (uint16_t)state6502.a | value;
+		zerocalc(result);
+		signcalc(result);
+		saveaccum(result);
+	}
+	clockticks6502 += 4;
+	if (penaltyop && penaltyaddr)
+		clockticks6502++;
+} break;
+
+case 0x1E: { // asl absx
+	{
+		uint16_t startpage;
+		ea        = ((uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8));
+		startpage = ea & 0xFF00;
+		ea += (uint16_t)state6502.x;
+		if (startpage != (ea & 0xFF00)) { //one cycle penlty for page-crossing on some opcodes
+			penaltyaddr = 1;
+		}
+		state6502.pc += 2;
+	}
+	{
+		value  = ((uint16_t)read6502(ea));
+		result = value << 1;
+		carrycalc(result);
+		zerocalc(result);
+		signcalc(result);
+		write6502(ea, ((result) & 0x00FF));
+	}
+	clockticks6502 += 7;
+} break;
+
+case 0x1F: { // bbr1 zprel
+	{
+		ea      = (uint16_t)read6502(state6502.pc);
+		reladdr = (uint16_t)read6502(state6502.pc + 1);
+		if (reladdr & 0x80)
+			reladdr |= 0xFF00;
+		state6502.pc += 2;
+	}
+	{
+		{
+		const uint16_t bitmask = 0x02;
+		if ((((uint16_t)read6502(ea)) & bitmask) == 0) {
+			oldpc = state6502.pc;
+			state6502.pc += reladdr;
+			if ((oldpc & 0xFF00) != (state6502.pc & 0xFF00))
+				clockticks6502 += 2; //check if jump crossed a page boundary
+			else
+				clockticks6502++;
+		}}
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0x20: { // jsr abso
+	{
+		ea = (uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8);
+		state6502.pc += 2;
+	}
+	{
+		auto &ss       = stack6502[state6502.sp_depth++];
+		ss.source_pc   = state6502.pc;
+		ss.source_bank = bank6502(state6502.pc);
+		push16(state6502.pc - 1);
+		state6502.pc = ea;
+		ss.dest_pc   = state6502.pc;
+		ss.dest_bank = bank6502(state6502.pc);
+		ss.op_type   = _stack_op_type::op;
+		ss.opcode    = 0x20;
+	}
+	clockticks6502 += 6;
+} break;
+
+case 0x21: { // and indx
+	{
+		uint16_t eahelp;
+		eahelp = (uint16_t)(((uint16_t)read6502(state6502.pc++) + (uint16_t)state6502.x) & 0xFF); // zero-page wraparound for table pointer
+		ea     = (uint16_t)read6502(eahelp & 0x00FF) | ((uint16_t)read6502((eahelp + 1) & 0x00FF) << 8);
+	}
+	{
+		penaltyop = 1;
+		value     = ((uint16_t)read6502(ea));
+		result    = (uint16_t)state6502.a & value;
+		zerocalc(result);
+		signcalc(result);
+		saveaccum(result);
+	}
+	clockticks6502 += 6;
+} break;
+
+case 0x22: { // nop imp
+	{
+		switch (0x22) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x23: { // nop imp
+	{
+		switch (0x23) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x24: { // bit zp
+	{
+		ea = (uint16_t)read6502((uint16_t)state6502.pc++);
+	}
+	{
+		value  = ((uint16_t)read6502(ea));
+		result = (uint16_t)state6502.a & value;
+		zerocalc(result);
+		state6502.status = (state6502.status & 0x3F) | (uint8_t)(value & 0xC0);
+	}
+	clockticks6502 += 3;
+} break;
+
+case 0x25: { // and zp
+	{
+		ea = (uint16_t)read6502((uint16_t)state6502.pc++);
+	}
+	{
+		penaltyop = 1;
+		value     = ((uint16_t)read6502(ea));
+		result    = (uint16_t)state6502.a & value;
+		zerocalc(result);
+		signcalc(result);
+		saveaccum(result);
+	}
+	clockticks6502 += 3;
+} break;
+
+case 0x26: { // rol zp
+	{
+		ea = (uint16_t)read6502((uint16_t)state6502.pc++);
+	}
+	{
+		value  = ((uint16_t)read6502(ea));
+		result = (value << 1) | (state6502.status & FLAG_CARRY);
+		carrycalc(result);
+		zerocalc(result);
+		signcalc(result);
+		write6502(ea, ((result) & 0x00FF));
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0x27: { // rmb2 zp
+	{
+		ea = (uint16_t)read6502((uint16_t)state6502.pc++);
+	}
+	{
+		write6502(ea, ((((uint16_t)read6502(ea)) & ~0x04) & 0x00FF));
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0x28: { // plp imp
+	{
+		state6502.status = pull8() | FLAG_CONSTANT;
+	}
+	clockticks6502 += 4;
+} break;
+
+case 0x29: { // and imm
+	{
+		ea = state6502.pc++;
+	}
+	{
+		penaltyop = 1;
+		value     = ((uint16_t)read6502(ea));
+		result    = (uint16_t)state6502.a & value;
+		zerocalc(result);
+		signcalc(result);
+		saveaccum(result);
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x2A: { // rol acc
+	{
+		value  = ((uint16_t)state6502.a);
+		result = (value << 1) | (state6502.status & FLAG_CARRY);
+		carrycalc(result);
+		zerocalc(result);
+		signcalc(result);
+		state6502.a = (uint8_t)((result) & 0x00FF);
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x2B: { // nop imp
+	{
+		switch (0x2B) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x2C: { // bit abso
+	{
+		ea = (uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8);
+		state6502.pc += 2;
+	}
+	{
+		value  = ((uint16_t)read6502(ea));
+		result = (uint16_t)state6502.a & value;
+		zerocalc(result);
+		state6502.status = (state6502.status & 0x3F) | (uint8_t)(value & 0xC0);
+	}
+	clockticks6502 += 4;
+} break;
+
+case 0x2D: { // and abso
+	{
+		ea = (uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8);
+		state6502.pc += 2;
+	}
+	{
+		penaltyop = 1;
+		value     = ((uint16_t)read6502(ea));
+		result    = (uint16_t)state6502.a & value;
+		zerocalc(result);
+		signcalc(result);
+		saveaccum(result);
+	}
+	clockticks6502 += 4;
+} break;
+
+case 0x2E: { // rol abso
+	{
+		ea = (uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8);
+		state6502.pc += 2;
+	}
+	{
+		value  = ((uint16_t)read6502(ea));
+		result = (value << 1) | (state6502.status & FLAG_CARRY);
+		carrycalc(result);
+		zerocalc(result);
+		signcalc(result);
+		write6502(ea, ((result) & 0x00FF));
+	}
+	clockticks6502 += 6;
+} break;
+
+case 0x2F: { // bbr2 zprel
+	{
+		ea      = (uint16_t)read6502(state6502.pc);
+		reladdr = (uint16_t)read6502(state6502.pc + 1);
+		if (reladdr & 0x80)
+			reladdr |= 0xFF00;
+		state6502.pc += 2;
+	}
+	{
+		{
+		const uint16_t bitmask = 0x04;
+		if ((((uint16_t)read6502(ea)) & bitmask) == 0) {
+			oldpc = state6502.pc;
+			state6502.pc += reladdr;
+			if ((oldpc & 0xFF00) != (state6502.pc & 0xFF00))
+				clockticks6502 += 2; //check if jump crossed a page boundary
+			else
+				clockticks6502++;
+		}}
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0x30: { // bmi rel
+	{
+		reladdr = (int16_t)((int8_t)read6502(state6502.pc++));
+	}
+	{
+		if ((state6502.status & FLAG_SIGN) == FLAG_SIGN) {
+			oldpc = state6502.pc;
+			state6502.pc += reladdr;
+			if ((oldpc & 0xFF00) != (state6502.pc & 0xFF00))
+				clockticks6502 += 2; // check if jump crossed a page boundary
+			else
+				clockticks6502++;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x31: { // and indy
+	{
+		uint16_t eahelp, eahelp2, startpage;
+		eahelp    = (uint16_t)read6502(state6502.pc++);
+		eahelp2   = (eahelp & 0xFF00) | ((eahelp + 1) & 0x00FF); //zero-page wraparound
+		ea        = (uint16_t)read6502(eahelp) | ((uint16_t)read6502(eahelp2) << 8);
+		startpage = ea & 0xFF00;
+		ea += (uint16_t)state6502.y;
+		if (startpage != (ea & 0xFF00)) { //one cycle penlty for page-crossing on some opcodes
+			penaltyaddr = 1;
+		}
+	}
+	{
+		penaltyop = 1;
+		value     = ((uint16_t)read6502(ea));
+		result    = (uint16_t)state6502.a & value;
+		zerocalc(result);
+		signcalc(result);
+		saveaccum(result);
+	}
+	clockticks6502 += 5;
+	if (penaltyop && penaltyaddr)
+		clockticks6502++;
+} break;
+
+case 0x32: { // and ind0
+	{
+		uint16_t eahelp, eahelp2;
+		eahelp  = (uint16_t)read6502(state6502.pc++);
+		eahelp2 = (eahelp & 0xFF00) | ((eahelp + 1) & 0x00FF); //zero-page wraparound
+		ea      = (uint16_t)read6502(eahelp) | ((uint16_t)read6502(eahelp2) << 8);
+	}
+	{
+		penaltyop = 1;
+		value     = ((uint16_t)read6502(ea));
+		result    = (uint16_t)state6502.a & value;
+		zerocalc(result);
+		signcalc(result);
+		saveaccum(result);
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0x33: { // nop imp
+	{
+		switch (0x33) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x34: { // bit zpx
+	{
+		ea = ((uint16_t)read6502((uint16_t)state6502.pc++) + (uint16_t)state6502.x) & 0xFF; // zero-page wraparound
+	}
+	{
+		value  = ((uint16_t)read6502(ea));
+		result = (uint16_t)state6502.a & value;
+		zerocalc(result);
+		state6502.status = (state6502.status & 0x3F) | (uint8_t)(value & 0xC0);
+	}
+	clockticks6502 += 4;
+} break;
+
+case 0x35: { // and zpx
+	{
+		ea = ((uint16_t)read6502((uint16_t)state6502.pc++) + (uint16_t)state6502.x) & 0xFF; // zero-page wraparound
+	}
+	{
+		penaltyop = 1;
+		value     = ((uint16_t)read6502(ea));
+		result    = (uint16_t)state6502.a & value;
+		zerocalc(result);
+		signcalc(result);
+		saveaccum(result);
+	}
+	clockticks6502 += 4;
+} break;
+
+case 0x36: { // rol zpx
+	{
+		ea = ((uint16_t)read6502((uint16_t)state6502.pc++) + (uint16_t)state6502.x) & 0xFF; // zero-page wraparound
+	}
+	{
+		value  = ((uint16_t)read6502(ea));
+		result = (value << 1) | (state6502.status & FLAG_CARRY);
+		carrycalc(result);
+		zerocalc(result);
+		signcalc(result);
+		write6502(ea, ((result) & 0x00FF));
+	}
+	clockticks6502 += 6;
+} break;
+
+case 0x37: { // rmb3 zp
+	{
+		ea = (uint16_t)read6502((uint16_t)state6502.pc++);
+	}
+	{
+		write6502(ea, ((((uint16_t)read6502(ea)) & ~0x08) & 0x00FF));
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0x38: { // sec imp
+	{
+		setcarry();
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x39: { // and absy
+	{
+		uint16_t startpage;
+		ea        = ((uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8));
+		startpage = ea & 0xFF00;
+		ea += (uint16_t)state6502.y;
+		if (startpage != (ea & 0xFF00)) { //one cycle penlty for page-crossing on some opcodes
+			penaltyaddr = 1;
+		}
+		state6502.pc += 2;
+	}
+	{
+		penaltyop = 1;
+		value     = ((uint16_t)read6502(ea));
+		result    = (uint16_t)state6502.a & value;
+		zerocalc(result);
+		signcalc(result);
+		saveaccum(result);
+	}
+	clockticks6502 += 4;
+	if (penaltyop && penaltyaddr)
+		clockticks6502++;
+} break;
+
+case 0x3A: { // dec acc
+	{
+		value  = ((uint16_t)state6502.a);
+		result = value - 1;
+		zerocalc(result);
+		signcalc(result);
+		state6502.a = (uint8_t)((result) & 0x00FF);
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x3B: { // nop imp
+	{
+		switch (0x3B) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x3C: { // bit absx
+	{
+		uint16_t startpage;
+		ea        = ((uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8));
+		startpage = ea & 0xFF00;
+		ea += (uint16_t)state6502.x;
+		if (startpage != (ea & 0xFF00)) { //one cycle penlty for page-crossing on some opcodes
+			penaltyaddr = 1;
+		}
+		state6502.pc += 2;
+	}
+	{
+		value  = ((uint16_t)read6502(ea));
+		result = (uint16_t)state6502.a & value;
+		zerocalc(result);
+		state6502.status = (state6502.status & 0x3F) | (uint8_t)(value & 0xC0);
+	}
+	clockticks6502 += 4;
+} break;
+
+case 0x3D: { // and absx
+	{
+		uint16_t startpage;
+		ea        = ((uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8));
+		startpage = ea & 0xFF00;
+		ea += (uint16_t)state6502.x;
+		if (startpage != (ea & 0xFF00)) { //one cycle penlty for page-crossing on some opcodes
+			penaltyaddr = 1;
+		}
+		state6502.pc += 2;
+	}
+	{
+		penaltyop = 1;
+		value     = ((uint16_t)read6502(ea));
+		result    = (uint16_t)state6502.a & value;
+		zerocalc(result);
+		signcalc(result);
+		saveaccum(result);
+	}
+	clockticks6502 += 4;
+	if (penaltyop && penaltyaddr)
+		clockticks6502++;
+} break;
+
+case 0x3E: { // rol absx
+	{
+		uint16_t startpage;
+		ea        = ((uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8));
+		startpage = ea & 0xFF00;
+		ea += (uint16_t)state6502.x;
+		if (startpage != (ea & 0xFF00)) { //one cycle penlty for page-crossing on some opcodes
+			penaltyaddr = 1;
+		}
+		state6502.pc += 2;
+	}
+	{
+		value  = ((uint16_t)read6502(ea));
+		result = (value << 1) | (state6502.status & FLAG_CARRY);
+		carrycalc(result);
+		zerocalc(result);
+		signcalc(result);
+		write6502(ea, ((result) & 0x00FF));
+	}
+	clockticks6502 += 7;
+} break;
+
+case 0x3F: { // bbr3 zprel
+	{
+		ea      = (uint16_t)read6502(state6502.pc);
+		reladdr = (uint16_t)read6502(state6502.pc + 1);
+		if (reladdr & 0x80)
+			reladdr |= 0xFF00;
+		state6502.pc += 2;
+	}
+	{
+		{
+		const uint16_t bitmask = 0x08;
+		if ((((uint16_t)read6502(ea)) & bitmask) == 0) {
+			oldpc = state6502.pc;
+			state6502.pc += reladdr;
+			if ((oldpc & 0xFF00) != (state6502.pc & 0xFF00))
+				clockticks6502 += 2; //check if jump crossed a page boundary
+			else
+				clockticks6502++;
+		}}
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0x40: { // rti imp
+	{
+		state6502.status = pull8();
+		value            = pull16();
+		state6502.pc     = value;
+		state6502.sp_depth -= !!state6502.sp_depth;
+	}
+	clockticks6502 += 6;
+} break;
+
+case 0x41: { // eor indx
+	{
+		uint16_t eahelp;
+		eahelp = (uint16_t)(((uint16_t)read6502(state6502.pc++) + (uint16_t)state6502.x) & 0xFF); // zero-page wraparound for table pointer
+		ea     = (uint16_t)read6502(eahelp & 0x00FF) | ((uint16_t)read6502((eahelp + 1) & 0x00FF) << 8);
+	}
+	{
+		penaltyop = 1;
+		value     = ((uint16_t)read6502(ea));
+		result    = (uint16_t)state6502.a ^ value;
+		zerocalc(result);
+		signcalc(result);
+		saveaccum(result);
+	}
+	clockticks6502 += 6;
+} break;
+
+case 0x42: { // nop imp
+	{
+		switch (0x42) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x43: { // nop imp
+	{
+		switch (0x43) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x44: { // nop imp
+	{
+		switch (0x44) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x45: { // eor zp
+	{
+		ea = (uint16_t)read6502((uint16_t)state6502.pc++);
+	}
+	{
+		penaltyop = 1;
+		value     = ((uint16_t)read6502(ea));
+		result    = (uint16_t)state6502.a ^ value;
+		zerocalc(result);
+		signcalc(result);
+		saveaccum(result);
+	}
+	clockticks6502 += 3;
+} break;
+
+case 0x46: { // lsr zp
+	{
+		ea = (uint16_t)read6502((uint16_t)state6502.pc++);
+	}
+	{
+		value  = ((uint16_t)read6502(ea));
+		result = value >> 1;
+		if (value & 1)
+			setcarry();
+		else
+			clearcarry();
+		zerocalc(result);
+		signcalc(result);
+		write6502(ea, ((result) & 0x00FF));
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0x47: { // rmb4 zp
+	{
+		ea = (uint16_t)read6502((uint16_t)state6502.pc++);
+	}
+	{
+		write6502(ea, ((((uint16_t)read6502(ea)) & ~0x10) & 0x00FF));
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0x48: { // pha imp
+	{
+		push8(state6502.a);
+	}
+	clockticks6502 += 3;
+} break;
+
+case 0x49: { // eor imm
+	{
+		ea = state6502.pc++;
+	}
+	{
+		penaltyop = 1;
+		value     = ((uint16_t)read6502(ea));
+		result    = (uint16_t)state6502.a ^ value;
+		zerocalc(result);
+		signcalc(result);
+		saveaccum(result);
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x4A: { // lsr acc
+	{
+		value  = ((uint16_t)state6502.a);
+		result = value >> 1;
+		if (value & 1)
+			setcarry();
+		else
+			clearcarry();
+		zerocalc(result);
+		signcalc(result);
+		state6502.a = (uint8_t)((result) & 0x00FF);
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x4B: { // nop imp
+	{
+		switch (0x4B) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x4C: { // jmp abso
+	{
+		ea = (uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8);
+		state6502.pc += 2;
+	}
+	{
+		state6502.pc = ea;
+	}
+	clockticks6502 += 3;
+} break;
+
+case 0x4D: { // eor abso
+	{
+		ea = (uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8);
+		state6502.pc += 2;
+	}
+	{
+		penaltyop = 1;
+		value     = ((uint16_t)read6502(ea));
+		result    = (uint16_t)state6502.a ^ value;
+		zerocalc(result);
+		signcalc(result);
+		saveaccum(result);
+	}
+	clockticks6502 += 4;
+} break;
+
+case 0x4E: { // lsr abso
+	{
+		ea = (uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8);
+		state6502.pc += 2;
+	}
+	{
+		value  = ((uint16_t)read6502(ea));
+		result = value >> 1;
+		if (value & 1)
+			setcarry();
+		else
+			clearcarry();
+		zerocalc(result);
+		signcalc(result);
+		write6502(ea, ((result) & 0x00FF));
+	}
+	clockticks6502 += 6;
+} break;
+
+case 0x4F: { // bbr4 zprel
+	{
+		ea      = (uint16_t)read6502(state6502.pc);
+		reladdr = (uint16_t)read6502(state6502.pc + 1);
+		if (reladdr & 0x80)
+			reladdr |= 0xFF00;
+		state6502.pc += 2;
+	}
+	{
+		{
+		const uint16_t bitmask = 0x10;
+		if ((((uint16_t)read6502(ea)) & bitmask) == 0) {
+			oldpc = state6502.pc;
+			state6502.pc += reladdr;
+			if ((oldpc & 0xFF00) != (state6502.pc & 0xFF00))
+				clockticks6502 += 2; //check if jump crossed a page boundary
+			else
+				clockticks6502++;
+		}}
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0x50: { // bvc rel
+	{
+		reladdr = (int16_t)((int8_t)read6502(state6502.pc++));
+	}
+	{
+		if ((state6502.status & FLAG_OVERFLOW) == 0) {
+			oldpc = state6502.pc;
+			state6502.pc += reladdr;
+			if ((oldpc & 0xFF00) != (state6502.pc & 0xFF00))
+				clockticks6502 += 2; // check if jump crossed a page boundary
+			else
+				clockticks6502++;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x51: { // eor indy
+	{
+		uint16_t eahelp, eahelp2, startpage;
+		eahelp    = (uint16_t)read6502(state6502.pc++);
+		eahelp2   = (eahelp & 0xFF00) | ((eahelp + 1) & 0x00FF); //zero-page wraparound
+		ea        = (uint16_t)read6502(eahelp) | ((uint16_t)read6502(eahelp2) << 8);
+		startpage = ea & 0xFF00;
+		ea += (uint16_t)state6502.y;
+		if (startpage != (ea & 0xFF00)) { //one cycle penlty for page-crossing on some opcodes
+			penaltyaddr = 1;
+		}
+	}
+	{
+		penaltyop = 1;
+		value     = ((uint16_t)read6502(ea));
+		result    = (uint16_t)state6502.a ^ value;
+		zerocalc(result);
+		signcalc(result);
+		saveaccum(result);
+	}
+	clockticks6502 += 5;
+	if (penaltyop && penaltyaddr)
+		clockticks6502++;
+} break;
+
+case 0x52: { // eor ind0
+	{
+		uint16_t eahelp, eahelp2;
+		eahelp  = (uint16_t)read6502(state6502.pc++);
+		eahelp2 = (eahelp & 0xFF00) | ((eahelp + 1) & 0x00FF); //zero-page wraparound
+		ea      = (uint16_t)read6502(eahelp) | ((uint16_t)read6502(eahelp2) << 8);
+	}
+	{
+		penaltyop = 1;
+		value     = ((uint16_t)read6502(ea));
+		result    = (uint16_t)state6502.a ^ value;
+		zerocalc(result);
+		signcalc(result);
+		saveaccum(result);
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0x53: { // nop imp
+	{
+		switch (0x53) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x54: { // nop imp
+	{
+		switch (0x54) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x55: { // eor zpx
+	{
+		ea = ((uint16_t)read6502((uint16_t)state6502.pc++) + (uint16_t)state6502.x) & 0xFF; // zero-page wraparound
+	}
+	{
+		penaltyop = 1;
+		value     = ((uint16_t)read6502(ea));
+		result    = (uint16_t)state6502.a ^ value;
+		zerocalc(result);
+		signcalc(result);
+		saveaccum(result);
+	}
+	clockticks6502 += 4;
+} break;
+
+case 0x56: { // lsr zpx
+	{
+		ea = ((uint16_t)read6502((uint16_t)state6502.pc++) + (uint16_t)state6502.x) & 0xFF; // zero-page wraparound
+	}
+	{
+		value  = ((uint16_t)read6502(ea));
+		result = value >> 1;
+		if (value & 1)
+			setcarry();
+		else
+			clearcarry();
+		zerocalc(result);
+		signcalc(result);
+		write6502(ea, ((result) & 0x00FF));
+	}
+	clockticks6502 += 6;
+} break;
+
+case 0x57: { // rmb5 zp
+	{
+		ea = (uint16_t)read6502((uint16_t)state6502.pc++);
+	}
+	{
+		write6502(ea, ((((uint16_t)read6502(ea)) & ~0x20) & 0x00FF));
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0x58: { // cli imp
+	{
+		clearinterrupt();
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x59: { // eor absy
+	{
+		uint16_t startpage;
+		ea        = ((uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8));
+		startpage = ea & 0xFF00;
+		ea += (uint16_t)state6502.y;
+		if (startpage != (ea & 0xFF00)) { //one cycle penlty for page-crossing on some opcodes
+			penaltyaddr = 1;
+		}
+		state6502.pc += 2;
+	}
+	{
+		penaltyop = 1;
+		value     = ((uint16_t)read6502(ea));
+		result    = (uint16_t)state6502.a ^ value;
+		zerocalc(result);
+		signcalc(result);
+		saveaccum(result);
+	}
+	clockticks6502 += 4;
+	if (penaltyop && penaltyaddr)
+		clockticks6502++;
+} break;
+
+case 0x5A: { // phy imp
+	{
+		push8(state6502.y);
+	}
+	clockticks6502 += 3;
+} break;
+
+case 0x5B: { // nop imp
+	{
+		switch (0x5B) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x5C: { // nop imp
+	{
+		switch (0x5C) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x5D: { // eor absx
+	{
+		uint16_t startpage;
+		ea        = ((uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8));
+		startpage = ea & 0xFF00;
+		ea += (uint16_t)state6502.x;
+		if (startpage != (ea & 0xFF00)) { //one cycle penlty for page-crossing on some opcodes
+			penaltyaddr = 1;
+		}
+		state6502.pc += 2;
+	}
+	{
+		penaltyop = 1;
+		value     = ((uint16_t)read6502(ea));
+		result    = (uint16_t)state6502.a ^ value;
+		zerocalc(result);
+		signcalc(result);
+		saveaccum(result);
+	}
+	clockticks6502 += 4;
+	if (penaltyop && penaltyaddr)
+		clockticks6502++;
+} break;
+
+case 0x5E: { // lsr absx
+	{
+		uint16_t startpage;
+		ea        = ((uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8));
+		startpage = ea & 0xFF00;
+		ea += (uint16_t)state6502.x;
+		if (startpage != (ea & 0xFF00)) { //one cycle penlty for page-crossing on some opcodes
+			penaltyaddr = 1;
+		}
+		state6502.pc += 2;
+	}
+	{
+		value  = ((uint16_t)read6502(ea));
+		result = value >> 1;
+		if (value & 1)
+			setcarry();
+		else
+			clearcarry();
+		zerocalc(result);
+		signcalc(result);
+		write6502(ea, ((result) & 0x00FF));
+	}
+	clockticks6502 += 7;
+} break;
+
+case 0x5F: { // bbr5 zprel
+	{
+		ea      = (uint16_t)read6502(state6502.pc);
+		reladdr = (uint16_t)read6502(state6502.pc + 1);
+		if (reladdr & 0x80)
+			reladdr |= 0xFF00;
+		state6502.pc += 2;
+	}
+	{
+		{
+		const uint16_t bitmask = 0x20;
+		if ((((uint16_t)read6502(ea)) & bitmask) == 0) {
+			oldpc = state6502.pc;
+			state6502.pc += reladdr;
+			if ((oldpc & 0xFF00) != (state6502.pc & 0xFF00))
+				clockticks6502 += 2; //check if jump crossed a page boundary
+			else
+				clockticks6502++;
+		}}
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0x60: { // rts imp
+	{
+		value        = pull16();
+		state6502.pc = value + 1;
+		state6502.sp_depth -= !!state6502.sp_depth;
+	}
+	clockticks6502 += 6;
+} break;
+
+case 0x61: { // adc indx
+	{
+		uint16_t eahelp;
+		eahelp = (uint16_t)(((uint16_t)read6502(state6502.pc++) + (uint16_t)state6502.x) & 0xFF); // zero-page wraparound for table pointer
+		ea     = (uint16_t)read6502(eahelp & 0x00FF) | ((uint16_t)read6502((eahelp + 1) & 0x00FF) << 8);
+	}
+	{
+		penaltyop = 1;
+		if (state6502.status & FLAG_DECIMAL) {
+			uint16_t tmp, tmp2;
+			value = ((uint16_t)read6502(ea));
+			tmp   = ((uint16_t)state6502.a & 0x0F) + (value & 0x0F) + (uint16_t)(state6502.status & FLAG_CARRY);
+			tmp2  = ((uint16_t)state6502.a & 0xF0) + (value & 0xF0);
+			if (tmp > 0x09) {
+				tmp2 += 0x10;
+				tmp += 0x06;
+			}
+			if (tmp2 > 0x90) {
+				tmp2 += 0x60;
+			}
+			if (tmp2 & 0xFF00) {
+				setcarry();
+			} else {
+				clearcarry();
+			}
+			result = (tmp & 0x0F) | (tmp2 & 0xF0);
+			zerocalc(result); /* 65C02 change, Decimal Arithmetic sets NZV */
+			signcalc(result);
+			clockticks6502++;
+		} else {
+			value  = ((uint16_t)read6502(ea));
+			result = (uint16_t)state6502.a + value + (uint16_t)(state6502.status & FLAG_CARRY);
+			carrycalc(result);
+			zerocalc(result);
+			overflowcalc(result, state6502.a, value);
+			signcalc(result);
+		}
+		saveaccum(result);
+	}
+	clockticks6502 += 6;
+} break;
+
+case 0x62: { // nop imp
+	{
+		switch (0x62) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x63: { // nop imp
+	{
+		switch (0x63) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x64: { // stz zp
+	{
+		ea = (uint16_t)read6502((uint16_t)state6502.pc++);
+	}
+	{
+		write6502(ea, ((0) & 0x00FF));
+	}
+	clockticks6502 += 3;
+} break;
+
+case 0x65: { // adc zp
+	{
+		ea = (uint16_t)read6502((uint16_t)state6502.pc++);
+	}
+	{
+		penaltyop = 1;
+		if (state6502.status & FLAG_DECIMAL) {
+			uint16_t tmp, tmp2;
+			value = ((uint16_t)read6502(ea));
+			tmp   = ((uint16_t)state6502.a & 0x0F) + (value & 0x0F) + (uint16_t)(state6502.status & FLAG_CARRY);
+			tmp2  = ((uint16_t)state6502.a & 0xF0) + (value & 0xF0);
+			if (tmp > 0x09) {
+				tmp2 += 0x10;
+				tmp += 0x06;
+			}
+			if (tmp2 > 0x90) {
+				tmp2 += 0x60;
+			}
+			if (tmp2 & 0xFF00) {
+				setcarry();
+			} else {
+				clearcarry();
+			}
+			result = (tmp & 0x0F) | (tmp2 & 0xF0);
+			zerocalc(result); /* 65C02 change, Decimal Arithmetic sets NZV */
+			signcalc(result);
+			clockticks6502++;
+		} else {
+			value  = ((uint16_t)read6502(ea));
+			result = (uint16_t)state6502.a + value + (uint16_t)(state6502.status & FLAG_CARRY);
+			carrycalc(result);
+			zerocalc(result);
+			overflowcalc(result, state6502.a, value);
+			signcalc(result);
+		}
+		saveaccum(result);
+	}
+	clockticks6502 += 3;
+} break;
+
+case 0x66: { // ror zp
+	{
+		ea = (uint16_t)read6502((uint16_t)state6502.pc++);
+	}
+	{
+		value  = ((uint16_t)read6502(ea));
+		result = (value >> 1) | ((state6502.status & FLAG_CARRY) << 7);
+		if (value & 1)
+			setcarry();
+		else
+			clearcarry();
+		zerocalc(result);
+		signcalc(result);
+		write6502(ea, ((result) & 0x00FF));
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0x67: { // rmb6 zp
+	{
+		ea = (uint16_t)read6502((uint16_t)state6502.pc++);
+	}
+	{
+		write6502(ea, ((((uint16_t)read6502(ea)) & ~0x40) & 0x00FF));
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0x68: { // pla imp
+	{
+		state6502.a = pull8();
+		zerocalc(state6502.a);
+		signcalc(state6502.a);
+	}
+	clockticks6502 += 4;
+} break;
+
+case 0x69: { // adc imm
+	{
+		ea = state6502.pc++;
+	}
+	{
+		penaltyop = 1;
+		if (state6502.status & FLAG_DECIMAL) {
+			uint16_t tmp, tmp2;
+			value = ((uint16_t)read6502(ea));
+			tmp   = ((uint16_t)state6502.a & 0x0F) + (value & 0x0F) + (uint16_t)(state6502.status & FLAG_CARRY);
+			tmp2  = ((uint16_t)state6502.a & 0xF0) + (value & 0xF0);
+			if (tmp > 0x09) {
+				tmp2 += 0x10;
+				tmp += 0x06;
+			}
+			if (tmp2 > 0x90) {
+				tmp2 += 0x60;
+			}
+			if (tmp2 & 0xFF00) {
+				setcarry();
+			} else {
+				clearcarry();
+			}
+			result = (tmp & 0x0F) | (tmp2 & 0xF0);
+			zerocalc(result); /* 65C02 change, Decimal Arithmetic sets NZV */
+			signcalc(result);
+			clockticks6502++;
+		} else {
+			value  = ((uint16_t)read6502(ea));
+			result = (uint16_t)state6502.a + value + (uint16_t)(state6502.status & FLAG_CARRY);
+			carrycalc(result);
+			zerocalc(result);
+			overflowcalc(result, state6502.a, value);
+			signcalc(result);
+		}
+		saveaccum(result);
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x6A: { // ror acc
+	{
+		value  = ((uint16_t)state6502.a);
+		result = (value >> 1) | ((state6502.status & FLAG_CARRY) << 7);
+		if (value & 1)
+			setcarry();
+		else
+			clearcarry();
+		zerocalc(result);
+		signcalc(result);
+		state6502.a = (uint8_t)((result) & 0x00FF);
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x6B: { // nop imp
+	{
+		switch (0x6B) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x6C: { // jmp ind
+	{
+		uint16_t eahelp, eahelp2;
+		eahelp = (uint16_t)read6502(state6502.pc) | (uint16_t)((uint16_t)read6502(state6502.pc + 1) << 8);
+		//
+		//      The 6502 page boundary wraparound bug does not occur on a 65C02.
+		//
+		//eahelp2 = (eahelp & 0xFF00) | ((eahelp + 1) & 0x00FF); //replicate 6502 page-boundary wraparound bug
+		eahelp2 = (eahelp + 1) & 0xFFFF;
+		ea      = (uint16_t)read6502(eahelp) | ((uint16_t)read6502(eahelp2) << 8);
+		state6502.pc += 2;
+	}
+	{
+		state6502.pc = ea;
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0x6D: { // adc abso
+	{
+		ea = (uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8);
+		state6502.pc += 2;
+	}
+	{
+		penaltyop = 1;
+		if (state6502.status & FLAG_DECIMAL) {
+			uint16_t tmp, tmp2;
+			value = ((uint16_t)read6502(ea));
+			tmp   = ((uint16_t)state6502.a & 0x0F) + (value & 0x0F) + (uint16_t)(state6502.status & FLAG_CARRY);
+			tmp2  = ((uint16_t)state6502.a & 0xF0) + (value & 0xF0);
+			if (tmp > 0x09) {
+				tmp2 += 0x10;
+				tmp += 0x06;
+			}
+			if (tmp2 > 0x90) {
+				tmp2 += 0x60;
+			}
+			if (tmp2 & 0xFF00) {
+				setcarry();
+			} else {
+				clearcarry();
+			}
+			result = (tmp & 0x0F) | (tmp2 & 0xF0);
+			zerocalc(result); /* 65C02 change, Decimal Arithmetic sets NZV */
+			signcalc(result);
+			clockticks6502++;
+		} else {
+			value  = ((uint16_t)read6502(ea));
+			result = (uint16_t)state6502.a + value + (uint16_t)(state6502.status & FLAG_CARRY);
+			carrycalc(result);
+			zerocalc(result);
+			overflowcalc(result, state6502.a, value);
+			signcalc(result);
+		}
+		saveaccum(result);
+	}
+	clockticks6502 += 4;
+} break;
+
+case 0x6E: { // ror abso
+	{
+		ea = (uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8);
+		state6502.pc += 2;
+	}
+	{
+		value  = ((uint16_t)read6502(ea));
+		result = (value >> 1) | ((state6502.status & FLAG_CARRY) << 7);
+		if (value & 1)
+			setcarry();
+		else
+			clearcarry();
+		zerocalc(result);
+		signcalc(result);
+		write6502(ea, ((result) & 0x00FF));
+	}
+	clockticks6502 += 6;
+} break;
+
+case 0x6F: { // bbr6 zprel
+	{
+		ea      = (uint16_t)read6502(state6502.pc);
+		reladdr = (uint16_t)read6502(state6502.pc + 1);
+		if (reladdr & 0x80)
+			reladdr |= 0xFF00;
+		state6502.pc += 2;
+	}
+	{
+		{
+		const uint16_t bitmask = 0x40;
+		if ((((uint16_t)read6502(ea)) & bitmask) == 0) {
+			oldpc = state6502.pc;
+			state6502.pc += reladdr;
+			if ((oldpc & 0xFF00) != (state6502.pc & 0xFF00))
+				clockticks6502 += 2; //check if jump crossed a page boundary
+			else
+				clockticks6502++;
+		}}
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0x70: { // bvs rel
+	{
+		reladdr = (int16_t)((int8_t)read6502(state6502.pc++));
+	}
+	{
+		if ((state6502.status & FLAG_OVERFLOW) == FLAG_OVERFLOW) {
+			oldpc = state6502.pc;
+			state6502.pc += reladdr;
+			if ((oldpc & 0xFF00) != (state6502.pc & 0xFF00))
+				clockticks6502 += 2; // check if jump crossed a page boundary
+			else
+				clockticks6502++;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x71: { // adc indy
+	{
+		uint16_t eahelp, eahelp2, startpage;
+		eahelp    = (uint16_t)read6502(state6502.pc++);
+		eahelp2   = (eahelp & 0xFF00) | ((eahelp + 1) & 0x00FF); //zero-page wraparound
+		ea        = (uint16_t)read6502(eahelp) | ((uint16_t)read6502(eahelp2) << 8);
+		startpage = ea & 0xFF00;
+		ea += (uint16_t)state6502.y;
+		if (startpage != (ea & 0xFF00)) { //one cycle penlty for page-crossing on some opcodes
+			penaltyaddr = 1;
+		}
+	}
+	{
+		penaltyop = 1;
+		if (state6502.status & FLAG_DECIMAL) {
+			uint16_t tmp, tmp2;
+			value = ((uint16_t)read6502(ea));
+			tmp   = ((uint16_t)state6502.a & 0x0F) + (value & 0x0F) + (uint16_t)(state6502.status & FLAG_CARRY);
+			tmp2  = ((uint16_t)state6502.a & 0xF0) + (value & 0xF0);
+			if (tmp > 0x09) {
+				tmp2 += 0x10;
+				tmp += 0x06;
+			}
+			if (tmp2 > 0x90) {
+				tmp2 += 0x60;
+			}
+			if (tmp2 & 0xFF00) {
+				setcarry();
+			} else {
+				clearcarry();
+			}
+			result = (tmp & 0x0F) | (tmp2 & 0xF0);
+			zerocalc(result); /* 65C02 change, Decimal Arithmetic sets NZV */
+			signcalc(result);
+			clockticks6502++;
+		} else {
+			value  = ((uint16_t)read6502(ea));
+			result = (uint16_t)state6502.a + value + (uint16_t)(state6502.status & FLAG_CARRY);
+			carrycalc(result);
+			zerocalc(result);
+			overflowcalc(result, state6502.a, value);
+			signcalc(result);
+		}
+		saveaccum(result);
+	}
+	clockticks6502 += 5;
+	if (penaltyop && penaltyaddr)
+		clockticks6502++;
+} break;
+
+case 0x72: { // adc ind0
+	{
+		uint16_t eahelp, eahelp2;
+		eahelp  = (uint16_t)read6502(state6502.pc++);
+		eahelp2 = (eahelp & 0xFF00) | ((eahelp + 1) & 0x00FF); //zero-page wraparound
+		ea      = (uint16_t)read6502(eahelp) | ((uint16_t)read6502(eahelp2) << 8);
+	}
+	{
+		penaltyop = 1;
+		if (state6502.status & FLAG_DECIMAL) {
+			uint16_t tmp, tmp2;
+			value = ((uint16_t)read6502(ea));
+			tmp   = ((uint16_t)state6502.a & 0x0F) + (value & 0x0F) + (uint16_t)(state6502.status & FLAG_CARRY);
+			tmp2  = ((uint16_t)state6502.a & 0xF0) + (value & 0xF0);
+			if (tmp > 0x09) {
+				tmp2 += 0x10;
+				tmp += 0x06;
+			}
+			if (tmp2 > 0x90) {
+				tmp2 += 0x60;
+			}
+			if (tmp2 & 0xFF00) {
+				setcarry();
+			} else {
+				clearcarry();
+			}
+			result = (tmp & 0x0F) | (tmp2 & 0xF0);
+			zerocalc(result); /* 65C02 change, Decimal Arithmetic sets NZV */
+			signcalc(result);
+			clockticks6502++;
+		} else {
+			value  = ((uint16_t)read6502(ea));
+			result = (uint16_t)state6502.a + value + (uint16_t)(state6502.status & FLAG_CARRY);
+			carrycalc(result);
+			zerocalc(result);
+			overflowcalc(result, state6502.a, value);
+			signcalc(result);
+		}
+		saveaccum(result);
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0x73: { // nop imp
+	{
+		switch (0x73) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x74: { // stz zpx
+	{
+		ea = ((uint16_t)read6502((uint16_t)state6502.pc++) + (uint16_t)state6502.x) & 0xFF; // zero-page wraparound
+	}
+	{
+		write6502(ea, ((0) & 0x00FF));
+	}
+	clockticks6502 += 4;
+} break;
+
+case 0x75: { // adc zpx
+	{
+		ea = ((uint16_t)read6502((uint16_t)state6502.pc++) + (uint16_t)state6502.x) & 0xFF; // zero-page wraparound
+	}
+	{
+		penaltyop = 1;
+		if (state6502.status & FLAG_DECIMAL) {
+			uint16_t tmp, tmp2;
+			value = ((uint16_t)read6502(ea));
+			tmp   = ((uint16_t)state6502.a & 0x0F) + (value & 0x0F) + (uint16_t)(state6502.status & FLAG_CARRY);
+			tmp2  = ((uint16_t)state6502.a & 0xF0) + (value & 0xF0);
+			if (tmp > 0x09) {
+				tmp2 += 0x10;
+				tmp += 0x06;
+			}
+			if (tmp2 > 0x90) {
+				tmp2 += 0x60;
+			}
+			if (tmp2 & 0xFF00) {
+				setcarry();
+			} else {
+				clearcarry();
+			}
+			result = (tmp & 0x0F) | (tmp2 & 0xF0);
+			zerocalc(result); /* 65C02 change, Decimal Arithmetic sets NZV */
+			signcalc(result);
+			clockticks6502++;
+		} else {
+			value  = ((uint16_t)read6502(ea));
+			result = (uint16_t)state6502.a + value + (uint16_t)(state6502.status & FLAG_CARRY);
+			carrycalc(result);
+			zerocalc(result);
+			overflowcalc(result, state6502.a, value);
+			signcalc(result);
+		}
+		saveaccum(result);
+	}
+	clockticks6502 += 4;
+} break;
+
+case 0x76: { // ror zpx
+	{
+		ea = ((uint16_t)read6502((uint16_t)state6502.pc++) + (uint16_t)state6502.x) & 0xFF; // zero-page wraparound
+	}
+	{
+		value  = ((uint16_t)read6502(ea));
+		result = (value >> 1) | ((state6502.status & FLAG_CARRY) << 7);
+		if (value & 1)
+			setcarry();
+		else
+			clearcarry();
+		zerocalc(result);
+		signcalc(result);
+		write6502(ea, ((result) & 0x00FF));
+	}
+	clockticks6502 += 6;
+} break;
+
+case 0x77: { // rmb7 zp
+	{
+		ea = (uint16_t)read6502((uint16_t)state6502.pc++);
+	}
+	{
+		write6502(ea, ((((uint16_t)read6502(ea)) & ~0x80) & 0x00FF));
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0x78: { // sei imp
+	{
+		setinterrupt();
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x79: { // adc absy
+	{
+		uint16_t startpage;
+		ea        = ((uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8));
+		startpage = ea & 0xFF00;
+		ea += (uint16_t)state6502.y;
+		if (startpage != (ea & 0xFF00)) { //one cycle penlty for page-crossing on some opcodes
+			penaltyaddr = 1;
+		}
+		state6502.pc += 2;
+	}
+	{
+		penaltyop = 1;
+		if (state6502.status & FLAG_DECIMAL) {
+			uint16_t tmp, tmp2;
+			value = ((uint16_t)read6502(ea));
+			tmp   = ((uint16_t)state6502.a & 0x0F) + (value & 0x0F) + (uint16_t)(state6502.status & FLAG_CARRY);
+			tmp2  = ((uint16_t)state6502.a & 0xF0) + (value & 0xF0);
+			if (tmp > 0x09) {
+				tmp2 += 0x10;
+				tmp += 0x06;
+			}
+			if (tmp2 > 0x90) {
+				tmp2 += 0x60;
+			}
+			if (tmp2 & 0xFF00) {
+				setcarry();
+			} else {
+				clearcarry();
+			}
+			result = (tmp & 0x0F) | (tmp2 & 0xF0);
+			zerocalc(result); /* 65C02 change, Decimal Arithmetic sets NZV */
+			signcalc(result);
+			clockticks6502++;
+		} else {
+			value  = ((uint16_t)read6502(ea));
+			result = (uint16_t)state6502.a + value + (uint16_t)(state6502.status & FLAG_CARRY);
+			carrycalc(result);
+			zerocalc(result);
+			overflowcalc(result, state6502.a, value);
+			signcalc(result);
+		}
+		saveaccum(result);
+	}
+	clockticks6502 += 4;
+	if (penaltyop && penaltyaddr)
+		clockticks6502++;
+} break;
+
+case 0x7A: { // ply imp
+	{
+		state6502.y = pull8();
+		zerocalc(state6502.y);
+		signcalc(state6502.y);
+	}
+	clockticks6502 += 4;
+} break;
+
+case 0x7B: { // nop imp
+	{
+		switch (0x7B) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x7C: { // jmp ainx
+	{
+		uint16_t eahelp, eahelp2;
+		eahelp = (uint16_t)read6502(state6502.pc) | (uint16_t)((uint16_t)read6502(state6502.pc + 1) << 8);
+		eahelp = (eahelp + (uint16_t)state6502.x) & 0xFFFF;
+#if 0
+	    eahelp2 = (eahelp & 0xFF00) | ((eahelp + 1) & 0x00FF); //replicate 6502 page-boundary wraparound bug
+#else
+		eahelp2 = eahelp + 1; // the 65c02 doesn't have the bug
+#endif
+		ea = (uint16_t)read6502(eahelp) | ((uint16_t)read6502(eahelp2) << 8);
+		state6502.pc += 2;
+	}
+	{
+		state6502.pc = ea;
+	}
+	clockticks6502 += 6;
+} break;
+
+case 0x7D: { // adc absx
+	{
+		uint16_t startpage;
+		ea        = ((uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8));
+		startpage = ea & 0xFF00;
+		ea += (uint16_t)state6502.x;
+		if (startpage != (ea & 0xFF00)) { //one cycle penlty for page-crossing on some opcodes
+			penaltyaddr = 1;
+		}
+		state6502.pc += 2;
+	}
+	{
+		penaltyop = 1;
+		if (state6502.status & FLAG_DECIMAL) {
+			uint16_t tmp, tmp2;
+			value = ((uint16_t)read6502(ea));
+			tmp   = ((uint16_t)state6502.a & 0x0F) + (value & 0x0F) + (uint16_t)(state6502.status & FLAG_CARRY);
+			tmp2  = ((uint16_t)state6502.a & 0xF0) + (value & 0xF0);
+			if (tmp > 0x09) {
+				tmp2 += 0x10;
+				tmp += 0x06;
+			}
+			if (tmp2 > 0x90) {
+				tmp2 += 0x60;
+			}
+			if (tmp2 & 0xFF00) {
+				setcarry();
+			} else {
+				clearcarry();
+			}
+			result = (tmp & 0x0F) | (tmp2 & 0xF0);
+			zerocalc(result); /* 65C02 change, Decimal Arithmetic sets NZV */
+			signcalc(result);
+			clockticks6502++;
+		} else {
+			value  = ((uint16_t)read6502(ea));
+			result = (uint16_t)state6502.a + value + (uint16_t)(state6502.status & FLAG_CARRY);
+			carrycalc(result);
+			zerocalc(result);
+			overflowcalc(result, state6502.a, value);
+			signcalc(result);
+		}
+		saveaccum(result);
+	}
+	clockticks6502 += 4;
+	if (penaltyop && penaltyaddr)
+		clockticks6502++;
+} break;
+
+case 0x7E: { // ror absx
+	{
+		uint16_t startpage;
+		ea        = ((uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8));
+		startpage = ea & 0xFF00;
+		ea += (uint16_t)state6502.x;
+		if (startpage != (ea & 0xFF00)) { //one cycle penlty for page-crossing on some opcodes
+			penaltyaddr = 1;
+		}
+		state6502.pc += 2;
+	}
+	{
+		value  = ((uint16_t)read6502(ea));
+		result = (value >> 1) | ((state6502.status & FLAG_CARRY) << 7);
+		if (value & 1)
+			setcarry();
+		else
+			clearcarry();
+		zerocalc(result);
+		signcalc(result);
+		write6502(ea, ((result) & 0x00FF));
+	}
+	clockticks6502 += 7;
+} break;
+
+case 0x7F: { // bbr7 zprel
+	{
+		ea      = (uint16_t)read6502(state6502.pc);
+		reladdr = (uint16_t)read6502(state6502.pc + 1);
+		if (reladdr & 0x80)
+			reladdr |= 0xFF00;
+		state6502.pc += 2;
+	}
+	{
+		{
+		const uint16_t bitmask = 0x80;
+		if ((((uint16_t)read6502(ea)) & bitmask) == 0) {
+			oldpc = state6502.pc;
+			state6502.pc += reladdr;
+			if ((oldpc & 0xFF00) != (state6502.pc & 0xFF00))
+				clockticks6502 += 2; //check if jump crossed a page boundary
+			else
+				clockticks6502++;
+		}}
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0x80: { // bra rel
+	{
+		reladdr = (int16_t)((int8_t)read6502(state6502.pc++));
+	}
+	{
+		oldpc = state6502.pc;
+		state6502.pc += reladdr;
+		if ((oldpc & 0xFF00) != (state6502.pc & 0xFF00))
+			clockticks6502++; //check if jump crossed a page boundary
+	}
+	clockticks6502 += 3;
+} break;
+
+case 0x81: { // sta indx
+	{
+		uint16_t eahelp;
+		eahelp = (uint16_t)(((uint16_t)read6502(state6502.pc++) + (uint16_t)state6502.x) & 0xFF); // zero-page wraparound for table pointer
+		ea     = (uint16_t)read6502(eahelp & 0x00FF) | ((uint16_t)read6502((eahelp + 1) & 0x00FF) << 8);
+	}
+	{
+		write6502(ea, ((state6502.a) & 0x00FF));
+	}
+	clockticks6502 += 6;
+} break;
+
+case 0x82: { // nop imp
+	{
+		switch (0x82) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x83: { // nop imp
+	{
+		switch (0x83) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x84: { // sty zp
+	{
+		ea = (uint16_t)read6502((uint16_t)state6502.pc++);
+	}
+	{
+		write6502(ea, ((state6502.y) & 0x00FF));
+	}
+	clockticks6502 += 3;
+} break;
+
+case 0x85: { // sta zp
+	{
+		ea = (uint16_t)read6502((uint16_t)state6502.pc++);
+	}
+	{
+		write6502(ea, ((state6502.a) & 0x00FF));
+	}
+	clockticks6502 += 3;
+} break;
+
+case 0x86: { // stx zp
+	{
+		ea = (uint16_t)read6502((uint16_t)state6502.pc++);
+	}
+	{
+		write6502(ea, ((state6502.x) & 0x00FF));
+	}
+	clockticks6502 += 3;
+} break;
+
+case 0x87: { // smb0 zp
+	{
+		ea = (uint16_t)read6502((uint16_t)state6502.pc++);
+	}
+	{
+		write6502(ea, ((((uint16_t)read6502(ea)) | 0x01) & 0x00FF));
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0x88: { // dey imp
+	{
+		state6502.y--;
+		zerocalc(state6502.y);
+		signcalc(state6502.y);
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x89: { // bit imm
+	{
+		ea = state6502.pc++;
+	}
+	{
+		value  = ((uint16_t)read6502(ea));
+		result = (uint16_t)state6502.a & value;
+		zerocalc(result);
+		state6502.status = (state6502.status & 0x3F) | (uint8_t)(value & 0xC0);
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x8A: { // txa imp
+	{
+		state6502.a = state6502.x;
+		zerocalc(state6502.a);
+		signcalc(state6502.a);
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x8B: { // nop imp
+	{
+		switch (0x8B) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x8C: { // sty abso
+	{
+		ea = (uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8);
+		state6502.pc += 2;
+	}
+	{
+		write6502(ea, ((state6502.y) & 0x00FF));
+	}
+	clockticks6502 += 4;
+} break;
+
+case 0x8D: { // sta abso
+	{
+		ea = (uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8);
+		state6502.pc += 2;
+	}
+	{
+		write6502(ea, ((state6502.a) & 0x00FF));
+	}
+	clockticks6502 += 4;
+} break;
+
+case 0x8E: { // stx abso
+	{
+		ea = (uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8);
+		state6502.pc += 2;
+	}
+	{
+		write6502(ea, ((state6502.x) & 0x00FF));
+	}
+	clockticks6502 += 4;
+} break;
+
+case 0x8F: { // bbs0 zprel
+	{
+		ea      = (uint16_t)read6502(state6502.pc);
+		reladdr = (uint16_t)read6502(state6502.pc + 1);
+		if (reladdr & 0x80)
+			reladdr |= 0xFF00;
+		state6502.pc += 2;
+	}
+	{
+		{
+		const uint16_t bitmask = 0x01;
+		if ((((uint16_t)read6502(ea)) & bitmask) != 0) {
+			oldpc = state6502.pc;
+			state6502.pc += reladdr;
+			if ((oldpc & 0xFF00) != (state6502.pc & 0xFF00))
+				clockticks6502 += 2; //check if jump crossed a page boundary
+			else
+				clockticks6502++;
+		}}
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0x90: { // bcc rel
+	{
+		reladdr = (int16_t)((int8_t)read6502(state6502.pc++));
+	}
+	{
+		if ((state6502.status & FLAG_CARRY) == 0) {
+			oldpc = state6502.pc;
+			state6502.pc += reladdr;
+			if ((oldpc & 0xFF00) != (state6502.pc & 0xFF00))
+				clockticks6502 += 2; // check if jump crossed a page boundary
+			else
+				clockticks6502++;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x91: { // sta indy
+	{
+		uint16_t eahelp, eahelp2, startpage;
+		eahelp    = (uint16_t)read6502(state6502.pc++);
+		eahelp2   = (eahelp & 0xFF00) | ((eahelp + 1) & 0x00FF); //zero-page wraparound
+		ea        = (uint16_t)read6502(eahelp) | ((uint16_t)read6502(eahelp2) << 8);
+		startpage = ea & 0xFF00;
+		ea += (uint16_t)state6502.y;
+		if (startpage != (ea & 0xFF00)) { //one cycle penlty for page-crossing on some opcodes
+			penaltyaddr = 1;
+		}
+	}
+	{
+		write6502(ea, ((state6502.a) & 0x00FF));
+	}
+	clockticks6502 += 6;
+} break;
+
+case 0x92: { // sta ind0
+	{
+		uint16_t eahelp, eahelp2;
+		eahelp  = (uint16_t)read6502(state6502.pc++);
+		eahelp2 = (eahelp & 0xFF00) | ((eahelp + 1) & 0x00FF); //zero-page wraparound
+		ea      = (uint16_t)read6502(eahelp) | ((uint16_t)read6502(eahelp2) << 8);
+	}
+	{
+		write6502(ea, ((state6502.a) & 0x00FF));
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0x93: { // nop imp
+	{
+		switch (0x93) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x94: { // sty zpx
+	{
+		ea = ((uint16_t)read6502((uint16_t)state6502.pc++) + (uint16_t)state6502.x) & 0xFF; // zero-page wraparound
+	}
+	{
+		write6502(ea, ((state6502.y) & 0x00FF));
+	}
+	clockticks6502 += 4;
+} break;
+
+case 0x95: { // sta zpx
+	{
+		ea = ((uint16_t)read6502((uint16_t)state6502.pc++) + (uint16_t)state6502.x) & 0xFF; // zero-page wraparound
+	}
+	{
+		write6502(ea, ((state6502.a) & 0x00FF));
+	}
+	clockticks6502 += 4;
+} break;
+
+case 0x96: { // stx zpy
+	{
+		ea = ((uint16_t)read6502((uint16_t)state6502.pc++) + (uint16_t)state6502.y) & 0xFF; // zero-page wraparound
+	}
+	{
+		write6502(ea, ((state6502.x) & 0x00FF));
+	}
+	clockticks6502 += 4;
+} break;
+
+case 0x97: { // smb1 zp
+	{
+		ea = (uint16_t)read6502((uint16_t)state6502.pc++);
+	}
+	{
+		write6502(ea, ((((uint16_t)read6502(ea)) | 0x02) & 0x00FF));
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0x98: { // tya imp
+	{
+		state6502.a = state6502.y;
+		zerocalc(state6502.a);
+		signcalc(state6502.a);
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x99: { // sta absy
+	{
+		uint16_t startpage;
+		ea        = ((uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8));
+		startpage = ea & 0xFF00;
+		ea += (uint16_t)state6502.y;
+		if (startpage != (ea & 0xFF00)) { //one cycle penlty for page-crossing on some opcodes
+			penaltyaddr = 1;
+		}
+		state6502.pc += 2;
+	}
+	{
+		write6502(ea, ((state6502.a) & 0x00FF));
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0x9A: { // txs imp
+	{
+		state6502.sp = state6502.x;
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x9B: { // nop imp
+	{
+		switch (0x9B) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0x9C: { // stz abso
+	{
+		ea = (uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8);
+		state6502.pc += 2;
+	}
+	{
+		write6502(ea, ((0) & 0x00FF));
+	}
+	clockticks6502 += 4;
+} break;
+
+case 0x9D: { // sta absx
+	{
+		uint16_t startpage;
+		ea        = ((uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8));
+		startpage = ea & 0xFF00;
+		ea += (uint16_t)state6502.x;
+		if (startpage != (ea & 0xFF00)) { //one cycle penlty for page-crossing on some opcodes
+			penaltyaddr = 1;
+		}
+		state6502.pc += 2;
+	}
+	{
+		write6502(ea, ((state6502.a) & 0x00FF));
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0x9E: { // stz absx
+	{
+		uint16_t startpage;
+		ea        = ((uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8));
+		startpage = ea & 0xFF00;
+		ea += (uint16_t)state6502.x;
+		if (startpage != (ea & 0xFF00)) { //one cycle penlty for page-crossing on some opcodes
+			penaltyaddr = 1;
+		}
+		state6502.pc += 2;
+	}
+	{
+		write6502(ea, ((0) & 0x00FF));
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0x9F: { // bbs1 zprel
+	{
+		ea      = (uint16_t)read6502(state6502.pc);
+		reladdr = (uint16_t)read6502(state6502.pc + 1);
+		if (reladdr & 0x80)
+			reladdr |= 0xFF00;
+		state6502.pc += 2;
+	}
+	{
+		{
+		const uint16_t bitmask = 0x02;
+		if ((((uint16_t)read6502(ea)) & bitmask) != 0) {
+			oldpc = state6502.pc;
+			state6502.pc += reladdr;
+			if ((oldpc & 0xFF00) != (state6502.pc & 0xFF00))
+				clockticks6502 += 2; //check if jump crossed a page boundary
+			else
+				clockticks6502++;
+		}}
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0xA0: { // ldy imm
+	{
+		ea = state6502.pc++;
+	}
+	{
+		penaltyop   = 1;
+		value       = ((uint16_t)read6502(ea));
+		state6502.y = (uint8_t)(value & 0x00FF);
+		zerocalc(state6502.y);
+		signcalc(state6502.y);
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0xA1: { // lda indx
+	{
+		uint16_t eahelp;
+		eahelp = (uint16_t)(((uint16_t)read6502(state6502.pc++) + (uint16_t)state6502.x) & 0xFF); // zero-page wraparound for table pointer
+		ea     = (uint16_t)read6502(eahelp & 0x00FF) | ((uint16_t)read6502((eahelp + 1) & 0x00FF) << 8);
+	}
+	{
+		penaltyop   = 1;
+		value       = ((uint16_t)read6502(ea));
+		state6502.a = (uint8_t)(value & 0x00FF);
+		zerocalc(state6502.a);
+		signcalc(state6502.a);
+	}
+	clockticks6502 += 6;
+} break;
+
+case 0xA2: { // ldx imm
+	{
+		ea = state6502.pc++;
+	}
+	{
+		penaltyop   = 1;
+		value       = ((uint16_t)read6502(ea));
+		state6502.x = (uint8_t)(value & 0x00FF);
+		zerocalc(state6502.x);
+		signcalc(state6502.x);
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0xA3: { // nop imp
+	{
+		switch (0xA3) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0xA4: { // ldy zp
+	{
+		ea = (uint16_t)read6502((uint16_t)state6502.pc++);
+	}
+	{
+		penaltyop   = 1;
+		value       = ((uint16_t)read6502(ea));
+		state6502.y = (uint8_t)(value & 0x00FF);
+		zerocalc(state6502.y);
+		signcalc(state6502.y);
+	}
+	clockticks6502 += 3;
+} break;
+
+case 0xA5: { // lda zp
+	{
+		ea = (uint16_t)read6502((uint16_t)state6502.pc++);
+	}
+	{
+		penaltyop   = 1;
+		value       = ((uint16_t)read6502(ea));
+		state6502.a = (uint8_t)(value & 0x00FF);
+		zerocalc(state6502.a);
+		signcalc(state6502.a);
+	}
+	clockticks6502 += 3;
+} break;
+
+case 0xA6: { // ldx zp
+	{
+		ea = (uint16_t)read6502((uint16_t)state6502.pc++);
+	}
+	{
+		penaltyop   = 1;
+		value       = ((uint16_t)read6502(ea));
+		state6502.x = (uint8_t)(value & 0x00FF);
+		zerocalc(state6502.x);
+		signcalc(state6502.x);
+	}
+	clockticks6502 += 3;
+} break;
+
+case 0xA7: { // smb2 zp
+	{
+		ea = (uint16_t)read6502((uint16_t)state6502.pc++);
+	}
+	{
+		write6502(ea, ((((uint16_t)read6502(ea)) | 0x04) & 0x00FF));
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0xA8: { // tay imp
+	{
+		state6502.y = state6502.a;
+		zerocalc(state6502.y);
+		signcalc(state6502.y);
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0xA9: { // lda imm
+	{
+		ea = state6502.pc++;
+	}
+	{
+		penaltyop   = 1;
+		value       = ((uint16_t)read6502(ea));
+		state6502.a = (uint8_t)(value & 0x00FF);
+		zerocalc(state6502.a);
+		signcalc(state6502.a);
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0xAA: { // tax imp
+	{
+		state6502.x = state6502.a;
+		zerocalc(state6502.x);
+		signcalc(state6502.x);
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0xAB: { // nop imp
+	{
+		switch (0xAB) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0xAC: { // ldy abso
+	{
+		ea = (uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8);
+		state6502.pc += 2;
+	}
+	{
+		penaltyop   = 1;
+		value       = ((uint16_t)read6502(ea));
+		state6502.y = (uint8_t)(value & 0x00FF);
+		zerocalc(state6502.y);
+		signcalc(state6502.y);
+	}
+	clockticks6502 += 4;
+} break;
+
+case 0xAD: { // lda abso
+	{
+		ea = (uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8);
+		state6502.pc += 2;
+	}
+	{
+		penaltyop   = 1;
+		value       = ((uint16_t)read6502(ea));
+		state6502.a = (uint8_t)(value & 0x00FF);
+		zerocalc(state6502.a);
+		signcalc(state6502.a);
+	}
+	clockticks6502 += 4;
+} break;
+
+case 0xAE: { // ldx abso
+	{
+		ea = (uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8);
+		state6502.pc += 2;
+	}
+	{
+		penaltyop   = 1;
+		value       = ((uint16_t)read6502(ea));
+		state6502.x = (uint8_t)(value & 0x00FF);
+		zerocalc(state6502.x);
+		signcalc(state6502.x);
+	}
+	clockticks6502 += 4;
+} break;
+
+case 0xAF: { // bbs2 zprel
+	{
+		ea      = (uint16_t)read6502(state6502.pc);
+		reladdr = (uint16_t)read6502(state6502.pc + 1);
+		if (reladdr & 0x80)
+			reladdr |= 0xFF00;
+		state6502.pc += 2;
+	}
+	{
+		{
+		const uint16_t bitmask = 0x04;
+		if ((((uint16_t)read6502(ea)) & bitmask) != 0) {
+			oldpc = state6502.pc;
+			state6502.pc += reladdr;
+			if ((oldpc & 0xFF00) != (state6502.pc & 0xFF00))
+				clockticks6502 += 2; //check if jump crossed a page boundary
+			else
+				clockticks6502++;
+		}}
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0xB0: { // bcs rel
+	{
+		reladdr = (int16_t)((int8_t)read6502(state6502.pc++));
+	}
+	{
+		if ((state6502.status & FLAG_CARRY) == FLAG_CARRY) {
+			oldpc = state6502.pc;
+			state6502.pc += reladdr;
+			if ((oldpc & 0xFF00) != (state6502.pc & 0xFF00))
+				clockticks6502 += 2; // check if jump crossed a page boundary
+			else
+				clockticks6502++;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0xB1: { // lda indy
+	{
+		uint16_t eahelp, eahelp2, startpage;
+		eahelp    = (uint16_t)read6502(state6502.pc++);
+		eahelp2   = (eahelp & 0xFF00) | ((eahelp + 1) & 0x00FF); //zero-page wraparound
+		ea        = (uint16_t)read6502(eahelp) | ((uint16_t)read6502(eahelp2) << 8);
+		startpage = ea & 0xFF00;
+		ea += (uint16_t)state6502.y;
+		if (startpage != (ea & 0xFF00)) { //one cycle penlty for page-crossing on some opcodes
+			penaltyaddr = 1;
+		}
+	}
+	{
+		penaltyop   = 1;
+		value       = ((uint16_t)read6502(ea));
+		state6502.a = (uint8_t)(value & 0x00FF);
+		zerocalc(state6502.a);
+		signcalc(state6502.a);
+	}
+	clockticks6502 += 5;
+	if (penaltyop && penaltyaddr)
+		clockticks6502++;
+} break;
+
+case 0xB2: { // lda ind0
+	{
+		uint16_t eahelp, eahelp2;
+		eahelp  = (uint16_t)read6502(state6502.pc++);
+		eahelp2 = (eahelp & 0xFF00) | ((eahelp + 1) & 0x00FF); //zero-page wraparound
+		ea      = (uint16_t)read6502(eahelp) | ((uint16_t)read6502(eahelp2) << 8);
+	}
+	{
+		penaltyop   = 1;
+		value       = ((uint16_t)read6502(ea));
+		state6502.a = (uint8_t)(value & 0x00FF);
+		zerocalc(state6502.a);
+		signcalc(state6502.a);
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0xB3: { // nop imp
+	{
+		switch (0xB3) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0xB4: { // ldy zpx
+	{
+		ea = ((uint16_t)read6502((uint16_t)state6502.pc++) + (uint16_t)state6502.x) & 0xFF; // zero-page wraparound
+	}
+	{
+		penaltyop   = 1;
+		value       = ((uint16_t)read6502(ea));
+		state6502.y = (uint8_t)(value & 0x00FF);
+		zerocalc(state6502.y);
+		signcalc(state6502.y);
+	}
+	clockticks6502 += 4;
+} break;
+
+case 0xB5: { // lda zpx
+	{
+		ea = ((uint16_t)read6502((uint16_t)state6502.pc++) + (uint16_t)state6502.x) & 0xFF; // zero-page wraparound
+	}
+	{
+		penaltyop   = 1;
+		value       = ((uint16_t)read6502(ea));
+		state6502.a = (uint8_t)(value & 0x00FF);
+		zerocalc(state6502.a);
+		signcalc(state6502.a);
+	}
+	clockticks6502 += 4;
+} break;
+
+case 0xB6: { // ldx zpy
+	{
+		ea = ((uint16_t)read6502((uint16_t)state6502.pc++) + (uint16_t)state6502.y) & 0xFF; // zero-page wraparound
+	}
+	{
+		penaltyop   = 1;
+		value       = ((uint16_t)read6502(ea));
+		state6502.x = (uint8_t)(value & 0x00FF);
+		zerocalc(state6502.x);
+		signcalc(state6502.x);
+	}
+	clockticks6502 += 4;
+} break;
+
+case 0xB7: { // smb3 zp
+	{
+		ea = (uint16_t)read6502((uint16_t)state6502.pc++);
+	}
+	{
+		write6502(ea, ((((uint16_t)read6502(ea)) | 0x08) & 0x00FF));
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0xB8: { // clv imp
+	{
+		clearoverflow();
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0xB9: { // lda absy
+	{
+		uint16_t startpage;
+		ea        = ((uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8));
+		startpage = ea & 0xFF00;
+		ea += (uint16_t)state6502.y;
+		if (startpage != (ea & 0xFF00)) { //one cycle penlty for page-crossing on some opcodes
+			penaltyaddr = 1;
+		}
+		state6502.pc += 2;
+	}
+	{
+		penaltyop   = 1;
+		value       = ((uint16_t)read6502(ea));
+		state6502.a = (uint8_t)(value & 0x00FF);
+		zerocalc(state6502.a);
+		signcalc(state6502.a);
+	}
+	clockticks6502 += 4;
+	if (penaltyop && penaltyaddr)
+		clockticks6502++;
+} break;
+
+case 0xBA: { // tsx imp
+	{
+		state6502.x = state6502.sp;
+		zerocalc(state6502.x);
+		signcalc(state6502.x);
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0xBB: { // nop imp
+	{
+		switch (0xBB) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0xBC: { // ldy absx
+	{
+		uint16_t startpage;
+		ea        = ((uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8));
+		startpage = ea & 0xFF00;
+		ea += (uint16_t)state6502.x;
+		if (startpage != (ea & 0xFF00)) { //one cycle penlty for page-crossing on some opcodes
+			penaltyaddr = 1;
+		}
+		state6502.pc += 2;
+	}
+	{
+		penaltyop   = 1;
+		value       = ((uint16_t)read6502(ea));
+		state6502.y = (uint8_t)(value & 0x00FF);
+		zerocalc(state6502.y);
+		signcalc(state6502.y);
+	}
+	clockticks6502 += 4;
+	if (penaltyop && penaltyaddr)
+		clockticks6502++;
+} break;
+
+case 0xBD: { // lda absx
+	{
+		uint16_t startpage;
+		ea        = ((uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8));
+		startpage = ea & 0xFF00;
+		ea += (uint16_t)state6502.x;
+		if (startpage != (ea & 0xFF00)) { //one cycle penlty for page-crossing on some opcodes
+			penaltyaddr = 1;
+		}
+		state6502.pc += 2;
+	}
+	{
+		penaltyop   = 1;
+		value       = ((uint16_t)read6502(ea));
+		state6502.a = (uint8_t)(value & 0x00FF);
+		zerocalc(state6502.a);
+		signcalc(state6502.a);
+	}
+	clockticks6502 += 4;
+	if (penaltyop && penaltyaddr)
+		clockticks6502++;
+} break;
+
+case 0xBE: { // ldx absy
+	{
+		uint16_t startpage;
+		ea        = ((uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8));
+		startpage = ea & 0xFF00;
+		ea += (uint16_t)state6502.y;
+		if (startpage != (ea & 0xFF00)) { //one cycle penlty for page-crossing on some opcodes
+			penaltyaddr = 1;
+		}
+		state6502.pc += 2;
+	}
+	{
+		penaltyop   = 1;
+		value       = ((uint16_t)read6502(ea));
+		state6502.x = (uint8_t)(value & 0x00FF);
+		zerocalc(state6502.x);
+		signcalc(state6502.x);
+	}
+	clockticks6502 += 4;
+	if (penaltyop && penaltyaddr)
+		clockticks6502++;
+} break;
+
+case 0xBF: { // bbs3 zprel
+	{
+		ea      = (uint16_t)read6502(state6502.pc);
+		reladdr = (uint16_t)read6502(state6502.pc + 1);
+		if (reladdr & 0x80)
+			reladdr |= 0xFF00;
+		state6502.pc += 2;
+	}
+	{
+		{
+		const uint16_t bitmask = 0x08;
+		if ((((uint16_t)read6502(ea)) & bitmask) != 0) {
+			oldpc = state6502.pc;
+			state6502.pc += reladdr;
+			if ((oldpc & 0xFF00) != (state6502.pc & 0xFF00))
+				clockticks6502 += 2; //check if jump crossed a page boundary
+			else
+				clockticks6502++;
+		}}
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0xC0: { // cpy imm
+	{
+		ea = state6502.pc++;
+	}
+	{
+		value  = ((uint16_t)read6502(ea));
+		result = (uint16_t)state6502.y - value;
+		if (state6502.y >= (uint8_t)(value & 0x00FF))
+			setcarry();
+		else
+			clearcarry();
+		if (state6502.y == (uint8_t)(value & 0x00FF))
+			setzero();
+		else
+			clearzero();
+		signcalc(result);
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0xC1: { // cmp indx
+	{
+		uint16_t eahelp;
+		eahelp = (uint16_t)(((uint16_t)read6502(state6502.pc++) + (uint16_t)state6502.x) & 0xFF); // zero-page wraparound for table pointer
+		ea     = (uint16_t)read6502(eahelp & 0x00FF) | ((uint16_t)read6502((eahelp + 1) & 0x00FF) << 8);
+	}
+	{
+		penaltyop = 1;
+		value     = ((uint16_t)read6502(ea));
+		result    = (uint16_t)state6502.a - value;
+		if (state6502.a >= (uint8_t)(value & 0x00FF))
+			setcarry();
+		else
+			clearcarry();
+		if (state6502.a == (uint8_t)(value & 0x00FF))
+			setzero();
+		else
+			clearzero();
+		signcalc(result);
+	}
+	clockticks6502 += 6;
+} break;
+
+case 0xC2: { // nop imp
+	{
+		switch (0xC2) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0xC3: { // nop imp
+	{
+		switch (0xC3) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0xC4: { // cpy zp
+	{
+		ea = (uint16_t)read6502((uint16_t)state6502.pc++);
+	}
+	{
+		value  = ((uint16_t)read6502(ea));
+		result = (uint16_t)state6502.y - value;
+		if (state6502.y >= (uint8_t)(value & 0x00FF))
+			setcarry();
+		else
+			clearcarry();
+		if (state6502.y == (uint8_t)(value & 0x00FF))
+			setzero();
+		else
+			clearzero();
+		signcalc(result);
+	}
+	clockticks6502 += 3;
+} break;
+
+case 0xC5: { // cmp zp
+	{
+		ea = (uint16_t)read6502((uint16_t)state6502.pc++);
+	}
+	{
+		penaltyop = 1;
+		value     = ((uint16_t)read6502(ea));
+		result    = (uint16_t)state6502.a - value;
+		if (state6502.a >= (uint8_t)(value & 0x00FF))
+			setcarry();
+		else
+			clearcarry();
+		if (state6502.a == (uint8_t)(value & 0x00FF))
+			setzero();
+		else
+			clearzero();
+		signcalc(result);
+	}
+	clockticks6502 += 3;
+} break;
+
+case 0xC6: { // dec zp
+	{
+		ea = (uint16_t)read6502((uint16_t)state6502.pc++);
+	}
+	{
+		value  = ((uint16_t)read6502(ea));
+		result = value - 1;
+		zerocalc(result);
+		signcalc(result);
+		write6502(ea, ((result) & 0x00FF));
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0xC7: { // smb4 zp
+	{
+		ea = (uint16_t)read6502((uint16_t)state6502.pc++);
+	}
+	{
+		write6502(ea, ((((uint16_t)read6502(ea)) | 0x10) & 0x00FF));
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0xC8: { // iny imp
+	{
+		state6502.y++;
+		zerocalc(state6502.y);
+		signcalc(state6502.y);
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0xC9: { // cmp imm
+	{
+		ea = state6502.pc++;
+	}
+	{
+		penaltyop = 1;
+		value     = ((uint16_t)read6502(ea));
+		result    = (uint16_t)state6502.a - value;
+		if (state6502.a >= (uint8_t)(value & 0x00FF))
+			setcarry();
+		else
+			clearcarry();
+		if (state6502.a == (uint8_t)(value & 0x00FF))
+			setzero();
+		else
+			clearzero();
+		signcalc(result);
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0xCA: { // dex imp
+	{
+		state6502.x--;
+		zerocalc(state6502.x);
+		signcalc(state6502.x);
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0xCB: { // wai imp
+	{
+		waiting = 1;
+	}
+	clockticks6502 += 3;
+} break;
+
+case 0xCC: { // cpy abso
+	{
+		ea = (uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8);
+		state6502.pc += 2;
+	}
+	{
+		value  = ((uint16_t)read6502(ea));
+		result = (uint16_t)state6502.y - value;
+		if (state6502.y >= (uint8_t)(value & 0x00FF))
+			setcarry();
+		else
+			clearcarry();
+		if (state6502.y == (uint8_t)(value & 0x00FF))
+			setzero();
+		else
+			clearzero();
+		signcalc(result);
+	}
+	clockticks6502 += 4;
+} break;
+
+case 0xCD: { // cmp abso
+	{
+		ea = (uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8);
+		state6502.pc += 2;
+	}
+	{
+		penaltyop = 1;
+		value     = ((uint16_t)read6502(ea));
+		result    = (uint16_t)state6502.a - value;
+		if (state6502.a >= (uint8_t)(value & 0x00FF))
+			setcarry();
+		else
+			clearcarry();
+		if (state6502.a == (uint8_t)(value & 0x00FF))
+			setzero();
+		else
+			clearzero();
+		signcalc(result);
+	}
+	clockticks6502 += 4;
+} break;
+
+case 0xCE: { // dec abso
+	{
+		ea = (uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8);
+		state6502.pc += 2;
+	}
+	{
+		value  = ((uint16_t)read6502(ea));
+		result = value - 1;
+		zerocalc(result);
+		signcalc(result);
+		write6502(ea, ((result) & 0x00FF));
+	}
+	clockticks6502 += 6;
+} break;
+
+case 0xCF: { // bbs4 zprel
+	{
+		ea      = (uint16_t)read6502(state6502.pc);
+		reladdr = (uint16_t)read6502(state6502.pc + 1);
+		if (reladdr & 0x80)
+			reladdr |= 0xFF00;
+		state6502.pc += 2;
+	}
+	{
+		{
+		const uint16_t bitmask = 0x10;
+		if ((((uint16_t)read6502(ea)) & bitmask) != 0) {
+			oldpc = state6502.pc;
+			state6502.pc += reladdr;
+			if ((oldpc & 0xFF00) != (state6502.pc & 0xFF00))
+				clockticks6502 += 2; //check if jump crossed a page boundary
+			else
+				clockticks6502++;
+		}}
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0xD0: { // bne rel
+	{
+		reladdr = (int16_t)((int8_t)read6502(state6502.pc++));
+	}
+	{
+		if ((state6502.status & FLAG_ZERO) == 0) {
+			oldpc = state6502.pc;
+			state6502.pc += reladdr;
+			if ((oldpc & 0xFF00) != (state6502.pc & 0xFF00))
+				clockticks6502 += 2; // check if jump crossed a page boundary
+			else
+				clockticks6502++;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0xD1: { // cmp indy
+	{
+		uint16_t eahelp, eahelp2, startpage;
+		eahelp    = (uint16_t)read6502(state6502.pc++);
+		eahelp2   = (eahelp & 0xFF00) | ((eahelp + 1) & 0x00FF); //zero-page wraparound
+		ea        = (uint16_t)read6502(eahelp) | ((uint16_t)read6502(eahelp2) << 8);
+		startpage = ea & 0xFF00;
+		ea += (uint16_t)state6502.y;
+		if (startpage != (ea & 0xFF00)) { //one cycle penlty for page-crossing on some opcodes
+			penaltyaddr = 1;
+		}
+	}
+	{
+		penaltyop = 1;
+		value     = ((uint16_t)read6502(ea));
+		result    = (uint16_t)state6502.a - value;
+		if (state6502.a >= (uint8_t)(value & 0x00FF))
+			setcarry();
+		else
+			clearcarry();
+		if (state6502.a == (uint8_t)(value & 0x00FF))
+			setzero();
+		else
+			clearzero();
+		signcalc(result);
+	}
+	clockticks6502 += 5;
+	if (penaltyop && penaltyaddr)
+		clockticks6502++;
+} break;
+
+case 0xD2: { // cmp ind0
+	{
+		uint16_t eahelp, eahelp2;
+		eahelp  = (uint16_t)read6502(state6502.pc++);
+		eahelp2 = (eahelp & 0xFF00) | ((eahelp + 1) & 0x00FF); //zero-page wraparound
+		ea      = (uint16_t)read6502(eahelp) | ((uint16_t)read6502(eahelp2) << 8);
+	}
+	{
+		penaltyop = 1;
+		value     = ((uint16_t)read6502(ea));
+		result    = (uint16_t)state6502.a - value;
+		if (state6502.a >= (uint8_t)(value & 0x00FF))
+			setcarry();
+		else
+			clearcarry();
+		if (state6502.a == (uint8_t)(value & 0x00FF))
+			setzero();
+		else
+			clearzero();
+		signcalc(result);
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0xD3: { // nop imp
+	{
+		switch (0xD3) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0xD4: { // nop imp
+	{
+		switch (0xD4) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0xD5: { // cmp zpx
+	{
+		ea = ((uint16_t)read6502((uint16_t)state6502.pc++) + (uint16_t)state6502.x) & 0xFF; // zero-page wraparound
+	}
+	{
+		penaltyop = 1;
+		value     = ((uint16_t)read6502(ea));
+		result    = (uint16_t)state6502.a - value;
+		if (state6502.a >= (uint8_t)(value & 0x00FF))
+			setcarry();
+		else
+			clearcarry();
+		if (state6502.a == (uint8_t)(value & 0x00FF))
+			setzero();
+		else
+			clearzero();
+		signcalc(result);
+	}
+	clockticks6502 += 4;
+} break;
+
+case 0xD6: { // dec zpx
+	{
+		ea = ((uint16_t)read6502((uint16_t)state6502.pc++) + (uint16_t)state6502.x) & 0xFF; // zero-page wraparound
+	}
+	{
+		value  = ((uint16_t)read6502(ea));
+		result = value - 1;
+		zerocalc(result);
+		signcalc(result);
+		write6502(ea, ((result) & 0x00FF));
+	}
+	clockticks6502 += 6;
+} break;
+
+case 0xD7: { // smb5 zp
+	{
+		ea = (uint16_t)read6502((uint16_t)state6502.pc++);
+	}
+	{
+		write6502(ea, ((((uint16_t)read6502(ea)) | 0x20) & 0x00FF));
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0xD8: { // cld imp
+	{
+		cleardecimal();
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0xD9: { // cmp absy
+	{
+		uint16_t startpage;
+		ea        = ((uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8));
+		startpage = ea & 0xFF00;
+		ea += (uint16_t)state6502.y;
+		if (startpage != (ea & 0xFF00)) { //one cycle penlty for page-crossing on some opcodes
+			penaltyaddr = 1;
+		}
+		state6502.pc += 2;
+	}
+	{
+		penaltyop = 1;
+		value     = ((uint16_t)read6502(ea));
+		result    = (uint16_t)state6502.a - value;
+		if (state6502.a >= (uint8_t)(value & 0x00FF))
+			setcarry();
+		else
+			clearcarry();
+		if (state6502.a == (uint8_t)(value & 0x00FF))
+			setzero();
+		else
+			clearzero();
+		signcalc(result);
+	}
+	clockticks6502 += 4;
+	if (penaltyop && penaltyaddr)
+		clockticks6502++;
+} break;
+
+case 0xDA: { // phx imp
+	{
+		push8(state6502.x);
+	}
+	clockticks6502 += 3;
+} break;
+
+case 0xDB: { // dbg imp
+	{
+		debugger_pause_execution(); // Invoke debugger.
+	}
+	clockticks6502 += 1;
+} break;
+
+case 0xDC: { // nop imp
+	{
+		switch (0xDC) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0xDD: { // cmp absx
+	{
+		uint16_t startpage;
+		ea        = ((uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8));
+		startpage = ea & 0xFF00;
+		ea += (uint16_t)state6502.x;
+		if (startpage != (ea & 0xFF00)) { //one cycle penlty for page-crossing on some opcodes
+			penaltyaddr = 1;
+		}
+		state6502.pc += 2;
+	}
+	{
+		penaltyop = 1;
+		value     = ((uint16_t)read6502(ea));
+		result    = (uint16_t)state6502.a - value;
+		if (state6502.a >= (uint8_t)(value & 0x00FF))
+			setcarry();
+		else
+			clearcarry();
+		if (state6502.a == (uint8_t)(value & 0x00FF))
+			setzero();
+		else
+			clearzero();
+		signcalc(result);
+	}
+	clockticks6502 += 4;
+	if (penaltyop && penaltyaddr)
+		clockticks6502++;
+} break;
+
+case 0xDE: { // dec absx
+	{
+		uint16_t startpage;
+		ea        = ((uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8));
+		startpage = ea & 0xFF00;
+		ea += (uint16_t)state6502.x;
+		if (startpage != (ea & 0xFF00)) { //one cycle penlty for page-crossing on some opcodes
+			penaltyaddr = 1;
+		}
+		state6502.pc += 2;
+	}
+	{
+		value  = ((uint16_t)read6502(ea));
+		result = value - 1;
+		zerocalc(result);
+		signcalc(result);
+		write6502(ea, ((result) & 0x00FF));
+	}
+	clockticks6502 += 7;
+} break;
+
+case 0xDF: { // bbs5 zprel
+	{
+		ea      = (uint16_t)read6502(state6502.pc);
+		reladdr = (uint16_t)read6502(state6502.pc + 1);
+		if (reladdr & 0x80)
+			reladdr |= 0xFF00;
+		state6502.pc += 2;
+	}
+	{
+		{
+		const uint16_t bitmask = 0x20;
+		if ((((uint16_t)read6502(ea)) & bitmask) != 0) {
+			oldpc = state6502.pc;
+			state6502.pc += reladdr;
+			if ((oldpc & 0xFF00) != (state6502.pc & 0xFF00))
+				clockticks6502 += 2; //check if jump crossed a page boundary
+			else
+				clockticks6502++;
+		}}
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0xE0: { // cpx imm
+	{
+		ea = state6502.pc++;
+	}
+	{
+		value  = ((uint16_t)read6502(ea));
+		result = (uint16_t)state6502.x - value;
+		if (state6502.x >= (uint8_t)(value & 0x00FF))
+			setcarry();
+		else
+			clearcarry();
+		if (state6502.x == (uint8_t)(value & 0x00FF))
+			setzero();
+		else
+			clearzero();
+		signcalc(result);
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0xE1: { // sbc indx
+	{
+		uint16_t eahelp;
+		eahelp = (uint16_t)(((uint16_t)read6502(state6502.pc++) + (uint16_t)state6502.x) & 0xFF); // zero-page wraparound for table pointer
+		ea     = (uint16_t)read6502(eahelp & 0x00FF) | ((uint16_t)read6502((eahelp + 1) & 0x00FF) << 8);
+	}
+	{
+		penaltyop = 1;
+		if (state6502.status & FLAG_DECIMAL) {
+			value  = ((uint16_t)read6502(ea));
+			result = (uint16_t)state6502.a - (value & 0x0f) + (state6502.status & FLAG_CARRY) - 1;
+			if ((result & 0x0f) > (state6502.a & 0x0f)) {
+				result -= 6;
+			}
+			result -= (value & 0xf0);
+			if ((result & 0xfff0) > ((uint16_t)state6502.a & 0xf0)) {
+				result -= 0x60;
+			}
+			if (result <= (uint16_t)state6502.a) {
+				setcarry();
+			} else {
+				clearcarry();
+			}
+			zerocalc(result); /* 65C02 change, Decimal Arithmetic sets NZV */
+			signcalc(result);
+			clockticks6502++;
+		} else {
+			value  = ((uint16_t)read6502(ea)) ^ 0x00FF;
+			result = (uint16_t)state6502.a + value + (uint16_t)(state6502.status & FLAG_CARRY);
+			carrycalc(result);
+			zerocalc(result);
+			overflowcalc(result, state6502.a, value);
+			signcalc(result);
+		}
+		saveaccum(result);
+	}
+	clockticks6502 += 6;
+} break;
+
+case 0xE2: { // nop imp
+	{
+		switch (0xE2) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0xE3: { // nop imp
+	{
+		switch (0xE3) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0xE4: { // cpx zp
+	{
+		ea = (uint16_t)read6502((uint16_t)state6502.pc++);
+	}
+	{
+		value  = ((uint16_t)read6502(ea));
+		result = (uint16_t)state6502.x - value;
+		if (state6502.x >= (uint8_t)(value & 0x00FF))
+			setcarry();
+		else
+			clearcarry();
+		if (state6502.x == (uint8_t)(value & 0x00FF))
+			setzero();
+		else
+			clearzero();
+		signcalc(result);
+	}
+	clockticks6502 += 3;
+} break;
+
+case 0xE5: { // sbc zp
+	{
+		ea = (uint16_t)read6502((uint16_t)state6502.pc++);
+	}
+	{
+		penaltyop = 1;
+		if (state6502.status & FLAG_DECIMAL) {
+			value  = ((uint16_t)read6502(ea));
+			result = (uint16_t)state6502.a - (value & 0x0f) + (state6502.status & FLAG_CARRY) - 1;
+			if ((result & 0x0f) > (state6502.a & 0x0f)) {
+				result -= 6;
+			}
+			result -= (value & 0xf0);
+			if ((result & 0xfff0) > ((uint16_t)state6502.a & 0xf0)) {
+				result -= 0x60;
+			}
+			if (result <= (uint16_t)state6502.a) {
+				setcarry();
+			} else {
+				clearcarry();
+			}
+			zerocalc(result); /* 65C02 change, Decimal Arithmetic sets NZV */
+			signcalc(result);
+			clockticks6502++;
+		} else {
+			value  = ((uint16_t)read6502(ea)) ^ 0x00FF;
+			result = (uint16_t)state6502.a + value + (uint16_t)(state6502.status & FLAG_CARRY);
+			carrycalc(result);
+			zerocalc(result);
+			overflowcalc(result, state6502.a, value);
+			signcalc(result);
+		}
+		saveaccum(result);
+	}
+	clockticks6502 += 3;
+} break;
+
+case 0xE6: { // inc zp
+	{
+		ea = (uint16_t)read6502((uint16_t)state6502.pc++);
+	}
+	{
+		value  = ((uint16_t)read6502(ea));
+		result = value + 1;
+		zerocalc(result);
+		signcalc(result);
+		write6502(ea, ((result) & 0x00FF));
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0xE7: { // smb6 zp
+	{
+		ea = (uint16_t)read6502((uint16_t)state6502.pc++);
+	}
+	{
+		write6502(ea, ((((uint16_t)read6502(ea)) | 0x40) & 0x00FF));
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0xE8: { // inx imp
+	{
+		state6502.x++;
+		zerocalc(state6502.x);
+		signcalc(state6502.x);
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0xE9: { // sbc imm
+	{
+		ea = state6502.pc++;
+	}
+	{
+		penaltyop = 1;
+		if (state6502.status & FLAG_DECIMAL) {
+			value  = ((uint16_t)read6502(ea));
+			result = (uint16_t)state6502.a - (value & 0x0f) + (state6502.status & FLAG_CARRY) - 1;
+			if ((result & 0x0f) > (state6502.a & 0x0f)) {
+				result -= 6;
+			}
+			result -= (value & 0xf0);
+			if ((result & 0xfff0) > ((uint16_t)state6502.a & 0xf0)) {
+				result -= 0x60;
+			}
+			if (result <= (uint16_t)state6502.a) {
+				setcarry();
+			} else {
+				clearcarry();
+			}
+			zerocalc(result); /* 65C02 change, Decimal Arithmetic sets NZV */
+			signcalc(result);
+			clockticks6502++;
+		} else {
+			value  = ((uint16_t)read6502(ea)) ^ 0x00FF;
+			result = (uint16_t)state6502.a + value + (uint16_t)(state6502.status & FLAG_CARRY);
+			carrycalc(result);
+			zerocalc(result);
+			overflowcalc(result, state6502.a, value);
+			signcalc(result);
+		}
+		saveaccum(result);
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0xEA: { // nop imp
+	{
+		switch (0xEA) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0xEB: { // nop imp
+	{
+		switch (0xEB) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0xEC: { // cpx abso
+	{
+		ea = (uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8);
+		state6502.pc += 2;
+	}
+	{
+		value  = ((uint16_t)read6502(ea));
+		result = (uint16_t)state6502.x - value;
+		if (state6502.x >= (uint8_t)(value & 0x00FF))
+			setcarry();
+		else
+			clearcarry();
+		if (state6502.x == (uint8_t)(value & 0x00FF))
+			setzero();
+		else
+			clearzero();
+		signcalc(result);
+	}
+	clockticks6502 += 4;
+} break;
+
+case 0xED: { // sbc abso
+	{
+		ea = (uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8);
+		state6502.pc += 2;
+	}
+	{
+		penaltyop = 1;
+		if (state6502.status & FLAG_DECIMAL) {
+			value  = ((uint16_t)read6502(ea));
+			result = (uint16_t)state6502.a - (value & 0x0f) + (state6502.status & FLAG_CARRY) - 1;
+			if ((result & 0x0f) > (state6502.a & 0x0f)) {
+				result -= 6;
+			}
+			result -= (value & 0xf0);
+			if ((result & 0xfff0) > ((uint16_t)state6502.a & 0xf0)) {
+				result -= 0x60;
+			}
+			if (result <= (uint16_t)state6502.a) {
+				setcarry();
+			} else {
+				clearcarry();
+			}
+			zerocalc(result); /* 65C02 change, Decimal Arithmetic sets NZV */
+			signcalc(result);
+			clockticks6502++;
+		} else {
+			value  = ((uint16_t)read6502(ea)) ^ 0x00FF;
+			result = (uint16_t)state6502.a + value + (uint16_t)(state6502.status & FLAG_CARRY);
+			carrycalc(result);
+			zerocalc(result);
+			overflowcalc(result, state6502.a, value);
+			signcalc(result);
+		}
+		saveaccum(result);
+	}
+	clockticks6502 += 4;
+} break;
+
+case 0xEE: { // inc abso
+	{
+		ea = (uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8);
+		state6502.pc += 2;
+	}
+	{
+		value  = ((uint16_t)read6502(ea));
+		result = value + 1;
+		zerocalc(result);
+		signcalc(result);
+		write6502(ea, ((result) & 0x00FF));
+	}
+	clockticks6502 += 6;
+} break;
+
+case 0xEF: { // bbs6 zprel
+	{
+		ea      = (uint16_t)read6502(state6502.pc);
+		reladdr = (uint16_t)read6502(state6502.pc + 1);
+		if (reladdr & 0x80)
+			reladdr |= 0xFF00;
+		state6502.pc += 2;
+	}
+	{
+		{
+		const uint16_t bitmask = 0x40;
+		if ((((uint16_t)read6502(ea)) & bitmask) != 0) {
+			oldpc = state6502.pc;
+			state6502.pc += reladdr;
+			if ((oldpc & 0xFF00) != (state6502.pc & 0xFF00))
+				clockticks6502 += 2; //check if jump crossed a page boundary
+			else
+				clockticks6502++;
+		}}
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0xF0: { // beq rel
+	{
+		reladdr = (int16_t)((int8_t)read6502(state6502.pc++));
+	}
+	{
+		if ((state6502.status & FLAG_ZERO) == FLAG_ZERO) {
+			oldpc = state6502.pc;
+			state6502.pc += reladdr;
+			if ((oldpc & 0xFF00) != (state6502.pc & 0xFF00))
+				clockticks6502 += 2; // check if jump crossed a page boundary
+			else
+				clockticks6502++;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0xF1: { // sbc indy
+	{
+		uint16_t eahelp, eahelp2, startpage;
+		eahelp    = (uint16_t)read6502(state6502.pc++);
+		eahelp2   = (eahelp & 0xFF00) | ((eahelp + 1) & 0x00FF); //zero-page wraparound
+		ea        = (uint16_t)read6502(eahelp) | ((uint16_t)read6502(eahelp2) << 8);
+		startpage = ea & 0xFF00;
+		ea += (uint16_t)state6502.y;
+		if (startpage != (ea & 0xFF00)) { //one cycle penlty for page-crossing on some opcodes
+			penaltyaddr = 1;
+		}
+	}
+	{
+		penaltyop = 1;
+		if (state6502.status & FLAG_DECIMAL) {
+			value  = ((uint16_t)read6502(ea));
+			result = (uint16_t)state6502.a - (value & 0x0f) + (state6502.status & FLAG_CARRY) - 1;
+			if ((result & 0x0f) > (state6502.a & 0x0f)) {
+				result -= 6;
+			}
+			result -= (value & 0xf0);
+			if ((result & 0xfff0) > ((uint16_t)state6502.a & 0xf0)) {
+				result -= 0x60;
+			}
+			if (result <= (uint16_t)state6502.a) {
+				setcarry();
+			} else {
+				clearcarry();
+			}
+			zerocalc(result); /* 65C02 change, Decimal Arithmetic sets NZV */
+			signcalc(result);
+			clockticks6502++;
+		} else {
+			value  = ((uint16_t)read6502(ea)) ^ 0x00FF;
+			result = (uint16_t)state6502.a + value + (uint16_t)(state6502.status & FLAG_CARRY);
+			carrycalc(result);
+			zerocalc(result);
+			overflowcalc(result, state6502.a, value);
+			signcalc(result);
+		}
+		saveaccum(result);
+	}
+	clockticks6502 += 5;
+	if (penaltyop && penaltyaddr)
+		clockticks6502++;
+} break;
+
+case 0xF2: { // sbc ind0
+	{
+		uint16_t eahelp, eahelp2;
+		eahelp  = (uint16_t)read6502(state6502.pc++);
+		eahelp2 = (eahelp & 0xFF00) | ((eahelp + 1) & 0x00FF); //zero-page wraparound
+		ea      = (uint16_t)read6502(eahelp) | ((uint16_t)read6502(eahelp2) << 8);
+	}
+	{
+		penaltyop = 1;
+		if (state6502.status & FLAG_DECIMAL) {
+			value  = ((uint16_t)read6502(ea));
+			result = (uint16_t)state6502.a - (value & 0x0f) + (state6502.status & FLAG_CARRY) - 1;
+			if ((result & 0x0f) > (state6502.a & 0x0f)) {
+				result -= 6;
+			}
+			result -= (value & 0xf0);
+			if ((result & 0xfff0) > ((uint16_t)state6502.a & 0xf0)) {
+				result -= 0x60;
+			}
+			if (result <= (uint16_t)state6502.a) {
+				setcarry();
+			} else {
+				clearcarry();
+			}
+			zerocalc(result); /* 65C02 change, Decimal Arithmetic sets NZV */
+			signcalc(result);
+			clockticks6502++;
+		} else {
+			value  = ((uint16_t)read6502(ea)) ^ 0x00FF;
+			result = (uint16_t)state6502.a + value + (uint16_t)(state6502.status & FLAG_CARRY);
+			carrycalc(result);
+			zerocalc(result);
+			overflowcalc(result, state6502.a, value);
+			signcalc(result);
+		}
+		saveaccum(result);
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0xF3: { // nop imp
+	{
+		switch (0xF3) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0xF4: { // nop imp
+	{
+		switch (0xF4) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0xF5: { // sbc zpx
+	{
+		ea = ((uint16_t)read6502((uint16_t)state6502.pc++) + (uint16_t)state6502.x) & 0xFF; // zero-page wraparound
+	}
+	{
+		penaltyop = 1;
+		if (state6502.status & FLAG_DECIMAL) {
+			value  = ((uint16_t)read6502(ea));
+			result = (uint16_t)state6502.a - (value & 0x0f) + (state6502.status & FLAG_CARRY) - 1;
+			if ((result & 0x0f) > (state6502.a & 0x0f)) {
+				result -= 6;
+			}
+			result -= (value & 0xf0);
+			if ((result & 0xfff0) > ((uint16_t)state6502.a & 0xf0)) {
+				result -= 0x60;
+			}
+			if (result <= (uint16_t)state6502.a) {
+				setcarry();
+			} else {
+				clearcarry();
+			}
+			zerocalc(result); /* 65C02 change, Decimal Arithmetic sets NZV */
+			signcalc(result);
+			clockticks6502++;
+		} else {
+			value  = ((uint16_t)read6502(ea)) ^ 0x00FF;
+			result = (uint16_t)state6502.a + value + (uint16_t)(state6502.status & FLAG_CARRY);
+			carrycalc(result);
+			zerocalc(result);
+			overflowcalc(result, state6502.a, value);
+			signcalc(result);
+		}
+		saveaccum(result);
+	}
+	clockticks6502 += 4;
+} break;
+
+case 0xF6: { // inc zpx
+	{
+		ea = ((uint16_t)read6502((uint16_t)state6502.pc++) + (uint16_t)state6502.x) & 0xFF; // zero-page wraparound
+	}
+	{
+		value  = ((uint16_t)read6502(ea));
+		result = value + 1;
+		zerocalc(result);
+		signcalc(result);
+		write6502(ea, ((result) & 0x00FF));
+	}
+	clockticks6502 += 6;
+} break;
+
+case 0xF7: { // smb7 zp
+	{
+		ea = (uint16_t)read6502((uint16_t)state6502.pc++);
+	}
+	{
+		write6502(ea, ((((uint16_t)read6502(ea)) | 0x80) & 0x00FF));
+	}
+	clockticks6502 += 5;
+} break;
+
+case 0xF8: { // sed imp
+	{
+		setdecimal();
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0xF9: { // sbc absy
+	{
+		uint16_t startpage;
+		ea        = ((uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8));
+		startpage = ea & 0xFF00;
+		ea += (uint16_t)state6502.y;
+		if (startpage != (ea & 0xFF00)) { //one cycle penlty for page-crossing on some opcodes
+			penaltyaddr = 1;
+		}
+		state6502.pc += 2;
+	}
+	{
+		penaltyop = 1;
+		if (state6502.status & FLAG_DECIMAL) {
+			value  = ((uint16_t)read6502(ea));
+			result = (uint16_t)state6502.a - (value & 0x0f) + (state6502.status & FLAG_CARRY) - 1;
+			if ((result & 0x0f) > (state6502.a & 0x0f)) {
+				result -= 6;
+			}
+			result -= (value & 0xf0);
+			if ((result & 0xfff0) > ((uint16_t)state6502.a & 0xf0)) {
+				result -= 0x60;
+			}
+			if (result <= (uint16_t)state6502.a) {
+				setcarry();
+			} else {
+				clearcarry();
+			}
+			zerocalc(result); /* 65C02 change, Decimal Arithmetic sets NZV */
+			signcalc(result);
+			clockticks6502++;
+		} else {
+			value  = ((uint16_t)read6502(ea)) ^ 0x00FF;
+			result = (uint16_t)state6502.a + value + (uint16_t)(state6502.status & FLAG_CARRY);
+			carrycalc(result);
+			zerocalc(result);
+			overflowcalc(result, state6502.a, value);
+			signcalc(result);
+		}
+		saveaccum(result);
+	}
+	clockticks6502 += 4;
+	if (penaltyop && penaltyaddr)
+		clockticks6502++;
+} break;
+
+case 0xFA: { // plx imp
+	{
+		state6502.x = pull8();
+		zerocalc(state6502.x);
+		signcalc(state6502.x);
+	}
+	clockticks6502 += 4;
+} break;
+
+case 0xFB: { // nop imp
+	{
+		switch (0xFB) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0xFC: { // nop imp
+	{
+		switch (0xFC) {
+			case 0x1C:
+			case 0x3C:
+			case 0x5C:
+			case 0x7C:
+			case 0xDC:
+			case 0xFC:
+				penaltyop = 1;
+				break;
+		}
+	}
+	clockticks6502 += 2;
+} break;
+
+case 0xFD: { // sbc absx
+	{
+		uint16_t startpage;
+		ea        = ((uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8));
+		startpage = ea & 0xFF00;
+		ea += (uint16_t)state6502.x;
+		if (startpage != (ea & 0xFF00)) { //one cycle penlty for page-crossing on some opcodes
+			penaltyaddr = 1;
+		}
+		state6502.pc += 2;
+	}
+	{
+		penaltyop = 1;
+		if (state6502.status & FLAG_DECIMAL) {
+			value  = ((uint16_t)read6502(ea));
+			result = (uint16_t)state6502.a - (value & 0x0f) + (state6502.status & FLAG_CARRY) - 1;
+			if ((result & 0x0f) > (state6502.a & 0x0f)) {
+				result -= 6;
+			}
+			result -= (value & 0xf0);
+			if ((result & 0xfff0) > ((uint16_t)state6502.a & 0xf0)) {
+				result -= 0x60;
+			}
+			if (result <= (uint16_t)state6502.a) {
+				setcarry();
+			} else {
+				clearcarry();
+			}
+			zerocalc(result); /* 65C02 change, Decimal Arithmetic sets NZV */
+			signcalc(result);
+			clockticks6502++;
+		} else {
+			value  = ((uint16_t)read6502(ea)) ^ 0x00FF;
+			result = (uint16_t)state6502.a + value + (uint16_t)(state6502.status & FLAG_CARRY);
+			carrycalc(result);
+			zerocalc(result);
+			overflowcalc(result, state6502.a, value);
+			signcalc(result);
+		}
+		saveaccum(result);
+	}
+	clockticks6502 += 4;
+	if (penaltyop && penaltyaddr)
+		clockticks6502++;
+} break;
+
+case 0xFE: { // inc absx
+	{
+		uint16_t startpage;
+		ea        = ((uint16_t)read6502(state6502.pc) | ((uint16_t)read6502(state6502.pc + 1) << 8));
+		startpage = ea & 0xFF00;
+		ea += (uint16_t)state6502.x;
+		if (startpage != (ea & 0xFF00)) { //one cycle penlty for page-crossing on some opcodes
+			penaltyaddr = 1;
+		}
+		state6502.pc += 2;
+	}
+	{
+		value  = ((uint16_t)read6502(ea));
+		result = value + 1;
+		zerocalc(result);
+		signcalc(result);
+		write6502(ea, ((result) & 0x00FF));
+	}
+	clockticks6502 += 7;
+} break;
+
+case 0xFF: { // bbs7 zprel
+	{
+		ea      = (uint16_t)read6502(state6502.pc);
+		reladdr = (uint16_t)read6502(state6502.pc + 1);
+		if (reladdr & 0x80)
+			reladdr |= 0xFF00;
+		state6502.pc += 2;
+	}
+	{
+		{
+		const uint16_t bitmask = 0x80;
+		if ((((uint16_t)read6502(ea)) & bitmask) != 0) {
+			oldpc = state6502.pc;
+			state6502.pc += reladdr;
+			if ((oldpc & 0xFF00) != (state6502.pc & 0xFF00))
+				clockticks6502 += 2; //check if jump crossed a page boundary
+			else
+				clockticks6502++;
+		}}
+	}
+	clockticks6502 += 5;
+} break;
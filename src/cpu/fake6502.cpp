@@ -39,8 +39,9 @@
  *   - Call this once before you begin execution.    *
  *                                                   *
  * void exec6502(uint32_t tickcount)                 *
- *   - Execute 6502 code up to the next specified    *
- *     count of clock ticks.                         *
+ *   - Execute 6502 code for at least the specified  *
+ *     count of clock ticks, or until yield6502() is *
+ *     called or the PC reaches yieldpc6502.         *
  *                                                   *
  * void step6502()                                   *
  *   - Execute a single instrution.                  *
@@ -67,6 +68,8 @@
 #include "fake6502.h"
 
 #include "../debugger.h"
+#include "../profiler.h"
+#include "../trace.h"
 #include <stdint.h>
 #include <stdio.h>
 
@@ -82,7 +85,7 @@
 #define BASE_STACK 0x100
 
 // 6502 CPU registers
-_state6502 state6502, debug_state6502;
+_state6502 state6502;
 
 // helper variables
 uint32_t instructions   = 0; // keep track of total instructions executed
@@ -90,6 +93,7 @@ uint64_t clockticks6502 = 0, clockgoal6502 = 0;
 uint16_t oldpc, ea, reladdr, value, result;
 uint8_t  opcode, oldstatus;
 uint8_t  debug6502 = 0;
+uint16_t yieldpc6502 = 0xffff;
 
 uint8_t penaltyop, penaltyaddr;
 uint8_t waiting = 0;
@@ -125,6 +129,25 @@ static void putvalue(uint16_t saveval)
 		write6502(ea, (saveval & 0x00FF));
 }
 
+// Runs the instruction whose opcode has just been fetched, including its cycle count.
+// Callers that roll back on a debug break also restore clockticks6502.
+static inline void execute6502()
+{
+#if defined(FAKE6502_FUSED)
+	// One case per opcode with the addressing mode and operation inlined, see buildtables.py
+	switch (opcode) {
+#	include "dispatch.h"
+	}
+#else
+	(*addrtable[opcode])();
+	(*optable[opcode])();
+
+	clockticks6502 += ticktable[opcode];
+	if (penaltyop && penaltyaddr)
+		clockticks6502++;
+#endif
+}
+
 void nmi6502()
 {
 	auto &ss     = stack6502[state6502.sp_depth++];
@@ -165,118 +188,172 @@ void irq6502()
 	waiting = 0;
 }
 
-void exec6502(uint32_t tickcount)
+// Fetches and runs one instruction. With DEBUG, the instruction is rolled back if it hit a
+// breakpoint and false is returned. Without it, nothing is saved for a rollback, so it must
+// only be used when the debugger has no flags that could set debug6502. With PROFILING and TRACING,
+// the instruction is passed on to the profiler and the trace once it has completed.
+template <bool DEBUG, bool PROFILING, bool TRACING>
+static bool execute_instruction6502()
 {
-	debug6502 = 0;
-
-	if (waiting) {
-		clockticks6502 += tickcount;
-		clockgoal6502 = clockticks6502;
-		return;
+	// Whatever the enabled options don't use of this is optimized away.
+	const _state6502 start_state      = state6502;
+	const uint64_t   start_clockticks = clockticks6502;
+	uint8_t          start_bank       = 0;
+	uint8_t          start_ram_bank   = 0;
+	uint8_t          start_rom_bank   = 0;
+	if constexpr (PROFILING) {
+		start_bank = bank6502(start_state.pc);
+	}
+	if constexpr (TRACING) {
+		start_ram_bank = bank6502(0xa000);
+		start_rom_bank = bank6502(0xc000);
 	}
 
-	clockgoal6502 += tickcount;
-
-	while (clockticks6502 < clockgoal6502) {
-		debug_state6502                     = state6502;
-		const uint64_t debug_clockticks6502 = clockticks6502;
-
-		opcode = read6502(state6502.pc++);
+	opcode = read6502(state6502.pc++);
+	if constexpr (DEBUG) {
 		if (debug6502 & DEBUG6502_EXEC) {
-			state6502      = debug_state6502;
-			clockticks6502 = debug_clockticks6502;
-			return;
+			state6502      = start_state;
+			clockticks6502 = start_clockticks;
+			return false;
 		}
-		state6502.status |= FLAG_CONSTANT;
+	}
+	state6502.status |= FLAG_CONSTANT;
+
+	penaltyop   = 0;
+	penaltyaddr = 0;
 
-		penaltyop   = 0;
-		penaltyaddr = 0;
+	execute6502();
 
-		(*addrtable[opcode])();
-		(*optable[opcode])();
+	// A pending IRQ is taken as soon as the I flag is cleared (CLI, PLP, RTI), so the batch ends there
+	// and the caller gets to look at the IRQ lines.
+	if (start_state.status & ~state6502.status & FLAG_INTERRUPT) {
+		yield6502();
+	}
 
+	if constexpr (DEBUG) {
 		if (debug6502 & (DEBUG6502_READ | DEBUG6502_WRITE)) {
-			state6502      = debug_state6502;
-			clockticks6502 = debug_clockticks6502;
-			return;
+			state6502      = start_state;
+			clockticks6502 = start_clockticks;
+			return false;
 		}
+		debug6502 = 0;
+	}
 
-		clockticks6502 += ticktable[opcode];
-		if (penaltyop && penaltyaddr)
-			clockticks6502++;
+	if constexpr (PROFILING) {
+		profiler_instruction(start_state.pc, start_bank, start_state.sp_depth, (uint32_t)(clockticks6502 - start_clockticks));
+	}
+	if constexpr (TRACING) {
+		trace_instruction(start_state, opcode, start_ram_bank, start_rom_bank, start_clockticks);
+	}
 
-		instructions++;
-		debug6502 = 0;
+	instructions++;
+	return true;
+}
+
+template <bool DEBUG, bool PROFILING, bool TRACING>
+static void exec_instructions6502()
+{
+	while (clockticks6502 < clockgoal6502) {
+		if (!execute_instruction6502<DEBUG, PROFILING, TRACING>()) {
+			return;
+		}
+		if (waiting || state6502.pc >= yieldpc6502) {
+			break;
+		}
 	}
 }
 
-void step6502()
+// Each combination of DEBUG, PROFILING and TRACING gets its own copy of the loop, picked by hooks6502().
+static bool (*const Execute_instruction6502[])() = {
+	execute_instruction6502<false, false, false>,
+	execute_instruction6502<false, false, true>,
+	execute_instruction6502<false, true, false>,
+	execute_instruction6502<false, true, true>,
+	execute_instruction6502<true, false, false>,
+	execute_instruction6502<true, false, true>,
+	execute_instruction6502<true, true, false>,
+	execute_instruction6502<true, true, true>,
+};
+
+static void (*const Exec_instructions6502[])() = {
+	exec_instructions6502<false, false, false>,
+	exec_instructions6502<false, false, true>,
+	exec_instructions6502<false, true, false>,
+	exec_instructions6502<false, true, true>,
+	exec_instructions6502<true, false, false>,
+	exec_instructions6502<true, false, true>,
+	exec_instructions6502<true, true, false>,
+	exec_instructions6502<true, true, true>,
+};
+
+static constexpr int Hook_debug   = 4;
+static constexpr int Hook_profile = 2;
+static constexpr int Hook_trace   = 1;
+
+static int hooks6502()
+{
+	return (debugger_has_active_flags() ? Hook_debug : 0) | (profiler_is_enabled() ? Hook_profile : 0) | (trace_is_enabled() ? Hook_trace : 0);
+}
+
+void exec6502(uint32_t tickcount)
 {
 	debug6502 = 0;
 
 	if (waiting) {
-		++clockticks6502;
+		clockticks6502 += tickcount;
 		clockgoal6502 = clockticks6502;
+		if (profiler_is_enabled()) {
+			profiler_wait(tickcount);
+		}
 		return;
 	}
 
-	debug_state6502                     = state6502;
-	const uint64_t debug_clockticks6502 = clockticks6502;
+	clockgoal6502 = clockticks6502 + tickcount;
 
-	opcode = read6502(state6502.pc++);
-	if (debug6502 & DEBUG6502_EXEC) {
-		state6502      = debug_state6502;
-		clockticks6502 = debug_clockticks6502;
-		return;
-	}
-	state6502.status |= FLAG_CONSTANT;
+	Exec_instructions6502[hooks6502()]();
+}
 
-	penaltyop   = 0;
-	penaltyaddr = 0;
+void yield6502()
+{
+	// Called from within an instruction, so clockticks6502 hasn't advanced yet
+	// and exec6502 stops as soon as the current instruction completes.
+	clockgoal6502 = clockticks6502;
+}
 
-	(*addrtable[opcode])();
-	(*optable[opcode])();
+void step6502()
+{
+	debug6502 = 0;
 
-	if (debug6502 & (DEBUG6502_READ | DEBUG6502_WRITE)) {
-		state6502      = debug_state6502;
-		clockticks6502 = debug_clockticks6502;
+	if (waiting) {
+		++clockticks6502;
+		clockgoal6502 = clockticks6502;
+		if (profiler_is_enabled()) {
+			profiler_wait(1);
+		}
 		return;
 	}
 
-	clockticks6502 += ticktable[opcode];
-	if (penaltyop && penaltyaddr)
-		clockticks6502++;
-	clockgoal6502 = clockticks6502;
-
-	instructions++;
-	debug6502 = 0;
+	const bool completed = Execute_instruction6502[hooks6502()]();
+	if (completed) {
+		clockgoal6502 = clockticks6502;
+	}
 }
 
 void force6502()
 {
-	debug6502 = 0;
+	debug6502 = DEBUG6502_FORCE;
 
 	if (waiting) {
 		++clockticks6502;
 		clockgoal6502 = clockticks6502;
+		if (profiler_is_enabled()) {
+			profiler_wait(1);
+		}
 		return;
 	}
 
-	opcode = read6502(state6502.pc++);
-	state6502.status |= FLAG_CONSTANT;
-
-	penaltyop   = 0;
-	penaltyaddr = 0;
-
-	(*addrtable[opcode])();
-	(*optable[opcode])();
-
-	clockticks6502 += ticktable[opcode];
-	if (penaltyop && penaltyaddr)
-		clockticks6502++;
+	Execute_instruction6502[hooks6502() & ~Hook_debug]();
 	clockgoal6502 = clockticks6502;
-
-	instructions++;
 }
 
 //  Fixes from http://6502.org/tutorials/65c02opcodes.html
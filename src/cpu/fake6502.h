@@ -10,6 +10,7 @@
 #define DEBUG6502_EXEC 0x1
 #define DEBUG6502_READ 0x2
 #define DEBUG6502_WRITE 0x4
+#define DEBUG6502_FORCE 0x8 // Set while force6502() runs an instruction regardless of breakpoints
 
 struct _state6502 {
 	uint16_t pc;
@@ -36,9 +37,11 @@ extern void     reset6502();
 extern void     step6502();
 extern void     force6502();
 extern void     exec6502(uint32_t tickcount);
+extern void     yield6502();
 extern void     nmi6502();
 extern void     irq6502();
 extern uint64_t clockticks6502;
 extern uint8_t  debug6502;
+extern uint16_t yieldpc6502;
 
 #endif
@@ -1,16 +1,62 @@
 #include "debugger.h"
 #include "cpu/fake6502.h"
 #include "cpu/mnemonics.h"
+#include "expression.h"
 #include "glue.h"
 #include "memory.h"
 
+#include <map>
+#include <vector>
+
 //
 // Breakpoints
 //
 
 static breakpoint_list Breakpoints;
 static breakpoint_list Active_breakpoints;
-static uint8_t        *Breakpoint_flags = nullptr;
+
+// Flags are kept 256 addresses at a time, in pages that are only allocated while they have flags or
+// watchpoints. Banked addresses are offset by their bank (see get_offset), so each bank has its own pages.
+static constexpr uint32_t Num_breakpoint_pages = (0xa000 + 0x6000 * NUM_MAX_RAM_BANKS) >> 8;
+
+struct breakpoint_page {
+	uint8_t  flags[256];  // Active flags in the low nibble, all flags in the high nibble
+	uint16_t used;        // Count of addresses with any flags
+	uint16_t active;      // Count of addresses with active flags
+	uint16_t watchpoints; // Count of watchpoints covering any of the page
+};
+
+static std::vector<breakpoint_page> Breakpoint_pages;
+static std::vector<uint16_t>        Free_breakpoint_pages;
+static uint16_t                    *Breakpoint_page_index = nullptr;                    // For each page, 1 + its index in Breakpoint_pages, or 0 if it isn't allocated
+static uint64_t                     Armed_pages[(Num_breakpoint_pages + 63) / 64] = {}; // A bit for each page with active flags or watchpoints
+static uint32_t                     Num_armed_pages = 0;
+
+static watchpoint_list Watchpoints;
+
+// Breakpoints get settings when they're first hit or configured. Without a condition, hit target or
+// message, they always break.
+struct breakpoint_settings {
+	expression         condition;
+	expression_message message;
+	uint32_t           hit_target = 0;
+	uint32_t           hits       = 0;
+};
+
+static std::map<breakpoint_type, breakpoint_settings> Breakpoint_settings;
+
+// The flagged addresses the current instruction touched, so that their breakpoints and watchpoints
+// can be checked once it has been rolled back. No instruction touches more than 7 addresses.
+struct breakpoint_access {
+	uint16_t address;
+	uint8_t  bank;
+	uint8_t  access; // How the address was accessed, as DEBUG6502_* flags
+	uint8_t  value;  // What was written, since the write itself is held back
+};
+
+static constexpr int     Max_accesses = 8;
+static breakpoint_access Accesses[Max_accesses];
+static int               Num_accesses = 0;
 
 enum debugger_mode {
 	DEBUG_RUN,
@@ -62,14 +108,77 @@ static uint32_t get_offset(const uint16_t addr, const uint8_t bank)
 	}
 }
 
-static uint8_t &get_flags(const uint16_t addr, const uint8_t bank)
+static breakpoint_page *find_page(const uint32_t page_number)
+{
+	const uint16_t index = Breakpoint_page_index[page_number];
+	return (index != 0) ? &Breakpoint_pages[index - 1] : nullptr;
+}
+
+static breakpoint_page &allocate_page(const uint32_t page_number)
+{
+	uint16_t &index = Breakpoint_page_index[page_number];
+	if (index == 0) {
+		if (Free_breakpoint_pages.empty()) {
+			Breakpoint_pages.emplace_back();
+			index = (uint16_t)Breakpoint_pages.size();
+		} else {
+			index = Free_breakpoint_pages.back();
+			Free_breakpoint_pages.pop_back();
+		}
+		Breakpoint_pages[index - 1] = {};
+	}
+	return Breakpoint_pages[index - 1];
+}
+
+// Arms or disarms a page after its counts changed, and frees it once nothing is left in it.
+static void update_page(const uint32_t page_number)
+{
+	uint16_t              &index = Breakpoint_page_index[page_number];
+	const breakpoint_page &page  = Breakpoint_pages[index - 1];
+
+	const bool     armed = page.active != 0 || page.watchpoints != 0;
+	const uint64_t bit   = (uint64_t)1 << (page_number & 63);
+	uint64_t      &bits  = Armed_pages[page_number >> 6];
+	if (armed != ((bits & bit) != 0)) {
+		if (armed) {
+			bits |= bit;
+			++Num_armed_pages;
+		} else {
+			bits &= ~bit;
+			--Num_armed_pages;
+		}
+		// The memory fast path skips pages that aren't armed, so it needs to know when that changes.
+		memory_update_page_table();
+	}
+
+	if (page.used == 0 && page.watchpoints == 0) {
+		Free_breakpoint_pages.push_back(index);
+		index = 0;
+	}
+}
+
+static uint8_t get_flags(const uint16_t addr, const uint8_t bank)
 {
-	return Breakpoint_flags[get_offset(addr, bank)];
+	const uint32_t         offset = get_offset(addr, bank);
+	const breakpoint_page *page   = find_page(offset >> 8);
+	return (page != nullptr) ? page->flags[offset & 0xff] : 0;
 }
 
 static void set_flags(const uint16_t addr, const uint8_t bank, uint8_t flags)
 {
-	Breakpoint_flags[get_offset(addr, bank)] = flags;
+	const uint32_t offset      = get_offset(addr, bank);
+	const uint32_t page_number = offset >> 8;
+	if (flags == 0 && find_page(page_number) == nullptr) {
+		return;
+	}
+
+	breakpoint_page &page    = allocate_page(page_number);
+	uint8_t         &current = page.flags[offset & 0xff];
+	page.used += (flags != 0) - (current != 0);
+	page.active += ((flags & 0x0f) != 0) - ((current & 0x0f) != 0);
+	current = flags;
+
+	update_page(page_number);
 }
 
 static bool execution_exited_interrupt()
@@ -93,17 +202,21 @@ static bool execution_exited_interrupt()
 
 void debugger_init(int max_ram_banks)
 {
-	constexpr const int breakpoint_flags_size = 0xa000 + 0x6000 * NUM_MAX_RAM_BANKS;
-
-	Breakpoint_flags = new uint8_t[breakpoint_flags_size];
-	memset(Breakpoint_flags, 0, breakpoint_flags_size);
+	Breakpoint_page_index = new uint16_t[Num_breakpoint_pages];
+	memset(Breakpoint_page_index, 0, Num_breakpoint_pages * sizeof(uint16_t));
 
 	options_apply_debugger_opts();
 }
 
 void debugger_shutdown()
 {
-	delete[] Breakpoint_flags;
+	delete[] Breakpoint_page_index;
+	Breakpoint_page_index = nullptr;
+	Breakpoint_pages.clear();
+	Free_breakpoint_pages.clear();
+	memset(Armed_pages, 0, sizeof(Armed_pages));
+	Num_armed_pages = 0;
+	Watchpoints.clear();
 }
 
 bool debugger_is_paused()
@@ -200,13 +313,124 @@ bool debugger_is_paused()
 	return false;
 }
 
+bool debugger_is_running()
+{
+	return Debug_mode == DEBUG_RUN;
+}
+
+// Counts a hit of a breakpoint whose flags matched, and returns whether it should break.
+static bool breakpoint_is_hit(const breakpoint_type bp)
+{
+	breakpoint_settings &s = Breakpoint_settings[bp];
+	if (!s.condition.empty() && s.condition.evaluate() == 0) {
+		return false;
+	}
+	if (++s.hits < s.hit_target) {
+		return false;
+	}
+	if (!s.message.empty()) {
+		printf("%s\n", s.message.format().c_str());
+		return false;
+	}
+	return true;
+}
+
+static bool watchpoint_covers(const watchpoint_type &watchpoint, uint16_t address, uint8_t bank)
+{
+	return address >= watchpoint.first && address <= watchpoint.last && (address < 0xa000 || bank == watchpoint.bank);
+}
+
+static int64_t watchpoint_value(const uint8_t *bytes, uint8_t size_type)
+{
+	const int size  = (size_type & 3) + 1;
+	int64_t   value = 0;
+	for (int i = size - 1; i >= 0; --i) {
+		value = (value << 8) | bytes[i];
+	}
+	if ((size_type & 4) && (bytes[size - 1] & 0x80)) {
+		value -= (int64_t)1 << (size * 8);
+	}
+	return value;
+}
+
+// Returns whether the accesses of the current instruction set off a watchpoint.
+static bool watchpoint_is_hit(const watchpoint_type &watchpoint, const breakpoint_access *accesses, int num_accesses)
+{
+	if (watchpoint.size_type < 0) {
+		for (int i = 0; i < num_accesses; ++i) {
+			const breakpoint_access &access = accesses[i];
+			if ((access.access & watchpoint.flags) == 0 || !watchpoint_covers(watchpoint, access.address, access.bank)) {
+				continue;
+			}
+			const int64_t old   = debug_read6502(access.address, access.bank);
+			const int64_t value = (access.access & DEBUG6502_WRITE) ? access.value : old;
+			if (watchpoint.condition.empty() || watchpoint.condition.evaluate(value, old) != 0) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Memory still has the old value, and the writes that were held back make the new one.
+	uint8_t old_bytes[4];
+	uint8_t new_bytes[4];
+	for (uint16_t i = 0; i <= watchpoint.last - watchpoint.first; ++i) {
+		old_bytes[i] = debug_read6502(watchpoint.first + i, watchpoint.bank);
+		new_bytes[i] = old_bytes[i];
+	}
+
+	bool written = false;
+	for (int i = 0; i < num_accesses; ++i) {
+		const breakpoint_access &access = accesses[i];
+		if ((access.access & DEBUG6502_WRITE) && watchpoint_covers(watchpoint, access.address, access.bank)) {
+			new_bytes[access.address - watchpoint.first] = access.value;
+			written                                      = true;
+		}
+	}
+	if (!written) {
+		return false;
+	}
+
+	const int64_t old   = watchpoint_value(old_bytes, watchpoint.size_type);
+	const int64_t value = watchpoint_value(new_bytes, watchpoint.size_type);
+	return value != old && (watchpoint.condition.empty() || watchpoint.condition.evaluate(value, old) != 0);
+}
+
 void debugger_process_cpu()
 {
+	const int num_accesses = Num_accesses;
+	Num_accesses           = 0;
+
 	if (debugger_step_clocks() == 0) {
 		return;
 	}
 
-	debugger_pause_execution();
+	bool hit = false;
+	for (int i = 0; i < num_accesses; ++i) {
+		const breakpoint_access &access = Accesses[i];
+
+		// Memory flags an execute breakpoint on any read of its address, but only fetching the opcode counts.
+		uint8_t kinds = access.access;
+		if (access.address != state6502.pc || access.bank != memory_get_current_bank(access.address)) {
+			kinds &= ~DEBUG6502_EXEC;
+		}
+
+		// Every breakpoint is checked, so that all of their hit counts and messages are kept up.
+		if ((get_flags(access.address, access.bank) & kinds & 0x0f) != 0 && breakpoint_is_hit({ access.address, access.bank })) {
+			hit = true;
+		}
+	}
+
+	for (watchpoint_type &watchpoint : Watchpoints) {
+		if (watchpoint_is_hit(watchpoint, Accesses, num_accesses)) {
+			++watchpoint.hits;
+			hit = true;
+		}
+	}
+
+	if (hit) {
+		debugger_pause_execution();
+	}
 }
 
 void debugger_pause_execution()
@@ -309,6 +533,65 @@ uint8_t debugger_get_flags(uint16_t address, uint8_t bank)
 	return get_flags(address, bank) & 0x0f;
 }
 
+uint8_t debugger_check_access(uint16_t address, uint8_t bank, uint8_t access, uint8_t value /* = 0 */)
+{
+	if (debug6502 & DEBUG6502_FORCE) {
+		return 0;
+	}
+	if (address < 0xa000) {
+		bank = 0;
+	}
+
+	const uint32_t         offset = get_offset(address, bank);
+	const breakpoint_page *page   = find_page(offset >> 8);
+	if (page == nullptr) {
+		return 0;
+	}
+	uint8_t flags = page->flags[offset & 0xff] & access;
+	if (page->watchpoints != 0) {
+		for (const watchpoint_type &watchpoint : Watchpoints) {
+			if (watchpoint_covers(watchpoint, address, bank)) {
+				flags |= watchpoint.flags & access;
+			}
+		}
+	}
+	if (flags == 0) {
+		return 0;
+	}
+
+	// The CPU clears debug6502 before each instruction, and whatever was collected before that is stale.
+	if (debug6502 == 0) {
+		Num_accesses = 0;
+	}
+	for (int i = 0; i < Num_accesses; ++i) {
+		if (Accesses[i].address == address && Accesses[i].bank == bank) {
+			Accesses[i].access |= access;
+			if (access & DEBUG6502_WRITE) {
+				Accesses[i].value = value;
+			}
+			return flags;
+		}
+	}
+	if (Num_accesses < Max_accesses) {
+		Accesses[Num_accesses++] = { address, bank, access, value };
+	}
+	return flags;
+}
+
+bool debugger_has_active_flags()
+{
+	return Num_armed_pages != 0;
+}
+
+bool debugger_page_has_flags(uint8_t page, uint8_t bank)
+{
+	if (page < 0xa0) {
+		bank = 0;
+	}
+	const uint32_t page_number = get_offset(page << 8, bank) >> 8;
+	return (Armed_pages[page_number >> 6] >> (page_number & 63)) & 1;
+}
+
 void debugger_add_breakpoint(uint16_t address, uint8_t bank /* = 0 */, uint8_t flags /* = DEBUG6502_EXEC */)
 {
 	if (address < 0xa000) {
@@ -344,6 +627,7 @@ void debugger_remove_breakpoint(uint16_t address, uint8_t bank /* = 0 */, uint8_
 		breakpoint_type old_bp{ address, bank };
 		Breakpoints.erase(old_bp);
 		Active_breakpoints.erase(old_bp);
+		Breakpoint_settings.erase(old_bp);
 	}
 }
 
@@ -408,6 +692,79 @@ const breakpoint_list &debugger_get_breakpoints()
 	return Breakpoints;
 }
 
+static breakpoint_settings *find_settings(uint16_t address, uint8_t bank)
+{
+	if (address < 0xa000) {
+		bank = 0;
+	}
+	const auto settings = Breakpoint_settings.find({ address, bank });
+	return (settings != Breakpoint_settings.end()) ? &settings->second : nullptr;
+}
+
+static breakpoint_settings &get_settings(uint16_t address, uint8_t bank)
+{
+	if (address < 0xa000) {
+		bank = 0;
+	}
+	return Breakpoint_settings[{ address, bank }];
+}
+
+bool debugger_set_breakpoint_condition(uint16_t address, uint8_t bank, const char *condition, std::string &error)
+{
+	expression &expr = get_settings(address, bank).condition;
+	if (condition == nullptr || condition[0] == '\0') {
+		expr.clear();
+		return true;
+	}
+	return expr.compile(condition, error);
+}
+
+bool debugger_set_breakpoint_message(uint16_t address, uint8_t bank, const char *message, std::string &error)
+{
+	expression_message &msg = get_settings(address, bank).message;
+	if (message == nullptr || message[0] == '\0') {
+		msg.clear();
+		return true;
+	}
+	return msg.compile(message, error);
+}
+
+void debugger_set_breakpoint_hit_target(uint16_t address, uint8_t bank, uint32_t hits)
+{
+	get_settings(address, bank).hit_target = hits;
+}
+
+void debugger_reset_breakpoint_hits(uint16_t address, uint8_t bank)
+{
+	if (breakpoint_settings *settings = find_settings(address, bank)) {
+		settings->hits = 0;
+	}
+}
+
+const char *debugger_get_breakpoint_condition(uint16_t address, uint8_t bank)
+{
+	const breakpoint_settings *settings = find_settings(address, bank);
+	return settings ? settings->condition.text().c_str() : "";
+}
+
+const char *debugger_get_breakpoint_message(uint16_t address, uint8_t bank)
+{
+	const breakpoint_settings *settings = find_settings(address, bank);
+	return settings ? settings->message.text().c_str() : "";
+}
+
+uint32_t debugger_get_breakpoint_hit_target(uint16_t address, uint8_t bank)
+{
+	const breakpoint_settings *settings = find_settings(address, bank);
+	return settings ? settings->hit_target : 0;
+}
+
+uint32_t debugger_get_breakpoint_hits(uint16_t address, uint8_t bank)
+{
+	const breakpoint_settings *settings = find_settings(address, bank);
+	return settings ? settings->hits : 0;
+}
+
 //
 // Memory watch
 //
@@ -451,3 +808,68 @@ const watch_address_list &debugger_get_watchlist()
 {
 	return Watchlist;
 }
+
+//
+// Watchpoints
+//
+
+// Counts the watchpoint in each page it covers, from either side of $A000.
+static void arm_watchpoint(const watchpoint_type &watchpoint, int delta)
+{
+	for (uint32_t p = watchpoint.first >> 8; p <= (uint32_t)(watchpoint.last >> 8); ++p) {
+		const uint32_t   page_number = get_offset(p << 8, watchpoint.bank) >> 8;
+		breakpoint_page &page        = allocate_page(page_number);
+		page.watchpoints += delta;
+		update_page(page_number);
+	}
+}
+
+static bool add_watchpoint(watchpoint_type &&watchpoint, const char *condition, std::string &error)
+{
+	if (watchpoint.last < 0xa000) {
+		watchpoint.bank = 0;
+	}
+	if (condition != nullptr && condition[0] != '\0' && !watchpoint.condition.compile(condition, error)) {
+		return false;
+	}
+	arm_watchpoint(watchpoint, 1);
+	Watchpoints.push_back(std::move(watchpoint));
+	return true;
+}
+
+bool debugger_add_range_watchpoint(uint16_t first, uint16_t last, uint8_t bank, uint8_t flags, const char *condition, std::string &error)
+{
+	if (last < first) {
+		error = "The range ends before it starts";
+		return false;
+	}
+	flags &= DEBUG6502_READ | DEBUG6502_WRITE;
+	if (flags == 0) {
+		error = "Nothing to watch for";
+		return false;
+	}
+	return add_watchpoint({ first, last, bank, flags, -1 }, condition, error);
+}
+
+bool debugger_add_value_watchpoint(uint16_t address, uint8_t bank, uint8_t size_type, const char *condition, std::string &error)
+{
+	const uint16_t size = (size_type & 3) + 1;
+	if (address > 0x10000 - size) {
+		error = "The value doesn't fit below $10000";
+		return false;
+	}
+	return add_watchpoint({ address, (uint16_t)(address + size - 1), bank, DEBUG6502_WRITE, (int8_t)(size_type & 7) }, condition, error);
+}
+
+void debugger_remove_watchpoint(size_t index)
+{
+	if (index < Watchpoints.size()) {
+		arm_watchpoint(Watchpoints[index], -1);
+		Watchpoints.erase(Watchpoints.begin() + index);
+	}
+}
+
+const watchpoint_list &debugger_get_watchpoints()
+{
+	return Watchpoints;
+}
@@ -7,9 +7,12 @@
 #	define DEBUGGER_H
 
 #	include <set>
+#	include <string>
 #	include <tuple>
+#	include <vector>
 
 #include "cpu/fake6502.h"
+#include "expression.h"
 
 //
 // Breakpoints
@@ -21,6 +24,7 @@ using breakpoint_list = std::set<breakpoint_type>;
 void debugger_init(int max_ram_banks);
 void debugger_shutdown();
 bool debugger_is_paused();
+bool debugger_is_running();
 
 void debugger_process_cpu();
 void debugger_pause_execution();
@@ -34,6 +38,9 @@ void     debugger_interrupt();
 bool     debugger_step_interrupted();
 
 uint8_t  debugger_get_flags(uint16_t address, uint8_t bank);
+uint8_t  debugger_check_access(uint16_t address, uint8_t bank, uint8_t access, uint8_t value = 0); // Flags that the access hit, noted for debugger_process_cpu
+bool     debugger_has_active_flags();                                                                // Any breakpoints or watchpoints armed
+bool     debugger_page_has_flags(uint8_t page, uint8_t bank);                                        // Breakpoints or watchpoints armed in the page
 
 // Bank parameter is only meaninful for addresses >= $A000.
 // Addresses < $A000 will force bank to 0.
@@ -46,6 +53,19 @@ bool debugger_breakpoint_is_active(uint16_t address, uint8_t bank = 0, uint8_t f
 
 const breakpoint_list &debugger_get_breakpoints();
 
+// A breakpoint with a condition (see expression.h) only counts a hit when the condition is non-zero,
+// and one with a hit target only breaks once it has counted that many hits. One with a message is a
+// tracepoint: it writes the message out (see expression_message) instead of breaking.
+bool debugger_set_breakpoint_condition(uint16_t address, uint8_t bank, const char *condition, std::string &error);
+bool debugger_set_breakpoint_message(uint16_t address, uint8_t bank, const char *message, std::string &error);
+void debugger_set_breakpoint_hit_target(uint16_t address, uint8_t bank, uint32_t hits);
+void debugger_reset_breakpoint_hits(uint16_t address, uint8_t bank);
+
+const char *debugger_get_breakpoint_condition(uint16_t address, uint8_t bank);
+const char *debugger_get_breakpoint_message(uint16_t address, uint8_t bank);
+uint32_t    debugger_get_breakpoint_hit_target(uint16_t address, uint8_t bank);
+uint32_t    debugger_get_breakpoint_hits(uint16_t address, uint8_t bank);
+
 //
 // Memory watch
 //
@@ -70,4 +90,30 @@ void debugger_remove_watch(uint16_t address, uint8_t bank, uint8_t size);
 
 const watch_address_list &debugger_get_watchlist();
 
+//
+// Watchpoints
+//
+
+// A range watchpoint breaks on reads or writes (DEBUG6502_READ, DEBUG6502_WRITE) of any address from
+// first to last, where reads include fetching code. A value watchpoint breaks when a write changes the
+// value at first, as one of the DEBUGGER_SIZE_TYPE_* types. Either only breaks when its condition is
+// non-zero, with "value" the new value and "old" the previous one (for ranges, of the byte accessed).
+// Like breakpoints, they stop before the instruction that set them off.
+struct watchpoint_type {
+	uint16_t   first;
+	uint16_t   last;
+	uint8_t    bank; // For addresses >= $A000
+	uint8_t    flags;
+	int8_t     size_type; // Negative for range watchpoints
+	expression condition;
+	uint32_t   hits = 0;
+};
+using watchpoint_list = std::vector<watchpoint_type>;
+
+bool debugger_add_range_watchpoint(uint16_t first, uint16_t last, uint8_t bank, uint8_t flags, const char *condition, std::string &error);
+bool debugger_add_value_watchpoint(uint16_t address, uint8_t bank, uint8_t size_type, const char *condition, std::string &error);
+void debugger_remove_watchpoint(size_t index);
+
+const watchpoint_list &debugger_get_watchpoints();
+
 #endif
@@ -221,7 +221,7 @@ void icon_set::draw(int id, int x, int y, int w, int h, SDL_Color color)
 
 static void display_video()
 {
-	if (!vera_video_is_cheat_frame()) {
+	if (!vera_video_last_frame_skipped()) {
 		const uint8_t *video_buffer = vera_video_get_framebuffer();
 		glBindTexture(GL_TEXTURE_2D, Video_framebuffer_texture_handle);
 		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, Display.video_rect.w, Display.video_rect.h, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, video_buffer);
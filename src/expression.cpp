@@ -0,0 +1,528 @@
+// Commander X16 Emulator
+// Copyright (c) 2023 Stephen Horn, et al.
+// All rights reserved. License: 2-clause BSD
+
+#include "expression.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "glue.h"
+#include "memory.h"
+#include "symbols.h"
+
+// Deeper expressions than this are refused, so evaluating never has to check for room.
+static constexpr int Max_stack = 32;
+
+enum class expression_op : uint8_t {
+	constant,
+	reg_a,
+	reg_x,
+	reg_y,
+	reg_sp,
+	reg_p,
+	reg_pc,
+	clock,
+	ram_bank,
+	rom_bank,
+	value,
+	old_value,
+	peek,
+	peek_bank,
+	peekw,
+	peekw_bank,
+	negate,
+	logical_not,
+	bitwise_not,
+	multiply,
+	divide,
+	modulo,
+	add,
+	subtract,
+	shift_left,
+	shift_right,
+	less,
+	less_equal,
+	greater,
+	greater_equal,
+	equal,
+	not_equal,
+	bitwise_and,
+	bitwise_xor,
+	bitwise_or,
+	logical_and,
+	logical_or,
+};
+
+struct binary_operator {
+	const char   *token;
+	int           precedence; // Lowest binds loosest
+	expression_op op;
+};
+
+// Longer tokens come first, so that "<<" isn't read as "<".
+static const binary_operator Binary_operators[] = {
+	{ "||", 0, expression_op::logical_or },
+	{ "&&", 1, expression_op::logical_and },
+	{ "==", 5, expression_op::equal },
+	{ "!=", 5, expression_op::not_equal },
+	{ "<=", 6, expression_op::less_equal },
+	{ ">=", 6, expression_op::greater_equal },
+	{ "<<", 7, expression_op::shift_left },
+	{ ">>", 7, expression_op::shift_right },
+	{ "|", 2, expression_op::bitwise_or },
+	{ "^", 3, expression_op::bitwise_xor },
+	{ "&", 4, expression_op::bitwise_and },
+	{ "<", 6, expression_op::less },
+	{ ">", 6, expression_op::greater },
+	{ "+", 8, expression_op::add },
+	{ "-", 8, expression_op::subtract },
+	{ "*", 9, expression_op::multiply },
+	{ "/", 9, expression_op::divide },
+	{ "%", 9, expression_op::modulo },
+};
+
+static constexpr int Max_precedence = 9;
+
+struct named_value {
+	const char   *name;
+	expression_op op;
+	int64_t       value;
+};
+
+static const named_value Named_values[] = {
+	{ "a", expression_op::reg_a, 0 },
+	{ "x", expression_op::reg_x, 0 },
+	{ "y", expression_op::reg_y, 0 },
+	{ "sp", expression_op::reg_sp, 0 },
+	{ "p", expression_op::reg_p, 0 },
+	{ "pc", expression_op::reg_pc, 0 },
+	{ "c", expression_op::reg_p, 0x01 },
+	{ "z", expression_op::reg_p, 0x02 },
+	{ "i", expression_op::reg_p, 0x04 },
+	{ "d", expression_op::reg_p, 0x08 },
+	{ "v", expression_op::reg_p, 0x40 },
+	{ "n", expression_op::reg_p, 0x80 },
+	{ "clock", expression_op::clock, 0 },
+	{ "ram", expression_op::ram_bank, 0 },
+	{ "rom", expression_op::rom_bank, 0 },
+	{ "value", expression_op::value, 0 },
+	{ "old", expression_op::old_value, 0 },
+};
+
+// A recursive descent parser, emitting code for each operand before its operator.
+class expression_parser
+{
+public:
+	expression_parser(const char *text, std::vector<expression_instruction> &code)
+	    : pos(text),
+	      code(code)
+	{
+	}
+
+	bool parse(std::string &error)
+	{
+		if (!parse_binary(0)) {
+			error = this->error;
+			return false;
+		}
+		skip_space();
+		if (*pos != '\0') {
+			error = std::string("Unexpected \"") + pos + "\"";
+			return false;
+		}
+		return true;
+	}
+
+	int max_depth() const { return max; }
+
+private:
+	const char                          *pos;
+	std::vector<expression_instruction> &code;
+	std::string                          error;
+	int                                  depth = 0;
+	int                                  max   = 0;
+
+	void skip_space()
+	{
+		while (isspace((unsigned char)*pos)) {
+			++pos;
+		}
+	}
+
+	bool fail(const char *message)
+	{
+		error = message;
+		return false;
+	}
+
+	// Tracks how deep the stack gets as the code runs: each operation pops its operands and pushes one result.
+	void emit(expression_op op, int operands, int64_t value = 0)
+	{
+		code.push_back({ op, value });
+		depth += 1 - operands;
+		if (depth > max) {
+			max = depth;
+		}
+	}
+
+	const binary_operator *peek_operator()
+	{
+		skip_space();
+		for (const binary_operator &op : Binary_operators) {
+			if (strncmp(pos, op.token, strlen(op.token)) == 0) {
+				return &op;
+			}
+		}
+		return nullptr;
+	}
+
+	bool parse_binary(int precedence)
+	{
+		if (precedence > Max_precedence) {
+			return parse_unary();
+		}
+		if (!parse_binary(precedence + 1)) {
+			return false;
+		}
+		for (;;) {
+			const binary_operator *op = peek_operator();
+			if (op == nullptr || op->precedence != precedence) {
+				return true;
+			}
+			pos += strlen(op->token);
+			if (!parse_binary(precedence + 1)) {
+				return false;
+			}
+			emit(op->op, 2);
+		}
+	}
+
+	bool parse_unary()
+	{
+		skip_space();
+		expression_op op;
+		switch (*pos) {
+			case '-': op = expression_op::negate; break;
+			case '!': op = expression_op::logical_not; break;
+			case '~': op = expression_op::bitwise_not; break;
+			case '+':
+				++pos;
+				return parse_unary();
+			default:
+				return parse_primary();
+		}
+		++pos;
+		if (!parse_unary()) {
+			return false;
+		}
+		emit(op, 1);
+		return true;
+	}
+
+	bool parse_number()
+	{
+		int base = 10;
+		if (*pos == '$') {
+			base = 16;
+			++pos;
+		} else if (*pos == '%') {
+			base = 2;
+			++pos;
+		} else if (pos[0] == '0' && (pos[1] == 'x' || pos[1] == 'X')) {
+			base = 16;
+			pos += 2;
+		}
+
+		char          *end;
+		const uint64_t value = strtoull(pos, &end, base);
+		if (end == pos) {
+			return fail("Expected a number");
+		}
+		pos = end;
+		emit(expression_op::constant, 0, (int64_t)value);
+		return true;
+	}
+
+	bool parse_peek(bool word)
+	{
+		skip_space();
+		if (*pos != '(') {
+			return fail("Expected ( after peek");
+		}
+		++pos;
+		if (!parse_binary(0)) {
+			return false;
+		}
+		skip_space();
+		bool banked = false;
+		if (*pos == ',') {
+			++pos;
+			if (!parse_binary(0)) {
+				return false;
+			}
+			skip_space();
+			banked = true;
+		}
+		if (*pos != ')') {
+			return fail("Expected ) after peek");
+		}
+		++pos;
+		if (banked) {
+			emit(word ? expression_op::peekw_bank : expression_op::peek_bank, 2);
+		} else {
+			emit(word ? expression_op::peekw : expression_op::peek, 1);
+		}
+		return true;
+	}
+
+	bool parse_name()
+	{
+		const char *start = pos;
+		if (*pos == '.') {
+			++pos;
+		}
+		while (isalnum((unsigned char)*pos) || *pos == '_' || *pos == '.' || *pos == '@') {
+			++pos;
+		}
+		const std::string name(start, pos);
+
+		std::string lower = (name[0] == '.') ? name.substr(1) : name;
+		for (char &c : lower) {
+			c = (char)tolower((unsigned char)c);
+		}
+		if (lower == "peek" || lower == "peekw") {
+			return parse_peek(lower == "peekw");
+		}
+		for (const named_value &named : Named_values) {
+			if (lower == named.name) {
+				emit(named.op, 0);
+				if (named.value != 0) {
+					// A flag, as 0 or 1.
+					emit(expression_op::constant, 0, named.value);
+					emit(expression_op::bitwise_and, 2);
+					emit(expression_op::constant, 0, 0);
+					emit(expression_op::not_equal, 2);
+				}
+				return true;
+			}
+		}
+
+		// Labels stand for their address.
+		bool found   = false;
+		int  address = 0;
+		symbols_for_each([&](uint16_t symbol_address, symbol_bank_type, const std::string &symbol) {
+			if (!found && symbol == name) {
+				found   = true;
+				address = symbol_address;
+			}
+		});
+		if (!found) {
+			error = "Unknown name \"" + name + "\"";
+			return false;
+		}
+		emit(expression_op::constant, 0, address);
+		return true;
+	}
+
+	bool parse_primary()
+	{
+		skip_space();
+		if (*pos == '(') {
+			++pos;
+			if (!parse_binary(0)) {
+				return false;
+			}
+			skip_space();
+			if (*pos != ')') {
+				return fail("Expected )");
+			}
+			++pos;
+			return true;
+		}
+		if (isdigit((unsigned char)*pos) || *pos == '$' || *pos == '%') {
+			return parse_number();
+		}
+		if (isalpha((unsigned char)*pos) || *pos == '_' || *pos == '.') {
+			return parse_name();
+		}
+		if (*pos == '\0') {
+			return fail("Unexpected end of expression");
+		}
+		return fail((std::string("Unexpected \"") + pos + "\"").c_str());
+	}
+};
+
+bool expression::compile(const char *text, std::string &error)
+{
+	std::vector<expression_instruction> compiled;
+	expression_parser                   parser(text, compiled);
+	if (!parser.parse(error)) {
+		return false;
+	}
+	if (parser.max_depth() > Max_stack) {
+		error = "Expression is too complicated";
+		return false;
+	}
+
+	code   = std::move(compiled);
+	source = text;
+	return true;
+}
+
+void expression::clear()
+{
+	code.clear();
+	source.clear();
+}
+
+static int64_t peek(int64_t address)
+{
+	return debug_read6502((uint16_t)address);
+}
+
+static int64_t peek(int64_t address, int64_t bank)
+{
+	return debug_read6502((uint16_t)address, (uint8_t)bank);
+}
+
+int64_t expression::evaluate(int64_t value, int64_t old_value) const
+{
+	if (code.empty()) {
+		return 0;
+	}
+
+	int64_t  stack[Max_stack];
+	int64_t *top = stack - 1;
+
+	for (const expression_instruction &instruction : code) {
+		switch (instruction.op) {
+			case expression_op::constant: *++top = instruction.value; break;
+			case expression_op::reg_a: *++top = state6502.a; break;
+			case expression_op::reg_x: *++top = state6502.x; break;
+			case expression_op::reg_y: *++top = state6502.y; break;
+			case expression_op::reg_sp: *++top = state6502.sp; break;
+			case expression_op::reg_p: *++top = state6502.status; break;
+			case expression_op::reg_pc: *++top = state6502.pc; break;
+			case expression_op::clock: *++top = (int64_t)clockticks6502; break;
+			case expression_op::ram_bank: *++top = memory_get_ram_bank(); break;
+			case expression_op::rom_bank: *++top = memory_get_rom_bank(); break;
+			case expression_op::value: *++top = value; break;
+			case expression_op::old_value: *++top = old_value; break;
+
+			case expression_op::peek: *top = peek(*top); break;
+			case expression_op::peekw: *top = peek(*top) | (peek((uint16_t)*top + 1) << 8); break;
+			case expression_op::peek_bank:
+				--top;
+				*top = peek(top[0], top[1]);
+				break;
+			case expression_op::peekw_bank:
+				--top;
+				*top = peek(top[0], top[1]) | (peek((uint16_t)top[0] + 1, top[1]) << 8);
+				break;
+
+			case expression_op::negate: *top = (int64_t)-(uint64_t)*top; break;
+			case expression_op::logical_not: *top = !*top; break;
+			case expression_op::bitwise_not: *top = ~*top; break;
+
+			default: {
+				const int64_t rhs = *top--;
+				int64_t      &lhs = *top;
+				// Arithmetic is done unsigned, so that it wraps around instead of overflowing.
+				switch (instruction.op) {
+					case expression_op::multiply: lhs = (int64_t)((uint64_t)lhs * (uint64_t)rhs); break;
+					// Dividing the most negative number by -1 traps, so -1 is handled as negation.
+					case expression_op::divide: lhs = (rhs == -1) ? (int64_t)-(uint64_t)lhs : (rhs != 0) ? lhs / rhs : 0; break;
+					case expression_op::modulo: lhs = (rhs == -1 || rhs == 0) ? 0 : lhs % rhs; break;
+					case expression_op::add: lhs = (int64_t)((uint64_t)lhs + (uint64_t)rhs); break;
+					case expression_op::subtract: lhs = (int64_t)((uint64_t)lhs - (uint64_t)rhs); break;
+					case expression_op::shift_left: lhs = (rhs >= 0 && rhs < 64) ? (int64_t)((uint64_t)lhs << rhs) : 0; break;
+					case expression_op::shift_right: lhs = (rhs >= 0 && rhs < 64) ? lhs >> rhs : 0; break;
+					case expression_op::less: lhs = lhs < rhs; break;
+					case expression_op::less_equal: lhs = lhs <= rhs; break;
+					case expression_op::greater: lhs = lhs > rhs; break;
+					case expression_op::greater_equal: lhs = lhs >= rhs; break;
+					case expression_op::equal: lhs = lhs == rhs; break;
+					case expression_op::not_equal: lhs = lhs != rhs; break;
+					case expression_op::bitwise_and: lhs &= rhs; break;
+					case expression_op::bitwise_xor: lhs ^= rhs; break;
+					case expression_op::bitwise_or: lhs |= rhs; break;
+					case expression_op::logical_and: lhs = lhs && rhs; break;
+					case expression_op::logical_or: lhs = lhs || rhs; break;
+					default: break;
+				}
+			} break;
+		}
+	}
+
+	return *top;
+}
+
+//
+// Messages
+//
+
+bool expression_message::compile(const char *text, std::string &error)
+{
+	std::vector<part> compiled;
+	std::string       literal;
+	for (const char *c = text; *c != '\0'; ++c) {
+		if ((c[0] == '{' && c[1] == '{') || (c[0] == '}' && c[1] == '}')) {
+			literal += *c++;
+		} else if (*c == '{') {
+			const char *end = strchr(c, '}');
+			if (end == nullptr) {
+				error = "Missing } after {";
+				return false;
+			}
+
+			std::string value(c + 1, end);
+			bool        decimal = false;
+			if (value.size() >= 2 && value.compare(value.size() - 2, 2, ":d") == 0) {
+				value.resize(value.size() - 2);
+				decimal = true;
+			}
+
+			compiled.push_back({ literal, {}, decimal });
+			literal.clear();
+			if (!compiled.back().value.compile(value.c_str(), error)) {
+				return false;
+			}
+			c = end;
+		} else {
+			literal += *c;
+		}
+	}
+	if (!literal.empty()) {
+		compiled.push_back({ literal, {}, false });
+	}
+
+	parts  = std::move(compiled);
+	source = text;
+	return true;
+}
+
+void expression_message::clear()
+{
+	parts.clear();
+	source.clear();
+}
+
+std::string expression_message::format() const
+{
+	std::string text;
+	for (const part &p : parts) {
+		text += p.literal;
+		if (!p.value.empty()) {
+			char value[24];
+			if (p.decimal) {
+				snprintf(value, sizeof(value), "%lld", (long long)p.value.evaluate());
+			} else {
+				snprintf(value, sizeof(value), "$%02llX", (unsigned long long)p.value.evaluate());
+			}
+			text += value;
+		}
+	}
+	return text;
+}
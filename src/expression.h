@@ -0,0 +1,68 @@
+// Commander X16 Emulator
+// Copyright (c) 2023 Stephen Horn, et al.
+// All rights reserved. License: 2-clause BSD
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Debugger expressions over the CPU and memory, like "a == $20 && peek($30) > 5". They're parsed once
+// into a small stack bytecode, so they're cheap enough to evaluate every time a breakpoint is hit.
+//
+// Operators are C's, with the same precedence. Numbers are decimal, or hex with $ or 0x, or binary
+// with %. Names are registers (a, x, y, sp, p, pc), flags (c, z, i, d, v, n), clock (the CPU cycle
+// count), ram and rom (the current banks), value and old (what a watchpoint saw change, otherwise 0),
+// or labels from the loaded symbols. VICE's .a style of register name works too. peek(address) and
+// peekw(address) read a byte or word from memory as the CPU sees it, and peek(address, bank) and
+// peekw(address, bank) from a given bank.
+
+enum class expression_op : uint8_t;
+
+struct expression_instruction {
+	expression_op op;
+	int64_t       value;
+};
+
+class expression
+{
+public:
+	// Returns false and keeps the previous expression if the text can't be parsed, with the reason in error.
+	bool compile(const char *text, std::string &error);
+	void clear();
+
+	bool               empty() const { return code.empty(); }
+	const std::string &text() const { return source; }
+
+	// An empty expression is 0.
+	int64_t evaluate(int64_t value = 0, int64_t old_value = 0) const;
+
+private:
+	std::vector<expression_instruction> code;
+	std::string                         source;
+};
+
+// Text with expressions in braces, like "a={a} clock={clock:d}", written out with each expression's
+// current value. Values are written in hex, or in decimal with :d. Use {{ and }} for plain braces.
+class expression_message
+{
+public:
+	bool compile(const char *text, std::string &error);
+	void clear();
+
+	bool               empty() const { return source.empty(); }
+	const std::string &text() const { return source; }
+
+	std::string format() const;
+
+private:
+	struct part {
+		std::string literal; // Written before the value
+		expression  value;
+		bool        decimal;
+	};
+
+	std::vector<part> parts;
+	std::string       source;
+};
@@ -1,6 +1,14 @@
 #include "gif_recorder.h"
 
-#include "gif/gif.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdio.h>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
 #include "vera/vera_video.h"
 
 // GIF recorder states
@@ -13,11 +21,374 @@ enum gif_recorder_state_t {
 
 static gif_recorder_state_t Gif_record_state = RECORD_GIF_DISABLED;
 static char *               Gif_path = nullptr;
-static GifWriter            Gif_writer;
 
 static int Gif_width;
 static int Gif_height;
 
+//
+// Frames are handed to an encoder thread as VERA's palette indices and palette, so they never need
+// quantizing. The rare frame drawn with more than one palette is handed over as colors instead, and
+// the encoder makes up a palette for it. Only the rectangle that changed since the last frame is
+// written, and a frame that didn't change at all makes the one before it last longer.
+//
+
+static constexpr uint32_t Frame_delay       = 2; // In 1/100ths of a second
+static constexpr size_t   Max_queued_frames = 8;
+
+struct gif_frame {
+	std::vector<uint8_t>  indices;
+	uint32_t              palette[256];
+	std::vector<uint32_t> colors; // Instead of indices and palette
+};
+
+static std::thread             Gif_thread;
+static std::mutex              Gif_mutex;
+static std::condition_variable Gif_work_cond;
+static std::condition_variable Gif_space_cond;
+static std::deque<gif_frame>   Gif_queue;
+static bool                    Gif_quit   = false;
+static bool                    Gif_failed = false;
+
+// Owned by the encoder thread
+static FILE                 *Gif_file = nullptr;
+static std::vector<uint32_t> Gif_canvas; // The colors a viewer shows once the last frame is written
+
+struct gif_pending_frame {
+	bool                 valid = false;
+	uint16_t             left;
+	uint16_t             top;
+	uint16_t             width;
+	uint16_t             height;
+	uint32_t             delay;
+	uint32_t             palette[256];
+	std::vector<uint8_t> indices;
+};
+
+static gif_pending_frame Gif_pending;
+
+//
+// Writing
+//
+
+static void gif_put_u16(uint16_t value)
+{
+	fputc(value & 0xff, Gif_file);
+	fputc(value >> 8, Gif_file);
+}
+
+class gif_lzw_writer
+{
+public:
+	gif_lzw_writer()
+	    : m_bits(0), m_bit_count(0), m_block_size(0)
+	{
+		// Nothing to do.
+	}
+
+	void write_code(uint32_t code, uint32_t size)
+	{
+		m_bits |= code << m_bit_count;
+		m_bit_count += size;
+		while (m_bit_count >= 8) {
+			put_byte(m_bits & 0xff);
+			m_bits >>= 8;
+			m_bit_count -= 8;
+		}
+	}
+
+	void finish()
+	{
+		if (m_bit_count > 0) {
+			put_byte(m_bits & 0xff);
+			m_bits      = 0;
+			m_bit_count = 0;
+		}
+		flush_block();
+		fputc(0, Gif_file); // block terminator
+	}
+
+private:
+	void put_byte(uint8_t value)
+	{
+		m_block[m_block_size++] = value;
+		if (m_block_size == sizeof(m_block)) {
+			flush_block();
+		}
+	}
+
+	void flush_block()
+	{
+		if (m_block_size > 0) {
+			fputc(m_block_size, Gif_file);
+			fwrite(m_block, 1, m_block_size, Gif_file);
+			m_block_size = 0;
+		}
+	}
+
+	uint32_t m_bits;
+	uint32_t m_bit_count;
+	uint8_t  m_block[255];
+	uint32_t m_block_size;
+};
+
+// Codes for runs of pixels are found in a hash table keyed by the run's prefix code and its last
+// pixel, which is much cheaper to clear than a tree with a branch for every pixel value.
+static constexpr uint32_t Lzw_max_code   = 4095;
+static constexpr uint32_t Lzw_table_size = 8192;
+
+static void gif_write_lzw(const uint8_t *pixels, size_t count)
+{
+	static int32_t  keys[Lzw_table_size];
+	static uint16_t codes[Lzw_table_size];
+
+	const uint32_t min_code_size = 8;
+	const uint32_t clear_code    = 1 << min_code_size;
+
+	gif_lzw_writer writer;
+	uint32_t       code_size = min_code_size + 1;
+	uint32_t       max_code  = clear_code + 1;
+
+	fputc(min_code_size, Gif_file);
+	std::fill(std::begin(keys), std::end(keys), -1);
+	writer.write_code(clear_code, code_size);
+
+	uint32_t run = pixels[0];
+	for (size_t i = 1; i < count; ++i) {
+		const uint8_t pixel = pixels[i];
+		const int32_t key   = (int32_t)((run << 8) | pixel);
+
+		uint32_t slot = ((uint32_t)key * 2654435761u) >> 19;
+		while (keys[slot] >= 0 && keys[slot] != key) {
+			slot = (slot + 1) & (Lzw_table_size - 1);
+		}
+		if (keys[slot] == key) {
+			run = codes[slot];
+			continue;
+		}
+
+		writer.write_code(run, code_size);
+
+		keys[slot]  = key;
+		codes[slot] = (uint16_t)++max_code;
+		if (max_code >= (1u << code_size)) {
+			code_size++;
+		}
+		if (max_code == Lzw_max_code) {
+			writer.write_code(clear_code, code_size);
+			std::fill(std::begin(keys), std::end(keys), -1);
+			code_size = min_code_size + 1;
+			max_code  = clear_code + 1;
+		}
+
+		run = pixel;
+	}
+
+	writer.write_code(run, code_size);
+	writer.write_code(clear_code, code_size);
+	writer.write_code(clear_code + 1, min_code_size + 1);
+	writer.finish();
+}
+
+static void gif_write_pending()
+{
+	if (!Gif_pending.valid) {
+		return;
+	}
+
+	// Graphics control extension: leave the frame in place for the next one to draw over.
+	fputc(0x21, Gif_file);
+	fputc(0xf9, Gif_file);
+	fputc(0x04, Gif_file);
+	fputc(0x04, Gif_file);
+	gif_put_u16((uint16_t)std::min(Gif_pending.delay, 0xffffu));
+	fputc(0, Gif_file);
+	fputc(0, Gif_file);
+
+	// Image descriptor, with its own 256 color table.
+	fputc(0x2c, Gif_file);
+	gif_put_u16(Gif_pending.left);
+	gif_put_u16(Gif_pending.top);
+	gif_put_u16(Gif_pending.width);
+	gif_put_u16(Gif_pending.height);
+	fputc(0x87, Gif_file);
+	for (const uint32_t color : Gif_pending.palette) {
+		fputc((color >> 16) & 0xff, Gif_file);
+		fputc((color >> 8) & 0xff, Gif_file);
+		fputc(color & 0xff, Gif_file);
+	}
+
+	gif_write_lzw(Gif_pending.indices.data(), Gif_pending.indices.size());
+	Gif_pending.valid = false;
+}
+
+// Makes up a palette for a frame that was drawn with more than one, dropping low bits from the
+// colors until there are few enough of them.
+static void gif_index_colors(gif_frame &frame)
+{
+	std::unordered_map<uint32_t, uint8_t> lookup;
+	for (uint32_t mask = 0xffffff; mask != 0; mask = (mask << 1) & 0xfefefe) {
+		lookup.clear();
+		bool fits = true;
+		for (const uint32_t color : frame.colors) {
+			if (lookup.size() > 256) {
+				fits = false;
+				break;
+			}
+			lookup.try_emplace(color & mask, (uint8_t)lookup.size());
+		}
+		if (!fits || lookup.size() > 256) {
+			continue;
+		}
+
+		std::fill(std::begin(frame.palette), std::end(frame.palette), 0);
+		for (const auto &[color, index] : lookup) {
+			frame.palette[index] = color;
+		}
+		frame.indices.resize(frame.colors.size());
+		for (size_t i = 0; i < frame.colors.size(); ++i) {
+			frame.indices[i] = lookup[frame.colors[i] & mask];
+		}
+		return;
+	}
+}
+
+static void gif_encode_frame(gif_frame &frame)
+{
+	if (!frame.colors.empty()) {
+		gif_index_colors(frame);
+	}
+
+	// Find what changed since the last frame, as the viewer will see it.
+	int left   = Gif_width;
+	int right  = -1;
+	int top    = Gif_height;
+	int bottom = -1;
+	for (int y = 0; y < Gif_height; ++y) {
+		const uint8_t *indices = frame.indices.data() + y * Gif_width;
+		uint32_t      *canvas  = Gif_canvas.data() + y * Gif_width;
+		for (int x = 0; x < Gif_width; ++x) {
+			const uint32_t color = frame.palette[indices[x]] & 0xffffff;
+			if (canvas[x] != color) {
+				canvas[x] = color;
+				left      = std::min(left, x);
+				right     = std::max(right, x);
+				top       = std::min(top, y);
+				bottom    = y;
+			}
+		}
+	}
+
+	if (right < 0 && Gif_pending.valid) {
+		Gif_pending.delay += Frame_delay;
+		return;
+	}
+	if (right < 0) {
+		// Nothing changed, but the first frame after resuming still has to be shown.
+		left = right = top = bottom = 0;
+	}
+
+	gif_write_pending();
+
+	Gif_pending.valid  = true;
+	Gif_pending.left   = (uint16_t)left;
+	Gif_pending.top    = (uint16_t)top;
+	Gif_pending.width  = (uint16_t)(right - left + 1);
+	Gif_pending.height = (uint16_t)(bottom - top + 1);
+	Gif_pending.delay  = Frame_delay;
+	memcpy(Gif_pending.palette, frame.palette, sizeof(Gif_pending.palette));
+	Gif_pending.indices.resize(Gif_pending.width * Gif_pending.height);
+	for (int y = 0; y < Gif_pending.height; ++y) {
+		memcpy(Gif_pending.indices.data() + y * Gif_pending.width, frame.indices.data() + (top + y) * Gif_width + left, Gif_pending.width);
+	}
+}
+
+static void gif_thread_main()
+{
+	std::unique_lock<std::mutex> lock(Gif_mutex);
+	for (;;) {
+		Gif_work_cond.wait(lock, [] { return Gif_quit || !Gif_queue.empty(); });
+		if (Gif_queue.empty()) {
+			break;
+		}
+
+		gif_frame frame = std::move(Gif_queue.front());
+		Gif_queue.pop_front();
+		Gif_space_cond.notify_one();
+
+		lock.unlock();
+		gif_encode_frame(frame);
+		const bool failed = ferror(Gif_file) != 0;
+		lock.lock();
+
+		if (failed) {
+			Gif_failed = true;
+			Gif_queue.clear();
+			Gif_space_cond.notify_one();
+		}
+	}
+}
+
+static bool gif_begin()
+{
+	Gif_file = fopen(Gif_path, "wb");
+	if (Gif_file == nullptr) {
+		return false;
+	}
+
+	fputs("GIF89a", Gif_file);
+	gif_put_u16((uint16_t)Gif_width);
+	gif_put_u16((uint16_t)Gif_height);
+	fputc(0x70, Gif_file); // no global color table, 8 bits per primary
+	fputc(0, Gif_file);    // background color
+	fputc(0, Gif_file);    // square pixels
+
+	// Loop forever
+	fputc(0x21, Gif_file);
+	fputc(0xff, Gif_file);
+	fputc(11, Gif_file);
+	fputs("NETSCAPE2.0", Gif_file);
+	fputc(3, Gif_file);
+	fputc(1, Gif_file);
+	gif_put_u16(0);
+	fputc(0, Gif_file);
+
+	// A viewer starts out with nothing, which no frame's colors can match.
+	Gif_canvas.assign(Gif_width * Gif_height, 0xff000000);
+	Gif_pending.valid = false;
+
+	Gif_quit   = false;
+	Gif_failed = false;
+	Gif_thread = std::thread(gif_thread_main);
+	return true;
+}
+
+static void gif_end()
+{
+	if (Gif_thread.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(Gif_mutex);
+			Gif_quit = true;
+		}
+		Gif_work_cond.notify_one();
+		Gif_thread.join();
+	}
+
+	if (Gif_file != nullptr) {
+		if (!Gif_failed) {
+			gif_write_pending();
+			fputc(0x3b, Gif_file); // trailer
+		}
+		fclose(Gif_file);
+		Gif_file = nullptr;
+	}
+	Gif_canvas.clear();
+	Gif_canvas.shrink_to_fit();
+}
+
+//
+// Recorder
+//
+
 void gif_recorder_set_path(char const *path)
 {
 	Gif_path = new char[strlen(path) + 1];
@@ -41,7 +412,7 @@ void gif_recorder_init(int width, int height)
 			// start now
 			Gif_record_state = RECORD_GIF_RECORDING;
 		}
-		if (!GifBegin(&Gif_writer, Gif_path, SCREEN_WIDTH, SCREEN_HEIGHT, 1, 8, false)) {
+		if (!gif_begin()) {
 			Gif_record_state = RECORD_GIF_DISABLED;
 		}
 	}
@@ -50,24 +421,48 @@ void gif_recorder_init(int width, int height)
 void gif_recorder_shutdown()
 {
 	if (Gif_record_state != RECORD_GIF_DISABLED) {
-		GifEnd(&Gif_writer);
+		gif_end();
 		Gif_record_state = RECORD_GIF_DISABLED;
 	}
 }
 
-void gif_recorder_update(const uint8_t *image_bytes)
+void gif_recorder_update()
 {
-	if (Gif_record_state > RECORD_GIF_PAUSED) {
-		if (!GifWriteFrame(&Gif_writer, image_bytes, SCREEN_WIDTH, SCREEN_HEIGHT, 2, 8, false)) {
-			// if that failed, stop recording
-			GifEnd(&Gif_writer);
-			Gif_record_state = RECORD_GIF_DISABLED;
-			printf("Unexpected end of recording.\n");
-		}
-		if (Gif_record_state == RECORD_GIF_SINGLE) { // if single-shot stop recording
-			Gif_record_state = RECORD_GIF_PAUSED;    // need to close in video_end()
+	if (Gif_record_state <= RECORD_GIF_PAUSED) {
+		return;
+	}
+
+	gif_frame frame;
+	if (const uint8_t *indices = vera_video_get_framebuffer_indices(frame.palette); indices != nullptr) {
+		frame.indices.assign(indices, indices + Gif_width * Gif_height);
+	} else {
+		const uint32_t *colors = reinterpret_cast<const uint32_t *>(vera_video_get_framebuffer());
+		frame.colors.assign(colors, colors + Gif_width * Gif_height);
+	}
+
+	bool failed;
+	{
+		// If the encoder falls behind, wait for it rather than leave frames out.
+		std::unique_lock<std::mutex> lock(Gif_mutex);
+		Gif_space_cond.wait(lock, [] { return Gif_failed || Gif_queue.size() < Max_queued_frames; });
+		failed = Gif_failed;
+		if (!failed) {
+			Gif_queue.push_back(std::move(frame));
 		}
 	}
+
+	if (failed) {
+		// if that failed, stop recording
+		gif_end();
+		Gif_record_state = RECORD_GIF_DISABLED;
+		printf("Unexpected end of recording.\n");
+		return;
+	}
+	Gif_work_cond.notify_one();
+
+	if (Gif_record_state == RECORD_GIF_SINGLE) { // if single-shot stop recording
+		Gif_record_state = RECORD_GIF_PAUSED;    // need to close in video_end()
+	}
 }
 
 // Control the GIF recorder
@@ -96,3 +491,8 @@ uint8_t gif_recorder_get_state()
 {
 	return static_cast<uint8_t>(Gif_record_state);
 }
+
+bool gif_recorder_is_capturing()
+{
+	return Gif_record_state > RECORD_GIF_PAUSED;
+}
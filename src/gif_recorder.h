@@ -10,7 +10,12 @@ enum gif_recorder_command_t {
 void gif_recorder_set_path(char const *path);
 void gif_recorder_init(int width, int height);
 void gif_recorder_shutdown();
-void gif_recorder_update(const uint8_t *framebuffer_bytes);
+
+// Hands the frame VERA just finished to the encoder thread, if recording.
+void gif_recorder_update();
 
 void    gif_recorder_set(gif_recorder_command_t command);
 uint8_t gif_recorder_get_state();
+
+// Whether the next frame will be written, so it has to be rendered.
+bool gif_recorder_is_capturing();
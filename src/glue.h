@@ -25,6 +25,9 @@
 
 #define ROM_SIZE (TOTAL_ROM_BANKS * 16384) /* banks at $C000-$FFFF */
 
+class snapshot_reader;
+class snapshot_writer;
+
 extern _state6502   state6502;
 extern uint8_t      waiting;
 extern _smart_stack stack6502[256];
@@ -39,6 +42,11 @@ extern bool save_on_exit;
 extern void machine_dump(const char *reason);
 extern void machine_reset();
 extern void machine_toggle_warp();
+extern void machine_request_exit(int exit_code);
+extern void machine_sync_devices();
+extern void machine_save_state(snapshot_writer &w);
+extern bool machine_check_state(snapshot_reader &r);
+extern bool machine_load_state(snapshot_reader &r);
 extern void init_audio();
 
 #endif
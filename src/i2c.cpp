@@ -10,6 +10,7 @@
 #include "ring_buffer.h"
 #include "rtc.h"
 #include "smc.h"
+#include "snapshot.h"
 
 #define LOG_LEVEL 0
 #define LOG_PRINTF(LEVEL, ...)          \
@@ -25,6 +26,8 @@
 
 i2c_port_t i2c_port;
 
+static i2c_port_t old_i2c_port;
+
 static int     state     = STATE_STOP;
 static bool    read_mode = false;
 static uint8_t value     = 0;
@@ -67,7 +70,6 @@ void i2c_write(uint8_t device, uint8_t offset, uint8_t value)
 
 void i2c_step()
 {
-	static i2c_port_t old_i2c_port;
 	if (old_i2c_port.clk_in != i2c_port.clk_in || old_i2c_port.data_in != i2c_port.data_in) {
 		LOG_PRINTF(5, "I2C(%d) C:%d D:%d\n", state, i2c_port.clk_in, i2c_port.data_in);
 		if (state == STATE_STOP && i2c_port.clk_in == 0 && i2c_port.data_in == 0) {
@@ -142,3 +144,38 @@ void i2c_step()
 		old_i2c_port = i2c_port;
 	}
 }
+
+// The SMC has no state of its own besides its LEDs, so it is saved along with the bus.
+void i2c_save_state(snapshot_writer &w)
+{
+	w.write(i2c_port);
+	w.write(old_i2c_port);
+	w.write(state);
+	w.write(read_mode);
+	w.write(value);
+	w.write(count);
+	w.write(device);
+	w.write(offset);
+	w.write(power_led);
+	w.write(activity_led);
+}
+
+bool i2c_check_state(snapshot_reader &r)
+{
+	return r.skip(sizeof(i2c_port) + sizeof(old_i2c_port) + sizeof(state) + sizeof(read_mode) + sizeof(value) + sizeof(count) + sizeof(device) + sizeof(offset) + sizeof(power_led) + sizeof(activity_led));
+}
+
+bool i2c_load_state(snapshot_reader &r)
+{
+	r.read(i2c_port);
+	r.read(old_i2c_port);
+	r.read(state);
+	r.read(read_mode);
+	r.read(value);
+	r.read(count);
+	r.read(device);
+	r.read(offset);
+	r.read(power_led);
+	r.read(activity_led);
+	return r.ok();
+}
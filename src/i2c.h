@@ -7,6 +7,9 @@
 
 #include <stdint.h>
 
+class snapshot_reader;
+class snapshot_writer;
+
 #define I2C_DATA_MASK 1
 #define I2C_CLK_MASK 2
 
@@ -20,4 +23,8 @@ extern i2c_port_t i2c_port;
 
 void i2c_step();
 
+void i2c_save_state(snapshot_writer &w);
+bool i2c_check_state(snapshot_reader &r);
+bool i2c_load_state(snapshot_reader &r);
+
 #endif
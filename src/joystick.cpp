@@ -3,12 +3,13 @@
 #include <SDL.h>
 #include <unordered_map>
 
+#include "replay.h"
+
 #define LOG_JOYSTICK(...) // printf(__VA_ARGS__)
 
 struct joystick_info {
 	SDL_GameController *controller;
 	uint16_t            button_mask;
-	uint16_t            shift_mask;
 	int                 current_slot;
 };
 
@@ -31,7 +32,11 @@ static const uint16_t button_map[SDL_CONTROLLER_BUTTON_MAX] = {
 };
 
 static std::unordered_map<int, joystick_info> Joystick_controllers;
-static int                                    Joystick_slots[NUM_JOYSTICKS];
+static int                                    Joystick_slots[NUM_JOYSTICKS] = { -1, -1, -1, -1 };
+
+// What each slot latched: its controller's buttons, or -1 if the slot was empty.
+static int      Latched_buttons[NUM_JOYSTICKS] = { -1, -1, -1, -1 };
+static uint16_t Shift_masks[NUM_JOYSTICKS];
 
 static bool Joystick_latch = false;
 uint8_t     Joystick_data  = 0;
@@ -81,7 +86,7 @@ void joystick_add(int index)
 				break;
 			}
 		}
-		Joystick_controllers.try_emplace(instance_id, joystick_info{ controller, 0xffff, 0, slot });
+		Joystick_controllers.try_emplace(instance_id, joystick_info{ controller, 0xffff, slot });
 	}
 }
 
@@ -170,10 +175,9 @@ void joystick_button_up(int instance_id, uint8_t button)
 static void do_shift()
 {
 	for (int i = 0; i < NUM_JOYSTICKS; ++i) {
-		if (Joystick_slots[i] >= 0) {
-			const auto &joy = Joystick_controllers.find(Joystick_slots[i]);
-			Joystick_data |= ((joy->second.shift_mask & 1) ? (0x80 >> i) : 0);
-			joy->second.shift_mask >>= 1;
+		if (Latched_buttons[i] >= 0) {
+			Joystick_data |= ((Shift_masks[i] & 1) ? (0x80 >> i) : 0);
+			Shift_masks[i] >>= 1;
 		} else {
 			Joystick_data |= 0x80 >> i;
 		}
@@ -184,8 +188,16 @@ void joystick_set_latch(bool value)
 {
 	Joystick_latch = value;
 	if (value) {
-		for (auto &joy : Joystick_controllers) {
-			joy.second.shift_mask = joy.second.button_mask | 0xF000;
+		for (int i = 0; i < NUM_JOYSTICKS; ++i) {
+			const auto &joy    = Joystick_controllers.find(Joystick_slots[i]);
+			Latched_buttons[i] = (joy != Joystick_controllers.end()) ? joy->second.button_mask : -1;
+		}
+
+		// The buttons are host input, so they go through the replay log as the machine sees them.
+		replay_joystick_latch(Latched_buttons);
+
+		for (int i = 0; i < NUM_JOYSTICKS; ++i) {
+			Shift_masks[i] = (uint16_t)Latched_buttons[i] | 0xF000;
 		}
 		do_shift();
 	}
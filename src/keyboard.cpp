@@ -164,6 +164,11 @@ void keyboard_process()
 	}
 }
 
+bool keyboard_has_pending_events()
+{
+	return !Keyboard_event_list.empty();
+}
+
 void keyboard_add_event(const bool down, const SDL_Scancode scancode)
 {
 	if (Options.log_keyboard) {
@@ -9,6 +9,7 @@
 #	include <SDL_keycode.h>
 
 void keyboard_process();
+bool keyboard_has_pending_events();
 
 void keyboard_add_event(const bool down, const SDL_Scancode scancode);
 void keyboard_add_text(char const *const text);
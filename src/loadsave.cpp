@@ -199,8 +199,10 @@ void LOAD()
 		} else if (start < 0xc000) {
 			// banked RAM
 			while (1) {
-				size_t len = 0xc000 - start;
-				bytes_read = (uint16_t)gzread(f, RAM + (((memory_get_ram_bank() % (uint16_t)Options.num_ram_banks) << 13) & 0xffffff) + start, static_cast<unsigned int>(len));
+				size_t         len    = 0xc000 - start;
+				const uint32_t offset = (((memory_get_ram_bank() % (uint16_t)Options.num_ram_banks) << 13) & 0xffffff) + start;
+				bytes_read            = (uint16_t)gzread(f, RAM + offset, static_cast<unsigned int>(len));
+				memory_mark_ram_dirty(offset, static_cast<uint32_t>(len));
 				if (bytes_read < len)
 					break;
 
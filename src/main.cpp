@@ -3,6 +3,7 @@
 // Copyright (c) 2021-2023 Stephen Horn, et al.
 // All rights reserved. License: 2-clause BSD
 
+#include <algorithm>
 #include <limits.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -18,7 +19,6 @@
 #include "cpu/fake6502.h"
 #include "cpu/mnemonics.h"
 #include "debugger.h"
-#include "disasm.h"
 #include "display.h"
 #include "files.h"
 #include "gif_recorder.h"
@@ -33,12 +33,17 @@
 #include "options.h"
 #include "overlay/cpu_visualization.h"
 #include "overlay/overlay.h"
+#include "profiler.h"
+#include "replay.h"
+#include "rewind.h"
 #include "ring_buffer.h"
 #include "rtc.h"
 #include "sdl_events.h"
 #include "serial.h"
+#include "snapshot.h"
 #include "symbols.h"
 #include "timing.h"
+#include "trace.h"
 #include "utf8.h"
 #include "utf8_encode.h"
 #include "vera/sdcard.h"
@@ -63,6 +68,13 @@ bool save_on_exit = true;
 bool   has_boot_tasks = false;
 gzFile prg_file       = nullptr;
 
+static bool Exit_requested = false;
+static int  Exit_code      = 0;
+
+static uint64_t Device_clockticks = 0;
+static bool     Device_new_frame  = false;
+static bool     Device_nmi        = false;
+
 void machine_dump(const char *reason)
 {
 	printf("Dumping system memory. Reason: %s\n", reason);
@@ -101,6 +113,13 @@ void machine_dump(const char *reason)
 
 	SDL_RWclose(f);
 	printf("Dumped system to %s.\n", filename);
+
+	if (trace_is_enabled()) {
+		char trace_filename[sizeof(filename)];
+		strcpy(trace_filename, filename);
+		strcpy(strrchr(trace_filename, '.'), ".txt");
+		trace_save(trace_filename, Options.trace_first, Options.trace_last);
+	}
 }
 
 void machine_reset()
@@ -114,19 +133,126 @@ void machine_reset()
 	reset6502();
 }
 
+void machine_save_state(snapshot_writer &w)
+{
+	w.write(state6502);
+	w.write(stack6502);
+	w.write(waiting);
+	w.write(clockticks6502);
+	w.write(instructions);
+	w.write(Device_new_frame);
+	w.write(Device_nmi);
+}
+
+bool machine_check_state(snapshot_reader &r)
+{
+	return r.skip(sizeof(state6502) + sizeof(stack6502) + sizeof(waiting) + sizeof(clockticks6502) + sizeof(instructions) + sizeof(Device_new_frame) + sizeof(Device_nmi));
+}
+
+bool machine_load_state(snapshot_reader &r)
+{
+	r.read(state6502);
+	r.read(stack6502);
+	r.read(waiting);
+	r.read(clockticks6502);
+	r.read(instructions);
+	r.read(Device_new_frame);
+	r.read(Device_nmi);
+
+	// Snapshots are only taken with the devices caught up to the CPU.
+	Device_clockticks = clockticks6502;
+	return r.ok();
+}
+
 void machine_toggle_warp()
 {
 	if (Options.warp_factor == 0) {
 		Options.warp_factor = 9;
-		vera_video_set_cheat_mask(0x3f);
 		timing_init();
 	} else {
 		Options.warp_factor = 0;
-		vera_video_set_cheat_mask(0);
 		timing_init();
 	}
 }
 
+void machine_request_exit(int exit_code)
+{
+	Exit_requested = true;
+	Exit_code      = exit_code;
+}
+
+void machine_sync_devices()
+{
+	const uint32_t clocks = (uint32_t)(clockticks6502 - Device_clockticks);
+	if (clocks == 0) {
+		return;
+	}
+	Device_clockticks = clockticks6502;
+
+	if (vera_video_step(MHZ, (float)clocks)) {
+		Device_new_frame = true;
+	}
+	const bool via1_irq_old = via1_irq();
+	via1_step(clocks);
+	if (!via1_irq_old && via1_irq()) {
+		Device_nmi = true;
+	}
+	via2_step(clocks);
+	rtc_step(clocks);
+	if (Options.enable_serial) {
+		serial_step(clocks);
+	}
+	audio_render(clocks);
+}
+
+// Devices are stepped in batches of however many clocks the CPU can run before any of them could
+// change an IRQ line or finish a scanline. The CPU is otherwise only stopped early by I/O accesses
+// (see memory.cpp) and by jumps into the hypercall range, so the observable timing is unchanged.
+// The RTC isn't an event source: it can only be observed over I2C, which is I/O.
+static uint32_t machine_clocks_until_event()
+{
+	uint32_t clocks = vera_video_clocks_until_event(MHZ);
+	clocks          = std::min(clocks, via1_clocks_until_event());
+	clocks          = std::min(clocks, via2_clocks_until_event());
+	clocks          = std::min(clocks, audio_clocks_until_event());
+	clocks          = std::min(clocks, YM_clocks_until_event());
+	clocks          = std::min(clocks, replay_clocks_until_event());
+	return clocks;
+}
+
+// Anything that has to be looked at between every instruction forces the old one-instruction-at-a-time loop.
+// A pending IRQ doesn't: the CPU ends its batch whenever it clears the I flag, which is when it can be taken.
+static bool machine_needs_single_step()
+{
+	return !debugger_is_running() || cpu_visualization_is_enabled() || keyboard_has_pending_events() || Options.enable_serial;
+}
+
+// In warp mode, a frame is only rendered if it's going to be presented, which happens about every
+// 16 ms: when the time since the last frame presented, plus however long the last frame took, gets
+// there. Nothing is presented in headless mode. Frames being recorded are always rendered.
+static void machine_plan_next_frame()
+{
+	static uint32_t last_frame_us   = 0;
+	static uint32_t last_present_us = 0;
+
+	const uint32_t now_us   = timing_total_microseconds_realtime();
+	const uint32_t frame_us = now_us - last_frame_us;
+	last_frame_us           = now_us;
+	if (!vera_video_last_frame_skipped()) {
+		last_present_us = now_us;
+	}
+
+	bool skip = false;
+	if (gif_recorder_is_capturing()) {
+		skip = false;
+	} else if (Options.headless) {
+		skip = true;
+	} else if (Options.warp_factor > 0) {
+		skip = (now_us - last_present_us) + frame_us < 16000;
+	}
+	vera_video_set_skip_frame(skip);
+}
+
 static bool is_kernal()
 {
 	return read6502(0xfff6) == 'M' && // only for KERNAL
@@ -147,8 +273,12 @@ int main(int argc, char **argv)
 		vera_video_set_log_video(true);
 	}
 
-	if (Options.warp_factor > 0) {
-		vera_video_set_cheat_mask((1 << (Options.warp_factor - 1)) - 1);
+	if (Options.headless) {
+		// Nothing is presented or heard in headless mode, so run as fast as possible.
+		Options.no_sound = true;
+		if (Options.warp_factor == 0) {
+			Options.warp_factor = 16;
+		}
 	}
 
 	// Initialize memory
@@ -157,6 +287,7 @@ int main(int argc, char **argv)
 		memory_params.randomize                           = Options.memory_randomize;
 		memory_params.enable_uninitialized_access_warning = Options.memory_uninit_warn;
 		memory_params.num_banks                           = Options.num_ram_banks;
+		memory_params.seed                                = Options.use_seed ? Options.seed : (uint32_t)SDL_GetPerformanceCounter();
 
 		memory_init(memory_params);
 	}
@@ -190,7 +321,11 @@ int main(int argc, char **argv)
 		vsprintf(message_buffer, format, list);
 		va_end(list);
 
-		SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, title, message_buffer, display_get_window());
+		if (Options.headless) {
+			printf("%s: %s\n", title, message_buffer);
+		} else {
+			SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, title, message_buffer, display_get_window());
+		}
 		exit(1);
 	};
 
@@ -243,7 +378,7 @@ int main(int argc, char **argv)
 	if (!Options.sdcard_path.empty()) {
 		std::filesystem::path sdcard_path;
 		if (options_find_file(sdcard_path, Options.sdcard_path)) {
-			sdcard_set_file(sdcard_path.generic_string().c_str());
+			sdcard_set_file(sdcard_path.generic_string().c_str(), Options.sdcard_overlay_path.generic_string().c_str());
 		}
 	}
 
@@ -251,6 +386,8 @@ int main(int argc, char **argv)
 		if (!hypercalls_init()) {
 			error("Boot error", "Could not initialize hypercalls. Disable hypercalls to boot with this ROM.");
 		}
+		// Hypercalls are checked between instructions, so batched execution has to stop at any that might be one.
+		yieldpc6502 = 0xff44;
 	}
 
 #ifdef SDL_HINT_VIDEO_X11_NET_WM_BYPASS_COMPOSITOR
@@ -259,17 +396,26 @@ int main(int argc, char **argv)
 	SDL_SetHint(SDL_HINT_VIDEO_X11_NET_WM_BYPASS_COMPOSITOR, "0");
 #endif
 
-	SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS | SDL_INIT_GAMECONTROLLER | SDL_INIT_AUDIO);
+	if (Options.headless) {
+		SDL_Init(SDL_INIT_TIMER);
+	} else {
+		SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS | SDL_INIT_GAMECONTROLLER | SDL_INIT_AUDIO);
+	}
 
 	if (!Options.no_sound) {
 		audio_init(Options.audio_dev_name.size() > 0 ? Options.audio_dev_name.c_str() : nullptr, Options.audio_buffers);
 		audio_set_render_callback(wav_recorder_process);
 		YM_set_irq_enabled(Options.ym_irq);
 		YM_set_strict_busy(Options.ym_strict);
+
+		// Rendering ahead for the audio device depends on when the host asks for it.
+		if (Options.use_seed || !Options.record_path.empty() || !Options.replay_path.empty()) {
+			audio_set_render_ahead(false);
+		}
 	}
 
 	// Initialize display
-	{
+	if (!Options.headless) {
 		display_settings init_settings;
 		init_settings.aspect_ratio  = Options.widescreen ? (16.0f / 9.0f) : (4.0f / 3.0f);
 		init_settings.video_rect.x  = 0;
@@ -286,6 +432,7 @@ int main(int argc, char **argv)
 		}
 	}
 
+	vera_video_init();
 	vera_video_reset();
 
 	if (!Options.gif_path.empty()) {
@@ -303,6 +450,7 @@ int main(int argc, char **argv)
 	}
 
 	if (!Options.wav_path.empty()) {
+		wav_recorder_set_float(Options.wav_float);
 		wav_recorder_set_path(Options.wav_path.generic_string().c_str());
 		switch (Options.wav_start) {
 			case wav_recorder_start_t::WAV_RECORDER_START_WAIT:
@@ -322,14 +470,40 @@ int main(int argc, char **argv)
 	gif_recorder_init(SCREEN_WIDTH, SCREEN_HEIGHT);
 	wav_recorder_init();
 
-	joystick_init();
+	if (!Options.headless) {
+		joystick_init();
+	}
 
 	midi_init();
 
-	rtc_init(Options.set_system_time);
+	rtc_init(Options.set_system_time && !Options.use_seed);
 
 	machine_reset();
 
+	// Load a machine state, if specified, so a run can start from a point after booting.
+	if (!Options.snapshot_path.empty()) {
+		std::filesystem::path snapshot_path;
+		if (!options_find_file(snapshot_path, Options.snapshot_path) || !snapshot_load_file(snapshot_path.generic_string().c_str())) {
+			error("Snapshot error", "Could not load snapshot %s.", Options.snapshot_path.generic_string().c_str());
+		}
+	}
+
+	// Recording or playing back starts from wherever the machine is now, including any snapshot.
+	if (!Options.record_path.empty() && !replay_record(Options.record_path.generic_string().c_str())) {
+		error("Recording error", "Could not record input to %s.", Options.record_path.generic_string().c_str());
+	}
+	if (!Options.replay_path.empty()) {
+		std::filesystem::path replay_path;
+		if (!options_find_file(replay_path, Options.replay_path) || !replay_play(replay_path.generic_string().c_str())) {
+			error("Playback error", "Could not play back %s.", Options.replay_path.generic_string().c_str());
+		}
+	}
+
+	if (!Options.profile_path.empty()) {
+		profiler_start();
+	}
+	trace_set_size(Options.trace_size);
+
 	timing_init();
 
 #ifdef __EMSCRIPTEN__
@@ -338,7 +512,13 @@ int main(int argc, char **argv)
 	emulator_loop();
 #endif
 
-	save_options_on_close(false);
+	if (!Options.headless) {
+		save_options_on_close(false);
+	}
+
+	if (!Options.profile_path.empty()) {
+		profiler_save(Options.profile_path.generic_string().c_str());
+	}
 
 	if (nvram_dirty && !Options.nvram_path.empty()) {
 		SDL_RWops *f = SDL_RWFromFile(Options.nvram_path.generic_string().c_str(), "wb");
@@ -349,26 +529,40 @@ int main(int argc, char **argv)
 		nvram_dirty = false;
 	}
 
+	replay_stop();
 	sdcard_shutdown();
 
 	SDL_free(const_cast<char *>(private_path));
 	SDL_free(const_cast<char *>(base_path));
 
 	audio_close();
+	vera_video_shutdown();
 	wav_recorder_shutdown();
 	gif_recorder_shutdown();
 	debugger_shutdown();
 display_quit:
-	display_shutdown();
+	if (!Options.headless) {
+		display_shutdown();
+	}
 	SDL_Quit();
 
-	return 0;
+	return Exit_code;
 }
 
 void emulator_loop()
 {
 	for (;;) {
+		replay_process();
+
 		if (debugger_is_paused()) {
+			if (Options.headless) {
+				// Nobody is around to resume execution, so treat a break as a failed run.
+				if (save_on_exit) {
+					machine_dump("Debugger break in headless mode");
+				}
+				Exit_code = 1;
+				return;
+			}
 			vera_video_force_redraw_screen();
 			display_process();
 			if (!sdl_events_update()) {
@@ -378,95 +572,51 @@ void emulator_loop()
 			continue;
 		}
 
-		//
-		// Trace functionality preserved for comparison with official emulator releases
-		//
-#if defined(TRACE)
-		{
-			uint16_t pc     = state6502.pc;
-			uint8_t  x      = state6502.x;
-			uint8_t  y      = state6502.y;
-			uint8_t  a      = state6502.a;
-			uint8_t  status = state6502.status;
-			uint8_t  sp     = state6502.sp;
-			uint8_t  ram    = memory_get_ram_bank();
-			uint8_t  rom    = memory_get_rom_bank();
-			uint8_t  cur    = memory_get_current_bank(pc);
-			char     buffer[1024];
-			uint8_t  pos = 0;
-
-			if ((Options.log_cpu_main && (pc >= 0x0800 && pc <= 0x9FFF)) ||
-			    (Options.log_cpu_bram && (pc >= 0xA000 && pc <= 0xBFFF)) ||
-			    (Options.log_cpu_low && (pc >= 0x0000 && pc <= 0x07FF)) ||
-			    (Options.log_cpu_brom && (pc >= 0xC000 && pc <= 0xFFFF))) {
-
-				printf("a:$%02x x:$%02x y:$%02x s:$%02x p:", a, x, y, sp);
-				for (int i = 7; i >= 0; i--) {
-					printf("%c", (status & (1 << i)) ? "czidb.vn"[i] : '-');
-				}
-
-				printf(" ram=$%02x rom=$%02x ", ram, rom);
-				const char *label     = disasm_get_label(pc);
-				size_t      label_len = label ? strlen(label) : 0;
-				if (label) {
-					printf("%s", label);
-				}
-				label_len = (label_len <= 25) ? label_len : 25;
-				for (size_t i = 0; i < 25 - label_len; i++) {
-					printf(" ");
-				}
-				printf("$%02x:$%04x ", cur, pc);
-				disasm_code(buffer, sizeof(buffer), pc, cur);
-				printf("%s", buffer);
-
-				printf("\n");
-			}
+		if (machine_needs_single_step()) {
+			step6502();
+		} else {
+			exec6502(machine_clocks_until_event());
 		}
-#endif
-
-		uint64_t old_clockticks6502 = clockticks6502;
-		step6502();
 		if (debug6502) {
 			debugger_process_cpu();
 			if (debugger_is_paused()) {
+				machine_sync_devices();
 				continue;
 			} else {
 				force6502();
 			}
 		}
 		cpu_visualization_step();
-		uint8_t clocks       = (uint8_t)(clockticks6502 - old_clockticks6502);
-		bool    new_frame    = vera_video_step(MHZ, clocks);
-		bool    via1_irq_old = via1_irq();
-		via1_step(clocks);
-		via2_step(clocks);
-		rtc_step(clocks);
-		if (Options.enable_serial) {
-			serial_step(clocks);
-		}
-		audio_render(clocks);
+		machine_sync_devices();
+
+		const bool new_frame = Device_new_frame;
+		const bool new_nmi   = Device_nmi;
+		Device_new_frame     = false;
+		Device_nmi           = false;
 
 		if (new_frame) {
+			rewind_capture();
 			midi_process();
-			gif_recorder_update(vera_video_get_framebuffer());
-			static uint32_t last_display_us = timing_total_microseconds_realtime();
-			const uint32_t  display_us      = timing_total_microseconds_realtime();
-			if ((Options.warp_factor == 0) || (display_us - last_display_us > 16000)) { // Close enough I'm willing to pay for OpenGL's sync.
-				display_process();
-				last_display_us = display_us;
-			}
-			if (!sdl_events_update()) {
-				break;
+			gif_recorder_update();
+			if (!Options.headless) {
+				if (!vera_video_last_frame_skipped()) {
+					display_process();
+				}
+				if (!sdl_events_update()) {
+					break;
+				}
 			}
+			replay_process();
 
 			timing_update();
+			machine_plan_next_frame();
 #ifdef __EMSCRIPTEN__
 			// After completing a frame we yield back control to the browser to stay responsive
 			return 0;
 #endif
 		}
 
-		if (!via1_irq_old && via1_irq()) {
+		if (new_nmi) {
 			nmi6502();
 			debugger_interrupt();
 		}
@@ -478,6 +628,13 @@ void emulator_loop()
 
 		hypercalls_process();
 
+		if (Exit_requested) {
+			if (save_on_exit) {
+				machine_dump("Exit requested by program");
+			}
+			return;
+		}
+
 		if (state6502.pc == 0xffff) {
 			if (save_on_exit) {
 				machine_dump("CPU program counter reached $ffff");
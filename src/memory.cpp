@@ -5,6 +5,7 @@
 
 #include "memory.h"
 
+#include <random>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
@@ -15,6 +16,7 @@
 #include "gif_recorder.h"
 #include "glue.h"
 #include "hypercalls.h"
+#include "snapshot.h"
 #include "vera/vera_video.h"
 #include "via.h"
 #include "wav_recorder.h"
@@ -31,6 +33,12 @@ uint8_t  ROM[ROM_SIZE];
 #define RAM_WRITE_BLOCKS (((RAM_SIZE) + 0x3f) >> 6)
 static uint64_t *RAM_written;
 
+// One flag per 64 bytes, set whenever they're written to, so that rewind deltas only have to
+// look at what was written since the last one. RAM_written uses the same blocks.
+#define ROM_DIRTY_BLOCKS (ROM_SIZE >> 6)
+static uint8_t *RAM_dirty;
+static uint8_t  ROM_dirty[ROM_DIRTY_BLOCKS];
+
 static uint8_t addr_ym = 0;
 
 #define DEVICE_EMULATOR (0x9fb0)
@@ -99,6 +107,17 @@ static void build_memory_map(memmap_table_entry *table_entries, uint8_t *map)
 
 static memory_init_params Memory_params;
 
+//
+// Host pointers to each page that can be accessed without going through the memory map,
+// for the banks currently selected. Pages that need a handler (IO, read-only ROM, uninitialized
+// access tracking, debugger flags) are nullptr.
+//
+
+static uint8_t *Read_page_table[0x100];
+static uint8_t *Write_page_table[0x100];
+static uint8_t *Dirty_page_table[0x100]; // The dirty flags for each page in Write_page_table
+static bool     Flagged_page_table[0x100]; // Pages with debugger flags for the banks currently selected
+
 //
 // Initialization and re-initialization
 //
@@ -110,9 +129,10 @@ void memory_init(const memory_init_params &init_params)
 	const uint32_t ram_size = RAM_SIZE;
 	RAM                     = new uint8_t[ram_size];
 	if (Memory_params.randomize) {
-		srand((uint32_t)SDL_GetPerformanceCounter());
+		// mt19937 gives the same sequence on every platform, unlike rand().
+		std::mt19937 random(Memory_params.seed);
 		for (uint32_t i = 0; i < RAM_SIZE; ++i) {
-			RAM[i] = rand();
+			RAM[i] = (uint8_t)random();
 		}
 	} else {
 		memset(RAM, 0, RAM_SIZE);
@@ -122,9 +142,14 @@ void memory_init(const memory_init_params &init_params)
 	RAM_written                     = new uint64_t[RAM_WRITE_BLOCKS];
 	memset(RAM_written, 0, RAM_WRITE_BLOCKS * sizeof(uint64_t));
 
+	RAM_dirty = new uint8_t[RAM_WRITE_BLOCKS];
+	memset(RAM_dirty, 1, RAM_WRITE_BLOCKS);
+	memset(ROM_dirty, 1, ROM_DIRTY_BLOCKS);
+
 	build_memory_map(memmap_table_hi, memory_map_hi);
 	build_memory_map(memmap_table_io, memory_map_io);
 
+	memory_update_page_table();
 	memory_reset();
 }
 
@@ -171,7 +196,10 @@ static uint8_t real_ram_read(uint16_t address)
 
 static void debug_ram_write(uint16_t address, uint8_t bank, uint8_t value)
 {
-	RAM[((uint32_t)bank << 13) + address] = value;
+	const uint32_t real_address = ((uint32_t)bank << 13) + address;
+
+	RAM_dirty[real_address >> 6] = 1;
+	RAM[real_address]            = value;
 }
 
 static void real_ram_write(uint16_t address, uint8_t value)
@@ -180,6 +208,7 @@ static void real_ram_write(uint16_t address, uint8_t value)
 	const int real_address = (ramBank << 13) + address;
 
 	RAM_written[real_address >> 6] |= (uint64_t)1 << (real_address & 0x3f);
+	RAM_dirty[real_address >> 6] = 1;
 
 	RAM[real_address] = value;
 }
@@ -202,7 +231,10 @@ static uint8_t real_rom_read(uint16_t address)
 static void debug_rom_write(uint16_t address, uint8_t bank, uint8_t value)
 {
 	if (bank >= NUM_ROM_BANKS) {
-		ROM[((uint32_t)bank << 14) + address - 0xc000] = value;
+		const uint32_t real_address = ((uint32_t)bank << 14) + address - 0xc000;
+
+		ROM_dirty[real_address >> 6] = 1;
+		ROM[real_address]            = value;
 	}
 }
 
@@ -212,13 +244,86 @@ static void real_rom_write(uint16_t address, uint8_t value)
 	if (romBank >= NUM_ROM_BANKS) {
 		const int real_address = (romBank << 14) + address - 0xc000;
 
-		ROM[real_address] = value;
+		ROM_dirty[real_address >> 6] = 1;
+		ROM[real_address]            = value;
 
 		//printf("Writing to hidden ram at addr: $%hx, bank $%hhx\n", address, romBank);
 	}
 	
 }
 
+//
+// Page table
+//
+
+static void update_pages(int first_page, int last_page)
+{
+	if (RAM == nullptr) {
+		return;
+	}
+
+	const uint8_t ram_bank = effective_ram_bank();
+	const uint8_t rom_bank = effective_rom_bank();
+
+	for (int page = first_page; page <= last_page; ++page) {
+		const uint16_t address = (uint16_t)(page << 8);
+
+		uint8_t *read_page  = nullptr;
+		uint8_t *write_page = nullptr;
+		uint8_t *dirty_page = nullptr;
+		switch (memory_map_hi[page]) {
+			case MEMMAP_DIRECT:
+				read_page  = &RAM[address];
+				write_page = read_page;
+				dirty_page = &RAM_dirty[address >> 6];
+				break;
+			case MEMMAP_RAMBANK:
+				if (!Memory_params.enable_uninitialized_access_warning) {
+					read_page  = &RAM[(ram_bank << 13) + address];
+					write_page = read_page;
+					dirty_page = &RAM_dirty[((ram_bank << 13) + address) >> 6];
+				}
+				break;
+			case MEMMAP_ROMBANK:
+				read_page = &ROM[(ROM_BANK << 14) + address - 0xc000];
+				if (rom_bank >= NUM_ROM_BANKS) {
+					write_page = &ROM[(rom_bank << 14) + address - 0xc000];
+					dirty_page = &ROM_dirty[((rom_bank << 14) + address - 0xc000) >> 6];
+				}
+				break;
+			default:
+				break;
+		}
+
+		const bool flagged = debugger_page_has_flags(page, memory_get_current_bank(address));
+		if (flagged) {
+			read_page  = nullptr;
+			write_page = nullptr;
+			dirty_page = nullptr;
+		}
+
+		Read_page_table[page]    = read_page;
+		Write_page_table[page]   = write_page;
+		Dirty_page_table[page]   = dirty_page;
+		Flagged_page_table[page] = flagged;
+	}
+}
+
+void memory_update_page_table()
+{
+	update_pages(0x00, 0xff);
+}
+
+// RAM_BANK and ROM_BANK live in RAM, so writes to them can come from anywhere that writes to RAM.
+static void update_bank_pages(uint16_t address)
+{
+	if (address == 0) {
+		update_pages(0xa0, 0xbf);
+	} else if (address == 1) {
+		update_pages(0xc0, 0xff);
+	}
+}
+
 //
 // Emulator state
 //
@@ -286,6 +391,7 @@ void emu_write(uint8_t reg, uint8_t value)
 		case 5: gif_recorder_set((gif_recorder_command_t)value); break;
 		case 6: wav_recorder_set((wav_recorder_command_t)value); break;
 		case 7: Options.no_keybinds = v; break;
+		case 12: machine_request_exit(value); break;
 		default: break; // printf("WARN: Invalid register %x\n", DEVICE_EMULATOR + reg);
 	}
 }
@@ -357,7 +463,10 @@ static void debug_write(uint16_t address, uint8_t bank, uint8_t value)
 {
 	switch (MAP[(address >> (BYTE * 8)) & 0xff]) {
 		case MEMMAP_NULL: break;
-		case MEMMAP_DIRECT: RAM[address] = value; break;
+		case MEMMAP_DIRECT:
+			RAM_dirty[address >> 6] = 1;
+			RAM[address]            = value;
+			break;
 		case MEMMAP_RAMBANK: debug_ram_write(address, bank, value); break;
 		case MEMMAP_ROMBANK: debug_rom_write(address, bank, value); break;
 		case MEMMAP_IO: real_write<memory_map_io, 0>(address, value); break;
@@ -375,7 +484,10 @@ static void real_write(uint16_t address, uint8_t value)
 {
 	switch (MAP[(address >> (BYTE * 8)) & 0xff]) {
 		case MEMMAP_NULL: break;
-		case MEMMAP_DIRECT: RAM[address] = value; break;
+		case MEMMAP_DIRECT:
+			RAM_dirty[address >> 6] = 1;
+			RAM[address]            = value;
+			break;
 		case MEMMAP_RAMBANK: real_ram_write(address, value); break;
 		case MEMMAP_ROMBANK: real_rom_write(address, value); break;
 		case MEMMAP_IO: real_write<memory_map_io, 0>(address, value); break;
@@ -402,11 +514,31 @@ uint8_t debug_read6502(uint16_t address, uint8_t bank)
 	return debug_read<memory_map_hi, 1>(address, bank);
 }
 
+// Devices are only stepped between batches of instructions, so they have to catch up to the
+// CPU before it can observe or change their state, and the batch has to end afterwards so
+// any IRQ changes are seen at the same instruction boundary as before.
+static void sync_io_access(uint16_t address)
+{
+	if ((address >> 8) == 0x9f) {
+		machine_sync_devices();
+		yield6502();
+	}
+}
+
 uint8_t read6502(uint16_t address)
 {
-	debug6502 |= (DEBUG6502_READ | DEBUG6502_EXEC) & debugger_get_flags(address, address >= 0xc000 ? memory_get_rom_bank() : memory_get_ram_bank());
+	uint8_t        value;
+	const uint8_t *page = Read_page_table[address >> 8];
+	if (page != nullptr) {
+		value = page[address & 0xff];
+	} else {
+		if (Flagged_page_table[address >> 8]) {
+			debug6502 |= debugger_check_access(address, address >= 0xc000 ? memory_get_rom_bank() : memory_get_ram_bank(), DEBUG6502_READ | DEBUG6502_EXEC);
+		}
+		sync_io_access(address);
 
-	uint8_t value = real_read<memory_map_hi, 1>(address);
+		value = real_read<memory_map_hi, 1>(address);
+	}
 #if defined(TRACE)
 	if (Options.log_mem_read)
 		printf("%04X -> %02X\n", address, value);
@@ -417,18 +549,33 @@ uint8_t read6502(uint16_t address)
 void debug_write6502(uint16_t address, uint8_t bank, uint8_t value)
 {
 	debug_write<memory_map_hi, 1>(address, bank, value);
+	update_bank_pages(address);
 }
 
 void write6502(uint16_t address, uint8_t value)
 {
-	debug6502 |= DEBUG6502_WRITE & debugger_get_flags(address, address >= 0xc000 ? memory_get_rom_bank() : memory_get_ram_bank());
-	if (~debug6502 & DEBUG6502_WRITE) {
+	uint8_t *page = Write_page_table[address >> 8];
+	if (page != nullptr) {
 #if defined(TRACE)
 		if (Options.log_mem_write)
 			printf("%02X -> %04X\n", value, address);
 #endif
-		real_write<memory_map_hi, 1>(address, value);
+		page[address & 0xff]                                  = value;
+		Dirty_page_table[address >> 8][(address & 0xff) >> 6] = 1;
+	} else {
+		if (Flagged_page_table[address >> 8]) {
+			debug6502 |= debugger_check_access(address, address >= 0xc000 ? memory_get_rom_bank() : memory_get_ram_bank(), DEBUG6502_WRITE, value);
+		}
+		if (~debug6502 & DEBUG6502_WRITE) {
+#if defined(TRACE)
+			if (Options.log_mem_write)
+				printf("%02X -> %04X\n", value, address);
+#endif
+			sync_io_access(address);
+			real_write<memory_map_hi, 1>(address, value);
+		}
 	}
+	update_bank_pages(address);
 }
 
 uint8_t bank6502(uint16_t address)
@@ -450,6 +597,57 @@ void memory_save(SDL_RWops *f, bool dump_ram, bool dump_bank)
 	}
 }
 
+//
+// Snapshots
+//
+
+void memory_mark_ram_dirty(uint32_t offset, uint32_t size)
+{
+	if (size > 0) {
+		memset(RAM_dirty + (offset >> 6), 1, ((offset + size - 1) >> 6) - (offset >> 6) + 1);
+	}
+}
+
+void memory_save_state(snapshot_writer &w)
+{
+	w.write(Options.num_ram_banks);
+	w.write(addr_ym);
+	// Some host code (hypercalls, loading files) writes to fixed RAM directly, and it's small
+	// enough to always compare.
+	w.write_bytes(RAM, 0xa000);
+	w.write_tracked(RAM + 0xa000, RAM_SIZE - 0xa000, RAM_dirty + (0xa000 >> 6), 64);
+	w.write_tracked(ROM, ROM_SIZE, ROM_dirty, 64);
+	w.write_tracked(RAM_written, RAM_WRITE_BLOCKS * sizeof(uint64_t), RAM_dirty, sizeof(uint64_t));
+	w.clear_dirty(RAM_dirty, RAM_WRITE_BLOCKS);
+	w.clear_dirty(ROM_dirty, ROM_DIRTY_BLOCKS);
+}
+
+bool memory_check_state(snapshot_reader &r)
+{
+	if (!r.expect(Options.num_ram_banks)) {
+		printf("Snapshot was saved with a different number of RAM banks.\n");
+		return false;
+	}
+	return r.skip(sizeof(addr_ym) + RAM_SIZE + ROM_SIZE + RAM_WRITE_BLOCKS * sizeof(uint64_t));
+}
+
+bool memory_load_state(snapshot_reader &r)
+{
+	if (!r.expect(Options.num_ram_banks)) {
+		printf("Snapshot was saved with a different number of RAM banks.\n");
+		return false;
+	}
+	r.read(addr_ym);
+	r.read_bytes(RAM, RAM_SIZE);
+	r.read_bytes(ROM, ROM_SIZE);
+	r.read_bytes(RAM_written, RAM_WRITE_BLOCKS * sizeof(uint64_t));
+
+	memset(RAM_dirty, 1, RAM_WRITE_BLOCKS);
+	memset(ROM_dirty, 1, ROM_DIRTY_BLOCKS);
+	memory_update_page_table();
+	return r.ok();
+}
+
 //
 // Banking access/mutates
 //
@@ -457,6 +655,7 @@ void memory_save(SDL_RWops *f, bool dump_ram, bool dump_bank)
 void memory_set_ram_bank(uint8_t bank)
 {
 	RAM_BANK = bank & (NUM_MAX_RAM_BANKS - 1);
+	update_bank_pages(0);
 }
 
 uint8_t memory_get_ram_bank()
@@ -467,6 +666,7 @@ uint8_t memory_get_ram_bank()
 void memory_set_rom_bank(uint8_t bank)
 {
 	ROM_BANK = bank & (TOTAL_ROM_BANKS - 1);
+	update_bank_pages(1);
 }
 
 uint8_t memory_get_rom_bank()
@@ -484,3 +684,8 @@ uint8_t memory_get_current_bank(uint16_t address)
 		return 0;
 	}
 }
+
+uint32_t memory_get_seed()
+{
+	return Memory_params.seed;
+}
@@ -13,9 +13,13 @@
 
 #define NUM_MAX_RAM_BANKS 256
 
+class snapshot_reader;
+class snapshot_writer;
+
 struct memory_init_params {
 	uint16_t num_banks;
 	bool     randomize;
+	uint32_t seed; // For randomize
 	bool     enable_uninitialized_access_warning;
 };
 
@@ -38,4 +42,16 @@ uint8_t memory_get_rom_bank();
 
 uint8_t memory_get_current_bank(uint16_t address);
 
+// The seed RAM was filled from, for other devices that start out with random contents.
+uint32_t memory_get_seed();
+
+void memory_update_page_table();
+
+// For host code that writes to banked RAM directly instead of through write6502.
+void memory_mark_ram_dirty(uint32_t offset, uint32_t size);
+
+void memory_save_state(snapshot_writer &w);
+bool memory_check_state(snapshot_reader &r);
+bool memory_load_state(snapshot_reader &r);
+
 #endif
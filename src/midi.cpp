@@ -5,6 +5,7 @@
 #include <cstring>
 #include <unordered_map>
 
+#include "replay.h"
 #include "vera/vera_psg.h"
 #include "ym2151/ym2151.h"
 
@@ -815,16 +816,25 @@ void midi_process()
 	for (auto &[port, open_port] : Open_midi_ports) {
 		open_port.controller->getMessage(&message);
 		while (message.size() > 0) {
-			if (Show_midi_messages) {
-				midi_port_descriptor desc(port);
-				printf("midi [%d,%d]: ", (int)desc.api, (int)desc.port_number);
-			}
-			parse_message(open_port, message);
+			replay_midi_message(port, message);
 			open_port.controller->getMessage(&message);
 		}
 	}
 }
 
+void midi_process_message(const midi_port_descriptor &port, const std::vector<unsigned char> &message)
+{
+	auto open_port = Open_midi_ports.find(port);
+	if (open_port == Open_midi_ports.end() || message.empty()) {
+		return;
+	}
+
+	if (Show_midi_messages) {
+		printf("midi [%d,%d]: ", (int)port.api, (int)port.port_number);
+	}
+	parse_message(open_port->second, message);
+}
+
 void midi_open_port(const midi_port_descriptor &port)
 {
 	if (Open_midi_ports.find(port) == Open_midi_ports.end()) {
@@ -4,6 +4,7 @@
 
 #	include <functional>
 #	include <string>
+#	include <vector>
 
 #	define MAX_MIDI_CHANNELS (16) // Comes from the 4-bit field in the midi message format
 
@@ -63,6 +64,9 @@ struct midi_channel_settings {
 void midi_init();
 void midi_process();
 
+// Plays a message through the port's channel settings, if the port is open.
+void midi_process_message(const midi_port_descriptor &port, const std::vector<unsigned char> &message);
+
 void midi_open_port(const midi_port_descriptor &port);
 void midi_close_port(const midi_port_descriptor &port);
 
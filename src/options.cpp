@@ -7,6 +7,7 @@
 #include "debugger.h"
 #include "overlay/overlay.h"
 #include "symbols.h"
+#include "trace.h"
 #include "version.h"
 
 options               Options;
@@ -87,6 +88,12 @@ static void usage()
 	printf("\tRecord a gif for the video output.\n");
 	printf("\tUse ,wait to start paused.\n");
 
+	printf("-headless\n");
+	printf("\tRun without a window, audio, or input devices, as fast as possible.\n");
+	printf("\tThe emulator exits when the program counter reaches $FFFF, the SMC powers off, or\n");
+	printf("\ta value is written to emulator register $9FBC, which becomes the process exit code.\n");
+	printf("\tA system dump is written on exit unless disabled by the program (see -dump).\n");
+
 	printf("-help\n");
 	printf("\tPrint this message and exit.\n");
 
@@ -102,10 +109,10 @@ static void usage()
 	printf("\tEnable a specific keyboard layout decode table.\n");
 
 #if defined(TRACE)
-	printf("-log {K|S|V|Cl|Cb|Ca|Co|Mw|Mr}...\n");
+	printf("-log {K|S|V|Cl|Cm|Ca|Co|Mw|Mr}...\n");
 	printf("\tEnable logging of (K)eyboard, (S)peed, (V)ideo, (C)pu, (M)emory.\n");
 	printf("\tMultiple characters are possible, e.g. -log KS\n");
-	printf("\tCpu activity logging works with zones:\n");
+	printf("\tCpu activity logging works with zones, limiting what a saved -trace includes:\n");
 	printf("\t\t- Cl = Cpu activity logging in low ram,     from $0000 to $07FF.\n");
 	printf("\t\t- Cm = Cpu activity logging in main ram,    from $0800 to $9FFF.\n");
 	printf("\t\t- Ca = Cpu activity logging in banked ram,  from $A000 to $BFFF.\n");
@@ -115,9 +122,14 @@ static void usage()
 	printf("\t\t- Mw = Memory write activity logging.\n");
 
 #else
-	printf("-log {K|S|V}...\n");
+	printf("-log {K|S|V|Cl|Cm|Ca|Co}...\n");
 	printf("\tEnable logging of (K)eyboard, (S)peed, (V)ideo, (C)pu.\n");
 	printf("\tMultiple characters are possible, e.g. -log KS\n");
+	printf("\tCpu activity logging works with zones, limiting what a saved -trace includes:\n");
+	printf("\t\t- Cl = Cpu activity logging in low ram,     from $0000 to $07FF.\n");
+	printf("\t\t- Cm = Cpu activity logging in main ram,    from $0800 to $9FFF.\n");
+	printf("\t\t- Ca = Cpu activity logging in banked ram,  from $A000 to $BFFF.\n");
+	printf("\t\t- Co = Cpu activity logging in banked rom,  from $C000 to $FFFF.\n");
 #endif
 
 	printf("-nobinds\n");
@@ -147,6 +159,10 @@ static void usage()
 	printf("\t(.PRG file with 2 byte start address header)\n");
 	printf("\tThe override load address is hex without a prefix.\n");
 
+	printf("-profile <file>\n");
+	printf("\tProfile the CPU from the start, saving where the cycles went to the file on exit.\n");
+	printf("\tThe file is in callgrind format, or folded stacks for flame graphs if its name ends in .folded.\n");
+
 	printf("-quality {nearest|linear|best}\n");
 	printf("\tScaling algorithm quality\n");
 
@@ -154,6 +170,17 @@ static void usage()
 	printf("\tSpecify banked RAM size in KB (8, 16, 32, ..., 2048).\n");
 	printf("\tThe default is 512.\n");
 
+	printf("-record <input.rpl>\n");
+	printf("\tRecord all input to the machine, from the moment it starts, so that it can be played back with -replay.\n");
+
+	printf("-replay <input.rpl>\n");
+	printf("\tPlay back input recorded with -record, starting from the same machine state it was recorded from.\n");
+	printf("\tThe ROM, programs and SD card image have to be the same as when it was recorded. Incompatible with -record.\n");
+
+	printf("-rewind <MB>\n");
+	printf("\tKeep a buffer of up to this many MB to rewind the machine with (Ctrl-Backspace).\n");
+	printf("\tThe default is 0, which disables rewinding.\n");
+
 	printf("-rom <rom.bin>\n");
 	printf("\tOverride KERNAL/BASIC/* ROM file.\n");
 
@@ -184,9 +211,19 @@ static void usage()
 	printf("-sdcard <sdcard.img>\n");
 	printf("\tSpecify SD card image (partition map + FAT32)\n");
 
+	printf("-sdcard_overlay <sdcard.img.overlay>\n");
+	printf("\tFile to keep writes to the SD card in, the image itself is only changed when merging.\n");
+	printf("\tBy default this is the image path with .overlay appended.\n");
+
+	printf("-seed <number>\n");
+	printf("\tFill RAM from this seed and ignore -rtc, so that every run with the same options goes the same way.\n");
+
 	printf("-serial\n");
 	printf("\tEnable the serial bus (experimental)\n");
 
+	printf("-snapshot <state.snp>\n");
+	printf("\tLoad a machine state saved with \"Save State\" once the machine has started.\n");
+
 	printf("-sound <output device>\n");
 	printf("\tSet the output device used for audio emulation. Incompatible with -nosound.\n");
 
@@ -205,6 +242,13 @@ static void usage()
 	printf("-test {0, 1, 2, 3}\n");
 	printf("\tImmediately invoke the TEST command with the provided test number.\n");
 
+	printf("-trace [<instructions>]\n");
+	printf("\tKeep a trace of the last instructions the CPU ran (about a million by default), to be saved\n");
+	printf("\tfrom the Machine menu or along with a memory dump. -log selects which areas it includes.\n");
+
+	printf("-tracerange <start>,<end>\n");
+	printf("\tOnly include the instructions from start to end (in hex, inclusive) in a saved -trace.\n");
+
 	printf("-verbose\n");
 	printf("\tPrint additional debug output from the emulator.\n");
 
@@ -217,14 +261,17 @@ static void usage()
 
 	printf("-warp {factor}\n");
 	printf("\tEnable warp mode, run emulator as fast as possible.\n");
-	printf("\tIf specified, the warp factor [1...16] determines how frequently to skip video rendering.\n");
-	printf("\tThis can significantly boost the emulated speed, at the cost of not seeing video.\n");
+	printf("\tVideo is only rendered for the frames that are displayed, about 60 a second.\n");
+	printf("\tA warp factor is still accepted, but no longer changes anything.\n");
 
 	printf("-wav <file.wav>[{,wait|,auto}]\n");
 	printf("\tRecord a wav for the audio output.\n");
 	printf("\tUse ,wait to start paused.\n");
 	printf("\tUse ,auto to start paused, but begin recording once a non-zero audio signal is detected.\n");
 
+	printf("-wavfloat\n");
+	printf("\tRecord the wav with 32-bit floating point samples instead of 16-bit integers.\n");
+
 	printf("-widescreen\n");
 	printf("\tDisplay the emulated X16 in a 16:9 aspect ratio instead of 4:3.\n");
 
@@ -463,6 +510,11 @@ static void parse_cmdline(mINI::INIMap<std::string> &ini, int argc, char **argv)
 			argv++;
 			argc--;
 
+		} else if (!strcmp(argv[0], "-headless")) {
+			argc--;
+			argv++;
+			ini["headless"] = "true";
+
 		} else if (!strcmp(argv[0], "-help")) {
 			argc--;
 			argv++;
@@ -606,6 +658,50 @@ static void parse_cmdline(mINI::INIMap<std::string> &ini, int argc, char **argv)
 			argc--;
 			argv++;
 
+		} else if (!strcmp(argv[0], "-profile")) {
+			argc--;
+			argv++;
+			if (!argc || argv[0][0] == '-') {
+				usage();
+			}
+
+			ini["profile"] = argv[0];
+			argc--;
+			argv++;
+
+		} else if (!strcmp(argv[0], "-record")) {
+			argc--;
+			argv++;
+			if (!argc || argv[0][0] == '-') {
+				usage();
+			}
+
+			ini["record"] = argv[0];
+			argc--;
+			argv++;
+
+		} else if (!strcmp(argv[0], "-replay")) {
+			argc--;
+			argv++;
+			if (!argc || argv[0][0] == '-') {
+				usage();
+			}
+
+			ini["replay"] = argv[0];
+			argc--;
+			argv++;
+
+		} else if (!strcmp(argv[0], "-rewind")) {
+			argc--;
+			argv++;
+			if (!argc || argv[0][0] == '-') {
+				usage();
+			}
+
+			ini["rewind"] = argv[0];
+			argc--;
+			argv++;
+
 		} else if (!strcmp(argv[0], "-randram")) {
 		    /* this operation has no effect anymore, randomizing the Ram is now default */
 			argc--;
@@ -698,6 +794,39 @@ static void parse_cmdline(mINI::INIMap<std::string> &ini, int argc, char **argv)
 			argc--;
 			argv++;
 
+		} else if (!strcmp(argv[0], "-sdcard_overlay")) {
+			argc--;
+			argv++;
+			if (!argc || argv[0][0] == '-') {
+				usage();
+			}
+
+			ini["sdcard_overlay"] = argv[0];
+			argc--;
+			argv++;
+
+		} else if (!strcmp(argv[0], "-snapshot")) {
+			argc--;
+			argv++;
+			if (!argc || argv[0][0] == '-') {
+				usage();
+			}
+
+			ini["snapshot"] = argv[0];
+			argc--;
+			argv++;
+
+		} else if (!strcmp(argv[0], "-seed")) {
+			argc--;
+			argv++;
+			if (!argc || argv[0][0] == '-') {
+				usage();
+			}
+
+			ini["seed"] = argv[0];
+			argc--;
+			argv++;
+
 		} else if (!strcmp(argv[0], "-serial")) {
 			argc--;
 			argv++;
@@ -766,6 +895,28 @@ static void parse_cmdline(mINI::INIMap<std::string> &ini, int argc, char **argv)
 			argc--;
 			argv++;
 
+		} else if (!strcmp(argv[0], "-trace")) {
+			argc--;
+			argv++;
+
+			if (argc && isdigit(argv[0][0])) {
+				ini["trace"] = argv[0];
+				argc--;
+				argv++;
+			} else {
+				ini["trace"] = "true";
+			}
+		} else if (!strcmp(argv[0], "-tracerange")) {
+			argc--;
+			argv++;
+			if (!argc || argv[0][0] == '-') {
+				usage();
+			}
+
+			ini["tracerange"] = argv[0];
+			argc--;
+			argv++;
+
 		} else if (!strcmp(argv[0], "-warp")) {
 			argc--;
 			argv++;
@@ -788,6 +939,11 @@ static void parse_cmdline(mINI::INIMap<std::string> &ini, int argc, char **argv)
 			argv++;
 			argc--;
 
+		} else if (!strcmp(argv[0], "-wavfloat")) {
+			argc--;
+			argv++;
+			ini["wavfloat"] = "true";
+
 		} else if (!strcmp(argv[0], "-widescreen")) {
 			argc--;
 			argv++;
@@ -852,6 +1008,13 @@ static char const *set_options(options &opts, mINI::INIMap<std::string> &ini)
 		opts.num_ram_banks = kb / 8;
 	}
 
+	if (ini.has("rewind")) {
+		opts.rewind_mb = atoi(ini["rewind"].c_str());
+		if (opts.rewind_mb < 0) {
+			return "rewind";
+		}
+	}
+
 	if (ini.has("hypercall_path")) {
 		opts.hyper_path = ini["hypercall_path"];
 	}
@@ -910,6 +1073,62 @@ static char const *set_options(options &opts, mINI::INIMap<std::string> &ini)
 		opts.sdcard_path = ini["sdcard"];
 	}
 
+	if (ini.has("sdcard_overlay")) {
+		opts.sdcard_overlay_path = ini["sdcard_overlay"];
+	}
+
+	if (ini.has("snapshot")) {
+		opts.snapshot_path = ini["snapshot"];
+	}
+
+	if (ini.has("record")) {
+		opts.record_path = ini["record"];
+	}
+
+	if (ini.has("profile")) {
+		opts.profile_path = ini["profile"];
+	}
+
+	if (ini.has("replay")) {
+		if (ini.has("record")) {
+			return "replay";
+		}
+		opts.replay_path = ini["replay"];
+	}
+
+	if (ini.has("seed")) {
+		char *end     = nullptr;
+		opts.seed     = (uint32_t)strtoul(ini["seed"].c_str(), &end, 0);
+		opts.use_seed = true;
+		if (end == nullptr || *end != '\0') {
+			return "seed";
+		}
+	}
+
+	if (ini.has("trace")) {
+		if (ini["trace"] == "true") {
+			opts.trace_size = TRACE_DEFAULT_SIZE;
+		} else {
+			opts.trace_size = (uint32_t)strtoul(ini["trace"].c_str(), nullptr, 10);
+		}
+	}
+
+	if (ini.has("tracerange")) {
+		const char         *range = ini["tracerange"].c_str();
+		char               *end   = nullptr;
+		const unsigned long first = strtoul(range, &end, 16);
+		if (end == range || *end != ',') {
+			return "tracerange";
+		}
+		range                    = end + 1;
+		const unsigned long last = strtoul(range, &end, 16);
+		if (end == range || *end != '\0' || first > last || last > 0xffff) {
+			return "tracerange";
+		}
+		opts.trace_first = (uint16_t)first;
+		opts.trace_last  = (uint16_t)last;
+	}
+
 	if (ini.has("warp")) {
 		if (ini["warp"] == "true") {
 			opts.warp_factor = 9;
@@ -918,6 +1137,10 @@ static char const *set_options(options &opts, mINI::INIMap<std::string> &ini)
 		}
 	}
 
+	if (ini.has("headless") && ini["headless"] == "true") {
+		opts.headless = true;
+	}
+
 	if (ini.has("echo")) {
 		char const *echo_mode = ini["echo"].c_str();
 		if (!strcmp(echo_mode, "raw")) {
@@ -1035,6 +1258,10 @@ static char const *set_options(options &opts, mINI::INIMap<std::string> &ini)
 		}
 	}
 
+	if (ini.has("wavfloat") && ini["wavfloat"] == "true") {
+		opts.wav_float = true;
+	}
+
 	if (ini.has("stds")) {
 		opts.load_standard_symbols = true;
 	}
@@ -1334,7 +1561,22 @@ static void set_ini_main(mINI::INIMap<std::string> &ini_main, bool all)
 	set_option("test", Options.test_number, Default_options.test_number);
 	set_option("nvram", Options.nvram_path, Default_options.nvram_path);
 	set_option("sdcard", Options.sdcard_path, Default_options.sdcard_path);
+	set_option("sdcard_overlay", Options.sdcard_overlay_path, Default_options.sdcard_overlay_path);
+	set_option("snapshot", Options.snapshot_path, Default_options.snapshot_path);
+	set_option("record", Options.record_path, Default_options.record_path);
+	set_option("replay", Options.replay_path, Default_options.replay_path);
+	set_option("profile", Options.profile_path, Default_options.profile_path);
+	if (Options.use_seed) {
+		ini_main["seed"] = std::to_string(Options.seed);
+	}
 	set_option("warp", Options.warp_factor > 0, Default_options.warp_factor > 0);
+	set_option("rewind", Options.rewind_mb, Default_options.rewind_mb);
+	set_option("trace", Options.trace_size, Default_options.trace_size);
+	if (all || Options.trace_first != Default_options.trace_first || Options.trace_last != Default_options.trace_last) {
+		char range[16];
+		snprintf(range, sizeof(range), "%04x,%04x", Options.trace_first, Options.trace_last);
+		ini_main["tracerange"] = range;
+	}
 	set_option("echo", echo_mode_str(Options.echo_mode), echo_mode_str(Default_options.echo_mode));
 
 	if (all || Options.log_keyboard != Default_options.log_keyboard || Options.log_speed != Default_options.log_speed || Options.log_video != Default_options.log_video) {
@@ -1370,6 +1612,7 @@ static void set_ini_main(mINI::INIMap<std::string> &ini_main, bool all)
 
 	set_comma_option("gif", Options.gif_path, Default_options.gif_path, gif_recorder_start_str(Options.gif_start), gif_recorder_start_str(Default_options.gif_start));
 	set_comma_option("wav", Options.wav_path, Default_options.wav_path, wav_recorder_start_str(Options.wav_start), wav_recorder_start_str(Default_options.wav_start));
+	set_option("wavfloat", Options.wav_float, Default_options.wav_float);
 	set_option("stds", Options.load_standard_symbols, Default_options.load_standard_symbols);
 	set_option("scale", Options.window_scale, Default_options.window_scale);
 	set_option("quality", quality_str(Options.scale_quality), quality_str(Default_options.scale_quality));
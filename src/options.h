@@ -50,14 +50,20 @@ struct options {
 	std::filesystem::path                                 hyper_path  = ".";
 	std::filesystem::path                                 prg_path    = "";
 	std::filesystem::path                                 bas_path    = "";
-	std::filesystem::path                                 sdcard_path = "";
-	std::filesystem::path                                 gif_path    = "";
-	std::filesystem::path                                 wav_path    = "";
+	std::filesystem::path                                 sdcard_path         = "";
+	std::filesystem::path                                 sdcard_overlay_path = "";
+	std::filesystem::path                                 snapshot_path       = "";
+	std::filesystem::path                                 record_path         = "";
+	std::filesystem::path                                 replay_path         = "";
+	std::filesystem::path                                 profile_path        = "";
+	std::filesystem::path                                 gif_path            = "";
+	std::filesystem::path                                 wav_path            = "";
 
 	uint16_t prg_override_start = 0;
 
 	gif_recorder_start_t gif_start = gif_recorder_start_t::GIF_RECORDER_START_NOW;
 	wav_recorder_start_t wav_start = wav_recorder_start_t::WAV_RECORDER_START_NOW;
+	bool                 wav_float = false;
 
 	bool run_after_load = false;
 	bool run_geos       = false;
@@ -86,6 +92,11 @@ struct options {
 	uint8_t         keymap        = 0;  // KERNAL's default
 	int             test_number   = -1;
 	int             warp_factor   = 0;
+	int             rewind_mb     = 0;  // Rewind buffer size, 0 disables rewinding
+	uint32_t        trace_size    = 0;  // Instructions kept in the CPU trace, 0 disables tracing
+	uint16_t        trace_first   = 0;  // Range of addresses a saved CPU trace includes
+	uint16_t        trace_last    = 0xffff;
+	uint32_t        seed          = 0;  // Only used with use_seed
 	int             window_scale  = 2;
 	bool            widescreen    = false;
 	scale_quality_t scale_quality = scale_quality_t::NEAREST;
@@ -95,6 +106,8 @@ struct options {
 	bool        no_sound       = false;
 	int         audio_buffers  = 8;
 
+	bool headless = false;
+
 	bool set_system_time    = false;
 	bool no_keybinds        = false;
 	bool no_ieee_hypercalls = false;
@@ -104,6 +117,7 @@ struct options {
 	bool ym_strict          = false;
 	bool memory_randomize   = true;
 	bool memory_uninit_warn = false;
+	bool use_seed           = false;
 };
 
 extern options Options;
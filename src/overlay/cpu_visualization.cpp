@@ -75,6 +75,11 @@ void cpu_visualization_enable(bool enable)
 	Enabled = enable;
 }
 
+bool cpu_visualization_is_enabled()
+{
+	return Enabled;
+}
+
 void cpu_visualization_step()
 {
 	if (!Enabled) {
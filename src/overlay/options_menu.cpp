@@ -83,6 +83,8 @@ void draw_options_menu()
 	file_option("bin", Options.rom_path, "ROM path", "Location of the emulator ROM file.\nCommand line: -rom <path>");
 	file_option("bin;nvram", Options.nvram_path, "NVRAM path", "Location of NVRAM image file, if any.\nCommand line: -nvram <path>");
 	file_option("bin;img;sdcard", Options.sdcard_path, "SD Card path", "Location of SD card image file, if any.\nCommand line: -sdcard <path>");
+	file_option("overlay", Options.sdcard_overlay_path, "SD Card overlay path", "Location of the file that keeps writes to the SD card, if not next to the image.\nCommand line: -sdcard_overlay <path>");
+	file_option("snp", Options.snapshot_path, "Snapshot path", "Machine state to load at startup, if any.\nCommand line: -snapshot <path>");
 
 	ImGui::NewLine();
 
@@ -199,7 +201,16 @@ void draw_options_menu()
 		Options.warp_factor = warp_speed ? 1 : 0;
 	}
 	if (ImGui::IsItemHovered()) {
-		ImGui::SetTooltip("Toggle warp speed. (VERA will skip most frames, speed cap is removed.)\nCommand line: -warp");
+		ImGui::SetTooltip("Toggle warp speed. (Only frames that are displayed are rendered, speed cap is removed.)\nCommand line: -warp");
+	}
+
+	if (ImGui::InputInt("Rewind MBs", &Options.rewind_mb, 16, 64)) {
+		if (Options.rewind_mb < 0) {
+			Options.rewind_mb = 0;
+		}
+	}
+	if (ImGui::IsItemHovered()) {
+		ImGui::SetTooltip("Size of the buffer kept for rewinding the machine with Ctrl-Backspace, 0 to disable.\nCommand line: -rewind <MB>");
 	}
 
 	ImGui::NewLine();
@@ -26,13 +26,17 @@
 #include "display.h"
 #include "glue.h"
 #include "joystick.h"
-#include "keyboard.h"
 #include "midi_overlay.h"
 #include "options_menu.h"
 #include "psg_overlay.h"
+#include "profiler.h"
+#include "replay.h"
+#include "rewind.h"
 #include "smc.h"
+#include "snapshot.h"
 #include "symbols.h"
 #include "timing.h"
+#include "trace.h"
 #include "vera/sdcard.h"
 #include "vera/vera_video.h"
 #include "ym2151_overlay.h"
@@ -114,8 +118,12 @@ static void draw_debugger_cpu_status()
 			ImGui::EndGroup();
 
 			ImGui::NewLine();
-			ImGui::InputHexLabel("RAM Bank", RAM[0]);
-			ImGui::InputHexLabel("ROM Bank", RAM[1]);
+			if (ImGui::InputHexLabel("RAM Bank", RAM[0])) {
+				memory_set_ram_bank(RAM[0]);
+			}
+			if (ImGui::InputHexLabel("ROM Bank", RAM[1])) {
+				memory_set_rom_bank(RAM[1]);
+			}
 
 			ImGui::NewLine();
 
@@ -1737,19 +1745,93 @@ static void draw_debugger_vram_visualizer()
 	viz.draw_preview_widgets();
 }
 
+// The breakpoint whose condition, hit target and message are being edited.
+static uint16_t    Edit_bp_address = 0;
+static uint8_t     Edit_bp_bank    = 0;
+static char        Edit_bp_condition[256];
+static char        Edit_bp_message[256];
+static int         Edit_bp_hit_target = 0;
+static std::string Edit_bp_error;
+static bool        Edit_bp_open = false;
+
+static void edit_breakpoint(uint16_t address, uint8_t bank)
+{
+	Edit_bp_address = address;
+	Edit_bp_bank    = bank;
+	snprintf(Edit_bp_condition, sizeof(Edit_bp_condition), "%s", debugger_get_breakpoint_condition(address, bank));
+	snprintf(Edit_bp_message, sizeof(Edit_bp_message), "%s", debugger_get_breakpoint_message(address, bank));
+	Edit_bp_hit_target = (int)debugger_get_breakpoint_hit_target(address, bank);
+	Edit_bp_error.clear();
+	Edit_bp_open = true;
+}
+
+static void draw_breakpoint_editor()
+{
+	// Opened from here rather than from the table, whose rows push their own IDs.
+	if (Edit_bp_open) {
+		ImGui::OpenPopup("Edit Breakpoint");
+		Edit_bp_open = false;
+	}
+	if (!ImGui::BeginPopup("Edit Breakpoint")) {
+		return;
+	}
+
+	ImGui::Text("Breakpoint at $%04X", Edit_bp_address);
+
+	ImGui::InputText("Condition", Edit_bp_condition, sizeof(Edit_bp_condition));
+	if (ImGui::IsItemHovered()) {
+		ImGui::SetTooltip("Only break when this is non-zero, e.g. a == $20 && peek($30) > 5.\nRegisters: a x y sp p pc, flags: c z i d v n,\nclock, ram, rom, peek(addr[, bank]), peekw(addr[, bank]) and labels.");
+	}
+
+	ImGui::InputInt("Break After Hits", &Edit_bp_hit_target);
+	if (Edit_bp_hit_target < 0) {
+		Edit_bp_hit_target = 0;
+	}
+
+	ImGui::InputText("Log Message", Edit_bp_message, sizeof(Edit_bp_message));
+	if (ImGui::IsItemHovered()) {
+		ImGui::SetTooltip("Log this message instead of breaking, e.g. a={a} clock={clock:d}.\nExpressions in braces are written in hex, or in decimal with :d.");
+	}
+
+	if (!Edit_bp_error.empty()) {
+		ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", Edit_bp_error.c_str());
+	}
+
+	if (ImGui::Button("Apply")) {
+		Edit_bp_error.clear();
+		debugger_set_breakpoint_hit_target(Edit_bp_address, Edit_bp_bank, (uint32_t)Edit_bp_hit_target);
+		if (debugger_set_breakpoint_condition(Edit_bp_address, Edit_bp_bank, Edit_bp_condition, Edit_bp_error) &&
+		    debugger_set_breakpoint_message(Edit_bp_address, Edit_bp_bank, Edit_bp_message, Edit_bp_error)) {
+			ImGui::CloseCurrentPopup();
+		}
+	}
+	ImGui::SameLine();
+	if (ImGui::Button("Reset Hits")) {
+		debugger_reset_breakpoint_hits(Edit_bp_address, Edit_bp_bank);
+	}
+	ImGui::SameLine();
+	if (ImGui::Button("Cancel")) {
+		ImGui::CloseCurrentPopup();
+	}
+
+	ImGui::EndPopup();
+}
+
 static void draw_breakpoints()
 {
 	ImGui::BeginGroup();
 	{
 		ImGui::PushStyleVar(ImGuiStyleVar_IndentSpacing, 0.0f);
 		if (ImGui::TreeNodeEx("Breakpoints", ImGuiTreeNodeFlags_Framed | ImGuiTreeNodeFlags_DefaultOpen)) {
-			if (ImGui::BeginTable("breakpoints", 7)) {
+			if (ImGui::BeginTable("breakpoints", 9)) {
 				ImGui::TableSetupColumn("", ImGuiTableColumnFlags_WidthFixed, 16);
 				ImGui::TableSetupColumn("R", ImGuiTableColumnFlags_WidthFixed, 16);
 				ImGui::TableSetupColumn("W", ImGuiTableColumnFlags_WidthFixed, 16);
 				ImGui::TableSetupColumn("X", ImGuiTableColumnFlags_WidthFixed, 16);
 				ImGui::TableSetupColumn("Address", ImGuiTableColumnFlags_WidthFixed, 64);
 				ImGui::TableSetupColumn("Bank", ImGuiTableColumnFlags_WidthFixed, 48);
+				ImGui::TableSetupColumn("Hits", ImGuiTableColumnFlags_WidthFixed, 64);
+				ImGui::TableSetupColumn("Condition");
 				ImGui::TableSetupColumn("Symbol");
 				ImGui::TableHeadersRow();
 
@@ -1827,6 +1909,27 @@ static void draw_breakpoints()
 						ImGui::Text("%s %02X", address < 0xc000 ? "RAM" : "ROM", bank);
 					}
 
+					ImGui::TableNextColumn();
+					const uint32_t hit_target = debugger_get_breakpoint_hit_target(address, bank);
+					if (hit_target > 0) {
+						ImGui::Text("%u/%u", debugger_get_breakpoint_hits(address, bank), hit_target);
+					} else {
+						ImGui::Text("%u", debugger_get_breakpoint_hits(address, bank));
+					}
+
+					ImGui::TableNextColumn();
+					const char *condition = debugger_get_breakpoint_condition(address, bank);
+					const char *message   = debugger_get_breakpoint_message(address, bank);
+					char        summary[256];
+					if (message[0] != '\0') {
+						snprintf(summary, sizeof(summary), "%s%slog \"%s\"", condition, condition[0] != '\0' ? ": " : "", message);
+					} else {
+						snprintf(summary, sizeof(summary), "%s", condition[0] != '\0' ? condition : "--");
+					}
+					if (ImGui::Selectable(summary)) {
+						edit_breakpoint(address, bank);
+					}
+
 					ImGui::TableNextColumn();
 					for (auto &sym : symbols_find(address)) {
 						if (ImGui::Selectable(sym.c_str(), false, ImGuiSelectableFlags_AllowDoubleClick)) {
@@ -1846,6 +1949,8 @@ static void draw_breakpoints()
 				ImGui::EndTable();
 			}
 
+			draw_breakpoint_editor();
+
 			static uint16_t new_address = 0;
 			static uint8_t  new_bank    = 0;
 			ImGui::InputHexLabel("New Address", new_address);
@@ -1864,6 +1969,124 @@ static void draw_breakpoints()
 	ImGui::EndGroup();
 }
 
+static void draw_watchpoints()
+{
+	ImGui::BeginGroup();
+	{
+		ImGui::PushStyleVar(ImGuiStyleVar_IndentSpacing, 0.0f);
+		if (ImGui::TreeNodeEx("Watchpoints", ImGuiTreeNodeFlags_Framed | ImGuiTreeNodeFlags_DefaultOpen)) {
+			if (ImGui::BeginTable("watchpoints", 6)) {
+				ImGui::TableSetupColumn("", ImGuiTableColumnFlags_WidthFixed, 16);
+				ImGui::TableSetupColumn("Watch", ImGuiTableColumnFlags_WidthFixed, 80);
+				ImGui::TableSetupColumn("Address", ImGuiTableColumnFlags_WidthFixed, 80);
+				ImGui::TableSetupColumn("Bank", ImGuiTableColumnFlags_WidthFixed, 48);
+				ImGui::TableSetupColumn("Hits", ImGuiTableColumnFlags_WidthFixed, 64);
+				ImGui::TableSetupColumn("Condition");
+				ImGui::TableHeadersRow();
+
+				const auto &watchpoints = debugger_get_watchpoints();
+				for (size_t i = 0; i < watchpoints.size(); ++i) {
+					const watchpoint_type &watchpoint = watchpoints[i];
+					ImGui::PushID((int)i);
+
+					ImGui::TableNextRow();
+					ImGui::TableNextColumn();
+					if (ImGui::TileButton(ICON_REMOVE)) {
+						debugger_remove_watchpoint(i);
+						ImGui::PopID();
+						break;
+					}
+
+					ImGui::TableNextColumn();
+					if (watchpoint.size_type >= 0) {
+						ImGui::Text("%s change", Debugger_size_types[watchpoint.size_type]);
+					} else {
+						constexpr const char *kinds[] = { "", "Read", "Write", "Read/Write" };
+						ImGui::Text("%s", kinds[(watchpoint.flags & (DEBUG6502_READ | DEBUG6502_WRITE)) >> 1]);
+					}
+
+					ImGui::TableNextColumn();
+					char addr_text[10];
+					if (watchpoint.size_type >= 0) {
+						sprintf(addr_text, "%04X", watchpoint.first);
+					} else {
+						sprintf(addr_text, "%04X-%04X", watchpoint.first, watchpoint.last);
+					}
+					if (ImGui::Selectable(addr_text, false, ImGuiSelectableFlags_AllowDoubleClick)) {
+						Show_memory_dump_1 = true;
+						memory_dump_1.set_dump_start(watchpoint.first);
+					}
+
+					ImGui::TableNextColumn();
+					if (watchpoint.last < 0xa000) {
+						ImGui::Text("--");
+					} else {
+						ImGui::Text("%s %02X", watchpoint.last < 0xc000 ? "RAM" : "ROM", watchpoint.bank);
+					}
+
+					ImGui::TableNextColumn();
+					ImGui::Text("%u", watchpoint.hits);
+
+					ImGui::TableNextColumn();
+					ImGui::Text("%s", watchpoint.condition.empty() ? "--" : watchpoint.condition.text().c_str());
+
+					ImGui::PopID();
+				}
+
+				ImGui::EndTable();
+			}
+
+			static uint16_t    first     = 0;
+			static uint16_t    last      = 0;
+			static uint8_t     bank      = 0;
+			static bool        read      = false;
+			static bool        write     = true;
+			static uint8_t     size_type = 0;
+			static char        condition[256];
+			static std::string error;
+
+			ImGui::InputHexLabel("Address", first);
+			ImGui::SameLine();
+			ImGui::InputHexLabel("To", last);
+			ImGui::SameLine();
+			ImGui::InputHexLabel("Bank", bank);
+
+			ImGui::InputText("Condition", condition, sizeof(condition));
+			if (ImGui::IsItemHovered()) {
+				ImGui::SetTooltip("Only break when this is non-zero, e.g. value > 1000 && old <= 1000.\n\"value\" is the new value and \"old\" the previous one.");
+			}
+
+			ImGui::Checkbox("Read", &read);
+			ImGui::SameLine();
+			ImGui::Checkbox("Write", &write);
+			ImGui::SameLine();
+			if (ImGui::Button("Add Range")) {
+				const uint8_t flags = (read ? DEBUG6502_READ : 0) | (write ? DEBUG6502_WRITE : 0);
+				if (debugger_add_range_watchpoint(first, std::max(first, last), bank, flags, condition, error)) {
+					error.clear();
+				}
+			}
+
+			ImGui::InputCombo("Type", Debugger_size_types, size_type);
+			ImGui::SameLine();
+			if (ImGui::Button("Add Value Change")) {
+				if (debugger_add_value_watchpoint(first, bank, size_type, condition, error)) {
+					error.clear();
+				}
+			}
+
+			if (!error.empty()) {
+				ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", error.c_str());
+			}
+
+			ImGui::Dummy(ImVec2(0, 5));
+			ImGui::TreePop();
+		}
+		ImGui::PopStyleVar();
+	}
+	ImGui::EndGroup();
+}
+
 static void draw_watch_list()
 {
 	ImGui::BeginGroup();
@@ -1873,7 +2096,8 @@ static void draw_watch_list()
 			static bool show_hex = true;
 			ImGui::Checkbox("Show Hex Values", &show_hex);
 
-			if (ImGui::BeginTable("watch list", 6)) {
+			if (ImGui::BeginTable("watch list", 7)) {
+				ImGui::TableSetupColumn("", ImGuiTableColumnFlags_WidthFixed, 16);
 				ImGui::TableSetupColumn("", ImGuiTableColumnFlags_WidthFixed, 16);
 				ImGui::TableSetupColumn("Address", ImGuiTableColumnFlags_WidthFixed, 64);
 				ImGui::TableSetupColumn("Bank", ImGuiTableColumnFlags_WidthFixed, 48);
@@ -1896,6 +2120,15 @@ static void draw_watch_list()
 						break;
 					}
 
+					ImGui::TableNextColumn();
+					if (ImGui::TileButton(ICON_ADD_BREAKPOINT)) {
+						std::string error;
+						debugger_add_value_watchpoint(address, bank, size, nullptr, error);
+					}
+					if (ImGui::IsItemHovered()) {
+						ImGui::SetTooltip("Break when this value changes");
+					}
+
 					ImGui::TableNextColumn();
 					char addr_text[5];
 					sprintf(addr_text, "%04X", address);
@@ -2296,7 +2529,7 @@ static void draw_menu_bar()
 			if (ImGui::MenuItem("Open TXT file")) {
 				char *open_path = nullptr;
 				if (NFD_OpenDialog("txt", nullptr, &open_path) == NFD_OKAY && open_path != nullptr) {
-					keyboard_add_file(open_path);
+					replay_text_file(open_path);
 				}
 			}
 
@@ -2314,15 +2547,80 @@ static void draw_menu_bar()
 
 		if (ImGui::BeginMenu("Machine")) {
 			if (ImGui::MenuItem("Reset", Options.no_keybinds ? nullptr : "Ctrl-R")) {
-				machine_reset();
+				replay_reset();
 			}
 			if (ImGui::MenuItem("NMI")) {
-				nmi6502();
-				debugger_interrupt();
+				replay_nmi();
 			}
 			if (ImGui::MenuItem("Save Dump", Options.no_keybinds ? nullptr : "Ctrl-S")) {
 				machine_dump("user menu request");
 			}
+			if (ImGui::MenuItem("Save State")) {
+				char *save_path = nullptr;
+				if (NFD_SaveDialog("snp", nullptr, &save_path) == NFD_OKAY && save_path != nullptr) {
+					snapshot_save_file(save_path);
+				}
+			}
+			if (ImGui::MenuItem("Load State")) {
+				char *open_path = nullptr;
+				if (NFD_OpenDialog("snp", nullptr, &open_path) == NFD_OKAY && open_path != nullptr) {
+					snapshot_load_file(open_path);
+				}
+			}
+			if (ImGui::BeginMenu("Profiler")) {
+				if (ImGui::MenuItem("Profile CPU", nullptr, profiler_is_enabled())) {
+					if (profiler_is_enabled()) {
+						profiler_stop();
+					} else {
+						profiler_start();
+					}
+				}
+				if (ImGui::MenuItem("Clear Profile")) {
+					profiler_reset();
+				}
+				ImGui::Separator();
+				if (ImGui::MenuItem("Save Callgrind Profile")) {
+					char *save_path = nullptr;
+					if (NFD_SaveDialog("out;txt", nullptr, &save_path) == NFD_OKAY && save_path != nullptr) {
+						profiler_save_callgrind(save_path);
+					}
+				}
+				if (ImGui::MenuItem("Save Flame Graph Stacks")) {
+					char *save_path = nullptr;
+					if (NFD_SaveDialog("folded", nullptr, &save_path) == NFD_OKAY && save_path != nullptr) {
+						profiler_save_folded(save_path);
+					}
+				}
+				ImGui::EndMenu();
+			}
+			if (ImGui::BeginMenu("CPU Trace")) {
+				const uint32_t trace_size = (Options.trace_size > 0) ? Options.trace_size : TRACE_DEFAULT_SIZE;
+				if (ImGui::MenuItem("Trace CPU", nullptr, trace_is_enabled())) {
+					trace_set_size(trace_is_enabled() ? 0 : trace_size);
+				}
+				if (ImGui::IsItemHovered()) {
+					ImGui::SetTooltip("Keep the last %u instructions the CPU ran.", trace_is_enabled() ? trace_get_size() : trace_size);
+				}
+				if (ImGui::MenuItem("Clear Trace", nullptr, false, trace_is_enabled())) {
+					trace_clear();
+				}
+				ImGui::InputHexLabel("From", Options.trace_first);
+				ImGui::SameLine();
+				ImGui::InputHexLabel("To", Options.trace_last);
+				if (ImGui::MenuItem("Save Trace", nullptr, false, trace_is_enabled())) {
+					char *save_path = nullptr;
+					if (NFD_SaveDialog("txt", nullptr, &save_path) == NFD_OKAY && save_path != nullptr) {
+						trace_save(save_path, Options.trace_first, Options.trace_last);
+					}
+				}
+				if (ImGui::IsItemHovered()) {
+					ImGui::SetTooltip("Save the instructions from $%04X to $%04X.", Options.trace_first, Options.trace_last);
+				}
+				ImGui::EndMenu();
+			}
+			if (ImGui::MenuItem("Rewind 1 Second", Options.no_keybinds ? nullptr : "Ctrl-Backspace", false, rewind_get_frames() > 0)) {
+				rewind_step_back(60);
+			}
 			if (ImGui::BeginMenu("Controller Ports")) {
 				joystick_for_each_slot([](int slot, int instance_id, SDL_GameController *controller) {
 					const char *name = nullptr;
@@ -2380,11 +2678,18 @@ static void draw_menu_bar()
 				bool sdcard_attached = sdcard_is_attached();
 				if (ImGui::Checkbox("Attach card", &sdcard_attached)) {
 					if (sdcard_attached) {
-						sdcard_attach();
+						replay_sdcard_attach();
 					} else {
-						sdcard_detach();
+						replay_sdcard_detach();
 					}
 				}
+
+				if (ImGui::MenuItem("Merge changes into image", nullptr, false, sdcard_has_changes())) {
+					sdcard_merge_changes();
+				}
+				if (ImGui::IsItemHovered()) {
+					ImGui::SetTooltip("Writes to the SD card are kept in an overlay file next to the image.\nThis writes them into the image itself and deletes the overlay.");
+				}
 				ImGui::EndMenu();
 			}
 
@@ -2397,14 +2702,11 @@ static void draw_menu_bar()
 
 			ImGui::Separator();
 
-			ImGui::SetNextItemWidth(69.0f);
-			if (ImGui::InputInt("Set Warp Factor", &Options.warp_factor)) {
-				Options.warp_factor = std::clamp(Options.warp_factor, 0, 16);
-				if (Options.warp_factor == 0) {
-					vera_video_set_cheat_mask(0);
-				} else {
-					vera_video_set_cheat_mask((1 << (Options.warp_factor - 1)) - 1);
-				}
+			if (ImGui::MenuItem("Warp", Options.no_keybinds ? nullptr : "Ctrl-=", Options.warp_factor > 0)) {
+				machine_toggle_warp();
+			}
+			if (ImGui::IsItemHovered()) {
+				ImGui::SetTooltip("Run as fast as possible, only rendering the frames that are displayed.\n%u frames skipped so far.", vera_video_get_skipped_frames());
 			}
 			bool audio_enabled = !Options.no_sound;
 			if (ImGui::Checkbox("Enable Audio", &audio_enabled)) {
@@ -2560,6 +2862,7 @@ void overlay_draw()
 	if (Show_breakpoints) {
 		if (ImGui::Begin("Breakpoints", &Show_breakpoints)) {
 			draw_breakpoints();
+			draw_watchpoints();
 		}
 		ImGui::End();
 	}
@@ -0,0 +1,345 @@
+// Commander X16 Emulator
+// Copyright (c) 2023 Stephen Horn, et al.
+// All rights reserved. License: 2-clause BSD
+
+#include "profiler.h"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <stdio.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "glue.h"
+#include "symbols.h"
+
+// Addresses are keyed by bank << 16 | address, the bank being 0 below $A000 like everywhere else.
+// The root of the call tree stands for whatever runs without a frame on the smart stack.
+static constexpr uint32_t Root_function = 0x1000000;
+
+// The smart stack has room for this many frames, and deeper ones aren't tracked.
+static constexpr uint16_t Max_depth = 256;
+
+struct profile_entry {
+	uint64_t cycles;
+	uint32_t instructions;
+	uint32_t function; // The entry point this address was first run under
+};
+
+// One node per distinct chain of calls, so that a call's cost is the sum of its subtree.
+struct call_node {
+	uint32_t parent;
+	uint32_t call_site;
+	uint32_t function;
+	uint32_t calls;
+	uint64_t self_cycles;
+	uint64_t self_instructions;
+	uint64_t wait_cycles;
+};
+
+struct call_key {
+	uint32_t parent;
+	uint32_t call_site;
+	uint32_t function;
+
+	bool operator==(const call_key &other) const
+	{
+		return parent == other.parent && call_site == other.call_site && function == other.function;
+	}
+};
+
+struct call_key_hash {
+	size_t operator()(const call_key &key) const
+	{
+		return std::hash<uint64_t>()(((uint64_t)key.parent << 32) ^ ((uint64_t)key.call_site << 24) ^ key.function);
+	}
+};
+
+// Entries are allocated 256 addresses at a time, as they're first run.
+static std::unique_ptr<profile_entry[]> Pages[0x10000];
+
+static std::vector<call_node>                                Nodes;
+static std::unordered_map<call_key, uint32_t, call_key_hash> Children;
+
+static bool     Enabled = false;
+static uint16_t Depth   = 0;
+static uint32_t Frame_nodes[Max_depth + 1];
+
+static uint32_t profiler_key(uint8_t bank, uint16_t address)
+{
+	return address < 0xa000 ? address : ((uint32_t)bank << 16) | address;
+}
+
+static void profiler_clear()
+{
+	for (std::unique_ptr<profile_entry[]> &page : Pages) {
+		page.reset();
+	}
+	Nodes.clear();
+	Nodes.push_back({ 0, 0, Root_function, 0, 0, 0, 0 });
+	Children.clear();
+
+	Depth          = 0;
+	Frame_nodes[0] = 0;
+}
+
+static uint32_t profiler_child(uint32_t parent, uint32_t call_site, uint32_t function)
+{
+	const auto [child, inserted] = Children.try_emplace({ parent, call_site, function }, (uint32_t)Nodes.size());
+	if (inserted) {
+		Nodes.push_back({ parent, call_site, function, 0, 0, 0, 0 });
+	}
+	return child->second;
+}
+
+// Follows the smart stack to its new depth. Frames that were popped are simply left; their cost is
+// already in their nodes.
+static void profiler_sync_depth(uint16_t depth)
+{
+	depth = std::min(depth, Max_depth);
+	if (depth < Depth) {
+		Depth = depth;
+	}
+	while (Depth < depth) {
+		// JSR leaves the address after itself, and interrupts the address they interrupted.
+		const _smart_stack &frame     = stack6502[Depth];
+		const uint16_t      call_site = (frame.op_type == _stack_op_type::op) ? frame.source_pc - 3 : frame.source_pc;
+		const uint32_t      node      = profiler_child(Frame_nodes[Depth], profiler_key(frame.source_bank, call_site), profiler_key(frame.dest_bank, frame.dest_pc));
+		++Nodes[node].calls;
+		Frame_nodes[++Depth] = node;
+	}
+}
+
+void profiler_start()
+{
+	if (Nodes.empty()) {
+		profiler_clear();
+	}
+	Enabled = true;
+}
+
+void profiler_stop()
+{
+	Enabled = false;
+}
+
+void profiler_reset()
+{
+	profiler_clear();
+}
+
+bool profiler_is_enabled()
+{
+	return Enabled;
+}
+
+void profiler_instruction(uint16_t pc, uint8_t bank, uint16_t depth, uint32_t cycles)
+{
+	if (depth != Depth) {
+		profiler_sync_depth(depth);
+	}
+
+	call_node &node = Nodes[Frame_nodes[Depth]];
+	node.self_cycles += cycles;
+	++node.self_instructions;
+
+	const uint32_t                    key  = profiler_key(bank, pc);
+	std::unique_ptr<profile_entry[]> &page = Pages[key >> 8];
+	if (!page) {
+		page = std::make_unique<profile_entry[]>(256);
+	}
+	profile_entry &entry = page[key & 0xff];
+	if (entry.instructions++ == 0) {
+		entry.function = node.function;
+	}
+	entry.cycles += cycles;
+
+	// Calls and returns are picked up here, interrupts at the start of the next instruction.
+	if (state6502.sp_depth != Depth) {
+		profiler_sync_depth(state6502.sp_depth);
+	}
+}
+
+void profiler_wait(uint32_t cycles)
+{
+	Nodes[Frame_nodes[Depth]].wait_cycles += cycles;
+}
+
+//
+// Exporting
+//
+
+static std::string profiler_name(uint32_t function)
+{
+	if (function == Root_function) {
+		return "(root)";
+	}
+
+	const uint16_t          address = function & 0xffff;
+	const uint8_t           bank    = function >> 16;
+	const symbol_list_type &symbols = symbols_find(address, bank);
+	if (!symbols.empty()) {
+		return symbols.front();
+	}
+
+	char name[16];
+	if (address >= 0xa000) {
+		snprintf(name, sizeof(name), "$%02X:$%04X", bank, address);
+	} else {
+		snprintf(name, sizeof(name), "$%04X", address);
+	}
+	return name;
+}
+
+// The cost of each node including everything it called.
+static void profiler_get_inclusive(std::vector<uint64_t> &cycles, std::vector<uint64_t> &instructions)
+{
+	cycles.resize(Nodes.size());
+	instructions.resize(Nodes.size());
+	for (size_t i = 0; i < Nodes.size(); ++i) {
+		cycles[i]       = Nodes[i].self_cycles + Nodes[i].wait_cycles;
+		instructions[i] = Nodes[i].self_instructions;
+	}
+
+	// Children are always created after their parents.
+	for (size_t i = Nodes.size() - 1; i > 0; --i) {
+		cycles[Nodes[i].parent] += cycles[i];
+		instructions[Nodes[i].parent] += instructions[i];
+	}
+}
+
+bool profiler_save_callgrind(const char *path)
+{
+	if (Nodes.empty()) {
+		profiler_clear();
+	}
+
+	FILE *f = fopen(path, "w");
+	if (f == nullptr) {
+		printf("Could not open %s to save the profile.\n", path);
+		return false;
+	}
+
+	struct call_edge {
+		uint32_t calls;
+		uint64_t cycles;
+		uint64_t instructions;
+	};
+
+	struct function_costs {
+		std::vector<std::pair<uint32_t, const profile_entry *>> lines;
+		std::map<std::pair<uint32_t, uint32_t>, call_edge>      calls; // By call site and callee
+		uint64_t                                                wait_cycles = 0;
+	};
+
+	std::map<uint32_t, function_costs> functions;
+	for (uint32_t p = 0; p < 0x10000; ++p) {
+		if (!Pages[p]) {
+			continue;
+		}
+		for (uint32_t i = 0; i < 256; ++i) {
+			const profile_entry &entry = Pages[p][i];
+			if (entry.instructions > 0) {
+				functions[entry.function].lines.emplace_back((p << 8) | i, &entry);
+			}
+		}
+	}
+
+	std::vector<uint64_t> inclusive_cycles;
+	std::vector<uint64_t> inclusive_instructions;
+	profiler_get_inclusive(inclusive_cycles, inclusive_instructions);
+
+	uint64_t total_wait = 0;
+	for (size_t i = 0; i < Nodes.size(); ++i) {
+		const call_node &node = Nodes[i];
+		functions[node.function].wait_cycles += node.wait_cycles;
+		total_wait += node.wait_cycles;
+		if (i > 0) {
+			call_edge &edge = functions[Nodes[node.parent].function].calls[{ node.call_site, node.function }];
+			edge.calls += node.calls;
+			edge.cycles += inclusive_cycles[i];
+			edge.instructions += inclusive_instructions[i];
+		}
+	}
+
+	fprintf(f, "# callgrind format\n");
+	fprintf(f, "version: 1\n");
+	fprintf(f, "creator: Box16\n");
+	fprintf(f, "positions: instr\n");
+	fprintf(f, "events: Cycles Instructions\n");
+	fprintf(f, "# Positions are bank << 16 | address. Waiting for interrupts (WAI) is counted at position 0.\n");
+	fprintf(f, "summary: %llu %llu\n", (unsigned long long)inclusive_cycles[0], (unsigned long long)inclusive_instructions[0]);
+
+	// Names are written in full the first time, and by number after that.
+	std::unordered_map<uint32_t, uint32_t> ids;
+	auto name = [&ids](uint32_t function) {
+		const auto [id, inserted] = ids.try_emplace(function, (uint32_t)ids.size() + 1);
+		const std::string number  = "(" + std::to_string(id->second) + ")";
+		return inserted ? number + " " + profiler_name(function) : number;
+	};
+
+	for (const auto &[function, costs] : functions) {
+		fprintf(f, "\nfn=%s\n", name(function).c_str());
+		if (costs.wait_cycles > 0) {
+			fprintf(f, "0 %llu 0\n", (unsigned long long)costs.wait_cycles);
+		}
+		for (const auto &[address, entry] : costs.lines) {
+			fprintf(f, "0x%06x %llu %u\n", address, (unsigned long long)entry->cycles, entry->instructions);
+		}
+		for (const auto &[call, edge] : costs.calls) {
+			const auto [call_site, callee] = call;
+			fprintf(f, "cfn=%s\n", name(callee).c_str());
+			fprintf(f, "calls=%u 0x%06x\n", edge.calls, callee);
+			fprintf(f, "0x%06x %llu %llu\n", call_site, (unsigned long long)edge.cycles, (unsigned long long)edge.instructions);
+		}
+	}
+
+	fclose(f);
+	printf("Saved profile of %llu cycles (%llu waiting for interrupts) to %s.\n", (unsigned long long)inclusive_cycles[0], (unsigned long long)total_wait, path);
+	return true;
+}
+
+bool profiler_save_folded(const char *path)
+{
+	if (Nodes.empty()) {
+		profiler_clear();
+	}
+
+	FILE *f = fopen(path, "w");
+	if (f == nullptr) {
+		printf("Could not open %s to save the profile.\n", path);
+		return false;
+	}
+
+	// Each node's stack is its parent's, plus its own function.
+	std::vector<std::string> stacks(Nodes.size());
+	for (size_t i = 0; i < Nodes.size(); ++i) {
+		std::string name = profiler_name(Nodes[i].function);
+		std::replace(name.begin(), name.end(), ';', ':');
+		std::replace(name.begin(), name.end(), ' ', '_');
+		stacks[i] = (i > 0) ? stacks[Nodes[i].parent] + ";" + name : name;
+
+		if (Nodes[i].self_cycles > 0) {
+			fprintf(f, "%s %llu\n", stacks[i].c_str(), (unsigned long long)Nodes[i].self_cycles);
+		}
+		if (Nodes[i].wait_cycles > 0) {
+			fprintf(f, "%s;(waiting) %llu\n", stacks[i].c_str(), (unsigned long long)Nodes[i].wait_cycles);
+		}
+	}
+
+	fclose(f);
+	printf("Saved profile as folded stacks to %s.\n", path);
+	return true;
+}
+
+bool profiler_save(const char *path)
+{
+	const std::string name = path;
+	const std::string ext  = ".folded";
+	if (name.size() >= ext.size() && name.compare(name.size() - ext.size(), ext.size(), ext) == 0) {
+		return profiler_save_folded(path);
+	}
+	return profiler_save_callgrind(path);
+}
@@ -0,0 +1,29 @@
+// Commander X16 Emulator
+// Copyright (c) 2023 Stephen Horn, et al.
+// All rights reserved. License: 2-clause BSD
+
+#pragma once
+
+#include <stdint.h>
+
+// Counts the cycles spent at each (bank, address), and under each chain of calls and interrupts
+// that led there, as the smart stack sees them. Exported as a callgrind profile (for tools like
+// KCachegrind) or as folded stacks (for flame graphs).
+
+void profiler_start();
+void profiler_stop();
+void profiler_reset();
+bool profiler_is_enabled();
+
+// Called by the CPU for every instruction while profiling, with the bank, PC and smart stack depth
+// from before the instruction, and the cycles it took.
+void profiler_instruction(uint16_t pc, uint8_t bank, uint16_t depth, uint32_t cycles);
+
+// Cycles the CPU spent waiting for an interrupt (WAI).
+void profiler_wait(uint32_t cycles);
+
+bool profiler_save_callgrind(const char *path);
+bool profiler_save_folded(const char *path);
+
+// Picks the format from the file name: folded stacks for ".folded", callgrind for anything else.
+bool profiler_save(const char *path);
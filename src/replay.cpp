@@ -0,0 +1,552 @@
+// Commander X16 Emulator
+// Copyright (c) 2023 Stephen Horn, et al.
+// All rights reserved. License: 2-clause BSD
+
+#include "replay.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <string>
+
+#include "audio.h"
+#include "cpu/fake6502.h"
+#include "debugger.h"
+#include "glue.h"
+#include "keyboard.h"
+#include "midi.h"
+#include "snapshot.h"
+#include "vera/sdcard.h"
+#include "zlib.h"
+
+// A recording is the machine's snapshot from when it started, followed by one event per input, in
+// the order they reached the machine. Files are gzip compressed:
+//     magic (8 bytes), version (4 bytes), audio sample rate (4 bytes), snapshot size (4 bytes), snapshot
+//     then per event: clock (8 bytes), type (1 byte), size (4 bytes), data (size bytes)
+//
+// Playing back applies each event at the first point between instructions that reaches its clock,
+// and batched execution stops at that clock, so it lands on the same instruction as it did when
+// recording. Events that are due are applied in order, whatever their clock, since replacing the
+// machine state can take the clock backwards.
+
+enum class replay_event_type : uint8_t {
+	key,
+	text,
+	mouse_button,
+	mouse_move,
+	mouse_state,
+	joystick,
+	midi,
+	reset,
+	nmi,
+	sdcard,
+	state,
+	end,
+};
+
+struct replay_event {
+	uint64_t             clock;
+	replay_event_type    type;
+	std::vector<uint8_t> data;
+};
+
+static const char     Replay_magic[8] = { 'B', 'O', 'X', '1', '6', 'R', 'P', 'L' };
+static const uint32_t Replay_version  = 1;
+
+// Nothing has been recorded for a slot yet, so that the first latch records every slot.
+static constexpr int Unrecorded_buttons = -2;
+
+static gzFile Record_file = Z_NULL;
+static int    Recorded_buttons[NUM_JOYSTICKS];
+
+static std::vector<replay_event> Events;
+static size_t                    Next_event = 0;
+static bool                      Playing    = false;
+static int                       Played_buttons[NUM_JOYSTICKS];
+
+//
+// Recording
+//
+
+static void record_event(replay_event_type type, const void *data, size_t size)
+{
+	if (Record_file == Z_NULL) {
+		return;
+	}
+
+	std::vector<uint8_t> header;
+	snapshot_writer      w(header);
+	w.write(clockticks6502);
+	w.write(type);
+	w.write((uint32_t)size);
+
+	// Flushed as it goes, so that a recording of a run that crashed still ends with what led up to it.
+	bool ok = gzwrite(Record_file, header.data(), (unsigned)header.size()) == (int)header.size();
+	if (ok && size > 0) {
+		ok = gzwrite(Record_file, data, (unsigned)size) == (int)size;
+	}
+	ok = ok && gzflush(Record_file, Z_SYNC_FLUSH) == Z_OK;
+
+	if (!ok) {
+		printf("Cannot write to the recording, stopping it.\n");
+		gzclose(Record_file);
+		Record_file = Z_NULL;
+	}
+}
+
+template <typename... T>
+static void record(replay_event_type type, const T &...values)
+{
+	if (Record_file == Z_NULL) {
+		return;
+	}
+
+	std::vector<uint8_t> data;
+	snapshot_writer      w(data);
+	(w.write(values), ...);
+	record_event(type, data.data(), data.size());
+}
+
+bool replay_record(const char *path)
+{
+	replay_stop();
+
+	gzFile f = gzopen(path, "wb6");
+	if (f == Z_NULL) {
+		printf("Cannot write to %s!\n", path);
+		return false;
+	}
+
+	std::vector<uint8_t> snapshot;
+	snapshot_capture(snapshot);
+
+	std::vector<uint8_t> header;
+	snapshot_writer      w(header);
+	w.write(Replay_magic);
+	w.write(Replay_version);
+	w.write(audio_get_sample_rate());
+	w.write((uint32_t)snapshot.size());
+
+	bool ok = gzwrite(f, header.data(), (unsigned)header.size()) == (int)header.size();
+	ok      = ok && gzwrite(f, snapshot.data(), (unsigned)snapshot.size()) == (int)snapshot.size();
+	ok      = ok && gzflush(f, Z_SYNC_FLUSH) == Z_OK;
+	if (!ok) {
+		printf("Cannot write to %s!\n", path);
+		gzclose(f);
+		return false;
+	}
+
+	Record_file = f;
+	std::fill(std::begin(Recorded_buttons), std::end(Recorded_buttons), Unrecorded_buttons);
+	printf("Recording input to %s.\n", path);
+	return true;
+}
+
+//
+// Playback
+//
+
+static void stop_playing(const char *reason)
+{
+	if (!Playing) {
+		return;
+	}
+	printf("%s\n", reason);
+	Playing = false;
+	Events.clear();
+	Events.shrink_to_fit();
+	Next_event = 0;
+}
+
+static bool apply_event(const replay_event &event)
+{
+	snapshot_reader r(event.data.data(), event.data.size(), 0);
+
+	switch (event.type) {
+		case replay_event_type::key: {
+			bool     down     = false;
+			uint16_t scancode = 0;
+			r.read(down);
+			r.read(scancode);
+			if (r.ok() && scancode < SDL_NUM_SCANCODES) {
+				keyboard_add_event(down, (SDL_Scancode)scancode);
+			}
+		} break;
+		case replay_event_type::text: {
+			const std::string text(event.data.begin(), event.data.end());
+			keyboard_add_text(text.c_str());
+		} break;
+		case replay_event_type::mouse_button: {
+			int  num  = 0;
+			bool down = false;
+			r.read(num);
+			r.read(down);
+			if (r.ok()) {
+				if (down) {
+					mouse_button_down(num);
+				} else {
+					mouse_button_up(num);
+				}
+			}
+		} break;
+		case replay_event_type::mouse_move: {
+			int x = 0;
+			int y = 0;
+			r.read(x);
+			r.read(y);
+			if (r.ok()) {
+				mouse_move(x, y);
+			}
+		} break;
+		case replay_event_type::mouse_state:
+			mouse_send_state();
+			break;
+		case replay_event_type::joystick: {
+			uint8_t slot    = 0;
+			int     buttons = 0;
+			r.read(slot);
+			r.read(buttons);
+			if (r.ok() && slot < NUM_JOYSTICKS) {
+				Played_buttons[slot] = buttons;
+			}
+		} break;
+		case replay_event_type::midi: {
+			uint32_t port = 0;
+			r.read(port);
+			if (r.ok()) {
+				midi_process_message(port, std::vector<unsigned char>(r.position(), r.position() + r.remaining()));
+			}
+		} break;
+		case replay_event_type::reset:
+			machine_reset();
+			break;
+		case replay_event_type::nmi:
+			nmi6502();
+			debugger_interrupt();
+			break;
+		case replay_event_type::sdcard: {
+			bool attach = false;
+			r.read(attach);
+			if (r.ok()) {
+				if (attach) {
+					sdcard_attach();
+				} else {
+					sdcard_detach();
+				}
+			}
+		} break;
+		case replay_event_type::state:
+			if (!snapshot_restore(event.data)) {
+				return false;
+			}
+			break;
+		default:
+			// Including the end, which only marks how far the recording went.
+			break;
+	}
+	return r.ok();
+}
+
+bool replay_play(const char *path)
+{
+	replay_stop();
+
+	gzFile f = gzopen(path, "rb");
+	if (f == Z_NULL) {
+		printf("Cannot open recording %s!\n", path);
+		return false;
+	}
+
+	std::vector<uint8_t> buffer;
+	uint8_t              chunk[64 * 1024];
+	int                  length;
+	while ((length = gzread(f, chunk, sizeof(chunk))) > 0) {
+		buffer.insert(buffer.end(), chunk, chunk + length);
+	}
+	gzclose(f);
+
+	snapshot_reader r(buffer.data(), buffer.size(), 0);
+
+	char     magic[sizeof(Replay_magic)];
+	uint32_t version       = 0;
+	int      sample_rate   = 0;
+	uint32_t snapshot_size = 0;
+	r.read(magic);
+	r.read(version);
+	r.read(sample_rate);
+	r.read(snapshot_size);
+	if (!r.ok() || memcmp(magic, Replay_magic, sizeof(magic)) != 0) {
+		printf("%s is not a recording.\n", path);
+		return false;
+	}
+	if (version != Replay_version) {
+		printf("Recording format version %u is not supported.\n", version);
+		return false;
+	}
+	if (snapshot_size > r.remaining()) {
+		printf("Recording %s is truncated.\n", path);
+		return false;
+	}
+
+	const std::vector<uint8_t> snapshot(r.position(), r.position() + snapshot_size);
+	r.skip(snapshot_size);
+
+	std::vector<replay_event> events;
+	while (r.remaining() > 0) {
+		replay_event event;
+		uint32_t     size = 0;
+		r.read(event.clock);
+		r.read(event.type);
+		r.read(size);
+		if (!r.ok() || size > r.remaining()) {
+			// Most likely the emulator didn't get to close the file, everything before this is still good.
+			printf("Recording %s stops partway through an event, playing back the %zu events before it.\n", path, events.size());
+			break;
+		}
+		event.data.assign(r.position(), r.position() + size);
+		r.skip(size);
+		events.push_back(std::move(event));
+	}
+
+	if (!snapshot_restore(snapshot)) {
+		printf("Cannot restore the machine from recording %s.\n", path);
+		return false;
+	}
+
+	// The PCM FIFO drains at the audio device's sample rate, so a different one changes the timing
+	// of anything waiting on it.
+	if (sample_rate != audio_get_sample_rate()) {
+		printf("Warning: %s was recorded with audio at %d Hz, it is %d Hz now. Playback may not match the recording.\n", path, sample_rate, audio_get_sample_rate());
+	}
+
+	Events     = std::move(events);
+	Next_event = 0;
+	Playing    = true;
+	std::fill(std::begin(Played_buttons), std::end(Played_buttons), -1);
+	printf("Playing back %s (%zu events), host input is ignored until it ends.\n", path, Events.size());
+	return true;
+}
+
+void replay_stop()
+{
+	if (Record_file != Z_NULL) {
+		record(replay_event_type::end);
+		if (Record_file != Z_NULL) {
+			gzclose(Record_file);
+			Record_file = Z_NULL;
+		}
+		printf("Stopped recording input.\n");
+	}
+	stop_playing("Stopped playing back input.");
+}
+
+bool replay_is_recording()
+{
+	return Record_file != Z_NULL;
+}
+
+bool replay_is_playing()
+{
+	return Playing;
+}
+
+void replay_process()
+{
+	if (!Playing) {
+		return;
+	}
+
+	while (Next_event < Events.size() && Events[Next_event].clock <= clockticks6502) {
+		if (!apply_event(Events[Next_event++])) {
+			stop_playing("Recording is damaged, stopped playing it back.");
+			return;
+		}
+	}
+
+	if (Next_event == Events.size()) {
+		stop_playing("Finished playing back input.");
+	}
+}
+
+uint32_t replay_clocks_until_event()
+{
+	if (!Playing || Next_event >= Events.size()) {
+		return UINT32_MAX;
+	}
+
+	const uint64_t clock = Events[Next_event].clock;
+	return (uint32_t)std::clamp<uint64_t>(clock > clockticks6502 ? clock - clockticks6502 : 1, 1, UINT32_MAX);
+}
+
+//
+// Host input
+//
+
+void replay_key_event(bool down, SDL_Scancode scancode)
+{
+	if (Playing) {
+		return;
+	}
+	record(replay_event_type::key, down, (uint16_t)scancode);
+	keyboard_add_event(down, scancode);
+}
+
+void replay_text(const char *text)
+{
+	if (Playing) {
+		return;
+	}
+	record_event(replay_event_type::text, text, strlen(text));
+	keyboard_add_text(text);
+}
+
+void replay_text_file(const char *path)
+{
+	if (Playing) {
+		return;
+	}
+	if (Record_file == Z_NULL) {
+		keyboard_add_file(path);
+		return;
+	}
+
+	// The recording keeps the text itself, since the file might not be there when it's played back.
+	gzFile f = gzopen(path, "r");
+	if (f == Z_NULL) {
+		printf("Cannot open text file %s!\n", path);
+		return;
+	}
+
+	std::string text;
+	char        chunk[4096];
+	int         length;
+	while ((length = gzread(f, chunk, sizeof(chunk))) > 0) {
+		text.append(chunk, length);
+	}
+	gzclose(f);
+
+	replay_text(text.c_str());
+}
+
+void replay_mouse_button(int num, bool down)
+{
+	if (Playing) {
+		return;
+	}
+	record(replay_event_type::mouse_button, num, down);
+	if (down) {
+		mouse_button_down(num);
+	} else {
+		mouse_button_up(num);
+	}
+}
+
+void replay_mouse_move(int x, int y)
+{
+	if (Playing) {
+		return;
+	}
+	record(replay_event_type::mouse_move, x, y);
+	mouse_move(x, y);
+}
+
+void replay_mouse_send_state()
+{
+	if (Playing) {
+		return;
+	}
+	record(replay_event_type::mouse_state);
+	mouse_send_state();
+}
+
+void replay_reset()
+{
+	if (Playing) {
+		return;
+	}
+	record(replay_event_type::reset);
+	machine_reset();
+}
+
+void replay_nmi()
+{
+	if (Playing) {
+		return;
+	}
+	record(replay_event_type::nmi);
+	nmi6502();
+	debugger_interrupt();
+}
+
+void replay_sdcard_attach()
+{
+	if (Playing) {
+		return;
+	}
+	record(replay_event_type::sdcard, true);
+	sdcard_attach();
+}
+
+void replay_sdcard_detach()
+{
+	if (Playing) {
+		return;
+	}
+	record(replay_event_type::sdcard, false);
+	sdcard_detach();
+}
+
+void replay_midi_message(uint32_t port, const std::vector<unsigned char> &message)
+{
+	if (Playing) {
+		return;
+	}
+	if (Record_file != Z_NULL) {
+		std::vector<uint8_t> data;
+		snapshot_writer      w(data);
+		w.write(port);
+		w.write_bytes(message.data(), message.size());
+		record_event(replay_event_type::midi, data.data(), data.size());
+	}
+	midi_process_message(port, message);
+}
+
+void replay_joystick_latch(int (&buttons)[NUM_JOYSTICKS])
+{
+	if (Playing) {
+		// Latching happens partway through an instruction, after everything else due at its clock
+		// has already been applied, so only joystick events can be waiting here.
+		while (Next_event < Events.size() && Events[Next_event].type == replay_event_type::joystick && Events[Next_event].clock <= clockticks6502) {
+			apply_event(Events[Next_event++]);
+		}
+		std::copy(std::begin(Played_buttons), std::end(Played_buttons), buttons);
+		return;
+	}
+
+	for (int i = 0; i < NUM_JOYSTICKS; ++i) {
+		if (buttons[i] != Recorded_buttons[i]) {
+			record(replay_event_type::joystick, (uint8_t)i, buttons[i]);
+			Recorded_buttons[i] = buttons[i];
+		}
+	}
+}
+
+void replay_state_replaced(uint64_t clock)
+{
+	if (Playing) {
+		// Whatever the machine does now isn't what was recorded.
+		stop_playing("The machine state was replaced, stopped playing back input.");
+		return;
+	}
+	if (Record_file == Z_NULL) {
+		return;
+	}
+
+	std::vector<uint8_t> snapshot;
+	snapshot_capture(snapshot);
+
+	// Stamped with the clock from before, since that's when it happened.
+	const uint64_t new_clock = clockticks6502;
+	clockticks6502           = clock;
+	record_event(replay_event_type::state, snapshot.data(), snapshot.size());
+	clockticks6502 = new_clock;
+}
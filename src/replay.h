@@ -0,0 +1,50 @@
+// Commander X16 Emulator
+// Copyright (c) 2023 Stephen Horn, et al.
+// All rights reserved. License: 2-clause BSD
+
+#pragma once
+
+#include <SDL_scancode.h>
+#include <stdint.h>
+#include <vector>
+
+#include "joystick.h"
+
+// Records everything from the host that reaches the machine, stamped with the CPU clock, so that
+// playing it back from the same starting point repeats the run exactly (and as fast as it can go).
+
+bool replay_record(const char *path);
+bool replay_play(const char *path);
+void replay_stop();
+
+bool replay_is_recording();
+bool replay_is_playing();
+
+// Applies the recorded input that's due. Called between instructions, wherever host input can reach
+// the machine while recording.
+void replay_process();
+
+// Batched execution has to stop at the next recorded input.
+uint32_t replay_clocks_until_event();
+
+// Host input on its way to the machine: logged when recording, then applied. While a recording is
+// played back, these are ignored and the recorded input is applied instead.
+void replay_key_event(bool down, SDL_Scancode scancode);
+void replay_text(const char *text);
+void replay_text_file(const char *path);
+void replay_mouse_button(int num, bool down);
+void replay_mouse_move(int x, int y);
+void replay_mouse_send_state();
+void replay_reset();
+void replay_nmi();
+void replay_sdcard_attach();
+void replay_sdcard_detach();
+void replay_midi_message(uint32_t port, const std::vector<unsigned char> &message);
+
+// The joystick buttons are sampled by the machine rather than sent to it, so they're recorded (or
+// replaced with the recorded ones) at the moment they're latched. Empty slots are -1.
+void replay_joystick_latch(int (&buttons)[NUM_JOYSTICKS]);
+
+// For when the host replaces the machine state (loading a state, rewinding) at the given clock,
+// which comes from before the state was replaced.
+void replay_state_replaced(uint64_t clock);
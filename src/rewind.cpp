@@ -0,0 +1,108 @@
+// Commander X16 Emulator
+// Copyright (c) 2023 Stephen Horn, et al.
+// All rights reserved. License: 2-clause BSD
+
+#include "rewind.h"
+
+#include <deque>
+#include <stdio.h>
+#include <vector>
+
+#include "cpu/fake6502.h"
+#include "options.h"
+#include "replay.h"
+#include "snapshot.h"
+
+// The rewind buffer keeps the machine as it was at the end of the last frame in an image, and a
+// delta for each frame before that. Going back a frame undoes the newest delta on the image.
+//
+// Deltas mostly look at the memory that was written to during the frame, but each one also
+// compares another 1/Sweep_frames of everything, to pick up anything that was changed without
+// being flagged (like RAM written to by a hypercall) without a spike of comparing it all at once.
+
+static constexpr unsigned Sweep_frames = 60;
+
+static snapshot_image                   Image;
+static std::deque<std::vector<uint8_t>> Deltas;
+static size_t                           Delta_bytes   = 0;
+static std::vector<uint8_t>             New_delta;
+static unsigned                         Sweep         = 0;
+static bool                             Warned_budget = false;
+
+void rewind_capture()
+{
+	const size_t budget = (size_t)Options.rewind_mb * 1024 * 1024;
+	if (budget == 0) {
+		if (!Image.sections.empty()) {
+			rewind_clear();
+		}
+		return;
+	}
+
+	if (Image.sections.empty()) {
+		// The first delta is the whole machine compared to nothing, which isn't worth going back to.
+		snapshot_capture_delta(Image, New_delta, 0, 1);
+	} else {
+		snapshot_capture_delta(Image, New_delta, Sweep, Sweep_frames);
+		Sweep = (Sweep + 1) % Sweep_frames;
+
+		Deltas.emplace_back(New_delta.begin(), New_delta.end());
+		Delta_bytes += New_delta.size();
+	}
+
+	size_t image_bytes = 0;
+	for (const std::vector<uint8_t> &section : Image.sections) {
+		image_bytes += section.size();
+	}
+
+	if (image_bytes >= budget && !Warned_budget) {
+		printf("Rewind buffer of %d MB is too small to hold the machine state (%zu KB).\n", Options.rewind_mb, image_bytes / 1024);
+		Warned_budget = true;
+	}
+
+	while (!Deltas.empty() && image_bytes + Delta_bytes > budget) {
+		Delta_bytes -= Deltas.front().size();
+		Deltas.pop_front();
+	}
+}
+
+bool rewind_step_back(int frames)
+{
+	if (Deltas.empty()) {
+		return false;
+	}
+
+	const uint64_t clock = clockticks6502;
+	for (int i = 0; i < frames && !Deltas.empty(); ++i) {
+		if (!snapshot_revert_delta(Image, Deltas.back())) {
+			printf("Rewind buffer is damaged, clearing it.\n");
+			rewind_clear();
+			return false;
+		}
+		Delta_bytes -= Deltas.back().size();
+		Deltas.pop_back();
+	}
+
+	if (!snapshot_restore_image(Image)) {
+		printf("Cannot rewind the machine, clearing the rewind buffer.\n");
+		rewind_clear();
+		return false;
+	}
+	replay_state_replaced(clock);
+	return true;
+}
+
+void rewind_clear()
+{
+	Image.sections.clear();
+	Image.sections.shrink_to_fit();
+	Deltas.clear();
+	Delta_bytes   = 0;
+	Sweep         = 0;
+	Warned_budget = false;
+}
+
+size_t rewind_get_frames()
+{
+	return Deltas.size();
+}
@@ -0,0 +1,16 @@
+// Commander X16 Emulator
+// Copyright (c) 2023 Stephen Horn, et al.
+// All rights reserved. License: 2-clause BSD
+
+#pragma once
+
+#include <stddef.h>
+
+// Captures the machine at the end of a frame, if rewinding is enabled.
+void rewind_capture();
+
+// Takes the machine back the given number of frames, or as far as the buffer goes.
+bool rewind_step_back(int frames);
+
+void   rewind_clear();
+size_t rewind_get_frames();
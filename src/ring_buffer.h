@@ -270,3 +270,63 @@ private:
 	std::atomic<size_t> m_count;
 	T      m_elems[SIZE];
 };
+
+// Lock-free ring for exactly one producer thread and one consumer thread.
+// The producer fills the slot returned by begin_write() and publishes it with end_write().
+// The consumer reads get_oldest() and releases it with free_oldest().
+// Neither side ever waits on the other: a full ring refuses writes, and an empty ring has no oldest.
+template <typename T, int SIZE>
+class spsc_ring_buffer
+{
+public:
+	spsc_ring_buffer()
+	    : m_write(0), m_read(0)
+	{
+		// Nothing to do.
+	}
+
+	// Producer only
+	T *begin_write()
+	{
+		const size_t write = m_write.load(std::memory_order_relaxed);
+		if (write - m_read.load(std::memory_order_acquire) >= SIZE) {
+			return nullptr;
+		}
+		return &m_elems[write % SIZE];
+	}
+
+	// Producer only, after a successful begin_write()
+	void end_write()
+	{
+		m_write.store(m_write.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	// Consumer only
+	const T *get_oldest() const
+	{
+		const size_t read = m_read.load(std::memory_order_relaxed);
+		if (read == m_write.load(std::memory_order_acquire)) {
+			return nullptr;
+		}
+		return &m_elems[read % SIZE];
+	}
+
+	// Consumer only, after a successful get_oldest()
+	void free_oldest()
+	{
+		m_read.store(m_read.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	// Exact from either side; the other side may have moved on by the time this returns.
+	const size_t count() const
+	{
+		const size_t read = m_read.load(std::memory_order_acquire);
+		return m_write.load(std::memory_order_acquire) - read;
+	}
+
+private:
+	// Kept on separate cache lines so the two threads don't invalidate each other's index.
+	alignas(64) std::atomic<size_t> m_write;
+	alignas(64) std::atomic<size_t> m_read;
+	T m_elems[SIZE];
+};
@@ -10,8 +10,10 @@
 
 #include "rtc.h"
 #include "glue.h"
+#include "snapshot.h"
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 #include <time.h>
 
 bool    nvram_dirty = false;
@@ -62,6 +64,54 @@ void rtc_init(bool set_system_time)
 	}
 }
 
+void rtc_save_state(snapshot_writer &w)
+{
+	w.write(running);
+	w.write(vbaten);
+	w.write(h24);
+	w.write(clocks);
+	w.write(seconds);
+	w.write(minutes);
+	w.write(hours);
+	w.write(day_of_week);
+	w.write(day);
+	w.write(month);
+	w.write(year);
+	w.write(nvram);
+}
+
+bool rtc_check_state(snapshot_reader &r)
+{
+	return r.skip(sizeof(running) + sizeof(vbaten) + sizeof(h24) + sizeof(clocks) + sizeof(seconds) + sizeof(minutes) + sizeof(hours) + sizeof(day_of_week) + sizeof(day) + sizeof(month) + sizeof(year) + sizeof(nvram));
+}
+
+bool rtc_load_state(snapshot_reader &r)
+{
+	uint8_t saved_nvram[sizeof(nvram)];
+
+	r.read(running);
+	r.read(vbaten);
+	r.read(h24);
+	r.read(clocks);
+	r.read(seconds);
+	r.read(minutes);
+	r.read(hours);
+	r.read(day_of_week);
+	r.read(day);
+	r.read(month);
+	r.read(year);
+	if (!r.read(saved_nvram)) {
+		return false;
+	}
+
+	// The NVRAM file is only written back on exit if something changed it.
+	if (memcmp(nvram, saved_nvram, sizeof(nvram)) != 0) {
+		memcpy(nvram, saved_nvram, sizeof(nvram));
+		nvram_dirty = true;
+	}
+	return true;
+}
+
 static uint8_t days_per_month[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
 
 bool is_leap_year()
@@ -7,6 +7,9 @@
 
 #include <stdint.h>
 
+class snapshot_reader;
+class snapshot_writer;
+
 extern bool    nvram_dirty;
 extern uint8_t nvram[0x40];
 
@@ -16,4 +19,8 @@ void    rtc_step(int c);
 uint8_t rtc_read(uint8_t offset);
 void    rtc_write(uint8_t offset, uint8_t value);
 
+void rtc_save_state(snapshot_writer &w);
+bool rtc_check_state(snapshot_reader &r);
+bool rtc_load_state(snapshot_reader &r);
+
 #endif
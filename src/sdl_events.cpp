@@ -7,12 +7,12 @@
 #include "glue.h"
 #include "imgui/imgui_impl_sdl.h"
 #include "joystick.h"
-#include "keyboard.h"
 #include "options.h"
 #include "overlay/overlay.h"
 #include "i2c.h"
+#include "replay.h"
+#include "rewind.h"
 #include "timing.h"
-#include "vera/sdcard.h"
 
 #ifdef __APPLE__
 #	define LSHORTCUT_KEY SDL_SCANCODE_LGUI
@@ -85,11 +85,11 @@ bool sdl_events_update()
 								consumed = true;
 								break;
 							case SDLK_r:
-								machine_reset();
+								replay_reset();
 								consumed = true;
 								break;
 							case SDLK_v:
-								keyboard_add_text(SDL_GetClipboardText());
+								replay_text(SDL_GetClipboardText());
 								consumed = true;
 								break;
 							case SDLK_f:
@@ -103,13 +103,19 @@ bool sdl_events_update()
 								consumed = true;
 								break;
 							case SDLK_a:
-								sdcard_attach();
+								replay_sdcard_attach();
 								consumed = true;
 								break;
 							case SDLK_d:
-								sdcard_detach();
+								replay_sdcard_detach();
 								consumed = true;
 								break;
+							case SDLK_BACKSPACE:
+								if (Options.rewind_mb > 0) {
+									rewind_step_back(60);
+									consumed = true;
+								}
+								break;
 						}
 					}
 					if (cmd_down && alt_down) {
@@ -144,7 +150,7 @@ bool sdl_events_update()
 					}
 				}
 				if (!consumed) {
-					keyboard_add_event(true, event.key.keysym.scancode);
+					replay_key_event(true, event.key.keysym.scancode);
 				}
 				break;
 			}
@@ -156,20 +162,20 @@ bool sdl_events_update()
 				if (event.key.keysym.scancode == SDL_SCANCODE_LALT || event.key.keysym.scancode == SDL_SCANCODE_RALT) {
 					alt_down = false;
 				}
-				keyboard_add_event(false, event.key.keysym.scancode);
+				replay_key_event(false, event.key.keysym.scancode);
 				break;
 
 			case SDL_MOUSEBUTTONDOWN:
 				mouse_state_change = true;
 				switch (event.button.button) {
 					case SDL_BUTTON_LEFT:
-						mouse_button_down(0);
+						replay_mouse_button(0, true);
 						break;
 					case SDL_BUTTON_RIGHT:
-						mouse_button_down(1);
+						replay_mouse_button(1, true);
 						break;
 					case SDL_BUTTON_MIDDLE:
-						mouse_button_down(2);
+						replay_mouse_button(2, true);
 						break;
 				}
 				break;
@@ -178,13 +184,13 @@ bool sdl_events_update()
 				mouse_state_change = true;
 				switch (event.button.button) {
 					case SDL_BUTTON_LEFT:
-						mouse_button_up(0);
+						replay_mouse_button(0, false);
 						break;
 					case SDL_BUTTON_RIGHT:
-						mouse_button_up(1);
+						replay_mouse_button(1, false);
 						break;
 					case SDL_BUTTON_MIDDLE:
-						mouse_button_up(2);
+						replay_mouse_button(2, false);
 						break;
 				}
 				break;
@@ -205,7 +211,7 @@ bool sdl_events_update()
 				mouse_state_change = true;
 				static int mouse_x;
 				static int mouse_y;
-				mouse_move(event.motion.x - mouse_x, event.motion.y - mouse_y);
+				replay_mouse_move(event.motion.x - mouse_x, event.motion.y - mouse_y);
 				mouse_x = event.motion.x;
 				mouse_y = event.motion.y;
 			} break;
@@ -219,7 +225,7 @@ bool sdl_events_update()
 	display_refund_render_time(event_handling_end_us - event_handling_start_us);
 
 	if (mouse_state_change) {
-		mouse_send_state();
+		replay_mouse_send_state();
 	}
 	return true;
 }
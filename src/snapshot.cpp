@@ -0,0 +1,467 @@
+// Commander X16 Emulator
+// Copyright (c) 2023 Stephen Horn, et al.
+// All rights reserved. License: 2-clause BSD
+
+#include "snapshot.h"
+
+#include <algorithm>
+#include <stdio.h>
+
+#include "audio.h"
+#include "cpu/fake6502.h"
+#include "files.h"
+#include "glue.h"
+#include "i2c.h"
+#include "memory.h"
+#include "replay.h"
+#include "rtc.h"
+#include "vera/sdcard.h"
+#include "vera/vera_pcm.h"
+#include "vera/vera_psg.h"
+#include "vera/vera_spi.h"
+#include "vera/vera_video.h"
+#include "via.h"
+#include "ym2151/ym2151.h"
+
+// A snapshot is a header followed by one chunk per section:
+//     tag (4 bytes), section version (4 bytes), size (4 bytes), data (size bytes)
+// Files are the same bytes, gzip compressed.
+
+static const char     Snapshot_magic[8] = { 'B', 'O', 'X', '1', '6', 'S', 'N', 'P' };
+static const uint32_t Snapshot_version  = 1;
+
+// check reads a section the way load would, without changing anything, and returns whether load
+// would accept it, so that a snapshot is either restored entirely or not at all.
+struct snapshot_section {
+	uint32_t tag;
+	uint32_t version;
+	void (*save)(snapshot_writer &w);
+	bool (*check)(snapshot_reader &r);
+	bool (*load)(snapshot_reader &r);
+};
+
+// Bump a section's version whenever its layout changes.
+static const snapshot_section Sections[] = {
+	{ SNAPSHOT_TAG('C', 'P', 'U', ' '), 1, machine_save_state, machine_check_state, machine_load_state },
+	{ SNAPSHOT_TAG('M', 'E', 'M', ' '), 1, memory_save_state, memory_check_state, memory_load_state },
+	{ SNAPSHOT_TAG('V', 'I', 'A', ' '), 1, via_save_state, via_check_state, via_load_state },
+	{ SNAPSHOT_TAG('R', 'T', 'C', ' '), 1, rtc_save_state, rtc_check_state, rtc_load_state },
+	{ SNAPSHOT_TAG('I', '2', 'C', ' '), 1, i2c_save_state, i2c_check_state, i2c_load_state },
+	{ SNAPSHOT_TAG('V', 'E', 'R', 'A'), 1, vera_video_save_state, vera_video_check_state, vera_video_load_state },
+	{ SNAPSHOT_TAG('P', 'S', 'G', ' '), 2, psg_save_state, psg_check_state, psg_load_state },
+	{ SNAPSHOT_TAG('P', 'C', 'M', ' '), 1, pcm_save_state, pcm_check_state, pcm_load_state },
+	{ SNAPSHOT_TAG('A', 'U', 'D', ' '), 1, audio_save_state, audio_check_state, audio_load_state },
+	{ SNAPSHOT_TAG('Y', 'M', ' ', ' '), 1, YM_save_state, YM_check_state, YM_load_state },
+	{ SNAPSHOT_TAG('S', 'P', 'I', ' '), 1, vera_spi_save_state, vera_spi_check_state, vera_spi_load_state },
+	{ SNAPSHOT_TAG('S', 'D', 'C', ' '), 2, sdcard_save_state, sdcard_check_state, sdcard_load_state },
+};
+
+static constexpr size_t Num_sections = sizeof(Sections) / sizeof(Sections[0]);
+
+static void print_tag(uint32_t tag)
+{
+	printf("%c%c%c%c", tag & 0xff, (tag >> 8) & 0xff, (tag >> 16) & 0xff, (tag >> 24) & 0xff);
+}
+
+void snapshot_capture(std::vector<uint8_t> &buffer)
+{
+	machine_sync_devices();
+
+	buffer.clear();
+	snapshot_writer w(buffer);
+	w.write(Snapshot_magic);
+	w.write(Snapshot_version);
+
+	for (const snapshot_section &section : Sections) {
+		w.write(section.tag);
+		w.write(section.version);
+
+		const size_t size_offset = w.size();
+		w.write((uint32_t)0);
+
+		section.save(w);
+
+		const uint32_t size = (uint32_t)(w.size() - size_offset - sizeof(uint32_t));
+		memcpy(w.data_at(size_offset), &size, sizeof(size));
+	}
+}
+
+// Finds every section before anything is loaded, so a snapshot that can't be restored is
+// rejected without touching the machine.
+static bool find_sections(const std::vector<uint8_t> &buffer, snapshot_reader (&readers)[Num_sections], bool (&found)[Num_sections])
+{
+	snapshot_reader r(buffer.data(), buffer.size(), 0);
+
+	char     magic[sizeof(Snapshot_magic)];
+	uint32_t version = 0;
+	r.read(magic);
+	r.read(version);
+	if (!r.ok() || memcmp(magic, Snapshot_magic, sizeof(magic)) != 0) {
+		printf("Not a snapshot file.\n");
+		return false;
+	}
+	if (version != Snapshot_version) {
+		printf("Snapshot format version %u is not supported.\n", version);
+		return false;
+	}
+
+	while (r.remaining() > 0) {
+		uint32_t tag             = 0;
+		uint32_t section_version = 0;
+		uint32_t size            = 0;
+		r.read(tag);
+		r.read(section_version);
+		r.read(size);
+		if (!r.ok() || size > r.remaining()) {
+			printf("Snapshot is truncated.\n");
+			return false;
+		}
+
+		const uint8_t *data = r.position();
+		size_t         i    = 0;
+		while (i < Num_sections && Sections[i].tag != tag) {
+			++i;
+		}
+		if (i == Num_sections) {
+			printf("Ignoring unknown snapshot section ");
+			print_tag(tag);
+			printf(".\n");
+		} else if (section_version != Sections[i].version) {
+			printf("Snapshot section ");
+			print_tag(tag);
+			printf(" has version %u, expected %u.\n", section_version, Sections[i].version);
+			return false;
+		} else {
+			readers[i] = snapshot_reader(data, size, section_version);
+			found[i]   = true;
+		}
+
+		r.skip(size);
+	}
+
+	for (size_t i = 0; i < Num_sections; ++i) {
+		if (!found[i]) {
+			printf("Snapshot is missing section ");
+			print_tag(Sections[i].tag);
+			printf(".\n");
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool restore_sections(snapshot_reader (&readers)[Num_sections])
+{
+	// A section can still turn out not to fit this machine, so every section is checked before
+	// the first one is loaded.
+	for (size_t i = 0; i < Num_sections; ++i) {
+		snapshot_reader r = readers[i];
+		if (!Sections[i].check(r) || !r.ok() || r.remaining() != 0) {
+			printf("Cannot restore snapshot section ");
+			print_tag(Sections[i].tag);
+			printf(".\n");
+			return false;
+		}
+	}
+
+	for (size_t i = 0; i < Num_sections; ++i) {
+		if (!Sections[i].load(readers[i]) || !readers[i].ok() || readers[i].remaining() != 0) {
+			printf("Snapshot section ");
+			print_tag(Sections[i].tag);
+			printf(" passed its check but couldn't be loaded, the machine is only partly restored!\n");
+			return false;
+		}
+	}
+	return true;
+}
+
+bool snapshot_restore(const std::vector<uint8_t> &buffer)
+{
+	snapshot_reader readers[Num_sections] = {};
+	bool            found[Num_sections]   = {};
+	if (!find_sections(buffer, readers, found)) {
+		return false;
+	}
+	return restore_sections(readers);
+}
+
+//
+// Deltas
+//
+// A delta lists the sections that changed, each as:
+//     section index, size before, size after, runs, 0
+// and each run of changed bytes as:
+//     length, distance from the end of the previous run, the bytes XORed with what they were
+// where every number is an unsigned LEB128. A section that changed size is XORed as if the
+// shorter of its two versions was padded with zeroes, so applying the runs goes either way.
+//
+
+// Blocks this big are compared with memcmp before looking for the bytes that changed.
+static constexpr size_t Compare_block_size = 64;
+static constexpr size_t Compare_skip_size  = 4096;
+
+static void put_varint(std::vector<uint8_t> &out, uint64_t value)
+{
+	while (value >= 0x80) {
+		out.push_back((uint8_t)(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back((uint8_t)value);
+}
+
+static bool get_varint(const uint8_t *&in, const uint8_t *end, uint64_t &value)
+{
+	value     = 0;
+	int shift = 0;
+	while (in < end && shift < 64) {
+		const uint8_t b = *in++;
+		value |= (uint64_t)(b & 0x7f) << shift;
+		if ((b & 0x80) == 0) {
+			return true;
+		}
+		shift += 7;
+	}
+	return false;
+}
+
+void snapshot_writer::add_run(size_t offset, const uint8_t *data, size_t size)
+{
+	put_varint(*m_delta, size);
+	put_varint(*m_delta, offset - m_delta_offset);
+
+	uint8_t *previous = m_buffer.data() + offset;
+	for (size_t i = 0; i < size; ++i) {
+		m_delta->push_back(previous[i] ^ data[i]);
+	}
+	memcpy(previous, data, size);
+	m_delta_offset = offset + size;
+}
+
+void snapshot_writer::compare_bytes(const uint8_t *data, size_t size, const uint8_t *dirty, size_t block_size)
+{
+	// Anything past the end of the earlier capture is compared with zeroes, and since there was
+	// nothing there to compare with, there's no use in only looking at the flagged blocks.
+	if (m_offset + size > m_buffer.size()) {
+		m_buffer.resize(m_offset + size);
+		dirty = nullptr;
+	}
+
+	const uint8_t *previous = m_buffer.data() + m_offset;
+
+	auto compare_blocks = [&](size_t start, size_t end) {
+		for (size_t pos = start; pos < end; pos += Compare_block_size) {
+			const size_t n = std::min(Compare_block_size, end - pos);
+			if (memcmp(data + pos, previous + pos, n) == 0) {
+				continue;
+			}
+			size_t first = pos;
+			size_t last  = pos + n - 1;
+			while (data[first] == previous[first]) {
+				++first;
+			}
+			while (data[last] == previous[last]) {
+				--last;
+			}
+			add_run(m_offset + first, data + first, last - first + 1);
+		}
+	};
+
+	// Most of a large range is usually unchanged, so skip over it in bigger steps first.
+	auto compare_range = [&](size_t start, size_t length) {
+		const size_t end = start + length;
+		for (size_t pos = start; pos < end; pos += Compare_skip_size) {
+			const size_t n = std::min(Compare_skip_size, end - pos);
+			if (memcmp(data + pos, previous + pos, n) != 0) {
+				compare_blocks(pos, pos + n);
+			}
+		}
+	};
+
+	if (dirty == nullptr) {
+		compare_range(0, size);
+		m_offset += size;
+		return;
+	}
+
+	auto compare_dirty = [&](size_t first_block, size_t end_block) {
+		for (size_t block = first_block; block < end_block; ++block) {
+			const uint8_t *next = reinterpret_cast<const uint8_t *>(memchr(dirty + block, 1, end_block - block));
+			if (next == nullptr) {
+				break;
+			}
+			block              = next - dirty;
+			const size_t start = block * block_size;
+			compare_blocks(start, std::min(start + block_size, size));
+		}
+	};
+
+	// The runs have to be in order, so the swept blocks go in between the flagged ones.
+	const size_t num_blocks  = (size + block_size - 1) / block_size;
+	const size_t sweep_start = num_blocks * m_sweep / m_sweeps;
+	const size_t sweep_end   = num_blocks * (m_sweep + 1) / m_sweeps;
+	compare_dirty(0, sweep_start);
+	compare_range(sweep_start * block_size, std::min(sweep_end * block_size, size) - sweep_start * block_size);
+	compare_dirty(sweep_end, num_blocks);
+	m_offset += size;
+}
+
+void snapshot_writer::finish()
+{
+	if (m_delta == nullptr || m_offset >= m_buffer.size()) {
+		return;
+	}
+
+	// The section got shorter, so the rest of the earlier capture is XORed with zeroes.
+	put_varint(*m_delta, m_buffer.size() - m_offset);
+	put_varint(*m_delta, m_offset - m_delta_offset);
+	m_delta->insert(m_delta->end(), m_buffer.begin() + m_offset, m_buffer.end());
+	m_buffer.resize(m_offset);
+}
+
+void snapshot_capture_delta(snapshot_image &image, std::vector<uint8_t> &delta, unsigned sweep, unsigned sweeps)
+{
+	machine_sync_devices();
+
+	image.sections.resize(Num_sections);
+	delta.clear();
+
+	std::vector<uint8_t> runs;
+	for (size_t i = 0; i < Num_sections; ++i) {
+		std::vector<uint8_t> &section  = image.sections[i];
+		const size_t          old_size = section.size();
+
+		runs.clear();
+		snapshot_writer w(section, runs, sweep, sweeps);
+		Sections[i].save(w);
+		w.finish();
+
+		if (!runs.empty() || section.size() != old_size) {
+			put_varint(delta, i);
+			put_varint(delta, old_size);
+			put_varint(delta, section.size());
+			delta.insert(delta.end(), runs.begin(), runs.end());
+			put_varint(delta, 0);
+		}
+	}
+}
+
+bool snapshot_revert_delta(snapshot_image &image, const std::vector<uint8_t> &delta)
+{
+	if (image.sections.size() != Num_sections) {
+		return false;
+	}
+
+	const uint8_t *in  = delta.data();
+	const uint8_t *end = in + delta.size();
+	while (in < end) {
+		uint64_t index;
+		uint64_t old_size;
+		uint64_t new_size;
+		if (!get_varint(in, end, index) || !get_varint(in, end, old_size) || !get_varint(in, end, new_size)) {
+			return false;
+		}
+		if (index >= Num_sections || image.sections[index].size() != new_size) {
+			return false;
+		}
+
+		std::vector<uint8_t> &section = image.sections[index];
+		section.resize(std::max(old_size, new_size));
+
+		uint64_t offset = 0;
+		while (true) {
+			uint64_t length;
+			uint64_t skip;
+			if (!get_varint(in, end, length)) {
+				return false;
+			}
+			if (length == 0) {
+				break;
+			}
+			if (!get_varint(in, end, skip)) {
+				return false;
+			}
+			offset += skip;
+			if (offset > section.size() || length > section.size() - offset || length > (uint64_t)(end - in)) {
+				return false;
+			}
+			for (uint64_t i = 0; i < length; ++i) {
+				section[offset + i] ^= in[i];
+			}
+			in += length;
+			offset += length;
+		}
+
+		section.resize(old_size);
+	}
+	return true;
+}
+
+bool snapshot_restore_image(const snapshot_image &image)
+{
+	if (image.sections.size() != Num_sections) {
+		return false;
+	}
+
+	snapshot_reader readers[Num_sections] = {};
+	for (size_t i = 0; i < Num_sections; ++i) {
+		readers[i] = snapshot_reader(image.sections[i].data(), image.sections[i].size(), Sections[i].version);
+	}
+	return restore_sections(readers);
+}
+
+bool snapshot_save_file(const char *path)
+{
+	std::vector<uint8_t> buffer;
+	snapshot_capture(buffer);
+
+	gzFile f = gzopen(path, "wb6");
+	if (f == Z_NULL) {
+		printf("Cannot write to %s!\n", path);
+		return false;
+	}
+
+	bool ok = true;
+	for (size_t pos = 0; pos < buffer.size() && ok; pos += 64 * 1024) {
+		const unsigned length = (unsigned)std::min((size_t)64 * 1024, buffer.size() - pos);
+		ok                    = gzwrite(f, buffer.data() + pos, length) == (int)length;
+	}
+	ok = gzclose(f) == Z_OK && ok;
+
+	if (!ok) {
+		printf("Cannot write to %s!\n", path);
+		return false;
+	}
+	printf("Saved snapshot to %s.\n", path);
+	return true;
+}
+
+bool snapshot_load_file(const char *path)
+{
+	gzFile f = gzopen(path, "rb");
+	if (f == Z_NULL) {
+		printf("Cannot open snapshot %s!\n", path);
+		return false;
+	}
+
+	std::vector<uint8_t> buffer;
+	uint8_t              chunk[64 * 1024];
+	int                  length;
+	while ((length = gzread(f, chunk, sizeof(chunk))) > 0) {
+		buffer.insert(buffer.end(), chunk, chunk + length);
+	}
+	const bool read_ok = length == 0;
+	gzclose(f);
+
+	if (!read_ok) {
+		printf("Cannot read snapshot %s!\n", path);
+		return false;
+	}
+	const uint64_t clock = clockticks6502;
+	if (!snapshot_restore(buffer)) {
+		printf("Cannot load snapshot %s.\n", path);
+		return false;
+	}
+	replay_state_replaced(clock);
+	printf("Loaded snapshot from %s.\n", path);
+	return true;
+}
@@ -0,0 +1,216 @@
+// Commander X16 Emulator
+// Copyright (c) 2023 Stephen Horn, et al.
+// All rights reserved. License: 2-clause BSD
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+#include <vector>
+
+// Machine snapshots: every device writes its own section, each section is tagged and versioned
+// so that a device can change its layout without invalidating every other device's section.
+
+#define SNAPSHOT_TAG(a, b, c, d) ((uint32_t)(a) | (uint32_t)(b) << 8 | (uint32_t)(c) << 16 | (uint32_t)(d) << 24)
+
+class snapshot_writer
+{
+public:
+	snapshot_writer(std::vector<uint8_t> &buffer)
+	    : m_buffer(buffer), m_delta(nullptr), m_offset(0), m_delta_offset(0), m_sweep(0), m_sweeps(1)
+	{
+		// Nothing to do.
+	}
+
+	// Writes over an earlier capture of the same section instead of appending to it, and adds
+	// the XOR of every run of bytes that changed to delta. finish() has to be called at the end.
+	snapshot_writer(std::vector<uint8_t> &previous, std::vector<uint8_t> &delta, unsigned sweep, unsigned sweeps)
+	    : m_buffer(previous), m_delta(&delta), m_offset(0), m_delta_offset(0), m_sweep(sweep), m_sweeps(sweeps)
+	{
+		// Nothing to do.
+	}
+
+	void write_bytes(const void *data, size_t size)
+	{
+		const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+		if (m_delta == nullptr) {
+			append(bytes, size);
+		} else {
+			compare_bytes(bytes, size, nullptr, 0);
+		}
+	}
+
+	template <typename T>
+	void write(const T &value)
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+		write_bytes(&value, sizeof(T));
+	}
+
+	// For large arrays whose owner sets the flag (to 1) for each block of block_size bytes as it's
+	// written to. A delta only compares the flagged blocks with the earlier capture, along with
+	// the part of the array that's due to be swept (see snapshot_capture_delta).
+	void write_tracked(const void *data, size_t size, const uint8_t *dirty, size_t block_size)
+	{
+		const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+		if (m_delta == nullptr) {
+			append(bytes, size);
+		} else {
+			compare_bytes(bytes, size, dirty, block_size);
+		}
+	}
+
+	// The flags have been seen once a delta has been written, so they can start over.
+	void clear_dirty(uint8_t *dirty, size_t count)
+	{
+		if (m_delta != nullptr) {
+			memset(dirty, 0, count);
+		}
+	}
+
+	void finish();
+
+	size_t size() const
+	{
+		return m_buffer.size();
+	}
+
+	uint8_t *data_at(size_t offset)
+	{
+		return m_buffer.data() + offset;
+	}
+
+private:
+	// vector::insert trips GCC's -Wstringop-overflow once it's inlined into a capture, so this grows
+	// the buffer and copies into it instead.
+	void append(const uint8_t *bytes, size_t size)
+	{
+		if (size == 0) {
+			return;
+		}
+		const size_t old_size = m_buffer.size();
+		m_buffer.resize(old_size + size);
+		memcpy(m_buffer.data() + old_size, bytes, size);
+	}
+
+	void compare_bytes(const uint8_t *data, size_t size, const uint8_t *dirty, size_t block_size);
+	void add_run(size_t offset, const uint8_t *data, size_t size);
+
+	std::vector<uint8_t> &m_buffer;
+	std::vector<uint8_t> *m_delta;
+	size_t                m_offset;
+	size_t                m_delta_offset;
+	unsigned              m_sweep;
+	unsigned              m_sweeps;
+};
+
+class snapshot_reader
+{
+public:
+	snapshot_reader()
+	    : snapshot_reader(nullptr, 0, 0)
+	{
+		// Nothing to do.
+	}
+
+	snapshot_reader(const uint8_t *data, size_t size, uint32_t version)
+	    : m_data(data), m_size(size), m_offset(0), m_version(version), m_ok(true)
+	{
+		// Nothing to do.
+	}
+
+	// Once a read fails, every later read fails too, so callers only need to check ok() at the end.
+	bool read_bytes(void *data, size_t size)
+	{
+		if (!m_ok || size > m_size - m_offset) {
+			m_ok = false;
+			return false;
+		}
+		memcpy(data, m_data + m_offset, size);
+		m_offset += size;
+		return true;
+	}
+
+	bool skip(size_t size)
+	{
+		if (!m_ok || size > m_size - m_offset) {
+			m_ok = false;
+			return false;
+		}
+		m_offset += size;
+		return true;
+	}
+
+	template <typename T>
+	bool read(T &value)
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+		return read_bytes(&value, sizeof(T));
+	}
+
+	// For values that have to fit something already in the machine, like the number of RAM banks.
+	template <typename T>
+	bool expect(const T &value)
+	{
+		T stored;
+		if (read(stored) && memcmp(&stored, &value, sizeof(T)) != 0) {
+			m_ok = false;
+		}
+		return m_ok;
+	}
+
+	size_t remaining() const
+	{
+		return m_size - m_offset;
+	}
+
+	const uint8_t *position() const
+	{
+		return m_data + m_offset;
+	}
+
+	uint32_t version() const
+	{
+		return m_version;
+	}
+
+	bool ok() const
+	{
+		return m_ok;
+	}
+
+private:
+	const uint8_t *m_data;
+	size_t         m_size;
+	size_t         m_offset;
+	uint32_t       m_version;
+	bool           m_ok;
+};
+
+// Serializes the whole machine into buffer, replacing its contents.
+void snapshot_capture(std::vector<uint8_t> &buffer);
+
+// Restores the machine from a buffer filled by snapshot_capture. If the buffer can't be restored,
+// the machine is left as it was and false is returned.
+bool snapshot_restore(const std::vector<uint8_t> &buffer);
+
+// The machine captured one section at a time, so that it can be kept up to date with deltas.
+struct snapshot_image {
+	std::vector<std::vector<uint8_t>> sections;
+};
+
+// Brings image up to date with the machine, replacing delta with the changes. Large arrays are
+// only compared where they have been written to since the last delta, plus part sweep of sweeps
+// of each, so that anything changed behind their owner's back is caught within sweeps deltas.
+void snapshot_capture_delta(snapshot_image &image, std::vector<uint8_t> &delta, unsigned sweep, unsigned sweeps);
+
+// Takes image back to what it was before the snapshot_capture_delta that made delta.
+bool snapshot_revert_delta(snapshot_image &image, const std::vector<uint8_t> &delta);
+
+// Like snapshot_restore, for an image kept up to date with snapshot_capture_delta.
+bool snapshot_restore_image(const snapshot_image &image);
+
+bool snapshot_save_file(const char *path);
+bool snapshot_load_file(const char *path);
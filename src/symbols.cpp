@@ -376,6 +376,47 @@ bool symbols_load_file(const std::string &file_path, symbol_bank_type bank)
 			saddr_str >> std::hex;
 			saddr_str >> addr;
 			debugger_add_breakpoint(addr);
+
+			// VICE-style conditions: break <address> if <condition>
+			std::string keyword;
+			sline >> keyword;
+			if (keyword == "if") {
+				std::string condition;
+				std::getline(sline, condition);
+				std::string error;
+				if (!debugger_set_breakpoint_condition(addr, 0, condition.c_str(), error)) {
+					printf("Could not set the condition of the breakpoint at $%04X: %s\n", addr, error.c_str());
+				}
+			}
+		} else if (cmd == "watch") {
+			// VICE-style watchpoints: watch [load|store] <address> [<address>] [if <condition>]
+			uint8_t     flags = DEBUG6502_READ | DEBUG6502_WRITE;
+			uint32_t    addrs[2];
+			int         num_addrs = 0;
+			std::string condition;
+			std::string word;
+			while (sline >> word) {
+				if (word == "load") {
+					flags = DEBUG6502_READ;
+				} else if (word == "store") {
+					flags = DEBUG6502_WRITE;
+				} else if (word == "if") {
+					std::getline(sline, condition);
+					break;
+				} else if (num_addrs < 2) {
+					std::istringstream saddr_str(word[0] == '$' ? word.substr(1) : word);
+					saddr_str >> std::hex;
+					saddr_str >> addrs[num_addrs++];
+				}
+			}
+			if (num_addrs == 0 || addrs[0] > 0xffff || (num_addrs > 1 && addrs[1] > 0xffff)) {
+				continue;
+			}
+
+			std::string error;
+			if (!debugger_add_range_watchpoint(addrs[0], num_addrs > 1 ? addrs[1] : addrs[0], 0, flags, condition.c_str(), error)) {
+				printf("Could not add the watchpoint at $%04X: %s\n", addrs[0], error.c_str());
+			}
 		}
 	}
 
@@ -5,6 +5,7 @@
 #include "glue.h"
 #include "options.h"
 #include "ring_buffer.h"
+#include "vera/vera_video.h"
 
 struct tick_record {
 	uint32_t us;
@@ -76,6 +77,9 @@ void timing_update()
 		printf("Speed: %d%%\n", Timing_perf);
 		uint32_t load = (uint32_t)(100 * tick.us / Expected_frametime_us);
 		printf("Load: %d%%\n", load > 100 ? 100 : load);
+		if (Options.warp_factor > 0) {
+			printf("Skipped frames: %u\n", vera_video_get_skipped_frames());
+		}
 	}
 
 	Last_performance_time = current_performance_time;
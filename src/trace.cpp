@@ -0,0 +1,144 @@
+// Commander X16 Emulator
+// Copyright (c) 2023 Stephen Horn, et al.
+// All rights reserved. License: 2-clause BSD
+
+#include "trace.h"
+
+#include <memory>
+#include <stdio.h>
+#include <string.h>
+
+#include "disasm.h"
+#include "memory.h"
+#include "options.h"
+
+// Enough for a few seconds of a busy CPU, at 16 bytes each.
+static constexpr uint32_t Max_records = 1 << 24;
+
+struct trace_record {
+	uint32_t clock; // Low bits of clockticks6502 when the instruction started
+	uint16_t pc;
+	uint8_t  opcode;
+	uint8_t  a;
+	uint8_t  x;
+	uint8_t  y;
+	uint8_t  sp;
+	uint8_t  status;
+	uint8_t  ram_bank;
+	uint8_t  rom_bank;
+	uint8_t  unused[2];
+};
+static_assert(sizeof(trace_record) == 16);
+
+static std::unique_ptr<trace_record[]> Records;
+static uint32_t                        Size  = 0;
+static uint64_t                        Count = 0; // Records ever added, the newest being at (Count - 1) % Size
+
+void trace_set_size(uint32_t instructions)
+{
+	uint32_t size = 0;
+	if (instructions > 0) {
+		size = 1;
+		while (size < instructions && size < Max_records) {
+			size <<= 1;
+		}
+	}
+
+	if (size != Size) {
+		Records.reset(size > 0 ? new trace_record[size] : nullptr);
+		Size  = size;
+		Count = 0;
+	}
+}
+
+uint32_t trace_get_size()
+{
+	return Size;
+}
+
+bool trace_is_enabled()
+{
+	return Size > 0;
+}
+
+void trace_clear()
+{
+	Count = 0;
+}
+
+void trace_instruction(const _state6502 &state, uint8_t opcode, uint8_t ram_bank, uint8_t rom_bank, uint64_t clock)
+{
+	trace_record &record = Records[Count++ & (Size - 1)];
+	record.clock         = (uint32_t)clock;
+	record.pc            = state.pc;
+	record.opcode        = opcode;
+	record.a             = state.a;
+	record.x             = state.x;
+	record.y             = state.y;
+	record.sp            = state.sp;
+	record.status        = state.status;
+	record.ram_bank      = ram_bank;
+	record.rom_bank      = rom_bank;
+}
+
+// The areas of memory selected by -log, like the official emulator's trace.
+static bool trace_is_logged(uint16_t pc)
+{
+	if (!Options.log_cpu_low && !Options.log_cpu_main && !Options.log_cpu_bram && !Options.log_cpu_brom) {
+		return true;
+	}
+	return (Options.log_cpu_low && pc <= 0x07ff) ||
+	       (Options.log_cpu_main && pc >= 0x0800 && pc <= 0x9fff) ||
+	       (Options.log_cpu_bram && pc >= 0xa000 && pc <= 0xbfff) ||
+	       (Options.log_cpu_brom && pc >= 0xc000);
+}
+
+bool trace_save(const char *path, uint16_t first, uint16_t last)
+{
+	FILE *f = fopen(path, "w");
+	if (f == nullptr) {
+		printf("Could not open %s to save the CPU trace.\n", path);
+		return false;
+	}
+
+	const uint64_t oldest = (Count > Size) ? Count - Size : 0;
+
+	// Only the low bits of the clock are kept, which is plenty to count back from the current clock.
+	const uint64_t now = clockticks6502;
+
+	uint64_t written = 0;
+	for (uint64_t i = oldest; i < Count; ++i) {
+		const trace_record &record = Records[i & (Size - 1)];
+		if (record.pc < first || record.pc > last || !trace_is_logged(record.pc)) {
+			continue;
+		}
+
+		const uint64_t clock = now - (uint32_t)((uint32_t)now - record.clock);
+		const uint8_t  bank  = (record.pc >= 0xc000) ? record.rom_bank : (record.pc >= 0xa000) ? record.ram_bank : 0;
+
+		char flags[9];
+		for (int b = 7; b >= 0; --b) {
+			flags[7 - b] = (record.status & (1 << b)) ? "czidb.vn"[b] : '-';
+		}
+		flags[8] = '\0';
+
+		const char *label = disasm_get_label(record.pc, bank);
+
+		char code[256];
+		disasm_code(code, sizeof(code), record.pc, bank);
+
+		fprintf(f, "%12llu a:$%02x x:$%02x y:$%02x s:$%02x p:%s ram=$%02x rom=$%02x %-25s$%02x:$%04x %s", (unsigned long long)clock, record.a, record.x, record.y, record.sp, flags, record.ram_bank, record.rom_bank, label ? label : "", bank, record.pc, code);
+
+		// The code is disassembled from memory as it is now, which may not be what ran.
+		const uint8_t opcode = debug_read6502(record.pc, bank);
+		if (opcode != record.opcode) {
+			fprintf(f, " (changed, opcode was $%02x)", record.opcode);
+		}
+		fprintf(f, "\n");
+		++written;
+	}
+
+	fclose(f);
+	printf("Saved CPU trace of %llu instructions to %s.\n", (unsigned long long)written, path);
+	return true;
+}
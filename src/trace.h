@@ -0,0 +1,29 @@
+// Commander X16 Emulator
+// Copyright (c) 2023 Stephen Horn, et al.
+// All rights reserved. License: 2-clause BSD
+
+#pragma once
+
+#include <stdint.h>
+
+#include "cpu/fake6502.h"
+
+// Keeps the last instructions the CPU ran as compact records in a ring, to find out afterwards how
+// the machine got to where it is. Nothing is formatted until the trace is saved.
+
+// How many instructions -trace keeps, unless it's given a number.
+#define TRACE_DEFAULT_SIZE (1 << 20)
+
+// Keeps the given number of instructions (rounded up to a power of 2), or stops tracing with 0.
+void     trace_set_size(uint32_t instructions);
+uint32_t trace_get_size();
+bool     trace_is_enabled();
+void     trace_clear();
+
+// Called by the CPU for every instruction it completes while tracing, with the state it started from.
+void trace_instruction(const _state6502 &state, uint8_t opcode, uint8_t ram_bank, uint8_t rom_bank, uint64_t clock);
+
+// Writes the instructions between first and last (inclusive, see -tracerange) out as text, oldest
+// first, in the same format as the official emulator's trace. If any of the CPU logs are selected with
+// -log, only the instructions in those areas are written. The code is disassembled from memory as it is now.
+bool trace_save(const char *path, uint16_t first, uint16_t last);
@@ -7,15 +7,18 @@
 
 #include <SDL.h>
 #include <algorithm>
+#include <array>
 #include <cstdlib>
+#include <iterator>
 #include <stdbool.h>
 #include <stdio.h>
-#include <unordered_map>
-#include <filesystem>
-
-#include "files.h"
+#include <string.h>
+#include <string>
+#include <vector>
 
 #include "hypercalls.h"
+#include "sdcard_image.h"
+#include "snapshot.h"
 
 //#define VERBOSE 1
 
@@ -44,12 +47,9 @@ enum {
 	CMD58  = 58,        // READ_OCR
 };
 
-char                               sdcard_path[PATH_MAX] = "";
-gzFile                             sdcard_file           = Z_NULL;
-size_t                             sdcard_size           = 0;
-bool                               sdcard_compressed     = false;
-std::unordered_map<int, char[512]> sdcard_changes;
-bool                               sdcard_attached = false;
+char sdcard_path[PATH_MAX]         = "";
+char sdcard_overlay_path[PATH_MAX] = "";
+bool sdcard_attached               = false;
 
 static uint8_t  rxbuf[3 + 512];
 static int      rxbuf_idx;
@@ -59,6 +59,10 @@ static bool     is_acmd        = false;
 static bool     is_idle        = true;
 static bool     is_initialized = false;
 
+// Set between CMD18/CMD25 and the end of the transfer.
+static bool reading_multiple = false;
+static bool writing_multiple = false;
+
 static const uint8_t *response         = NULL;
 static int            response_length  = 0;
 static int            response_counter = 0;
@@ -72,16 +76,26 @@ void sdcard_shutdown()
 	}
 }
 
-void sdcard_set_file(char const *path)
+void sdcard_set_file(char const *path, char const *overlay_path)
 {
+	// A path cut short would point at some other file, so a path that doesn't fit is refused.
+	const std::string image   = path;
+	const std::string overlay = (overlay_path != nullptr && overlay_path[0] != '\0') ? std::string(overlay_path) : image + ".overlay";
+	if (image.size() >= PATH_MAX) {
+		printf("SD card image path %s is too long!\n", path);
+		return;
+	}
+	if (overlay.size() >= PATH_MAX) {
+		printf("SD card overlay path %s is too long!\n", overlay.c_str());
+		return;
+	}
+
 	if (sdcard_attached) {
 		sdcard_detach();
 	}
 
-	strncpy(sdcard_path, path, PATH_MAX);
-	sdcard_path[PATH_MAX - 1] = '\0';
-
-	sdcard_compressed = file_is_compressed_type(sdcard_path);
+	memcpy(sdcard_path, image.c_str(), image.size() + 1);
+	memcpy(sdcard_overlay_path, overlay.c_str(), overlay.size() + 1);
 
 	sdcard_attach();
 }
@@ -89,18 +103,16 @@ void sdcard_set_file(char const *path)
 void sdcard_attach()
 {
 	if (!sdcard_attached && strlen(sdcard_path) > 0) {
-		sdcard_file = gzopen(sdcard_path, "rb");
-		if (sdcard_file == Z_NULL) {
+		if (!sdcard_image_open(sdcard_path, sdcard_overlay_path)) {
 			printf("Cannot open SDCard file %s!\n", sdcard_path);
 			return;
 		}
 
-		sdcard_size = gzsize(sdcard_file);
-		sdcard_changes.clear();
-
 		printf("SD card attached.\n");
-		sdcard_attached = true;
-		is_initialized  = false;
+		sdcard_attached  = true;
+		is_initialized   = false;
+		reading_multiple = false;
+		writing_multiple = false;
 
 		hypercalls_update();
 	}
@@ -112,34 +124,7 @@ void sdcard_detach()
 		printf("SD card detached.\n");
 		sdcard_attached = false;
 
-		if (!sdcard_changes.empty()) {
-			std::string temp_file_path = (std::filesystem::temp_directory_path() / (sdcard_compressed ? "sdcard.bin.gz" : "sdcard.bin")).generic_string();
-			gzFile      f              = gzopen(temp_file_path.c_str(), sdcard_compressed ? "wb9" : "wb0");
-			gzseek(sdcard_file, 0, SEEK_SET);
-
-			char buffer[64 * 1024];
-
-			int read = gzread(sdcard_file, buffer, sizeof(buffer));
-			int lba  = 0;
-			while (read > 0) {
-				const int lba0 = lba;
-				const int lba1 = lba + ((read + 511) >> 9);
-				for (int l = lba0; l < lba1; ++l) {
-					if (sdcard_changes.contains(l)) {
-						memcpy(&buffer[(l - lba0) << 9], sdcard_changes[l], 512);
-					}
-				}
-				lba = lba1;
-				gzwrite(f, buffer, read);
-				read = gzread(sdcard_file, buffer, sizeof(buffer));
-			}
-			gzclose(f);
-			gzclose(sdcard_file);
-			sdcard_file = Z_NULL;
-			std::filesystem::rename(temp_file_path, sdcard_path);
-		}
-
-		sdcard_size = 0;
+		sdcard_image_close();
 
 		hypercalls_update();
 	}
@@ -147,7 +132,24 @@ void sdcard_detach()
 
 bool sdcard_is_attached()
 {
-	return sdcard_file != Z_NULL && sdcard_attached;
+	return sdcard_attached && sdcard_image_is_open();
+}
+
+bool sdcard_has_changes()
+{
+	return sdcard_is_attached() && sdcard_image_has_changes();
+}
+
+bool sdcard_merge_changes()
+{
+	if (!sdcard_is_attached()) {
+		return false;
+	}
+	if (!sdcard_image_merge()) {
+		return false;
+	}
+	printf("SD card changes merged into %s.\n", sdcard_path);
+	return true;
 }
 
 void sdcard_select(bool select)
@@ -187,6 +189,37 @@ static void set_response_r3(void)
 	response_length           = sizeof(r3);
 }
 
+static void set_response_data_accepted(void)
+{
+	static const uint8_t data_response[] = { 0x05 };
+	response                             = data_response;
+	response_length                      = sizeof(data_response);
+}
+
+// Reads the sector at lba into a data block response. The first block of a read is preceded by the
+// R1 response to the command, later blocks of CMD18 only by the start block token.
+static void set_response_read_block(bool first_block)
+{
+	static uint8_t read_block_response[1 + 1 + 512 + 2];
+	read_block_response[0] = 0;
+	read_block_response[1] = 0xFE;
+#ifdef VERBOSE
+	printf("*** SD Reading LBA %d\n", lba);
+#endif
+	if (!sdcard_image_read(lba, &read_block_response[2])) {
+		printf("Warning: short read!\n");
+	}
+
+	if (first_block) {
+		response        = read_block_response;
+		response_length = sizeof(read_block_response);
+	} else {
+		response        = read_block_response + 1;
+		response_length = sizeof(read_block_response) - 1;
+	}
+	response_counter = 0;
+}
+
 static void set_response_r7(void)
 {
 	static const uint8_t r7[] = { 1, 0x00, 0x00, 0x01, 0xAA };
@@ -196,7 +229,7 @@ static void set_response_r7(void)
 
 uint8_t sdcard_handle(uint8_t inbyte)
 {
-	if (!selected || sdcard_file == Z_NULL) {
+	if (!selected || !sdcard_attached) {
 		return 0xFF;
 	}
 	// printf("sdcard_handle: %02X\n", inbyte);
@@ -205,6 +238,10 @@ uint8_t sdcard_handle(uint8_t inbyte)
 
 	if (rxbuf_idx == 0 && inbyte == 0xFF) {
 		// send response data
+		if (response == NULL && reading_multiple) {
+			++lba;
+			set_response_read_block(false);
+		}
 		if (response) {
 			outbyte = response[response_counter++];
 			if (response_counter == response_length) {
@@ -233,6 +270,9 @@ uint8_t sdcard_handle(uint8_t inbyte)
 
 			last_cmd = rxbuf[0];
 
+			reading_multiple = false;
+			writing_multiple = false;
+
 #if defined(VERBOSE) && VERBOSE >= 2
 			printf("*** SD %sCMD%d -> Response:", (rxbuf[0] & 0x80) ? "A" : "", rxbuf[0] & 0x3F);
 #endif
@@ -268,35 +308,26 @@ uint8_t sdcard_handle(uint8_t inbyte)
 					set_response_r1();
 					break;
 				}
-				case CMD17: {
-					// READ_SINGLE_BLOCK
-					uint32_t       lba = (rxbuf[1] << 24) | (rxbuf[2] << 16) | (rxbuf[3] << 8) | rxbuf[4];
-					static uint8_t read_block_response[2 + 512 + 2];
-					read_block_response[0] = 0;
-					read_block_response[1] = 0xFE;
-#ifdef VERBOSE
-					printf("*** SD Reading LBA %d\n", lba);
-#endif
-					auto sdcard_pos = lba * 512;
-					if (sdcard_size - sdcard_pos < 512) {
-						printf("Warning: short read!");
-					}
-					if (sdcard_changes.contains(lba)) {
-						memcpy(&read_block_response[2], sdcard_changes[lba], std::min((size_t)512, sdcard_size - sdcard_pos));
-					} else {
-						gzseek(sdcard_file, sdcard_pos, SEEK_SET);
-						gzread(sdcard_file, &read_block_response[2], 512);
-					}
-
-					response        = read_block_response;
-					response_length = 2 + 512 + 2;
+				case CMD12: {
+					// STOP_TRANSMISSION: Ends a CMD18 read
+					set_response_r1();
+					break;
+				}
+				case CMD17:
+				case CMD18: {
+					// READ_SINGLE_BLOCK, READ_MULTIPLE_BLOCK: CMD18 keeps sending consecutive blocks until CMD12
+					lba = (rxbuf[1] << 24) | (rxbuf[2] << 16) | (rxbuf[3] << 8) | rxbuf[4];
+					set_response_read_block(true);
+					reading_multiple = rxbuf[0] == CMD18;
 					break;
 				}
 
-				case CMD24: {
-					// WRITE_BLOCK
+				case CMD24:
+				case CMD25: {
+					// WRITE_BLOCK, WRITE_MULTIPLE_BLOCK: CMD25 accepts consecutive blocks until the stop token
 					lba = (rxbuf[1] << 24) | (rxbuf[2] << 16) | (rxbuf[3] << 8) | rxbuf[4];
 					set_response_r1();
+					writing_multiple = rxbuf[0] == CMD25;
 					break;
 				}
 
@@ -327,21 +358,170 @@ uint8_t sdcard_handle(uint8_t inbyte)
 			printf("\n");
 #endif
 
+		} else if (rxbuf_idx == 1 && rxbuf[0] == 0xFD && writing_multiple) {
+			// 'Stop tran' token ends a CMD25 write
+			rxbuf_idx        = 0;
+			writing_multiple = false;
 		} else if (rxbuf_idx == 515) {
 			rxbuf_idx = 0;
-			// Check for 'start block' byte
-			if (last_cmd == CMD24 && rxbuf[0] == 0xFE) {
+			// Check for 'start block' byte, CMD25 uses its own token
+			if ((last_cmd == CMD24 && rxbuf[0] == 0xFE) || (writing_multiple && rxbuf[0] == 0xFC)) {
 #ifdef VERBOSE
 				printf("*** SD Writing LBA %d\n", lba);
 #endif
-				auto sdcard_pos = lba * 512;
-				if (sdcard_size - sdcard_pos < 512) {
+				if (!sdcard_image_write(lba, rxbuf + 1)) {
 					printf("Warning: short write!\n");
 				}
-
-				memcpy(sdcard_changes[lba], rxbuf + 1, std::min((size_t)512, sdcard_size - sdcard_pos));
+				if (writing_multiple) {
+					++lba;
+				}
+				set_response_data_accepted();
+				response_counter = 0;
 			}
 		}
 	}
 	return outbyte;
 }
+
+// Where a response that was being sent when a snapshot was taken is restored to.
+static uint8_t restored_response[1 + 1 + 512 + 2];
+
+void sdcard_save_state(snapshot_writer &w)
+{
+	w.write(rxbuf);
+	w.write(rxbuf_idx);
+	w.write(lba);
+	w.write(last_cmd);
+	w.write(is_acmd);
+	w.write(is_idle);
+	w.write(is_initialized);
+	w.write(reading_multiple);
+	w.write(writing_multiple);
+	w.write(selected);
+
+	// Only the part of the response that hasn't been sent yet matters.
+	const int32_t response_left = response ? response_length - response_counter : 0;
+	w.write(response_left);
+	w.write_bytes(response ? response + response_counter : nullptr, response_left);
+
+	// The card keeps its own contents on disk, so only the sectors that differ from the image are saved.
+	const bool attached = sdcard_is_attached();
+	w.write(attached);
+	if (!attached) {
+		return;
+	}
+
+	// The sectors are in the order they were first written, so each one stays where it was in
+	// earlier captures, and only the ones written since then have to be compared.
+	const std::vector<uint32_t> &lbas    = sdcard_image_changed_sectors();
+	uint8_t                     *written = sdcard_image_changed_flags();
+	w.write((uint64_t)sdcard_image_size());
+	w.write((uint32_t)lbas.size());
+	w.write_bytes(lbas.data(), lbas.size() * sizeof(uint32_t));
+	for (size_t i = 0; i < lbas.size(); ++i) {
+		const uint8_t *sector = sdcard_image_sector(lbas[i]);
+		if (sector != nullptr) {
+			w.write_tracked(sector, 512, written + i, 512);
+		} else {
+			uint8_t partial[512];
+			sdcard_image_read(lbas[i], partial);
+			w.write(partial);
+		}
+	}
+	w.clear_dirty(written, lbas.size());
+}
+
+bool sdcard_check_state(snapshot_reader &r)
+{
+	int     saved_rxbuf_idx = 0;
+	int32_t response_left   = 0;
+	r.skip(sizeof(rxbuf));
+	r.read(saved_rxbuf_idx);
+	r.skip(sizeof(lba) + sizeof(last_cmd) + sizeof(is_acmd) + sizeof(is_idle) + sizeof(is_initialized) + sizeof(reading_multiple) + sizeof(writing_multiple) + sizeof(selected));
+	if (!r.read(response_left) || response_left < 0 || response_left > (int32_t)sizeof(restored_response) || saved_rxbuf_idx < 0 || saved_rxbuf_idx >= (int)sizeof(rxbuf)) {
+		return false;
+	}
+	r.skip(response_left);
+
+	bool attached = false;
+	if (!r.read(attached) || !attached) {
+		return r.ok();
+	}
+
+	uint32_t num_sectors = 0;
+	r.skip(sizeof(uint64_t));
+	r.read(num_sectors);
+	return r.ok() && num_sectors <= r.remaining() / (sizeof(uint32_t) + 512) && r.skip((size_t)num_sectors * (sizeof(uint32_t) + 512));
+}
+
+bool sdcard_load_state(snapshot_reader &r)
+{
+	r.read(rxbuf);
+	r.read(rxbuf_idx);
+	r.read(lba);
+	r.read(last_cmd);
+	r.read(is_acmd);
+	r.read(is_idle);
+	r.read(is_initialized);
+	r.read(reading_multiple);
+	r.read(writing_multiple);
+	r.read(selected);
+
+	int32_t response_left = 0;
+	if (!r.read(response_left) || response_left < 0 || response_left > (int32_t)sizeof(restored_response) || rxbuf_idx < 0 || rxbuf_idx >= (int)sizeof(rxbuf)) {
+		return false;
+	}
+	r.read_bytes(restored_response, response_left);
+	response         = response_left > 0 ? restored_response : NULL;
+	response_length  = response_left;
+	response_counter = 0;
+
+	bool attached = false;
+	if (!r.read(attached)) {
+		return false;
+	}
+	if (!attached) {
+		return r.ok();
+	}
+
+	uint64_t size        = 0;
+	uint32_t num_sectors = 0;
+	r.read(size);
+	r.read(num_sectors);
+	if (!r.ok() || num_sectors > r.remaining() / (sizeof(uint32_t) + 512)) {
+		return false;
+	}
+
+	std::vector<uint32_t>                 lbas(num_sectors);
+	std::vector<std::array<uint8_t, 512>> sectors(num_sectors);
+	r.read_bytes(lbas.data(), lbas.size() * sizeof(uint32_t));
+	r.read_bytes(sectors.data(), sectors.size() * sizeof(sectors[0]));
+	if (!r.ok()) {
+		return false;
+	}
+
+	if (!sdcard_is_attached() || sdcard_image_size() != size) {
+		printf("Warning: SD card in the snapshot doesn't match the attached one, its contents are left as they are.\n");
+		return true;
+	}
+
+	// Sectors written since the snapshot go back to their contents in the image, the rest get their saved contents.
+	std::vector<uint32_t> changed = sdcard_image_changed_sectors();
+	std::vector<uint32_t> kept    = lbas;
+	std::vector<uint32_t> reverted;
+	std::sort(changed.begin(), changed.end());
+	std::sort(kept.begin(), kept.end());
+	std::set_difference(changed.begin(), changed.end(), kept.begin(), kept.end(), std::back_inserter(reverted));
+	if (!sdcard_image_revert(reverted)) {
+		printf("Warning: Cannot read SD card image %s, the card may not match the snapshot.\n", sdcard_path);
+	}
+
+	uint8_t sector[512];
+	for (uint32_t i = 0; i < num_sectors; ++i) {
+		sdcard_image_read(lbas[i], sector);
+		if (memcmp(sector, sectors[i].data(), sizeof(sector)) != 0) {
+			sdcard_image_write(lbas[i], sectors[i].data());
+		}
+	}
+	return true;
+}
@@ -4,13 +4,26 @@
 #ifndef SD_CARD_H
 #define SD_CARD_H
 
+#include <stdint.h>
+
+class snapshot_reader;
+class snapshot_writer;
+
 void sdcard_shutdown();
-void sdcard_set_file(char const *path);
+// Writes to the card are kept in overlay_path, or next to the image if there is none.
+void sdcard_set_file(char const *path, char const *overlay_path = nullptr);
 void sdcard_attach();
 void sdcard_detach();
 bool sdcard_is_attached();
+bool sdcard_has_changes();
+bool sdcard_merge_changes();
 
 void    sdcard_select(bool select);
 uint8_t sdcard_handle(uint8_t inbyte);
 
+// The card itself isn't attached or detached by loading a snapshot, only its contents are restored.
+void sdcard_save_state(snapshot_writer &w);
+bool sdcard_check_state(snapshot_reader &r);
+bool sdcard_load_state(snapshot_reader &r);
+
 #endif
@@ -0,0 +1,625 @@
+// Commander X16 Emulator
+// Copyright (c) 2023 Stephen Horn, et al.
+// All rights reserved. License: 2-clause BSD
+
+#include "sdcard_image.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#if defined(_MSC_VER)
+#	include <io.h>
+#	include <windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+#include "files.h"
+
+// The overlay file starts with this header, followed by fixed-size records of one sector each.
+// A sector keeps its record once it has one, so rewriting a sector does not grow the file.
+struct overlay_header {
+	char     magic[8];
+	uint32_t version;
+	uint32_t sector_size;
+	uint64_t image_size;
+};
+
+struct overlay_record {
+	uint32_t lba;
+	uint8_t  data[512];
+};
+
+static const char     overlay_magic[8] = { 'B', '1', '6', 'S', 'D', 'O', 'V', 'L' };
+static const uint32_t overlay_version  = 1;
+
+static char     image_path[PATH_MAX]   = "";
+static char     overlay_path[PATH_MAX] = "";
+static bool     image_open             = false;
+static uint8_t *image_data           = nullptr;
+static size_t   image_size           = 0;
+
+// Decompressed copy of a gzip image, kept open for as long as it is mapped.
+static FILE *image_temp = nullptr;
+
+#if defined(_MSC_VER)
+static HANDLE image_mapping = NULL;
+#endif
+
+struct overlay_sector {
+	uint32_t slot;  // Record index in the overlay file
+	uint32_t index; // Index in overlay_lbas
+};
+
+static std::unordered_map<uint32_t, overlay_sector> overlay_slots;
+static uint32_t                                     overlay_num_records = 0;
+static FILE                                        *overlay_file        = nullptr;
+static bool                                         overlay_failed      = false;
+
+// The sectors in overlay_slots in the order they were first written, for snapshots, each with a
+// flag that's set whenever the sector is written.
+static std::vector<uint32_t> overlay_lbas;
+static std::vector<uint8_t>  overlay_written;
+
+// Records are written to the overlay file by a background thread, so emulation never waits on the disk.
+struct overlay_write {
+	uint32_t       slot;
+	overlay_record record;
+};
+
+static std::vector<overlay_write> overlay_pending;
+static std::mutex                 overlay_mutex;
+static std::condition_variable    overlay_cond;
+static std::thread                overlay_thread;
+static bool                       overlay_thread_quit = false;
+static bool                       overlay_error       = false;
+
+static bool is_gzip_file(char const *path)
+{
+	FILE *f = fopen(path, "rb");
+	if (f == nullptr) {
+		return false;
+	}
+
+	uint8_t magic[2] = { 0, 0 };
+	const size_t read = fread(magic, 1, 2, f);
+	fclose(f);
+
+	return read == 2 && magic[0] == 0x1f && magic[1] == 0x8b;
+}
+
+static int seek64(FILE *f, size_t offset)
+{
+#if defined(_MSC_VER)
+	return _fseeki64(f, (__int64)offset, SEEK_SET);
+#else
+	return fseeko(f, (off_t)offset, SEEK_SET);
+#endif
+}
+
+#if defined(_MSC_VER)
+static bool map_handle(HANDLE file)
+{
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size)) {
+		return false;
+	}
+
+	image_size = (size_t)size.QuadPart;
+	if (image_size == 0) {
+		return true;
+	}
+
+	image_mapping = CreateFileMapping(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+	if (image_mapping == NULL) {
+		return false;
+	}
+
+	image_data = (uint8_t *)MapViewOfFile(image_mapping, FILE_MAP_COPY, 0, 0, 0);
+	if (image_data == nullptr) {
+		CloseHandle(image_mapping);
+		image_mapping = NULL;
+		return false;
+	}
+	return true;
+}
+
+static bool map_path(char const *path)
+{
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	// The mapping keeps its own reference to the file.
+	const bool mapped = map_handle(file);
+	CloseHandle(file);
+	return mapped;
+}
+
+static bool map_temp(FILE *f)
+{
+	return map_handle((HANDLE)_get_osfhandle(_fileno(f)));
+}
+
+static void unmap()
+{
+	if (image_data != nullptr) {
+		UnmapViewOfFile(image_data);
+		image_data = nullptr;
+	}
+	if (image_mapping != NULL) {
+		CloseHandle(image_mapping);
+		image_mapping = NULL;
+	}
+}
+#else
+static bool map_fd(int fd)
+{
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		return false;
+	}
+
+	image_size = (size_t)st.st_size;
+	if (image_size == 0) {
+		return true;
+	}
+
+	void *data = mmap(nullptr, image_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	if (data == MAP_FAILED) {
+		return false;
+	}
+
+	image_data = (uint8_t *)data;
+	return true;
+}
+
+static bool map_path(char const *path)
+{
+	const int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+
+	// The mapping keeps its own reference to the file.
+	const bool mapped = map_fd(fd);
+	close(fd);
+	return mapped;
+}
+
+static bool map_temp(FILE *f)
+{
+	return map_fd(fileno(f));
+}
+
+static void unmap()
+{
+	if (image_data != nullptr) {
+		munmap(image_data, image_size);
+		image_data = nullptr;
+	}
+}
+#endif
+
+static bool decompress_to_temp(char const *path)
+{
+	gzFile f = gzopen(path, "rb");
+	if (f == Z_NULL) {
+		return false;
+	}
+
+	image_temp = tmpfile();
+	if (image_temp == nullptr) {
+		printf("Cannot create temporary file to decompress SD card image.\n");
+		gzclose(f);
+		return false;
+	}
+
+	static uint8_t buffer[64 * 1024];
+
+	int read = gzread(f, buffer, sizeof(buffer));
+	while (read > 0) {
+		if (fwrite(buffer, 1, read, image_temp) != (size_t)read) {
+			printf("Cannot write temporary file to decompress SD card image.\n");
+			gzclose(f);
+			return false;
+		}
+		read = gzread(f, buffer, sizeof(buffer));
+	}
+	gzclose(f);
+
+	return fflush(image_temp) == 0;
+}
+
+static void overlay_writer()
+{
+	std::vector<overlay_write>   writes;
+	std::unique_lock<std::mutex> lock(overlay_mutex);
+	while (true) {
+		overlay_cond.wait(lock, [] { return overlay_thread_quit || !overlay_pending.empty(); });
+		if (overlay_pending.empty()) {
+			break;
+		}
+		writes.swap(overlay_pending);
+		lock.unlock();
+
+		bool ok = true;
+		for (const overlay_write &w : writes) {
+			const size_t pos = sizeof(overlay_header) + (size_t)w.slot * sizeof(overlay_record);
+			ok               = ok && seek64(overlay_file, pos) == 0 && fwrite(&w.record, sizeof(w.record), 1, overlay_file) == 1;
+		}
+		ok = fflush(overlay_file) == 0 && ok;
+		writes.clear();
+
+		lock.lock();
+		if (!ok) {
+			overlay_error = true;
+		}
+	}
+}
+
+// Waits for all pending records to reach the overlay file.
+static void stop_overlay_writer()
+{
+	if (!overlay_thread.joinable()) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(overlay_mutex);
+		overlay_thread_quit = true;
+	}
+	overlay_cond.notify_one();
+	overlay_thread.join();
+	overlay_thread_quit = false;
+
+	if (overlay_error) {
+		printf("Cannot write SD card overlay %s!\n", overlay_path);
+		overlay_error = false;
+	}
+}
+
+static void close_overlay()
+{
+	stop_overlay_writer();
+	if (overlay_file != nullptr) {
+		fclose(overlay_file);
+		overlay_file = nullptr;
+	}
+	overlay_slots.clear();
+	overlay_num_records = 0;
+	overlay_lbas.clear();
+	overlay_written.clear();
+}
+
+// Applies the records of an existing overlay file to the mapped image.
+static bool load_overlay()
+{
+	overlay_file = fopen(overlay_path, "r+b");
+	if (overlay_file == nullptr) {
+		// No overlay yet, it is created on the first write.
+		return true;
+	}
+
+	overlay_header header;
+	if (fread(&header, sizeof(header), 1, overlay_file) != 1 || memcmp(header.magic, overlay_magic, sizeof(overlay_magic)) != 0 || header.version != overlay_version || header.sector_size != 512) {
+		printf("SD card overlay %s is not a valid overlay file!\n", overlay_path);
+		return false;
+	}
+	if (header.image_size != image_size) {
+		printf("SD card overlay %s does not belong to this image!\n", overlay_path);
+		return false;
+	}
+
+	// A record cut short by a crash is ignored, and later overwritten.
+	overlay_record record;
+	for (; fread(&record, sizeof(record), 1, overlay_file) == 1; ++overlay_num_records) {
+		const size_t pos = (size_t)record.lba << 9;
+		if (pos >= image_size) {
+			continue;
+		}
+		memcpy(image_data + pos, record.data, std::min((size_t)512, image_size - pos));
+		const auto [sector, added] = overlay_slots.try_emplace(record.lba, overlay_sector{ overlay_num_records, (uint32_t)overlay_lbas.size() });
+		if (added) {
+			overlay_lbas.push_back(record.lba);
+			overlay_written.push_back(1);
+		} else {
+			sector->second.slot = overlay_num_records;
+		}
+	}
+	return true;
+}
+
+static bool create_overlay()
+{
+	overlay_file = fopen(overlay_path, "w+b");
+	if (overlay_file == nullptr) {
+		return false;
+	}
+
+	overlay_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, overlay_magic, sizeof(overlay_magic));
+	header.version     = overlay_version;
+	header.sector_size = 512;
+	header.image_size  = image_size;
+
+	if (fwrite(&header, sizeof(header), 1, overlay_file) != 1 || fflush(overlay_file) != 0) {
+		fclose(overlay_file);
+		overlay_file = nullptr;
+		return false;
+	}
+	return true;
+}
+
+// Writes the overlay sectors into an uncompressed copy of the image.
+static bool write_overlay_sectors(FILE *f)
+{
+	bool ok = true;
+	for (const uint32_t lba : overlay_lbas) {
+		const size_t pos    = (size_t)lba << 9;
+		const size_t length = std::min((size_t)512, image_size - pos);
+		ok                  = ok && seek64(f, pos) == 0 && fwrite(image_data + pos, 1, length, f) == length;
+	}
+	return fflush(f) == 0 && ok;
+}
+
+// Writes the overlay sectors back into the original file.
+static bool merge_in_place()
+{
+	FILE *f = fopen(image_path, "r+b");
+	if (f == nullptr) {
+		return false;
+	}
+
+	const bool ok = write_overlay_sectors(f);
+	return fclose(f) == 0 && ok;
+}
+
+// Recompresses the whole image through a temporary file next to it, which then replaces the original.
+// The decompressed copy gets the overlay sectors too, so that it still matches the image.
+static bool merge_rewrite()
+{
+	const std::string temp_file_path = std::string(image_path) + ".tmp";
+
+	gzFile f = gzopen(temp_file_path.c_str(), "wb9");
+	if (f == Z_NULL) {
+		return false;
+	}
+
+	bool ok = true;
+	for (size_t pos = 0; pos < image_size && ok; pos += 64 * 1024) {
+		const unsigned length = (unsigned)std::min((size_t)64 * 1024, image_size - pos);
+		ok                    = gzwrite(f, image_data + pos, length) == (int)length;
+	}
+	ok = gzclose(f) == Z_OK && ok;
+
+	std::error_code ec;
+	if (ok) {
+		std::filesystem::rename(temp_file_path, image_path, ec);
+		ok = !ec;
+	}
+	if (!ok) {
+		std::filesystem::remove(temp_file_path, ec);
+	}
+	return ok && write_overlay_sectors(image_temp);
+}
+
+bool sdcard_image_open(char const *path, char const *overlay)
+{
+	if (image_open) {
+		sdcard_image_close();
+	}
+
+	strncpy(image_path, path, PATH_MAX);
+	image_path[PATH_MAX - 1] = '\0';
+
+	strncpy(overlay_path, overlay, PATH_MAX);
+	overlay_path[PATH_MAX - 1] = '\0';
+	overlay_failed             = false;
+
+	bool mapped = false;
+	if (is_gzip_file(image_path)) {
+		mapped = decompress_to_temp(image_path) && map_temp(image_temp);
+	} else {
+		mapped = map_path(image_path);
+	}
+
+	if (!mapped || !load_overlay()) {
+		close_overlay();
+		unmap();
+		if (image_temp != nullptr) {
+			fclose(image_temp);
+			image_temp = nullptr;
+		}
+		image_size = 0;
+		return false;
+	}
+
+	image_open = true;
+	return true;
+}
+
+void sdcard_image_close()
+{
+	if (!image_open) {
+		return;
+	}
+
+	close_overlay();
+	unmap();
+	if (image_temp != nullptr) {
+		fclose(image_temp);
+		image_temp = nullptr;
+	}
+
+	image_size = 0;
+	image_open = false;
+}
+
+bool sdcard_image_merge()
+{
+	if (!image_open || overlay_slots.empty()) {
+		return true;
+	}
+
+	stop_overlay_writer();
+
+	// Whether the image is compressed was decided by its contents when it was opened, not its name.
+	bool merged = false;
+	if (image_temp == nullptr) {
+		merged = merge_in_place();
+	} else {
+		merged = merge_rewrite();
+	}
+	if (!merged) {
+		printf("Cannot merge SD card overlay into %s!\n", image_path);
+		return false;
+	}
+
+	close_overlay();
+	std::error_code ec;
+	std::filesystem::remove(overlay_path, ec);
+	return true;
+}
+
+bool sdcard_image_has_changes()
+{
+	return !overlay_slots.empty();
+}
+
+bool sdcard_image_is_open()
+{
+	return image_open;
+}
+
+size_t sdcard_image_size()
+{
+	return image_size;
+}
+
+const std::vector<uint32_t> &sdcard_image_changed_sectors()
+{
+	return overlay_lbas;
+}
+
+uint8_t *sdcard_image_changed_flags()
+{
+	return overlay_written.data();
+}
+
+const uint8_t *sdcard_image_sector(uint32_t lba)
+{
+	const size_t pos = (size_t)lba << 9;
+	if (pos >= image_size || image_size - pos < 512) {
+		return nullptr;
+	}
+	return image_data + pos;
+}
+
+bool sdcard_image_revert(const std::vector<uint32_t> &lbas)
+{
+	if (!image_open || lbas.empty()) {
+		return true;
+	}
+
+	// The mapping is copy-on-write, so the file behind it still has the sectors as they were last merged.
+	FILE *f = image_temp;
+	if (f == nullptr) {
+		f = fopen(image_path, "rb");
+		if (f == nullptr) {
+			return false;
+		}
+	}
+
+	bool    ok = true;
+	uint8_t sector[512];
+	for (const uint32_t lba : lbas) {
+		const size_t pos = (size_t)lba << 9;
+		if (pos >= image_size) {
+			continue;
+		}
+		const size_t length = std::min((size_t)512, image_size - pos);
+		memset(sector, 0, sizeof(sector));
+		ok = ok && seek64(f, pos) == 0 && fread(sector, 1, length, f) == length;
+		if (ok) {
+			sdcard_image_write(lba, sector);
+		}
+	}
+
+	if (f != image_temp) {
+		fclose(f);
+	}
+	return ok;
+}
+
+bool sdcard_image_read(uint32_t lba, uint8_t *dst)
+{
+	const size_t pos = (size_t)lba << 9;
+	if (pos >= image_size) {
+		memset(dst, 0, 512);
+		return false;
+	}
+
+	const size_t length = std::min((size_t)512, image_size - pos);
+	memcpy(dst, image_data + pos, length);
+	memset(dst + length, 0, 512 - length);
+	return length == 512;
+}
+
+bool sdcard_image_write(uint32_t lba, uint8_t const *src)
+{
+	const size_t pos = (size_t)lba << 9;
+	if (pos >= image_size) {
+		return false;
+	}
+
+	const size_t length = std::min((size_t)512, image_size - pos);
+	memcpy(image_data + pos, src, length);
+
+	if (overlay_file == nullptr) {
+		if (overlay_failed) {
+			return length == 512;
+		}
+		if (!create_overlay()) {
+			printf("Cannot create SD card overlay %s, changes will not be kept!\n", overlay_path);
+			overlay_failed = true;
+			return length == 512;
+		}
+	}
+
+	const auto [sector, added] = overlay_slots.try_emplace(lba, overlay_sector{ overlay_num_records, (uint32_t)overlay_lbas.size() });
+	if (added) {
+		++overlay_num_records;
+		overlay_lbas.push_back(lba);
+		overlay_written.push_back(1);
+	} else {
+		overlay_written[sector->second.index] = 1;
+	}
+
+	overlay_write w;
+	w.slot       = sector->second.slot;
+	w.record.lba = lba;
+	memcpy(w.record.data, src, 512);
+	{
+		std::lock_guard<std::mutex> lock(overlay_mutex);
+		overlay_pending.push_back(w);
+	}
+	if (overlay_thread.joinable()) {
+		overlay_cond.notify_one();
+	} else {
+		overlay_thread = std::thread(overlay_writer);
+	}
+	return length == 512;
+}
@@ -0,0 +1,38 @@
+// Commander X16 Emulator
+// Copyright (c) 2023 Stephen Horn, et al.
+// All rights reserved. License: 2-clause BSD
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Sector access to an SD card image. Raw images are mapped into memory, compressed images are
+// decompressed once into a temporary file which is then mapped, so every sector access is a copy.
+// The image itself is never written: written sectors go to a sparse overlay file, which is applied
+// again the next time the image is opened, until it is merged back into the image.
+
+bool sdcard_image_open(char const *path, char const *overlay_path);
+void sdcard_image_close();
+bool sdcard_image_is_open();
+
+// Writes the overlay sectors into the image and deletes the overlay file.
+bool sdcard_image_merge();
+bool sdcard_image_has_changes();
+
+// Both return false if the sector is not entirely inside the image. Reads past the end are zero-filled,
+// writes past the end are dropped.
+bool sdcard_image_read(uint32_t lba, uint8_t *dst);
+bool sdcard_image_write(uint32_t lba, uint8_t const *src);
+
+// For snapshots, which have to put the card back the way it was: the sectors in the overlay, in the
+// order they were first written so that the list only grows at the end, with a flag for each that's
+// set (to 1) whenever it's written, and a way to write sectors back with their contents from the image file.
+size_t                       sdcard_image_size();
+const std::vector<uint32_t> &sdcard_image_changed_sectors();
+uint8_t                     *sdcard_image_changed_flags();
+bool                         sdcard_image_revert(const std::vector<uint32_t> &lbas);
+
+// The sector as it is now, or nullptr if it's not entirely inside the image.
+const uint8_t *sdcard_image_sector(uint32_t lba);
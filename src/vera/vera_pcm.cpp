@@ -6,6 +6,8 @@
 #include <stdio.h>
 
 #include "audio.h"
+#include "ring_buffer.h"
+#include "snapshot.h"
 
 static uint8_t  fifo[4096 - 1]; // Actual hardware FIFO is 4kB, but you can only use 4095 bytes.
 static unsigned fifo_wridx;
@@ -23,6 +25,18 @@ static uint8_t phase;
 static unsigned dbg_minsiz;
 static unsigned dbg_maxsiz;
 
+// Samples are produced by pcm_step as the emulated clock reaches them, so the FIFO drains (and
+// AFLOW changes) at the right time, and wait here until pcm_render mixes them into a buffer.
+// When a buffer is needed before the clock has produced it, pcm_render makes the missing samples
+// early and the same number is skipped by later steps.
+struct pcm_sample {
+	int16_t left;
+	int16_t right;
+};
+
+static ring_buffer<pcm_sample, 4096> sample_queue;
+static unsigned                      samples_ahead;
+
 static void fifo_reset(void)
 {
 	fifo_wridx = 0;
@@ -40,6 +54,9 @@ void pcm_reset(void)
 	cur_l = 0;
 	cur_r = 0;
 	phase = 0;
+
+	sample_queue.clear();
+	samples_ahead = 0;
 }
 
 void pcm_write_ctrl(uint8_t val)
@@ -108,42 +125,155 @@ bool pcm_is_fifo_almost_empty(void)
 	return fifo_cnt < 1024;
 }
 
+static pcm_sample render_sample(void)
+{
+	uint8_t old_phase = phase;
+	phase += rate;
+	if ((old_phase & 0x80) != (phase & 0x80)) {
+		switch ((ctrl >> 4) & 3) {
+			case 0: { // mono 8-bit
+				cur_l = (int16_t)read_fifo() << 8;
+				cur_r = cur_l;
+				break;
+			}
+			case 1: { // stereo 8-bit
+				cur_l = read_fifo() << 8;
+				cur_r = read_fifo() << 8;
+				break;
+			}
+			case 2: { // mono 16-bit
+				cur_l = read_fifo();
+				cur_l |= read_fifo() << 8;
+				cur_r = cur_l;
+				break;
+			}
+			case 3: { // stereo 16-bit
+				cur_l = read_fifo();
+				cur_l |= read_fifo() << 8;
+				cur_r = read_fifo();
+				cur_r |= read_fifo() << 8;
+				break;
+			}
+		}
+	}
+
+	const int16_t left  = ((int)cur_l * (int)volume_lut[ctrl & 0xF]) >> 6;
+	const int16_t right = ((int)cur_r * (int)volume_lut[ctrl & 0xF]) >> 6;
+	return { left, right };
+}
+
+void pcm_step(unsigned num_samples)
+{
+	const unsigned skipped = num_samples < samples_ahead ? num_samples : samples_ahead;
+	samples_ahead -= skipped;
+	num_samples -= skipped;
+
+	while (num_samples--) {
+		sample_queue.add(render_sample());
+	}
+}
+
 void pcm_render(int16_t *buf, unsigned num_samples)
 {
 	while (num_samples--) {
-		uint8_t old_phase = phase;
-		phase += rate;
-		if ((old_phase & 0x80) != (phase & 0x80)) {
-			switch ((ctrl >> 4) & 3) {
-				case 0: { // mono 8-bit
-					cur_l = (int16_t)read_fifo() << 8;
-					cur_r = cur_l;
-					break;
-				}
-				case 1: { // stereo 8-bit
-					cur_l = read_fifo() << 8;
-					cur_r = read_fifo() << 8;
-					break;
-				}
-				case 2: { // mono 16-bit
-					cur_l = read_fifo();
-					cur_l |= read_fifo() << 8;
-					cur_r = cur_l;
-					break;
-				}
-				case 3: { // stereo 16-bit
-					cur_l = read_fifo();
-					cur_l |= read_fifo() << 8;
-					cur_r = read_fifo();
-					cur_r |= read_fifo() << 8;
-					break;
-				}
-			}
+		pcm_sample sample;
+		if (sample_queue.count() > 0) {
+			sample = sample_queue.pop_oldest();
+		} else {
+			sample = render_sample();
+			++samples_ahead;
 		}
+		*(buf++) = sample.left;
+		*(buf++) = sample.right;
+	}
+}
 
-		*(buf++) = ((int)cur_l * (int)volume_lut[ctrl & 0xF]) >> 6;
-		*(buf++) = ((int)cur_r * (int)volume_lut[ctrl & 0xF]) >> 6;
+uint32_t pcm_samples_until_almost_empty(void)
+{
+	if (fifo_cnt < 1024 || rate == 0) {
+		return UINT32_MAX;
+	}
+
+	static const unsigned frame_bytes[4] = { 1, 2, 2, 4 };
+
+	const unsigned bytes  = frame_bytes[(ctrl >> 4) & 3];
+	const unsigned frames = (fifo_cnt - 1024 + bytes) / bytes;
+	if (rate > 128) {
+		// Each sample reads at most one frame from the FIFO.
+		return samples_ahead + frames;
+	}
+
+	// A frame is read each time phase crosses a multiple of 128.
+	const unsigned distance = 128 * frames - (phase & 0x7f);
+	return samples_ahead + (distance + rate - 1) / rate;
+}
+
+void pcm_save_state(snapshot_writer &w)
+{
+	w.write(fifo);
+	w.write(fifo_wridx);
+	w.write(fifo_rdidx);
+	w.write(fifo_cnt);
+	w.write(ctrl);
+	w.write(rate);
+	w.write(cur_l);
+	w.write(cur_r);
+	w.write(phase);
+	w.write(samples_ahead);
+
+	const uint32_t queued = (uint32_t)sample_queue.count();
+	w.write(queued);
+	sample_queue.for_each([&](const pcm_sample &sample) {
+		w.write(sample);
+	});
+}
+
+bool pcm_check_state(snapshot_reader &r)
+{
+	decltype(fifo_wridx) wridx  = 0;
+	decltype(fifo_rdidx) rdidx  = 0;
+	decltype(fifo_cnt)   cnt    = 0;
+	uint32_t             queued = 0;
+	r.skip(sizeof(fifo));
+	r.read(wridx);
+	r.read(rdidx);
+	r.read(cnt);
+	r.skip(sizeof(ctrl) + sizeof(rate) + sizeof(cur_l) + sizeof(cur_r) + sizeof(phase) + sizeof(samples_ahead));
+	r.read(queued);
+	if (!r.ok() || queued > 4096 || wridx >= sizeof(fifo) || rdidx >= sizeof(fifo) || cnt > sizeof(fifo)) {
+		return false;
 	}
+	return r.skip(queued * sizeof(pcm_sample));
+}
+
+bool pcm_load_state(snapshot_reader &r)
+{
+	r.read(fifo);
+	r.read(fifo_wridx);
+	r.read(fifo_rdidx);
+	r.read(fifo_cnt);
+	r.read(ctrl);
+	r.read(rate);
+	r.read(cur_l);
+	r.read(cur_r);
+	r.read(phase);
+	r.read(samples_ahead);
+
+	uint32_t queued = 0;
+	r.read(queued);
+	if (!r.ok() || queued > 4096 || fifo_wridx >= sizeof(fifo) || fifo_rdidx >= sizeof(fifo) || fifo_cnt > sizeof(fifo)) {
+		return false;
+	}
+	sample_queue.clear();
+	for (uint32_t i = 0; i < queued; ++i) {
+		pcm_sample sample;
+		r.read(sample);
+		sample_queue.add(sample);
+	}
+
+	dbg_minsiz = fifo_cnt;
+	dbg_maxsiz = fifo_cnt;
+	return r.ok();
 }
 
 pcm_debug_info pcm_get_debug_info(void)
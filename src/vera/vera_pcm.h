@@ -7,6 +7,9 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+class snapshot_reader;
+class snapshot_writer;
+
 struct pcm_debug_info {
 	uint8_t *fifo;
 	unsigned curidx;
@@ -21,7 +24,13 @@ uint8_t        pcm_read_ctrl(void);
 void           pcm_write_rate(uint8_t val);
 uint8_t        pcm_read_rate(void);
 void           pcm_write_fifo(uint8_t val);
+void           pcm_step(unsigned num_samples);
 void           pcm_render(int16_t *buf, unsigned num_samples);
+uint32_t       pcm_samples_until_almost_empty(void);
 bool           pcm_is_fifo_almost_empty(void);
 pcm_debug_info pcm_get_debug_info(void);
 void           pcm_reset_debug_values(void);
+
+void pcm_save_state(snapshot_writer &w);
+bool pcm_check_state(snapshot_reader &r);
+bool pcm_load_state(snapshot_reader &r);
@@ -9,42 +9,82 @@
 #include <string.h>
 
 #include "audio.h"
+#include "ring_buffer.h"
+#include "snapshot.h"
 
 static psg_channel Channels[PSG_NUM_CHANNELS];
 
+// Register writes from the CPU wait here, stamped with the sample of the next audio buffer they
+// happened in, so psg_render can apply each one at that sample instead of at the buffer's start.
+struct psg_write {
+	int     sample;
+	uint8_t reg;
+	uint8_t val;
+};
+
+static ring_buffer<psg_write, 1024, false> Write_queue;
+
+// Noise comes from a xorshift generator rather than rand(), so that it's the same from one run to
+// the next and can be saved along with the channels.
+static uint32_t Noise_state = 1;
+
 static uint8_t volume_lut[64] = { 0, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 6, 6, 7, 7, 7, 8, 8, 9, 9, 10, 11, 11, 12, 13, 14, 14, 15, 16, 17, 18, 19, 21, 22, 23, 25, 26, 28, 29, 31, 33, 35, 37, 39, 42, 44, 47, 50, 52, 56, 59, 63 };
 
 void psg_reset(void)
 {
-	audio_lock_scope lock;
 	memset(Channels, 0, sizeof(Channels));
+	Write_queue.clear();
+	Noise_state = 1;
 }
 
-void psg_writereg(uint8_t reg, uint8_t val)
+static void apply_write(psg_channel *channels, uint8_t reg, uint8_t val)
 {
-	audio_lock_scope lock;
-	reg &= 0x3f;
-
 	int ch  = reg / 4;
 	int idx = reg & 3;
 
 	switch (idx) {
-		case 0: Channels[ch].freq = (Channels[ch].freq & 0xFF00) | val; break;
-		case 1: Channels[ch].freq = (Channels[ch].freq & 0x00FF) | (val << 8); break;
+		case 0: channels[ch].freq = (channels[ch].freq & 0xFF00) | val; break;
+		case 1: channels[ch].freq = (channels[ch].freq & 0x00FF) | (val << 8); break;
 		case 2: {
-			Channels[ch].right  = (val & 0x80) != 0;
-			Channels[ch].left   = (val & 0x40) != 0;
-			Channels[ch].volume = volume_lut[val & 0x3F];
+			channels[ch].right  = (val & 0x80) != 0;
+			channels[ch].left   = (val & 0x40) != 0;
+			channels[ch].volume = volume_lut[val & 0x3F];
 			break;
 		}
 		case 3: {
-			Channels[ch].pw       = val & 0x3F;
-			Channels[ch].waveform = val >> 6;
+			channels[ch].pw       = val & 0x3F;
+			channels[ch].waveform = val >> 6;
 			break;
 		}
 	}
 }
 
+void psg_writereg(uint8_t reg, uint8_t val)
+{
+	reg &= 0x3f;
+
+	const int sample = audio_get_render_position();
+	if (sample < 0) {
+		// Nothing is rendering, so there's no timeline to place the write on.
+		apply_write(Channels, reg, val);
+		return;
+	}
+
+	if (Write_queue.size_remaining() == 0) {
+		const psg_write &oldest = Write_queue.pop_oldest();
+		apply_write(Channels, oldest.reg, oldest.val);
+	}
+	Write_queue.add({ sample, reg, val });
+}
+
+static uint8_t next_noise()
+{
+	Noise_state ^= Noise_state << 13;
+	Noise_state ^= Noise_state >> 17;
+	Noise_state ^= Noise_state << 5;
+	return Noise_state & 63;
+}
+
 static void render(int16_t *left, int16_t *right)
 {
 	int l = 0;
@@ -55,7 +95,7 @@ static void render(int16_t *left, int16_t *right)
 
 		unsigned new_phase = (ch->phase + ch->freq) & 0x1FFFF;
 		if ((ch->phase & 0x10000) != (new_phase & 0x10000)) {
-			ch->noiseval = rand() & 63;
+			ch->noiseval = next_noise();
 		}
 		ch->phase = new_phase;
 
@@ -87,15 +127,24 @@ static void render(int16_t *left, int16_t *right)
 
 void psg_render(int16_t *buf, unsigned int num_samples)
 {
-	while (num_samples--) {
+	for (int sample = 0; sample < (int)num_samples; ++sample) {
+		while (Write_queue.count() > 0 && Write_queue.get_oldest().sample <= sample) {
+			const psg_write &write = Write_queue.pop_oldest();
+			apply_write(Channels, write.reg, write.val);
+		}
 		render(&buf[0], &buf[1]);
 		buf += 2;
 	}
+
+	// Only a render shorter than an audio buffer can leave writes behind, and they're due by now.
+	while (Write_queue.count() > 0) {
+		const psg_write &write = Write_queue.pop_oldest();
+		apply_write(Channels, write.reg, write.val);
+	}
 }
 
 const psg_channel *psg_get_channel(unsigned int channel)
 {
-	audio_lock_scope lock;
 	if (channel > PSG_NUM_CHANNELS) {
 		return nullptr;
 	}
@@ -105,7 +154,6 @@ const psg_channel *psg_get_channel(unsigned int channel)
 
 psg_channel *psg_get_channel_debug(unsigned int channel)
 {
-	audio_lock_scope lock;
 	if (channel >= PSG_NUM_CHANNELS) {
 		return nullptr;
 	}
@@ -115,7 +163,6 @@ psg_channel *psg_get_channel_debug(unsigned int channel)
 
 void psg_set_channel_frequency(unsigned int channel, uint16_t freq)
 {
-	audio_lock_scope lock;
 	if (channel < PSG_NUM_CHANNELS) {
 		Channels[channel].freq = freq;
 	}
@@ -123,7 +170,6 @@ void psg_set_channel_frequency(unsigned int channel, uint16_t freq)
 
 void psg_set_channel_left(unsigned int channel, bool left)
 {
-	audio_lock_scope lock;
 	if (channel < PSG_NUM_CHANNELS) {
 		Channels[channel].left = left;
 	}
@@ -131,7 +177,6 @@ void psg_set_channel_left(unsigned int channel, bool left)
 
 void psg_set_channel_right(unsigned int channel, bool right)
 {
-	audio_lock_scope lock;
 	if (channel < PSG_NUM_CHANNELS) {
 		Channels[channel].right = right;
 	}
@@ -139,7 +184,6 @@ void psg_set_channel_right(unsigned int channel, bool right)
 
 void psg_set_channel_volume(unsigned int channel, uint8_t volume)
 {
-	audio_lock_scope lock;
 	if (channel < PSG_NUM_CHANNELS) {
 		Channels[channel].volume = volume & 0x3f;
 	}
@@ -147,7 +191,6 @@ void psg_set_channel_volume(unsigned int channel, uint8_t volume)
 
 void psg_set_channel_waveform(unsigned int channel, uint8_t waveform)
 {
-	audio_lock_scope lock;
 	if (channel < PSG_NUM_CHANNELS) {
 		Channels[channel].waveform = waveform;
 	}
@@ -155,8 +198,34 @@ void psg_set_channel_waveform(unsigned int channel, uint8_t waveform)
 
 void psg_set_channel_pulse_width(unsigned int channel, uint8_t pw)
 {
-	audio_lock_scope lock;
 	if (channel < PSG_NUM_CHANNELS) {
 		Channels[channel].pw = pw & 0x3f;
 	}
 }
+
+// Writes still waiting for their sample are applied to the saved copy, since they'd be applied
+// by the end of the next render anyway.
+void psg_save_state(snapshot_writer &w)
+{
+	psg_channel channels[PSG_NUM_CHANNELS];
+	memcpy(channels, Channels, sizeof(Channels));
+	Write_queue.for_each([&](const psg_write &write) {
+		apply_write(channels, write.reg, write.val);
+	});
+	w.write(channels);
+	w.write(Noise_state);
+}
+
+bool psg_check_state(snapshot_reader &r)
+{
+	return r.skip(sizeof(Channels) + sizeof(Noise_state));
+}
+
+bool psg_load_state(snapshot_reader &r)
+{
+	if (!r.read(Channels) || !r.read(Noise_state)) {
+		return false;
+	}
+	Write_queue.clear();
+	return true;
+}
@@ -6,6 +6,9 @@
 
 #include <stdint.h>
 
+class snapshot_reader;
+class snapshot_writer;
+
 #define PSG_NUM_CHANNELS (16)
 
 enum waveform {
@@ -39,3 +42,7 @@ void psg_set_channel_right(unsigned int channel, bool right);
 void psg_set_channel_volume(unsigned int channel, uint8_t volume);
 void psg_set_channel_waveform(unsigned int channel, uint8_t waveform);
 void psg_set_channel_pulse_width(unsigned int channel, uint8_t pw);
+
+void psg_save_state(snapshot_writer &w);
+bool psg_check_state(snapshot_reader &r);
+bool psg_load_state(snapshot_reader &r);
@@ -9,6 +9,7 @@
 #include <stdio.h>
 
 #include "cpu/fake6502.h"
+#include "snapshot.h"
 
 bool    ss;
 bool    busy;
@@ -16,6 +17,8 @@ bool    autotx;
 uint8_t sending_byte, received_byte;
 int     outcounter;
 
+static uint64_t autostep_clocks = 0;
+
 void vera_spi_init()
 {
 	ss            = false;
@@ -26,9 +29,8 @@ void vera_spi_init()
 
 void vera_spi_autostep()
 {
-	static uint64_t clocks = 0;
-	vera_spi_step((int)(clockticks6502 - clocks));
-	clocks = clockticks6502;
+	vera_spi_step((int)(clockticks6502 - autostep_clocks));
+	autostep_clocks = clockticks6502;
 }
 
 void vera_spi_step(int clocks)
@@ -95,3 +97,31 @@ void vera_spi_write(uint8_t reg, uint8_t value)
 			break;
 	}
 }
+
+void vera_spi_save_state(snapshot_writer &w)
+{
+	w.write(ss);
+	w.write(busy);
+	w.write(autotx);
+	w.write(sending_byte);
+	w.write(received_byte);
+	w.write(outcounter);
+	w.write(autostep_clocks);
+}
+
+bool vera_spi_check_state(snapshot_reader &r)
+{
+	return r.skip(sizeof(ss) + sizeof(busy) + sizeof(autotx) + sizeof(sending_byte) + sizeof(received_byte) + sizeof(outcounter) + sizeof(autostep_clocks));
+}
+
+bool vera_spi_load_state(snapshot_reader &r)
+{
+	r.read(ss);
+	r.read(busy);
+	r.read(autotx);
+	r.read(sending_byte);
+	r.read(received_byte);
+	r.read(outcounter);
+	r.read(autostep_clocks);
+	return r.ok();
+}
@@ -4,8 +4,15 @@
 
 #include <inttypes.h>
 
+class snapshot_reader;
+class snapshot_writer;
+
 void    vera_spi_init();
 void    vera_spi_step(int clocks);
 uint8_t debug_vera_spi_read(uint8_t reg);
 uint8_t vera_spi_read(uint8_t address);
 void    vera_spi_write(uint8_t address, uint8_t value);
+
+void vera_spi_save_state(snapshot_writer &w);
+bool vera_spi_check_state(snapshot_reader &r);
+bool vera_spi_load_state(snapshot_reader &r);
@@ -9,9 +9,20 @@
 #include "vera_pcm.h"
 #include "vera_psg.h"
 #include "vera_spi.h"
+#include "vera_video_compose.h"
 
 #include <algorithm>
+#include <bit>
+#include <condition_variable>
+#include <deque>
 #include <limits.h>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "memory.h"
+#include "snapshot.h"
 
 #ifdef __EMSCRIPTEN__
 #	include "emscripten.h"
@@ -53,6 +64,7 @@
 static bool is_fullscreen = false;
 
 static uint8_t video_ram[0x20000];
+static uint8_t video_ram_dirty[sizeof(video_ram) >> 6]; // One flag per 64 bytes, for snapshot deltas
 static uint8_t palette[256 * 2];
 static uint8_t sprite_data[128][8];
 
@@ -71,13 +83,12 @@ static uint16_t irq_line;
 static uint8_t reg_layer[2][7];
 static uint8_t reg_composer[8];
 
-static uint8_t layer_line[2][SCREEN_WIDTH];
 static uint8_t sprite_line_col[SCREEN_WIDTH];
 static uint8_t sprite_line_z[SCREEN_WIDTH];
 static uint8_t sprite_line_mask[SCREEN_WIDTH];
 static uint8_t sprite_line_collisions;
-static bool    layer_line_enable[2];
 static bool    sprite_line_enable;
+static bool    sprite_line_dirty;
 
 static float    vga_scan_pos_x;
 static uint16_t vga_scan_pos_y;
@@ -85,19 +96,108 @@ static float    ntsc_half_cnt;
 static uint16_t ntsc_scan_pos_y;
 
 static int frame_count = 0;
-static int cheat_mask  = 0;
+
+// Frames that won't be presented skip producing pixels, see vera_video_set_skip_frame.
+static bool     skip_frame         = false;
+static bool     last_frame_skipped = false;
+static uint32_t skipped_frames     = 0;
+
+// Sprites that can collide with others: a collision mask and a z-depth.
+static int colliding_sprites = 0;
 
 static bool log_video              = false;
 static bool shadow_safety_frame[4] = { false, false, true, true };
 
 static uint8_t framebuffer[SCREEN_WIDTH * SCREEN_HEIGHT * 4];
 
+// The framebuffer as palette indices, and which palette each line was looked up with (or
+// Darkened_line), so it can be recorded without going back from colors to indices.
+static constexpr uint32_t Darkened_line = UINT32_MAX;
+
+static uint8_t  framebuffer_indices[SCREEN_WIDTH * SCREEN_HEIGHT];
+static uint32_t framebuffer_line_palettes[SCREEN_HEIGHT];
+
+struct video_palette_props {
+	uint32_t entries[256];
+	bool     dirty;
+};
+
+struct video_palette_props video_palette;
+
+//
+// Line rendering pipeline
+//
+// Sprites are rendered on the emulation thread, because their collisions feed ISR.
+// Everything else a line needs is copied into a job, and a render thread draws the
+// layers and composes the line into the framebuffer. The render thread keeps its own
+// copy of VRAM, updated from the log of VRAM writes made before each line, so it
+// always sees VRAM as it was when the line was scanned out.
+//
+
+struct render_vram_write {
+	uint32_t address;
+	uint8_t  value;
+};
+
+struct render_line_job {
+	uint16_t y;
+	bool     palette_changed;
+	bool     shadow_safety_frame[4];
+	uint8_t  reg_composer[8];
+	uint8_t  reg_layer[2][7];
+
+	vera_video_layer_properties layer_properties[2];
+
+	uint8_t  sprite_line_col[SCREEN_WIDTH];
+	uint8_t  sprite_line_z[SCREEN_WIDTH];
+	uint32_t palette[256];
+
+	std::vector<render_vram_write> vram_writes;
+};
+
+// Owned by the render thread
+static uint8_t  render_video_ram[0x20000];
+static uint32_t render_palette[256];
+static uint32_t render_palette_generation = 0;
+static uint8_t  layer_line[2][SCREEN_WIDTH];
+static bool     layer_line_enable[2];
+
+// Tile and text rows decoded to one color index per pixel, in both horizontal orders.
+// A row is 1 to 16 bytes aligned to its size, so it never straddles a 16-byte VRAM
+// block, and an entry is stale once the write generation of its block has moved on.
+#define TILE_ROW_CACHE_SIZE 8192
+#define TILE_ROW_VALID (1 << 21)
+
+struct tile_row_cache_entry {
+	uint32_t tag;
+	uint32_t generation;
+	uint8_t  pixels[2][16];
+};
+
+static tile_row_cache_entry tile_row_cache[TILE_ROW_CACHE_SIZE];
+static uint32_t             render_vram_generation[0x20000 >> 4];
+
+// Owned by the emulation thread
+static std::vector<render_vram_write> render_pending_writes;
+static bool                           render_vram_stale = false;
+
+static std::mutex                     render_mutex;
+static std::condition_variable        render_work_cond;
+static std::condition_variable        render_idle_cond;
+static std::deque<render_line_job *>  render_queue;
+static std::vector<render_line_job *> render_free_jobs;
+static bool                           render_busy = false;
+static bool                           render_quit = false;
+static std::thread                    render_thread;
+
 static const uint16_t default_palette[] = {
 	0x000, 0xfff, 0x800, 0xafe, 0xc4c, 0x0c5, 0x00a, 0xee7, 0xd85, 0x640, 0xf77, 0x333, 0x777, 0xaf6, 0x08f, 0xbbb, 0x000, 0x111, 0x222, 0x333, 0x444, 0x555, 0x666, 0x777, 0x888, 0x999, 0xaaa, 0xbbb, 0xccc, 0xddd, 0xeee, 0xfff, 0x211, 0x433, 0x644, 0x866, 0xa88, 0xc99, 0xfbb, 0x211, 0x422, 0x633, 0x844, 0xa55, 0xc66, 0xf77, 0x200, 0x411, 0x611, 0x822, 0xa22, 0xc33, 0xf33, 0x200, 0x400, 0x600, 0x800, 0xa00, 0xc00, 0xf00, 0x221, 0x443, 0x664, 0x886, 0xaa8, 0xcc9, 0xfeb, 0x211, 0x432, 0x653, 0x874, 0xa95, 0xcb6, 0xfd7, 0x210, 0x431, 0x651, 0x862, 0xa82, 0xca3, 0xfc3, 0x210, 0x430, 0x640, 0x860, 0xa80, 0xc90, 0xfb0, 0x121, 0x343, 0x564, 0x786, 0x9a8, 0xbc9, 0xdfb, 0x121, 0x342, 0x463, 0x684, 0x8a5, 0x9c6, 0xbf7, 0x120, 0x241, 0x461, 0x582, 0x6a2, 0x8c3, 0x9f3, 0x120, 0x240, 0x360, 0x480, 0x5a0, 0x6c0, 0x7f0, 0x121, 0x343, 0x465, 0x686, 0x8a8, 0x9ca, 0xbfc, 0x121, 0x242, 0x364, 0x485, 0x5a6, 0x6c8, 0x7f9, 0x020, 0x141, 0x162, 0x283, 0x2a4, 0x3c5, 0x3f6, 0x020, 0x041, 0x061, 0x082, 0x0a2, 0x0c3, 0x0f3, 0x122, 0x344, 0x466, 0x688, 0x8aa, 0x9cc, 0xbff, 0x122, 0x244, 0x366, 0x488, 0x5aa, 0x6cc, 0x7ff, 0x022, 0x144, 0x166, 0x288, 0x2aa, 0x3cc, 0x3ff, 0x022, 0x044, 0x066, 0x088, 0x0aa, 0x0cc, 0x0ff, 0x112, 0x334, 0x456, 0x668, 0x88a, 0x9ac, 0xbcf, 0x112, 0x224, 0x346, 0x458, 0x56a, 0x68c, 0x79f, 0x002, 0x114, 0x126, 0x238, 0x24a, 0x35c, 0x36f, 0x002, 0x014, 0x016, 0x028, 0x02a, 0x03c, 0x03f, 0x112, 0x334, 0x546, 0x768, 0x98a, 0xb9c, 0xdbf, 0x112, 0x324, 0x436, 0x648, 0x85a, 0x96c, 0xb7f, 0x102, 0x214, 0x416, 0x528, 0x62a, 0x83c, 0x93f, 0x102, 0x204, 0x306, 0x408, 0x50a, 0x60c, 0x70f, 0x212, 0x434, 0x646, 0x868, 0xa8a, 0xc9c, 0xfbe, 0x211, 0x423, 0x635, 0x847, 0xa59, 0xc6b, 0xf7d, 0x201, 0x413, 0x615, 0x826, 0xa28, 0xc3a, 0xf3c, 0x201, 0x403, 0x604, 0x806, 0xa08, 0xc09, 0xf0b
 };
 
 static void refresh_palette();
 
+static void render_wait_idle();
+
 void vera_video_reset()
 {
 	// init I/O registers
@@ -134,10 +234,20 @@ void vera_video_reset()
 
 	refresh_palette();
 
-	// fill video RAM with random data
+	// fill video RAM with random data, from the RAM seed so that replays match, but not the same bytes as RAM
+	std::mt19937 random(memory_get_seed() ^ 0x56455241);
 	for (int i = 0; i < 128 * 1024; i++) {
-		video_ram[i] = rand();
+		video_ram[i] = (uint8_t)random();
 	}
+	memset(video_ram_dirty, 1, sizeof(video_ram_dirty));
+
+	render_wait_idle();
+	memcpy(render_video_ram, video_ram, sizeof(render_video_ram));
+	memset(tile_row_cache, 0, sizeof(tile_row_cache));
+	memcpy(render_palette, video_palette.entries, sizeof(render_palette));
+	++render_palette_generation;
+	render_pending_writes.clear();
+	render_vram_stale = false;
 
 	sprite_line_collisions = 0;
 
@@ -239,10 +349,46 @@ static void refresh_layer_properties(const uint8_t layer)
 
 vera_video_sprite_properties sprite_properties[128];
 
+// For each band of 8 lines, a bitmask of the sprites with a z-depth that cover any line
+// in it, so render_sprite_line can skip straight to the sprites that may be on its line.
+// Sprites never cover a line past 0x3ff.
+#define SPRITE_BAND_HEIGHT_LOG2 3
+#define NUM_SPRITE_BANDS (0x400 >> SPRITE_BAND_HEIGHT_LOG2)
+
+static uint64_t sprite_band_masks[NUM_SPRITE_BANDS][NUM_SPRITES / 64];
+
+static void update_sprite_bands(const uint16_t sprite, const bool visible)
+{
+	const struct vera_video_sprite_properties *props = &sprite_properties[sprite];
+
+	if (props->sprite_zdepth == 0) {
+		return;
+	}
+
+	const int first_line = std::max((int)props->sprite_y, 0);
+	const int last_line  = props->sprite_y + props->sprite_height - 1;
+
+	if (props->sprite_collision_mask != 0) {
+		colliding_sprites += visible ? 1 : -1;
+	}
+
+	const uint64_t bit  = 1ull << (sprite & 63);
+	const int      word = sprite >> 6;
+	for (int band = first_line >> SPRITE_BAND_HEIGHT_LOG2; band <= (last_line >> SPRITE_BAND_HEIGHT_LOG2); ++band) {
+		if (visible) {
+			sprite_band_masks[band][word] |= bit;
+		} else {
+			sprite_band_masks[band][word] &= ~bit;
+		}
+	}
+}
+
 static void refresh_sprite_properties(const uint16_t sprite)
 {
 	struct vera_video_sprite_properties *props = &sprite_properties[sprite];
 
+	update_sprite_bands(sprite, false);
+
 	props->sprite_zdepth         = (sprite_data[sprite][6] >> 2) & 3;
 	props->sprite_collision_mask = sprite_data[sprite][6] & 0xf0;
 
@@ -268,14 +414,9 @@ static void refresh_sprite_properties(const uint16_t sprite)
 	props->sprite_address = sprite_data[sprite][0] << 5 | (sprite_data[sprite][1] & 0xf) << 13;
 
 	props->palette_offset = (sprite_data[sprite][7] & 0x0f) << 4;
-}
-
-struct video_palette_props {
-	uint32_t entries[256];
-	bool     dirty;
-};
 
-struct video_palette_props video_palette;
+	update_sprite_bands(sprite, true);
+}
 
 static void refresh_palette()
 {
@@ -306,6 +447,29 @@ static void refresh_palette()
 	video_palette.dirty = false;
 }
 
+static void read_range(const uint8_t *vram, uint8_t *dest, uint32_t address, uint32_t size)
+{
+	address &= 0x1FFFF;
+	if (address >= ADDR_VRAM_START && (address + size) <= ADDR_VRAM_END) {
+		memcpy(dest, &vram[address], size);
+	} else {
+		const uint32_t tail_size = ADDR_VRAM_END - address;
+		memcpy(dest, &vram[address], tail_size);
+		const uint32_t head_size = ((address + size) & 0x1FFFF);
+		memcpy(dest + tail_size, vram, head_size);
+	}
+}
+
+static uint8_t render_space_read(uint32_t address)
+{
+	return render_video_ram[address & 0x1FFFF];
+}
+
+static void render_space_read_range(uint8_t *dest, uint32_t address, uint32_t size)
+{
+	read_range(render_video_ram, dest, address, size);
+}
+
 static void expand_1bpp_data(uint8_t *dst, const uint8_t *src, int dst_size)
 {
 	dst += 7;
@@ -377,313 +541,330 @@ static void expand_4bpp_data(uint8_t *dst, const uint8_t *src, int dst_size)
 	}
 }
 
-static void render_sprite_line(const uint16_t y)
+static void render_sprite_line_sprite(const uint16_t y, const int i, uint16_t &sprite_budget)
 {
-	memset(sprite_line_col, 0, SCREEN_WIDTH);
-	memset(sprite_line_z, 0, SCREEN_WIDTH);
-	memset(sprite_line_mask, 0, SCREEN_WIDTH);
+	const vera_video_sprite_properties *props = &sprite_properties[i];
 
-	uint16_t sprite_budget = 800 + 1;
-	for (int i = 0; i < NUM_SPRITES; i++) {
-		// one clock per lookup
-		sprite_budget--;
-		if (sprite_budget == 0)
-			break;
-		const vera_video_sprite_properties *props = &sprite_properties[i];
+	// check whether this line falls within the sprite
+	if (y < props->sprite_y || y >= props->sprite_y + props->sprite_height) {
+		return;
+	}
 
-		if (props->sprite_zdepth == 0) {
-			continue;
-		}
+	sprite_line_dirty = true;
 
-		// check whether this line falls within the sprite
-		if (y < props->sprite_y || y >= props->sprite_y + props->sprite_height) {
-			continue;
-		}
+	const uint16_t eff_sy = props->vflip ? ((props->sprite_height - 1) - (y - props->sprite_y)) : (y - props->sprite_y);
 
-		const uint16_t eff_sy = props->vflip ? ((props->sprite_height - 1) - (y - props->sprite_y)) : (y - props->sprite_y);
+	const uint8_t *bitmap_data = video_ram + props->sprite_address + (eff_sy << (props->sprite_width_log2 - (1 - props->color_mode)));
 
-		const uint8_t *bitmap_data = video_ram + props->sprite_address + (eff_sy << (props->sprite_width_log2 - (1 - props->color_mode)));
+	const uint16_t width = std::min((uint32_t)props->sprite_width, (uint32_t)64);
+	uint8_t        unpacked_sprite_line[64];
+	if (props->color_mode == 0) {
+		// 4bpp
+		expand_4bpp_data(unpacked_sprite_line, bitmap_data, width);
+	} else {
+		// 8bpp
+		memcpy(unpacked_sprite_line, bitmap_data, width);
+	}
 
-		const uint16_t width = std::min((uint32_t)props->sprite_width, (uint32_t)64);
-		uint8_t        unpacked_sprite_line[64];
-		if (props->color_mode == 0) {
-			// 4bpp
-			expand_4bpp_data(unpacked_sprite_line, bitmap_data, width);
-		} else {
-			// 8bpp
-			memcpy(unpacked_sprite_line, bitmap_data, width);
+	const int32_t scale          = reg_composer[1];
+	const int16_t scaled_x_start = scale ? ((int32_t)props->sprite_x << 7) / scale : (props->sprite_x ? SCREEN_WIDTH : 0);
+	const int16_t scaled_x_end   = scale ? scaled_x_start + (((int32_t)width << 7) / scale) : SCREEN_WIDTH;
+	const bool    hflip          = props->hflip;
+	for (int16_t sx = scaled_x_start; sx < scaled_x_end; sx += 1) {
+		if ((uint16_t)sx >= SCREEN_WIDTH) {
+			continue;
 		}
 
-		const int32_t scale          = reg_composer[1];
-		const int16_t scaled_x_start = scale ? ((int32_t)props->sprite_x << 7) / scale : (props->sprite_x ? SCREEN_WIDTH : 0);
-		const int16_t scaled_x_end   = scale ? scaled_x_start + (((int32_t)width << 7) / scale) : SCREEN_WIDTH;
-		const bool    hflip          = props->hflip;
-		for (int16_t sx = scaled_x_start; sx < scaled_x_end; sx += 1) {
-			if ((uint16_t)sx >= SCREEN_WIDTH) {
-				continue;
-			}
-
-			const uint16_t x = ((sx - scaled_x_start) * scale) >> 7;
-
-			// one clock per fetched 32 bits
-			if (!(x & 3)) {
-				sprite_budget--;
-				if (sprite_budget == 0)
-					break;
-			}
+		const uint16_t x = ((sx - scaled_x_start) * scale) >> 7;
 
-			// one clock per rendered pixel
+		// one clock per fetched 32 bits
+		if (!(x & 3)) {
 			sprite_budget--;
 			if (sprite_budget == 0)
 				break;
+		}
 
-			const uint8_t col_index = unpacked_sprite_line[hflip ? width - x - 1 : x];
+		// one clock per rendered pixel
+		sprite_budget--;
+		if (sprite_budget == 0)
+			break;
 
-			// palette offset
-			if (col_index > 0) {
-				sprite_line_collisions |= sprite_line_mask[sx] & props->sprite_collision_mask;
-				sprite_line_mask[sx] |= props->sprite_collision_mask;
+		const uint8_t col_index = unpacked_sprite_line[hflip ? width - x - 1 : x];
 
-				if (props->sprite_zdepth > sprite_line_z[sx]) {
-					sprite_line_col[sx] = col_index + props->palette_offset;
-					sprite_line_z[sx]   = props->sprite_zdepth;
-				}
+		// palette offset
+		if (col_index > 0) {
+			sprite_line_collisions |= sprite_line_mask[sx] & props->sprite_collision_mask;
+			sprite_line_mask[sx] |= props->sprite_collision_mask;
+
+			if (props->sprite_zdepth > sprite_line_z[sx]) {
+				sprite_line_col[sx] = col_index + props->palette_offset;
+				sprite_line_z[sx]   = props->sprite_zdepth;
 			}
 		}
 	}
 }
 
-static void render_layer_line_text(uint8_t layer, uint16_t y)
+static void render_sprite_line(const uint16_t y)
 {
-	const struct vera_video_layer_properties *props = &layer_properties[layer];
+	if (sprite_line_dirty) {
+		memset(sprite_line_col, 0, SCREEN_WIDTH);
+		memset(sprite_line_z, 0, SCREEN_WIDTH);
+		memset(sprite_line_mask, 0, SCREEN_WIDTH);
+		sprite_line_dirty = false;
+	}
 
-	const uint8_t max_pixels_per_byte = 7; // (8 >> props->color_depth) - 1; // Don't need this calculation, because props->color_depth will always be 0.
-	const int     eff_y               = calc_layer_eff_y(props, y);
-	const int     yy                  = eff_y & props->tileh_max;
+	const int band = y >> SPRITE_BAND_HEIGHT_LOG2;
+	if (band >= NUM_SPRITE_BANDS) {
+		return;
+	}
 
-	// additional bytes to reach the correct line of the tile
-	const uint32_t y_add = (yy << props->tilew_log2) >> 3;
+	uint16_t sprite_budget = 800 + 1;
+	int      last_sprite   = -1;
+	for (int word = 0; word < NUM_SPRITES / 64; ++word) {
+		for (uint64_t candidates = sprite_band_masks[band][word]; candidates != 0; candidates &= candidates - 1) {
+			const int i = (word << 6) + std::countr_zero(candidates);
+
+			// one clock per lookup, including each sprite skipped since the last candidate
+			const uint16_t lookups = i - last_sprite;
+			if (sprite_budget != 0 && sprite_budget <= lookups) {
+				return;
+			}
+			sprite_budget -= lookups;
+			last_sprite = i;
 
-	uint8_t tile_bytes[512]; // max 256 tiles, 2 bytes each.
-	vera_video_space_read_range(tile_bytes, props->map_base + ((eff_y >> props->tileh_log2) << (props->mapw_log2 + 1)), 2 << props->mapw_log2);
+			render_sprite_line_sprite(y, i, sprite_budget);
+		}
+	}
+}
 
-	uint32_t tile_start;
+// Decoded pixels of the tile row starting at address, reversed when hflip is set.
+static const uint8_t *render_tile_row(const struct vera_video_layer_properties *props, uint32_t address, bool hflip)
+{
+	address &= 0x1FFFF;
 
-	uint8_t fg_color;
-	uint8_t bg_color;
-	uint8_t s;
-	uint8_t color_shift;
+	const uint8_t  row_bytes_log2 = props->tilew_log2 + props->color_depth - 3;
+	const uint32_t tag            = address | (props->color_depth << 17) | ((props->tilew_log2 - 3) << 19) | TILE_ROW_VALID;
+	const uint32_t row            = address >> row_bytes_log2;
+	const uint32_t generation     = render_vram_generation[address >> 4];
+
+	tile_row_cache_entry &entry = tile_row_cache[(row ^ (row >> 13)) & (TILE_ROW_CACHE_SIZE - 1)];
+	if (entry.tag != tag || entry.generation != generation) {
+		const uint8_t max_pixels_per_byte = (8 >> props->color_depth) - 1;
+		for (uint16_t xx = 0; xx <= props->tilew_max; ++xx) {
+			const uint8_t s           = render_video_ram[address + ((xx << props->color_depth) >> 3)];
+			const uint8_t color_shift = props->first_color_pos - ((xx & max_pixels_per_byte) << props->color_depth);
+			const uint8_t col_index   = (s >> color_shift) & props->color_mask;
+
+			entry.pixels[0][xx]                    = col_index;
+			entry.pixels[1][xx ^ props->tilew_max] = col_index;
+		}
+		entry.tag        = tag;
+		entry.generation = generation;
+	}
+	return entry.pixels[hflip];
+}
 
-	{
-		const int eff_x = calc_layer_eff_x(props, 0);
-		const int xx    = eff_x & props->tilew_max;
+struct text_tile {
+	const uint8_t *pixels;
+	uint8_t        fg_color;
+	uint8_t        bg_color;
+};
 
-		// extract all information from the map
-		const uint32_t map_addr = calc_layer_map_offset_base2(props, eff_x);
+static text_tile text_tile_at(const struct vera_video_layer_properties *props, const uint8_t *tile_bytes, uint32_t y_add, int eff_x)
+{
+	// extract all information from the map
+	const uint32_t map_addr = calc_layer_map_offset_base2(props, eff_x);
 
-		const uint8_t tile_index = tile_bytes[map_addr];
-		const uint8_t byte1      = tile_bytes[map_addr + 1];
+	const uint8_t tile_index = tile_bytes[map_addr];
+	const uint8_t byte1      = tile_bytes[map_addr + 1];
 
-		if (!props->text_mode_256c) {
-			fg_color = byte1 & 15;
-			bg_color = byte1 >> 4;
-		} else {
-			fg_color = byte1;
-			bg_color = 0;
-		}
+	text_tile tile;
+	if (!props->text_mode_256c) {
+		tile.fg_color = byte1 & 15;
+		tile.bg_color = byte1 >> 4;
+	} else {
+		tile.fg_color = byte1;
+		tile.bg_color = 0;
+	}
 
-		// offset within tilemap of the current tile
-		tile_start = tile_index << props->tile_size_log2;
+	// offset within tilemap of the current tile
+	const uint32_t tile_start = tile_index << props->tile_size_log2;
 
-		// additional bytes to reach the correct column of the tile
-		const uint16_t x_add       = xx >> 3;
-		const uint32_t tile_offset = tile_start + y_add + x_add;
+	tile.pixels = render_tile_row(props, props->tile_base + tile_start + y_add, false);
+	return tile;
+}
 
-		s = vera_video_space_read(props->tile_base + tile_offset);
+static void render_layer_line_text(const render_line_job &job, uint8_t layer, uint16_t y)
+{
+	const struct vera_video_layer_properties *props = &job.layer_properties[layer];
+
+	const int eff_y = calc_layer_eff_y(props, y);
+	const int yy    = eff_y & props->tileh_max;
+
+	// additional bytes to reach the correct line of the tile
+	const uint32_t y_add = (yy << props->tilew_log2) >> 3;
+
+	uint8_t tile_bytes[512]; // max 256 tiles, 2 bytes each.
+	render_space_read_range(tile_bytes, props->map_base + ((eff_y >> props->tileh_log2) << (props->mapw_log2 + 1)), 2 << props->mapw_log2);
+
+	uint8_t *const line  = layer_line[layer];
+	const uint32_t scale = job.reg_composer[1];
+
+	if (scale == 128) {
+		// Unscaled, so every tile is a contiguous span of the line.
+		int eff_x = calc_layer_eff_x(props, 0);
+		for (int i = 0; i < SCREEN_WIDTH;) {
+			const text_tile tile  = text_tile_at(props, tile_bytes, y_add, eff_x);
+			const int       xx    = eff_x & props->tilew_max;
+			const int       count = std::min(props->tilew - xx, SCREEN_WIDTH - i);
+			for (int k = 0; k < count; ++k) {
+				line[i + k] = tile.pixels[xx + k] ? tile.fg_color : tile.bg_color;
+			}
+			i += count;
+			eff_x = (eff_x + count) & props->layerw_max;
+		}
+		return;
 	}
 
-	// Render tile line.
-	const uint32_t scale      = reg_composer[1];
-	uint32_t       scaled_x   = 0;
-	int            last_eff_x = calc_layer_eff_x(props, 0);
+	uint32_t  scaled_x   = 0;
+	int       last_eff_x = calc_layer_eff_x(props, 0);
+	text_tile tile       = text_tile_at(props, tile_bytes, y_add, last_eff_x);
 
 	for (int i = 0; i < SCREEN_WIDTH; i++) {
 		const uint16_t x = scaled_x >> 7;
 
 		// Scrolling
 		const int eff_x = calc_layer_eff_x(props, x);
-		const int xx    = eff_x & props->tilew_max;
-
-		if ((eff_x ^ last_eff_x) & ~0x7) {
-			if ((eff_x ^ last_eff_x) & ~props->tilew_max) {
-				// extract all information from the map
-				const uint32_t map_addr = calc_layer_map_offset_base2(props, eff_x);
-
-				const uint8_t tile_index = tile_bytes[map_addr];
-				const uint8_t byte1      = tile_bytes[map_addr + 1];
-
-				if (!props->text_mode_256c) {
-					fg_color = byte1 & 15;
-					bg_color = byte1 >> 4;
-				} else {
-					fg_color = byte1;
-					bg_color = 0;
-				}
-
-				// offset within tilemap of the current tile
-				tile_start = tile_index << props->tile_size_log2;
-			}
-
-			// additional bytes to reach the correct column of the tile
-			const uint16_t x_add       = xx >> 3;
-			const uint32_t tile_offset = tile_start + y_add + x_add;
-
-			s = vera_video_space_read(props->tile_base + tile_offset);
+		if ((eff_x ^ last_eff_x) & ~props->tilew_max) {
+			tile = text_tile_at(props, tile_bytes, y_add, eff_x);
 		}
 
-		// convert tile byte to indexed color
-		color_shift             = max_pixels_per_byte - (eff_x & 0x7);
-		const uint8_t col_index = (s >> color_shift) & 1;
-		layer_line[layer][i]    = col_index ? fg_color : bg_color;
+		line[i] = tile.pixels[eff_x & props->tilew_max] ? tile.fg_color : tile.bg_color;
 
 		scaled_x += scale;
 		last_eff_x = eff_x;
 	}
 }
 
-static void render_layer_line_tile(uint8_t layer, uint16_t y)
-{
-	struct vera_video_layer_properties *props = &layer_properties[layer];
+struct color_tile {
+	const uint8_t *pixels;
+	uint8_t        palette_offset;
+};
 
-	const uint8_t  max_pixels_per_byte = (8 >> props->color_depth) - 1;
-	const int      eff_y               = calc_layer_eff_y(props, y);
-	const uint8_t  yy                  = eff_y & props->tileh_max;
-	const uint8_t  yy_flip             = yy ^ props->tileh_max;
-	const uint32_t y_add               = (yy << (props->tilew_log2 + props->color_depth - 3));
-	const uint32_t y_add_flip          = (yy_flip << (props->tilew_log2 + props->color_depth - 3));
+static color_tile color_tile_at(const struct vera_video_layer_properties *props, const uint8_t *tile_bytes, uint32_t y_add, uint32_t y_add_flip, int eff_x)
+{
+	// extract all information from the map
+	const uint32_t map_addr = calc_layer_map_offset_base2(props, eff_x);
 
-	uint8_t tile_bytes[512]; // max 256 tiles, 2 bytes each.
-	vera_video_space_read_range(tile_bytes, props->map_base + ((eff_y >> props->tileh_log2) << (props->mapw_log2 + 1)), 2 << props->mapw_log2);
+	const uint8_t byte0 = tile_bytes[map_addr];
+	const uint8_t byte1 = tile_bytes[map_addr + 1];
 
-	uint8_t  palette_offset;
-	bool     vflip;
-	bool     hflip;
-	uint32_t tile_start;
-	uint8_t  s;
-	uint8_t  color_shift;
+	// Tile Flipping
+	const bool vflip = (byte1 >> 3) & 1;
+	const bool hflip = (byte1 >> 2) & 1;
 
-	{
-		const int eff_x = calc_layer_eff_x(props, 0);
+	// offset within tilemap of the current tile
+	const uint16_t tile_index = byte0 | ((byte1 & 3) << 8);
+	const uint32_t tile_start = tile_index << props->tile_size_log2;
 
-		// extract all information from the map
-		const uint32_t map_addr = calc_layer_map_offset_base2(props, eff_x);
+	color_tile tile;
+	tile.palette_offset = byte1 & 0xf0;
+	tile.pixels         = render_tile_row(props, props->tile_base + tile_start + (vflip ? y_add_flip : y_add), hflip);
+	return tile;
+}
 
-		const uint8_t byte0 = tile_bytes[map_addr];
-		const uint8_t byte1 = tile_bytes[map_addr + 1];
+static uint8_t tile_color(uint8_t col_index, uint8_t palette_offset)
+{
+	// Apply Palette Offset
+	if (palette_offset && col_index > 0 && col_index < 16) {
+		col_index += palette_offset;
+	}
+	return col_index;
+}
 
-		// Tile Flipping
-		vflip = (byte1 >> 3) & 1;
-		hflip = (byte1 >> 2) & 1;
+static void render_layer_line_tile(const render_line_job &job, uint8_t layer, uint16_t y)
+{
+	const struct vera_video_layer_properties *props = &job.layer_properties[layer];
 
-		palette_offset = byte1 & 0xf0;
+	if (props->tilew == 0) {
+		// The layer registers haven't been written since power-on, so every color mask is empty.
+		memset(layer_line[layer], 0, SCREEN_WIDTH);
+		return;
+	}
 
-		// offset within tilemap of the current tile
-		const uint16_t tile_index = byte0 | ((byte1 & 3) << 8);
-		tile_start                = tile_index << props->tile_size_log2;
+	const int      eff_y      = calc_layer_eff_y(props, y);
+	const uint8_t  yy         = eff_y & props->tileh_max;
+	const uint8_t  yy_flip    = yy ^ props->tileh_max;
+	const uint32_t y_add      = (yy << (props->tilew_log2 + props->color_depth - 3));
+	const uint32_t y_add_flip = (yy_flip << (props->tilew_log2 + props->color_depth - 3));
 
-		int xx = eff_x & props->tilew_max;
-		if (hflip) {
-			xx = xx ^ (props->tilew_max);
+	uint8_t tile_bytes[512]; // max 256 tiles, 2 bytes each.
+	render_space_read_range(tile_bytes, props->map_base + ((eff_y >> props->tileh_log2) << (props->mapw_log2 + 1)), 2 << props->mapw_log2);
+
+	uint8_t *const line  = layer_line[layer];
+	const uint32_t scale = job.reg_composer[1];
+
+	if (scale == 128) {
+		// Unscaled, so every tile is a contiguous span of the line.
+		int eff_x = calc_layer_eff_x(props, 0);
+		for (int i = 0; i < SCREEN_WIDTH;) {
+			const color_tile tile  = color_tile_at(props, tile_bytes, y_add, y_add_flip, eff_x);
+			const int       xx    = eff_x & props->tilew_max;
+			const int       count = std::min(props->tilew - xx, SCREEN_WIDTH - i);
+			if (tile.palette_offset) {
+				for (int k = 0; k < count; ++k) {
+					line[i + k] = tile_color(tile.pixels[xx + k], tile.palette_offset);
+				}
+			} else {
+				memcpy(line + i, tile.pixels + xx, count);
+			}
+			i += count;
+			eff_x = (eff_x + count) & props->layerw_max;
 		}
-
-		// additional bytes to reach the correct column of the tile
-		uint16_t x_add       = (xx << props->color_depth) >> 3;
-		uint32_t tile_offset = tile_start + (vflip ? y_add_flip : y_add) + x_add;
-
-		s = vera_video_space_read(props->tile_base + tile_offset);
+		return;
 	}
 
-	// Render tile line.
-	const uint32_t scale      = reg_composer[1];
-	uint32_t       scaled_x   = 0;
-	int            last_eff_x = calc_layer_eff_x(props, 0);
+	uint32_t  scaled_x   = 0;
+	int       last_eff_x = calc_layer_eff_x(props, 0);
+	color_tile tile       = color_tile_at(props, tile_bytes, y_add, y_add_flip, last_eff_x);
 
 	for (int i = 0; i < SCREEN_WIDTH; i++) {
 		const uint16_t x     = scaled_x >> 7;
 		const int      eff_x = calc_layer_eff_x(props, x);
 
-		if ((eff_x ^ last_eff_x) & ~max_pixels_per_byte) {
-			if ((eff_x ^ last_eff_x) & ~props->tilew_max) {
-				// extract all information from the map
-				const uint32_t map_addr = calc_layer_map_offset_base2(props, eff_x);
-
-				const uint8_t byte0 = tile_bytes[map_addr];
-				const uint8_t byte1 = tile_bytes[map_addr + 1];
-
-				// Tile Flipping
-				vflip = (byte1 >> 3) & 1;
-				hflip = (byte1 >> 2) & 1;
-
-				palette_offset = byte1 & 0xf0;
-
-				// offset within tilemap of the current tile
-				const uint16_t tile_index = byte0 | ((byte1 & 3) << 8);
-				tile_start                = tile_index << props->tile_size_log2;
-			}
-
-			int xx = eff_x & props->tilew_max;
-			if (hflip) {
-				xx = xx ^ (props->tilew_max);
-			}
-
-			// additional bytes to reach the correct column of the tile
-			const uint16_t x_add       = (xx << props->color_depth) >> 3;
-			const uint32_t tile_offset = tile_start + (vflip ? y_add_flip : y_add) + x_add;
-
-			s = vera_video_space_read(props->tile_base + tile_offset);
+		if ((eff_x ^ last_eff_x) & ~props->tilew_max) {
+			tile = color_tile_at(props, tile_bytes, y_add, y_add_flip, eff_x);
 		}
 
-		if (hflip) {
-			color_shift = (eff_x & max_pixels_per_byte) << props->color_depth;
-		} else {
-			color_shift = props->first_color_pos - ((eff_x & max_pixels_per_byte) << props->color_depth);
-		}
-		// convert tile byte to indexed color
-		uint8_t col_index = (s >> color_shift) & props->color_mask;
-
-		// Apply Palette Offset
-		if (palette_offset && col_index > 0 && col_index < 16) {
-			col_index += palette_offset;
-		}
-		layer_line[layer][i] = col_index;
+		line[i] = tile_color(tile.pixels[eff_x & props->tilew_max], tile.palette_offset);
 
 		scaled_x += scale;
 		last_eff_x = eff_x;
 	}
 }
 
-static void render_layer_line_bitmap(uint8_t layer, uint16_t y)
+static void render_layer_line_bitmap(const render_line_job &job, uint8_t layer, uint16_t y)
 {
-	struct vera_video_layer_properties *props = &layer_properties[layer];
+	const struct vera_video_layer_properties *props = &job.layer_properties[layer];
 
 	int yy = y % props->tileh;
 	// additional bytes to reach the correct line of the tile
 	uint32_t y_add = (yy * props->tilew * props->bits_per_pixel) >> 3;
 
 	// Render tile line.
-	const uint32_t scale    = reg_composer[1];
+	const uint32_t scale    = job.reg_composer[1];
 	uint32_t       scaled_x = 0;
 	for (int i = 0; i < SCREEN_WIDTH; i++) {
 		const uint16_t x  = scaled_x >> 7;
 		int            xx = x % props->tilew;
 
 		// extract all information from the map
-		uint8_t palette_offset = reg_layer[layer][4] & 0xf;
+		uint8_t palette_offset = job.reg_layer[layer][4] & 0xf;
 
 		// additional bytes to reach the correct column of the tile
 		uint16_t x_add       = (xx * props->bits_per_pixel) >> 3;
 		uint32_t tile_offset = y_add + x_add;
-		uint8_t  s           = vera_video_space_read(props->tile_base + tile_offset);
+		uint8_t  s           = render_space_read(props->tile_base + tile_offset);
 
 		// convert tile byte to indexed color
 		uint8_t col_index = (s >> (props->first_color_pos - ((xx & props->color_fields_max) << props->color_depth))) & props->color_mask;
@@ -698,84 +879,77 @@ static void render_layer_line_bitmap(uint8_t layer, uint16_t y)
 	}
 }
 
-static uint8_t calculate_line_col_index(uint8_t spr_zindex, uint8_t spr_col_index, uint8_t l1_col_index, uint8_t l2_col_index)
+// First column inside the title-safe area
+static uint16_t title_safe_start()
 {
-	uint8_t col_index = 0;
-	switch (spr_zindex) {
-		case 3:
-			col_index = spr_col_index ? spr_col_index : (l2_col_index ? l2_col_index : l1_col_index);
-			break;
-		case 2:
-			col_index = l2_col_index ? l2_col_index : (spr_col_index ? spr_col_index : l1_col_index);
-			break;
-		case 1:
-			col_index = l2_col_index ? l2_col_index : (l1_col_index ? l1_col_index : spr_col_index);
-			break;
-		case 0:
-			col_index = l2_col_index ? l2_col_index : l1_col_index;
-			break;
+	uint16_t x = 0;
+	while (x < SCREEN_WIDTH * TITLE_SAFE_X) {
+		++x;
 	}
-	return col_index;
+	return x;
 }
 
-static void render_line(uint16_t y)
+// First column past the title-safe area
+static uint16_t title_safe_stop()
 {
-	if (y >= SCREEN_HEIGHT) {
-		return;
+	uint16_t x = SCREEN_WIDTH;
+	while (x > 0 && x - 1 > SCREEN_WIDTH * (1 - TITLE_SAFE_X)) {
+		--x;
+	}
+	return x;
+}
+
+static void render_job(const render_line_job &job)
+{
+	for (const render_vram_write &write : job.vram_writes) {
+		render_video_ram[write.address] = write.value;
+		++render_vram_generation[write.address >> 4];
 	}
 
-	const uint8_t out_mode = reg_composer[0] & 3;
+	if (job.palette_changed) {
+		memcpy(render_palette, job.palette, sizeof(render_palette));
+		++render_palette_generation;
+	}
 
-	const uint8_t  border_color = reg_composer[3];
-	const uint16_t hstart       = reg_composer[4] << 2;
-	const uint16_t hstop        = reg_composer[5] << 2;
-	const uint16_t vstart       = reg_composer[6] << 1;
-	const uint16_t vstop        = reg_composer[7] << 1;
+	const uint16_t y = job.y;
 
-	const int eff_y = (reg_composer[2] * (y - vstart)) >> 7;
+	const uint8_t out_mode = job.reg_composer[0] & 3;
 
-	const uint8_t dc_video = reg_composer[0];
+	const uint8_t  border_color = job.reg_composer[3];
+	const uint16_t hstart       = job.reg_composer[4] << 2;
+	const uint16_t hstop        = job.reg_composer[5] << 2;
+	const uint16_t vstart       = job.reg_composer[6] << 1;
+	const uint16_t vstop        = job.reg_composer[7] << 1;
+
+	const int eff_y = (job.reg_composer[2] * (y - vstart)) >> 7;
+
+	const uint8_t dc_video = job.reg_composer[0];
 
 	const bool layer0_was_enabled = layer_line_enable[0];
 	const bool layer1_was_enabled = layer_line_enable[1];
-	const bool sprite_was_enabled = sprite_line_enable;
 
 	layer_line_enable[0] = dc_video & 0x10;
 	layer_line_enable[1] = dc_video & 0x20;
-	sprite_line_enable   = dc_video & 0x40;
-
-	if (sprite_line_enable) {
-		render_sprite_line(eff_y);
-	} else if (sprite_was_enabled) {
-		memset(sprite_line_z, 0, SCREEN_WIDTH);
-		memset(sprite_line_col, 0, SCREEN_WIDTH);
-	}
-
-	if (vera_video_is_cheat_frame()) {
-		// sprites were needed for the collision IRQ, but we can skip
-		// everything else if we're cheating and not actually updating.
-		return;
-	}
 
 	if (layer_line_enable[0]) {
-		if (layer_properties[0].text_mode) {
-			render_layer_line_text(0, eff_y);
-		} else if (layer_properties[0].bitmap_mode) {
-			render_layer_line_bitmap(0, eff_y);
+		if (job.layer_properties[0].text_mode) {
+			render_layer_line_text(job, 0, eff_y);
+		} else if (job.layer_properties[0].bitmap_mode) {
+			render_layer_line_bitmap(job, 0, eff_y);
 		} else {
-			render_layer_line_tile(0, eff_y);
+			render_layer_line_tile(job, 0, eff_y);
 		}
 	} else if (layer0_was_enabled) {
 		memset(layer_line[0], 0, SCREEN_WIDTH);
 	}
 
 	if (layer_line_enable[1]) {
-		if (layer_properties[1].text_mode) {
-			render_layer_line_text(1, eff_y);
-		} else if (layer_properties[1].bitmap_mode) {
-			render_layer_line_bitmap(1, eff_y);
+		if (job.layer_properties[1].text_mode) {
+			render_layer_line_text(job, 1, eff_y);
+		} else if (job.layer_properties[1].bitmap_mode) {
+			render_layer_line_bitmap(job, 1, eff_y);
 		} else {
-			render_layer_line_tile(1, eff_y);
+			render_layer_line_tile(job, 1, eff_y);
 		}
 	} else if (layer1_was_enabled) {
 		memset(layer_line[1], 0, SCREEN_WIDTH);
@@ -783,60 +957,196 @@ static void render_line(uint16_t y)
 
 	uint8_t col_line[SCREEN_WIDTH];
 
-	if (video_palette.dirty) {
-		refresh_palette();
-	}
-
 	// If video output is enabled, calculate color indices for line.
 	if (out_mode != 0) {
 		// Add border after if required.
 		if (y < vstart || y > vstop) {
-			uint32_t border_fill = border_color;
-			border_fill          = border_fill | (border_fill << 8);
-			border_fill          = border_fill | (border_fill << 16);
-			memset(col_line, border_fill, SCREEN_WIDTH);
+			memset(col_line, border_color, SCREEN_WIDTH);
 		} else {
-			const uint16_t xstart = hstart < 640 ? hstart : 640;
-			const uint16_t xstop  = hstop < 640 ? hstop : 640;
-
-			for (uint16_t x = 0; x < xstart; ++x) {
-				col_line[x] = border_color;
-			}
-			const uint16_t xwidth = xstop - xstart;
-			for (uint16_t x = 0; x < xwidth; ++x) {
-				col_line[xstart + x] = calculate_line_col_index(sprite_line_z[x], sprite_line_col[x], layer_line[0][x], layer_line[1][x]);
-			}
-			for (uint16_t x = xstop; x < SCREEN_WIDTH; ++x) {
-				col_line[x] = border_color;
-			}
+			vera_video_compose_line(col_line, SCREEN_WIDTH, hstart, hstop, border_color, job.sprite_line_z, job.sprite_line_col, layer_line[0], layer_line[1]);
 		}
+	} else {
+		// Every palette entry is the same color.
+		memset(col_line, 0, SCREEN_WIDTH);
 	}
 
+	memcpy(framebuffer_indices + y * SCREEN_WIDTH, col_line, SCREEN_WIDTH);
+	framebuffer_line_palettes[y] = render_palette_generation;
+
 	// Look up all color indices.
-	uint32_t *const framebuffer4_begin = ((uint32_t *)framebuffer) + (y * SCREEN_WIDTH);
+	uint32_t *const framebuffer4 = ((uint32_t *)framebuffer) + (y * SCREEN_WIDTH);
+	vera_video_palette_lookup(framebuffer4, col_line, render_palette, SCREEN_WIDTH);
+
+	// NTSC overscan
+	if (!job.shadow_safety_frame[0] && job.shadow_safety_frame[out_mode]) {
+		static const uint16_t title_safe_left  = title_safe_start();
+		static const uint16_t title_safe_right = title_safe_stop();
+
+		framebuffer_line_palettes[y] = Darkened_line;
+		if (y < SCREEN_HEIGHT * TITLE_SAFE_Y || y > SCREEN_HEIGHT * (1 - TITLE_SAFE_Y)) {
+			vera_video_darken(framebuffer4, SCREEN_WIDTH);
+		} else {
+			vera_video_darken(framebuffer4, title_safe_left);
+			vera_video_darken(framebuffer4 + title_safe_right, SCREEN_WIDTH - title_safe_right);
+		}
+	}
+}
+
+static void render_thread_main()
+{
+	std::unique_lock<std::mutex> lock(render_mutex);
+	for (;;) {
+		render_work_cond.wait(lock, [] { return render_quit || !render_queue.empty(); });
+		if (render_queue.empty()) {
+			return;
+		}
+
+		render_line_job *job = render_queue.front();
+		render_queue.pop_front();
+		render_busy = true;
+
+		lock.unlock();
+		render_job(*job);
+		lock.lock();
+
+		render_busy = false;
+		render_free_jobs.push_back(job);
+		if (render_queue.empty()) {
+			render_idle_cond.notify_all();
+		}
+	}
+}
+
+static void render_wait_idle()
+{
+	if (!render_thread.joinable()) {
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(render_mutex);
+	render_idle_cond.wait(lock, [] { return render_queue.empty() && !render_busy; });
+}
+
+static render_line_job *render_alloc_job()
+{
 	{
-		uint32_t *framebuffer4 = framebuffer4_begin;
-		for (uint16_t x = 0; x < SCREEN_WIDTH; x++) {
-			*framebuffer4++ = video_palette.entries[col_line[x]];
+		std::lock_guard<std::mutex> lock(render_mutex);
+		if (!render_free_jobs.empty()) {
+			render_line_job *job = render_free_jobs.back();
+			render_free_jobs.pop_back();
+			return job;
 		}
 	}
+	return new render_line_job;
+}
 
-	// NTSC overscan
-	if (!shadow_safety_frame[0] && shadow_safety_frame[out_mode]) {
-		uint32_t *framebuffer4 = framebuffer4_begin;
-		for (uint16_t x = 0; x < SCREEN_WIDTH; x++) {
-			if (x < SCREEN_WIDTH * TITLE_SAFE_X ||
-			    x > SCREEN_WIDTH * (1 - TITLE_SAFE_X) ||
-			    y < SCREEN_HEIGHT * TITLE_SAFE_Y ||
-			    y > SCREEN_HEIGHT * (1 - TITLE_SAFE_Y)) {
-
-				// Divide RGB elements by 4.
-				*framebuffer4 &= 0x00fcfcfc;
-				*framebuffer4 >>= 2;
-			}
-			framebuffer4++;
+static void render_submit_job(render_line_job *job)
+{
+	if (!render_thread.joinable()) {
+		render_job(*job);
+		std::lock_guard<std::mutex> lock(render_mutex);
+		render_free_jobs.push_back(job);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(render_mutex);
+		render_queue.push_back(job);
+	}
+	render_work_cond.notify_one();
+}
+
+static void render_line(uint16_t y)
+{
+	if (y >= SCREEN_HEIGHT) {
+		return;
+	}
+
+	const uint16_t vstart = reg_composer[6] << 1;
+
+	const int eff_y = (reg_composer[2] * (y - vstart)) >> 7;
+
+	const uint8_t dc_video = reg_composer[0];
+
+	const bool sprite_was_enabled = sprite_line_enable;
+
+	sprite_line_enable = dc_video & 0x40;
+
+	if (sprite_line_enable) {
+		// A line nobody will see only needs the sprites for their collisions, which takes sprites
+		// with a collision mask. Leaving the line as it was is fine, the next one drawn starts over.
+		if (!skip_frame || colliding_sprites > 0) {
+			render_sprite_line(eff_y);
 		}
+	} else if (sprite_was_enabled) {
+		memset(sprite_line_z, 0, SCREEN_WIDTH);
+		memset(sprite_line_col, 0, SCREEN_WIDTH);
+	}
+
+	if (skip_frame) {
+		// Palette changes wait for the next line that's drawn. VRAM writes are dropped rather than
+		// logged, since a headless or warping machine may not draw a line for a long time, and the
+		// next line that's drawn copies VRAM over instead.
+		render_pending_writes.clear();
+		render_vram_stale = true;
+		return;
 	}
+
+	if (render_vram_stale) {
+		render_wait_idle();
+		memcpy(render_video_ram, video_ram, sizeof(render_video_ram));
+		memset(tile_row_cache, 0, sizeof(tile_row_cache));
+		render_pending_writes.clear();
+		render_vram_stale = false;
+	}
+
+	render_line_job *job = render_alloc_job();
+
+	job->y = y;
+	memcpy(job->reg_composer, reg_composer, sizeof(job->reg_composer));
+	job->vram_writes.swap(render_pending_writes);
+	render_pending_writes.clear();
+
+	memcpy(job->reg_layer, reg_layer, sizeof(job->reg_layer));
+	memcpy(job->layer_properties, layer_properties, sizeof(job->layer_properties));
+	memcpy(job->shadow_safety_frame, shadow_safety_frame, sizeof(job->shadow_safety_frame));
+	memcpy(job->sprite_line_col, sprite_line_col, SCREEN_WIDTH);
+	memcpy(job->sprite_line_z, sprite_line_z, SCREEN_WIDTH);
+
+	job->palette_changed = video_palette.dirty;
+	if (video_palette.dirty) {
+		refresh_palette();
+		memcpy(job->palette, video_palette.entries, sizeof(job->palette));
+	}
+
+	render_submit_job(job);
+}
+
+void vera_video_init()
+{
+#ifndef __EMSCRIPTEN__
+	render_quit   = false;
+	render_thread = std::thread(render_thread_main);
+#endif
+}
+
+void vera_video_shutdown()
+{
+	if (!render_thread.joinable()) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(render_mutex);
+		render_quit = true;
+	}
+	render_work_cond.notify_one();
+	render_thread.join();
+
+	for (render_line_job *job : render_free_jobs) {
+		delete job;
+	}
+	render_free_jobs.clear();
 }
 
 static void update_isr_and_coll(uint16_t y, uint16_t compare)
@@ -856,6 +1166,15 @@ static void update_isr_and_coll(uint16_t y, uint16_t compare)
 	}
 }
 
+static void end_frame()
+{
+	frame_count++;
+	last_frame_skipped = skip_frame;
+	if (skip_frame) {
+		++skipped_frames;
+	}
+}
+
 bool vera_video_step(float mhz, float steps)
 {
 	uint16_t y         = 0;
@@ -872,7 +1191,7 @@ bool vera_video_step(float mhz, float steps)
 			vga_scan_pos_y = 0;
 			if (!ntsc_mode) {
 				new_frame = true;
-				frame_count++;
+				end_frame();
 			}
 		}
 		if (!ntsc_mode) {
@@ -900,7 +1219,7 @@ bool vera_video_step(float mhz, float steps)
 			reg_composer[0] |= 0x80;
 			if (ntsc_mode) {
 				new_frame = true;
-				frame_count++;
+				end_frame();
 			}
 		}
 		if (ntsc_scan_pos_y == SCAN_HEIGHT * 2) {
@@ -908,7 +1227,7 @@ bool vera_video_step(float mhz, float steps)
 			ntsc_scan_pos_y = 0;
 			if (ntsc_mode) {
 				new_frame = true;
-				frame_count++;
+				end_frame();
 			}
 		}
 		if (ntsc_mode) {
@@ -924,13 +1243,28 @@ bool vera_video_step(float mhz, float steps)
 	return new_frame;
 }
 
+uint32_t vera_video_clocks_until_event(float mhz)
+{
+	// Stepping fewer clocks than this can't complete a scanline on either the VGA or NTSC counter.
+	// Rounding can at worst land on the clock that completes the line, which is still safe to stop at.
+	const float    vga_remaining  = VGA_SCAN_WIDTH - vga_scan_pos_x;
+	const float    ntsc_remaining = NTSC_HALF_SCAN_WIDTH - ntsc_half_cnt;
+	const float    remaining      = vga_remaining < ntsc_remaining ? vga_remaining : ntsc_remaining;
+	const uint32_t clocks         = (uint32_t)(remaining * mhz / PIXEL_FREQ);
+	return clocks > 0 ? clocks : 1;
+}
+
 void vera_video_force_redraw_screen()
 {
 	const uint8_t old_sprite_line_collisions = sprite_line_collisions;
+	const bool    old_skip_frame             = skip_frame;
 
+	skip_frame = false;
 	for (int y = 0; y < SCREEN_HEIGHT; ++y) {
 		render_line(y);
 	}
+	skip_frame         = old_skip_frame;
+	last_frame_skipped = false;
 
 	sprite_line_collisions = old_sprite_line_collisions;
 }
@@ -954,6 +1288,96 @@ void vera_video_save(SDL_RWops *f)
 	SDL_RWwrite(f, &sprite_data[0], sizeof(uint8_t), sizeof(sprite_data));
 }
 
+void vera_video_save_state(snapshot_writer &w)
+{
+	w.write_tracked(video_ram, sizeof(video_ram), video_ram_dirty, 64);
+	w.clear_dirty(video_ram_dirty, sizeof(video_ram_dirty));
+	w.write(palette);
+	// The colors are only recomputed when the palette is marked dirty, and they depend on the
+	// output mode at that time, so they can't be rebuilt from the palette and registers.
+	w.write(video_palette);
+	w.write(sprite_data);
+	w.write(io_addr);
+	w.write(io_rddata);
+	w.write(io_inc);
+	w.write(io_addrsel);
+	w.write(io_dcsel);
+	w.write(ien);
+	w.write(isr);
+	w.write(irq_line);
+	w.write(reg_layer);
+	w.write(reg_composer);
+	w.write(sprite_line_col);
+	w.write(sprite_line_z);
+	w.write(sprite_line_mask);
+	w.write(sprite_line_collisions);
+	w.write(sprite_line_enable);
+	w.write(vga_scan_pos_x);
+	w.write(vga_scan_pos_y);
+	w.write(ntsc_half_cnt);
+	w.write(ntsc_scan_pos_y);
+	w.write(frame_count);
+}
+
+bool vera_video_check_state(snapshot_reader &r)
+{
+	r.skip(sizeof(video_ram) + sizeof(palette) + sizeof(video_palette) + sizeof(sprite_data));
+	r.skip(sizeof(io_addr) + sizeof(io_rddata) + sizeof(io_inc) + sizeof(io_addrsel) + sizeof(io_dcsel) + sizeof(ien) + sizeof(isr) + sizeof(irq_line));
+	r.skip(sizeof(reg_layer) + sizeof(reg_composer));
+	r.skip(sizeof(sprite_line_col) + sizeof(sprite_line_z) + sizeof(sprite_line_mask) + sizeof(sprite_line_collisions) + sizeof(sprite_line_enable));
+	r.skip(sizeof(vga_scan_pos_x) + sizeof(vga_scan_pos_y) + sizeof(ntsc_half_cnt) + sizeof(ntsc_scan_pos_y) + sizeof(frame_count));
+	return r.ok();
+}
+
+bool vera_video_load_state(snapshot_reader &r)
+{
+	// The render thread may still be drawing lines from before the snapshot.
+	render_wait_idle();
+
+	r.read(video_ram);
+	memset(video_ram_dirty, 1, sizeof(video_ram_dirty));
+	r.read(palette);
+	r.read(video_palette);
+	r.read(sprite_data);
+	r.read(io_addr);
+	r.read(io_rddata);
+	r.read(io_inc);
+	r.read(io_addrsel);
+	r.read(io_dcsel);
+	r.read(ien);
+	r.read(isr);
+	r.read(irq_line);
+	r.read(reg_layer);
+	r.read(reg_composer);
+	r.read(sprite_line_col);
+	r.read(sprite_line_z);
+	r.read(sprite_line_mask);
+	r.read(sprite_line_collisions);
+	r.read(sprite_line_enable);
+	r.read(vga_scan_pos_x);
+	r.read(vga_scan_pos_y);
+	r.read(ntsc_half_cnt);
+	r.read(ntsc_scan_pos_y);
+	r.read(frame_count);
+
+	// Everything else derived from the registers is rebuilt rather than saved.
+	refresh_layer_properties(0);
+	refresh_layer_properties(1);
+	for (int i = 0; i < NUM_SPRITES; ++i) {
+		refresh_sprite_properties(i);
+	}
+	sprite_line_dirty = true;
+
+	memcpy(render_video_ram, video_ram, sizeof(render_video_ram));
+	memset(tile_row_cache, 0, sizeof(tile_row_cache));
+	memcpy(render_palette, video_palette.entries, sizeof(render_palette));
+	++render_palette_generation;
+	render_pending_writes.clear();
+	render_vram_stale = false;
+
+	return r.ok();
+}
+
 static const int increments[32] = {
 	0,
 	0,
@@ -1007,20 +1431,14 @@ uint8_t vera_video_space_read(uint32_t address)
 
 void vera_video_space_read_range(uint8_t *dest, uint32_t address, uint32_t size)
 {
-	address &= 0x1FFFF;
-	if (address >= ADDR_VRAM_START && (address + size) <= ADDR_VRAM_END) {
-		memcpy(dest, &video_ram[address], size);
-	} else {
-		const uint32_t tail_size = ADDR_VRAM_END - address;
-		memcpy(dest, &video_ram[address], tail_size);
-		const uint32_t head_size = ((address + size) & 0x1FFFF);
-		memcpy(dest + tail_size, video_ram, head_size);
-	}
+	read_range(video_ram, dest, address, size);
 }
 
 void vera_video_space_write(uint32_t address, uint8_t value)
 {
-	video_ram[address & 0x1FFFF] = value;
+	video_ram[address & 0x1FFFF]              = value;
+	video_ram_dirty[(address & 0x1FFFF) >> 6] = 1;
+	render_pending_writes.push_back({ address & 0x1FFFF, value });
 
 	if (address >= ADDR_PSG_START && address < ADDR_PSG_END) {
 		psg_writereg(address & 0x3f, value);
@@ -1282,9 +1700,22 @@ bool vera_video_is_special_address(uint32_t addr)
 
 const uint8_t *vera_video_get_framebuffer()
 {
+	render_wait_idle();
 	return framebuffer;
 }
 
+const uint8_t *vera_video_get_framebuffer_indices(uint32_t *palette)
+{
+	render_wait_idle();
+	for (int y = 0; y < SCREEN_HEIGHT; ++y) {
+		if (framebuffer_line_palettes[y] != render_palette_generation) {
+			return nullptr;
+		}
+	}
+	memcpy(palette, render_palette, sizeof(render_palette));
+	return framebuffer_indices;
+}
+
 void vera_video_get_increment_values(const int **in, int *length)
 {
 	if (in != nullptr && length != nullptr) {
@@ -1397,19 +1828,19 @@ void vera_video_set_dc_vstop(uint8_t value)
 	reg_composer[7] = value;
 }
 
-void vera_video_set_cheat_mask(int mask)
+void vera_video_set_skip_frame(bool skip)
 {
-	cheat_mask = mask;
+	skip_frame = skip;
 }
 
-int vera_video_get_cheat_mask()
+bool vera_video_last_frame_skipped()
 {
-	return cheat_mask;
+	return last_frame_skipped;
 }
 
-bool vera_video_is_cheat_frame()
+uint32_t vera_video_get_skipped_frames()
 {
-	return frame_count & cheat_mask;
+	return skipped_frames;
 }
 
 void vera_video_set_log_video(bool enable)
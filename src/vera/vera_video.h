@@ -10,6 +10,9 @@
 #include <stdint.h>
 #include <stdio.h>
 
+class snapshot_reader;
+class snapshot_writer;
+
 // both VGA and NTSC signal timing
 #define SCAN_WIDTH 800
 #define SCAN_HEIGHT 525
@@ -80,12 +83,19 @@ struct vera_video_rect {
 	uint16_t vstop;
 };
 
+void vera_video_init();
+void vera_video_shutdown();
 void vera_video_reset(void);
 bool vera_video_step(float mhz, float cycles);
+uint32_t vera_video_clocks_until_event(float mhz);
 void vera_video_force_redraw_screen();
 bool vera_video_get_irq_out(void);
 void vera_video_save(SDL_RWops *f);
 
+void vera_video_save_state(snapshot_writer &w);
+bool vera_video_check_state(snapshot_reader &r);
+bool vera_video_load_state(snapshot_reader &r);
+
 uint8_t vera_debug_video_read(uint8_t reg);
 uint8_t vera_video_read(uint8_t reg);
 void    vera_video_write(uint8_t reg, uint8_t value);
@@ -104,6 +114,11 @@ bool vera_video_is_special_address(uint32_t addr);
 
 const uint8_t *vera_video_get_framebuffer();
 
+// The framebuffer as palette indices, with the palette copied into palette (256 entries, in the same
+// format as the framebuffer). Null if some lines didn't use the current palette (changed partway
+// through the frame, or darkened by NTSC overscan), in which case only the framebuffer will do.
+const uint8_t *vera_video_get_framebuffer_indices(uint32_t *palette);
+
 void vera_video_get_increment_values(const int **in, int *length);
 
 const int vera_video_get_data_auto_increment(int channel);
@@ -132,9 +147,12 @@ void vera_video_set_dc_hstop(uint8_t value);
 void vera_video_set_dc_vstart(uint8_t value);
 void vera_video_set_dc_vstop(uint8_t value);
 
-void vera_video_set_cheat_mask(int mask);
-int  vera_video_get_cheat_mask();
-bool vera_video_is_cheat_frame();
+// Skips producing pixels for the frame that's starting, for when it won't be presented. Sprite
+// collisions and IRQs are still worked out line by line, so the machine can't tell.
+void     vera_video_set_skip_frame(bool skip);
+bool     vera_video_last_frame_skipped();
+uint32_t vera_video_get_skipped_frames();
+
 void vera_video_set_log_video(bool enable);
 bool vera_video_get_log_video();
 
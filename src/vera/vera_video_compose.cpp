@@ -0,0 +1,231 @@
+// Commander X16 Emulator
+// Copyright (c) 2021-2023 Stephen Horn, et al.
+// All rights reserved. License: 2-clause BSD
+
+#include "vera_video_compose.h"
+
+#include <string.h>
+
+#if defined(__AVX2__)
+#	include <immintrin.h>
+#	define VERA_COMPOSE_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	include <emmintrin.h>
+#	define VERA_COMPOSE_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#	include <arm_neon.h>
+#	define VERA_COMPOSE_NEON
+#endif
+
+//
+// Scalar
+//
+
+static uint8_t compose_pixel(uint8_t spr_zindex, uint8_t spr_col_index, uint8_t l1_col_index, uint8_t l2_col_index)
+{
+	uint8_t col_index = 0;
+	switch (spr_zindex) {
+		case 3:
+			col_index = spr_col_index ? spr_col_index : (l2_col_index ? l2_col_index : l1_col_index);
+			break;
+		case 2:
+			col_index = l2_col_index ? l2_col_index : (spr_col_index ? spr_col_index : l1_col_index);
+			break;
+		case 1:
+			col_index = l2_col_index ? l2_col_index : (l1_col_index ? l1_col_index : spr_col_index);
+			break;
+		case 0:
+			col_index = l2_col_index ? l2_col_index : l1_col_index;
+			break;
+	}
+	return col_index;
+}
+
+// A stop before the start shows only border, instead of composing a negative width.
+static void clamp_span(uint16_t width, uint16_t &xstart, uint16_t &xstop)
+{
+	xstart = xstart < width ? xstart : width;
+	xstop  = xstop < width ? xstop : width;
+	xstop  = xstop > xstart ? xstop : xstart;
+}
+
+static void compose_span_scalar(uint8_t *dst, uint16_t count, const uint8_t *sprite_z, const uint8_t *sprite_col, const uint8_t *layer0, const uint8_t *layer1)
+{
+	for (uint16_t x = 0; x < count; ++x) {
+		dst[x] = compose_pixel(sprite_z[x], sprite_col[x], layer0[x], layer1[x]);
+	}
+}
+
+void vera_video_compose_line_scalar(uint8_t *col_line, uint16_t width, uint16_t xstart, uint16_t xstop, uint8_t border_color, const uint8_t *sprite_z, const uint8_t *sprite_col, const uint8_t *layer0, const uint8_t *layer1)
+{
+	clamp_span(width, xstart, xstop);
+
+	for (uint16_t x = 0; x < xstart; ++x) {
+		col_line[x] = border_color;
+	}
+	compose_span_scalar(col_line + xstart, xstop - xstart, sprite_z, sprite_col, layer0, layer1);
+	for (uint16_t x = xstop; x < width; ++x) {
+		col_line[x] = border_color;
+	}
+}
+
+void vera_video_palette_lookup_scalar(uint32_t *dst, const uint8_t *col_line, const uint32_t *palette, uint16_t width)
+{
+	for (uint16_t x = 0; x < width; ++x) {
+		dst[x] = palette[col_line[x]];
+	}
+}
+
+void vera_video_darken_scalar(uint32_t *dst, uint16_t count)
+{
+	for (uint16_t x = 0; x < count; ++x) {
+		dst[x] = (dst[x] & 0x00fcfcfc) >> 2;
+	}
+}
+
+//
+// Vector
+//
+// Priority is resolved for every z-depth at once and the right result picked per byte:
+//   z=0: l2 ? l2 : l1
+//   z=1: l2 ? l2 : (l1 ? l1 : spr)
+//   z=2: l2 ? l2 : (spr ? spr : l1)
+//   z=3: spr ? spr : (l2 ? l2 : l1)
+// "p ? p : q" is p | (q & (p == 0)), since p is zero wherever q is taken.
+//
+
+#if defined(VERA_COMPOSE_AVX2)
+
+using vec_u8 = __m256i;
+
+static constexpr int vec_bytes = 32;
+
+static vec_u8 load_u8(const uint8_t *src) { return _mm256_loadu_si256((const __m256i *)src); }
+static void   store_u8(uint8_t *dst, vec_u8 v) { _mm256_storeu_si256((__m256i *)dst, v); }
+static vec_u8 splat_u8(uint8_t v) { return _mm256_set1_epi8((char)v); }
+static vec_u8 equal_u8(vec_u8 a, vec_u8 b) { return _mm256_cmpeq_epi8(a, b); }
+static vec_u8 or_else(vec_u8 p, vec_u8 q) { return _mm256_or_si256(p, _mm256_and_si256(_mm256_cmpeq_epi8(p, _mm256_setzero_si256()), q)); }
+static vec_u8 select_u8(vec_u8 mask, vec_u8 a, vec_u8 b) { return _mm256_blendv_epi8(b, a, mask); }
+
+#elif defined(VERA_COMPOSE_SSE2)
+
+using vec_u8 = __m128i;
+
+static constexpr int vec_bytes = 16;
+
+static vec_u8 load_u8(const uint8_t *src) { return _mm_loadu_si128((const __m128i *)src); }
+static void   store_u8(uint8_t *dst, vec_u8 v) { _mm_storeu_si128((__m128i *)dst, v); }
+static vec_u8 splat_u8(uint8_t v) { return _mm_set1_epi8((char)v); }
+static vec_u8 equal_u8(vec_u8 a, vec_u8 b) { return _mm_cmpeq_epi8(a, b); }
+static vec_u8 or_else(vec_u8 p, vec_u8 q) { return _mm_or_si128(p, _mm_and_si128(_mm_cmpeq_epi8(p, _mm_setzero_si128()), q)); }
+static vec_u8 select_u8(vec_u8 mask, vec_u8 a, vec_u8 b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+
+#elif defined(VERA_COMPOSE_NEON)
+
+using vec_u8 = uint8x16_t;
+
+static constexpr int vec_bytes = 16;
+
+static vec_u8 load_u8(const uint8_t *src) { return vld1q_u8(src); }
+static void   store_u8(uint8_t *dst, vec_u8 v) { vst1q_u8(dst, v); }
+static vec_u8 splat_u8(uint8_t v) { return vdupq_n_u8(v); }
+static vec_u8 equal_u8(vec_u8 a, vec_u8 b) { return vceqq_u8(a, b); }
+static vec_u8 or_else(vec_u8 p, vec_u8 q) { return vorrq_u8(p, vandq_u8(vceqq_u8(p, vdupq_n_u8(0)), q)); }
+static vec_u8 select_u8(vec_u8 mask, vec_u8 a, vec_u8 b) { return vbslq_u8(mask, a, b); }
+
+#endif
+
+#if defined(VERA_COMPOSE_AVX2) || defined(VERA_COMPOSE_SSE2) || defined(VERA_COMPOSE_NEON)
+
+static void compose_span(uint8_t *dst, uint16_t count, const uint8_t *sprite_z, const uint8_t *sprite_col, const uint8_t *layer0, const uint8_t *layer1)
+{
+	const vec_u8 z1 = splat_u8(1);
+	const vec_u8 z2 = splat_u8(2);
+	const vec_u8 z3 = splat_u8(3);
+
+	uint16_t x = 0;
+	for (; x + vec_bytes <= count; x += vec_bytes) {
+		const vec_u8 z   = load_u8(sprite_z + x);
+		const vec_u8 spr = load_u8(sprite_col + x);
+		const vec_u8 l1  = load_u8(layer0 + x);
+		const vec_u8 l2  = load_u8(layer1 + x);
+
+		const vec_u8 col0 = or_else(l2, l1);
+		const vec_u8 col1 = or_else(l2, or_else(l1, spr));
+		const vec_u8 col2 = or_else(l2, or_else(spr, l1));
+		const vec_u8 col3 = or_else(spr, col0);
+
+		vec_u8 col = col0;
+		col        = select_u8(equal_u8(z, z1), col1, col);
+		col        = select_u8(equal_u8(z, z2), col2, col);
+		col        = select_u8(equal_u8(z, z3), col3, col);
+		store_u8(dst + x, col);
+	}
+	compose_span_scalar(dst + x, count - x, sprite_z + x, sprite_col + x, layer0 + x, layer1 + x);
+}
+
+void vera_video_compose_line(uint8_t *col_line, uint16_t width, uint16_t xstart, uint16_t xstop, uint8_t border_color, const uint8_t *sprite_z, const uint8_t *sprite_col, const uint8_t *layer0, const uint8_t *layer1)
+{
+	clamp_span(width, xstart, xstop);
+
+	memset(col_line, border_color, xstart);
+	compose_span(col_line + xstart, xstop - xstart, sprite_z, sprite_col, layer0, layer1);
+	memset(col_line + xstop, border_color, width - xstop);
+}
+
+#else
+
+void vera_video_compose_line(uint8_t *col_line, uint16_t width, uint16_t xstart, uint16_t xstop, uint8_t border_color, const uint8_t *sprite_z, const uint8_t *sprite_col, const uint8_t *layer0, const uint8_t *layer1)
+{
+	vera_video_compose_line_scalar(col_line, width, xstart, xstop, border_color, sprite_z, sprite_col, layer0, layer1);
+}
+
+#endif
+
+void vera_video_palette_lookup(uint32_t *dst, const uint8_t *col_line, const uint32_t *palette, uint16_t width)
+{
+	uint16_t x = 0;
+#if defined(VERA_COMPOSE_AVX2)
+	for (; x + 8 <= width; x += 8) {
+		const __m256i indices = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(col_line + x)));
+		_mm256_storeu_si256((__m256i *)(dst + x), _mm256_i32gather_epi32((const int *)palette, indices, 4));
+	}
+#else
+	// Without a gather instruction, four independent loads per iteration is as good as it gets.
+	for (; x + 4 <= width; x += 4) {
+		const uint32_t c0 = palette[col_line[x + 0]];
+		const uint32_t c1 = palette[col_line[x + 1]];
+		const uint32_t c2 = palette[col_line[x + 2]];
+		const uint32_t c3 = palette[col_line[x + 3]];
+		dst[x + 0]        = c0;
+		dst[x + 1]        = c1;
+		dst[x + 2]        = c2;
+		dst[x + 3]        = c3;
+	}
+#endif
+	vera_video_palette_lookup_scalar(dst + x, col_line + x, palette, width - x);
+}
+
+void vera_video_darken(uint32_t *dst, uint16_t count)
+{
+	uint16_t x = 0;
+#if defined(VERA_COMPOSE_AVX2)
+	const __m256i mask = _mm256_set1_epi32(0x00fcfcfc);
+	for (; x + 8 <= count; x += 8) {
+		const __m256i c = _mm256_loadu_si256((const __m256i *)(dst + x));
+		_mm256_storeu_si256((__m256i *)(dst + x), _mm256_srli_epi32(_mm256_and_si256(c, mask), 2));
+	}
+#elif defined(VERA_COMPOSE_SSE2)
+	const __m128i mask = _mm_set1_epi32(0x00fcfcfc);
+	for (; x + 4 <= count; x += 4) {
+		const __m128i c = _mm_loadu_si128((const __m128i *)(dst + x));
+		_mm_storeu_si128((__m128i *)(dst + x), _mm_srli_epi32(_mm_and_si128(c, mask), 2));
+	}
+#elif defined(VERA_COMPOSE_NEON)
+	const uint32x4_t mask = vdupq_n_u32(0x00fcfcfc);
+	for (; x + 4 <= count; x += 4) {
+		vst1q_u32(dst + x, vshrq_n_u32(vandq_u32(vld1q_u32(dst + x), mask), 2));
+	}
+#endif
+	vera_video_darken_scalar(dst + x, count - x);
+}
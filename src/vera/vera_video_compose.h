@@ -0,0 +1,29 @@
+// Commander X16 Emulator
+// Copyright (c) 2021-2023 Stephen Horn, et al.
+// All rights reserved. License: 2-clause BSD
+
+#ifndef VERA_VIDEO_COMPOSE_H
+#define VERA_VIDEO_COMPOSE_H
+
+#include <stdint.h>
+
+// Line composition stages of render_line, vectorized with AVX2, SSE2 or NEON where the
+// build targets them, with a scalar fallback. Every path produces the same output.
+
+// Fills col_line[0, width) with border_color outside [xstart, xstop), and with the
+// priority-resolved color index of the sprite and layer lines inside it. Element 0 of
+// the sprite and layer lines lands on col_line[xstart].
+void vera_video_compose_line(uint8_t *col_line, uint16_t width, uint16_t xstart, uint16_t xstop, uint8_t border_color, const uint8_t *sprite_z, const uint8_t *sprite_col, const uint8_t *layer0, const uint8_t *layer1);
+
+// dst[i] = palette[col_line[i]]
+void vera_video_palette_lookup(uint32_t *dst, const uint8_t *col_line, const uint32_t *palette, uint16_t width);
+
+// Divides the RGB elements of dst[0, count) by 4, for the NTSC title-safe area.
+void vera_video_darken(uint32_t *dst, uint16_t count);
+
+// Reference implementations, kept for tools/benchmark_vera_compose.cpp.
+void vera_video_compose_line_scalar(uint8_t *col_line, uint16_t width, uint16_t xstart, uint16_t xstop, uint8_t border_color, const uint8_t *sprite_z, const uint8_t *sprite_col, const uint8_t *layer0, const uint8_t *layer1);
+void vera_video_palette_lookup_scalar(uint32_t *dst, const uint8_t *col_line, const uint32_t *palette, uint16_t width);
+void vera_video_darken_scalar(uint32_t *dst, uint16_t count);
+
+#endif
@@ -15,6 +15,7 @@
 #include "joystick.h"
 #include "memory.h"
 #include "serial.h"
+#include "snapshot.h"
 
 static struct via_t {
 	int32_t  timer_count[2]; // signed int to distinguish between 0xffffffff (final clock before reset, counter reads "0xffff") and 0x0000ffff (maximum possible count value)
@@ -200,6 +201,20 @@ static void via_step(via_t &via, uint32_t clocks)
 	// TODO Cxx pin and shift register handling
 }
 
+static uint32_t via_clocks_until_event(const via_t &via)
+{
+	// Timer 1 underflows once more than (count + 1) clocks have elapsed, timer 2 once more than (count).
+	const int32_t  t1_remaining = via.timer_count[0] + 1;
+	const uint32_t t1_clocks    = t1_remaining > 0 ? (uint32_t)t1_remaining : 1;
+	if (via.registers[11] & 0x20) {
+		// Timer 2 is counting PB6 pulses instead of clocks
+		return t1_clocks;
+	}
+	const uint32_t t2_remaining = (uint32_t)via.timer_count[1];
+	const uint32_t t2_clocks    = t2_remaining > 0 ? t2_remaining : 1;
+	return t1_clocks < t2_clocks ? t1_clocks : t2_clocks;
+}
+
 //
 // VIA#1
 //
@@ -304,6 +319,11 @@ void via1_step(uint32_t clocks)
 	via_step(via[0], clocks);
 }
 
+uint32_t via1_clocks_until_event()
+{
+	return via_clocks_until_event(via[0]);
+}
+
 bool via1_irq()
 {
 	return (via[0].registers[13] & via[0].registers[14]) != 0;
@@ -336,7 +356,27 @@ void via2_step(uint32_t clocks)
 	via_step(via[1], clocks);
 }
 
+uint32_t via2_clocks_until_event()
+{
+	return via_clocks_until_event(via[1]);
+}
+
 bool via2_irq()
 {
 	return (via[1].registers[13] & via[1].registers[14]) != 0;
 }
+
+void via_save_state(snapshot_writer &w)
+{
+	w.write(via);
+}
+
+bool via_check_state(snapshot_reader &r)
+{
+	return r.skip(sizeof(via));
+}
+
+bool via_load_state(snapshot_reader &r)
+{
+	return r.read(via);
+}
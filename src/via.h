@@ -9,16 +9,26 @@
 #include <stdint.h>
 #include <stdbool.h>
 
-void    via1_init();
-uint8_t via1_read(uint8_t reg, bool debug);
-void    via1_write(uint8_t reg, uint8_t value);
-void    via1_step(uint32_t clocks);
-bool    via1_irq();
+class snapshot_reader;
+class snapshot_writer;
 
-void    via2_init();
-uint8_t via2_read(uint8_t reg, bool debug);
-void    via2_write(uint8_t reg, uint8_t value);
-void    via2_step(uint32_t clocks);
-bool    via2_irq();
+void     via1_init();
+uint8_t  via1_read(uint8_t reg, bool debug);
+void     via1_write(uint8_t reg, uint8_t value);
+void     via1_step(uint32_t clocks);
+uint32_t via1_clocks_until_event();
+bool     via1_irq();
+
+void     via2_init();
+uint8_t  via2_read(uint8_t reg, bool debug);
+void     via2_write(uint8_t reg, uint8_t value);
+void     via2_step(uint32_t clocks);
+uint32_t via2_clocks_until_event();
+bool     via2_irq();
+
+// Both VIAs are saved together.
+void via_save_state(snapshot_writer &w);
+bool via_check_state(snapshot_reader &r);
+bool via_load_state(snapshot_reader &r);
 
 #endif
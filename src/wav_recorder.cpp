@@ -1,7 +1,15 @@
 #include "wav_recorder.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 #include "SDL.h"
 #include "audio.h"
+#include "ring_buffer.h"
 
 // WAV recorder states
 enum wav_recorder_state_t {
@@ -13,11 +21,19 @@ enum wav_recorder_state_t {
 
 static wav_recorder_state_t Wav_record_state = RECORD_WAV_DISABLED;
 static char *               Wav_path         = nullptr;
+static bool                 Wav_float        = false;
+
+// Samples are queued by the emulation and written out by a thread of the recorder's own, so a slow
+// disk can only cost samples (which are reported), never time. The writer thread checks the queue
+// every Flush_interval (or sooner, when the queue is filling up quickly), and the queue holds a few
+// seconds of audio, in case the disk stalls for that long.
+static constexpr auto Flush_interval = std::chrono::milliseconds(50);
+static constexpr int  Queued_blocks  = 512;
 
 class wav_recorder
 {
 public:
-	void begin(const char *path, int32_t sample_rate);
+	void begin(const char *path, int32_t sample_rate, bool use_float);
 	void end();
 	void add(const int16_t *samples, const int num_samples);
 
@@ -40,6 +56,12 @@ private:
 		uint16_t bits_per_sample = 16 * 2;
 	};
 
+	struct fact_chunk {
+		char     chunk_id[4]   = { 'f', 'a', 'c', 't' };
+		uint32_t size          = 4;
+		uint32_t sample_frames = 0;
+	};
+
 	struct data_chunk {
 		char     chunk_id[4] = { 'd', 'a', 't', 'a' };
 		uint32_t size        = 0;
@@ -50,24 +72,68 @@ private:
 		fmt_chunk  fmt;
 		data_chunk data;
 	};
+
+	// Formats other than PCM need the size of the format's extra information (none, here) and a fact chunk.
+	struct float_file_header {
+		riff_chunk riff;
+		fmt_chunk  fmt;
+		uint16_t   extra_size = 0;
+		fact_chunk fact;
+		data_chunk data;
+	};
 #pragma pack(pop)
 
-	file_header header;
-	uint32_t    samples_written = 0;
+	struct sample_block {
+		int     num_samples;
+		int16_t samples[SAMPLES_PER_BUFFER * 2];
+	};
+
+	file_header       header;
+	float_file_header float_header;
+	bool              use_float       = false;
+	uint32_t          samples_written = 0;
 
 	SDL_RWops *wav_file = nullptr;
 
-	void update_sizes()
-	{
-		header.data.size = sizeof(int16_t) * header.fmt.channels * samples_written;
-		header.riff.size = 4 + sizeof(fmt_chunk) + sizeof(data_chunk) + (header.data.size);
-	}
+	spsc_ring_buffer<sample_block, Queued_blocks> queue;
+
+	std::thread             writer;
+	std::mutex              writer_mutex;
+	std::condition_variable writer_cond;
+	bool                    writer_stop      = false;
+	std::atomic<bool>       write_failed     = false;
+	std::atomic<uint32_t>   samples_dropped  = 0;
+	uint32_t                samples_reported = 0;
+
+	void writer_main();
+	void write_queued();
+	bool write_header();
 };
 
-void wav_recorder::begin(const char *path, int32_t sample_rate)
+bool wav_recorder::write_header()
+{
+	const int      bytes_per_sample = use_float ? sizeof(float) : sizeof(int16_t);
+	const uint32_t data_size        = bytes_per_sample * header.fmt.channels * samples_written;
+
+	header.data.size = data_size;
+	header.riff.size = sizeof(file_header) - sizeof(riff_chunk) + 4 + data_size;
+
+	float_header.fmt.size           = sizeof(fmt_chunk) - 8 + sizeof(float_header.extra_size);
+	float_header.fmt.format_tag     = 0x0003; // WAVE_FORMAT_IEEE_FLOAT
+	float_header.fact.sample_frames = samples_written;
+	float_header.data.size          = data_size;
+	float_header.riff.size          = sizeof(float_file_header) - sizeof(riff_chunk) + 4 + data_size;
+
+	if (use_float) {
+		return SDL_RWwrite(wav_file, &float_header, sizeof(float_file_header), 1) != 0;
+	}
+	return SDL_RWwrite(wav_file, &header, sizeof(file_header), 1) != 0;
+}
+
+void wav_recorder::begin(const char *path, int32_t sample_rate, bool use_float)
 {
 	if (wav_file != nullptr) {
-		if (header.fmt.samples_per_sec != sample_rate) {
+		if (header.fmt.samples_per_sec != sample_rate || this->use_float != use_float) {
 			end();
 		}
 	}
@@ -76,16 +142,27 @@ void wav_recorder::begin(const char *path, int32_t sample_rate)
 		wav_file = SDL_RWFromFile(path, "wb");
 
 		if (wav_file != nullptr) {
+			const int bytes_per_sample = use_float ? sizeof(float) : sizeof(int16_t);
+
+			this->use_float            = use_float;
+			samples_written            = 0;
 			header.fmt.samples_per_sec = sample_rate;
-			header.fmt.bytes_per_sec   = sample_rate * sizeof(int16_t) * header.fmt.channels;
-			header.fmt.block_align     = sizeof(int16_t) * header.fmt.channels;
-			header.fmt.bits_per_sample = (sizeof(int16_t)) << 3;
+			header.fmt.bytes_per_sec   = sample_rate * bytes_per_sample * header.fmt.channels;
+			header.fmt.block_align     = bytes_per_sample * header.fmt.channels;
+			header.fmt.bits_per_sample = bytes_per_sample << 3;
+			float_header.fmt           = header.fmt;
 
-			const size_t written = SDL_RWwrite(wav_file, &header, sizeof(file_header), 1);
-			if (written == 0) {
+			if (!write_header()) {
 				SDL_RWclose(wav_file);
 				wav_file = nullptr;
+				return;
 			}
+
+			writer_stop      = false;
+			write_failed     = false;
+			samples_dropped  = 0;
+			samples_reported = 0;
+			writer           = std::thread([this] { writer_main(); });
 		}
 	}
 }
@@ -93,9 +170,15 @@ void wav_recorder::begin(const char *path, int32_t sample_rate)
 void wav_recorder::end()
 {
 	if (wav_file != nullptr) {
-		update_sizes();
+		{
+			std::lock_guard<std::mutex> lock(writer_mutex);
+			writer_stop = true;
+		}
+		writer_cond.notify_one();
+		writer.join();
+
 		SDL_RWseek(wav_file, 0, RW_SEEK_SET);
-		SDL_RWwrite(wav_file, &header, sizeof(file_header), 1);
+		write_header();
 		SDL_RWclose(wav_file);
 		wav_file = nullptr;
 	}
@@ -103,15 +186,80 @@ void wav_recorder::end()
 
 void wav_recorder::add(const int16_t *samples, const int num_samples)
 {
-	if (wav_file) {
-		const size_t bytes   = sizeof(int16_t) * 2 * num_samples;
-		const size_t written = SDL_RWwrite(wav_file, samples, bytes, 1);
-		if (written == 0) {
-			SDL_RWclose(wav_file);
-			wav_file = nullptr;
-		} else {
-			samples_written += num_samples;
+	if (wav_file == nullptr || write_failed.load(std::memory_order_relaxed)) {
+		return;
+	}
+
+	for (int i = 0; i < num_samples; i += SAMPLES_PER_BUFFER) {
+		const int block_samples = std::min(num_samples - i, SAMPLES_PER_BUFFER);
+
+		sample_block *block = queue.begin_write();
+		if (block == nullptr) {
+			samples_dropped.fetch_add(block_samples, std::memory_order_relaxed);
+			continue;
+		}
+		block->num_samples = block_samples;
+		memcpy(block->samples, samples + i * 2, sizeof(int16_t) * 2 * block_samples);
+		queue.end_write();
+
+		// In warp mode, the queue can fill up faster than the writer thread checks it.
+		if (queue.count() == Queued_blocks / 4) {
+			writer_cond.notify_one();
+		}
+	}
+}
+
+void wav_recorder::writer_main()
+{
+	for (;;) {
+		bool stop;
+		{
+			std::unique_lock<std::mutex> lock(writer_mutex);
+			if (!writer_stop) {
+				writer_cond.wait_for(lock, Flush_interval);
+			}
+			stop = writer_stop;
+		}
+
+		// Everything queued before the recording was ended is written before the thread exits.
+		write_queued();
+		if (stop) {
+			break;
+		}
+	}
+}
+
+void wav_recorder::write_queued()
+{
+	float converted[SAMPLES_PER_BUFFER * 2];
+
+	for (const sample_block *block = queue.get_oldest(); block != nullptr; block = queue.get_oldest()) {
+		if (!write_failed.load(std::memory_order_relaxed)) {
+			const int values = block->num_samples * 2;
+			size_t    written;
+			if (use_float) {
+				for (int i = 0; i < values; ++i) {
+					converted[i] = block->samples[i] / 32768.0f;
+				}
+				written = SDL_RWwrite(wav_file, converted, sizeof(float) * values, 1);
+			} else {
+				written = SDL_RWwrite(wav_file, block->samples, sizeof(int16_t) * values, 1);
+			}
+
+			if (written == 0) {
+				printf("Could not write to the WAV file, recording stopped.\n");
+				write_failed.store(true, std::memory_order_relaxed);
+			} else {
+				samples_written += block->num_samples;
+			}
 		}
+		queue.free_oldest();
+	}
+
+	const uint32_t dropped = samples_dropped.load(std::memory_order_relaxed);
+	if (dropped != samples_reported) {
+		printf("WAV recording fell behind, %u samples were left out.\n", dropped - samples_reported);
+		samples_reported = dropped;
 	}
 }
 
@@ -132,7 +280,7 @@ void wav_recorder_process(const int16_t *samples, const int num_samples)
 		for (int i = 0; i < num_samples; ++i) {
 			if (samples[i] != 0) {
 				Wav_record_state = RECORD_WAV_RECORDING;
-				Wav_recorder.begin(Wav_path, audio_get_sample_rate());
+				Wav_recorder.begin(Wav_path, audio_get_sample_rate(), Wav_float);
 				break;
 			}
 		}
@@ -152,7 +300,7 @@ void wav_recorder_set(wav_recorder_command_t command)
 				break;
 			case RECORD_WAV_RECORD:
 				Wav_record_state = RECORD_WAV_RECORDING;
-				Wav_recorder.begin(Wav_path, audio_get_sample_rate());
+				Wav_recorder.begin(Wav_path, audio_get_sample_rate(), Wav_float);
 				break;
 			case RECORD_WAV_AUTOSTART:
 				if (Wav_record_state == RECORD_WAV_RECORDING) {
@@ -195,9 +343,14 @@ void wav_recorder_set_path(const char *path)
 			Wav_record_state               = RECORD_WAV_AUTOSTARTING;
 		} else {
 			Wav_record_state = RECORD_WAV_RECORDING;
-			Wav_recorder.begin(Wav_path, audio_get_sample_rate());
+			Wav_recorder.begin(Wav_path, audio_get_sample_rate(), Wav_float);
 		}
 	} else {
 		Wav_record_state = RECORD_WAV_DISABLED;
 	}
+}
+
+void wav_recorder_set_float(bool use_float)
+{
+	Wav_float = use_float;
 }
\ No newline at end of file
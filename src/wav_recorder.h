@@ -17,4 +17,7 @@ uint8_t wav_recorder_get_state();
 
 void wav_recorder_set_path(const char *path);
 
+// Records 32-bit float samples instead of 16-bit ones, from the next time a file is started.
+void wav_recorder_set_float(bool use_float);
+
 #endif
\ No newline at end of file
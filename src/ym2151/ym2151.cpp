@@ -1,6 +1,15 @@
 #include "ym2151.h"
 
 #include <queue>
+#include <vector>
+
+#if defined(__AVX__)
+#	include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#	include <arm_neon.h>
+#endif
 
 #include "ymfm_opm.h"
 
@@ -8,6 +17,7 @@
 
 #include "audio.h"
 #include "bitutils.h"
+#include "snapshot.h"
 
 class ym2151_interface : public ymfm::ymfm_interface
 {
@@ -23,6 +33,12 @@ public:
 	      m_busy_timer{ 0 },
 	      m_irq_status{ false }
 	{
+		for (int phase = 0; phase < upsampling_factor; ++phase) {
+			for (int tap = 0; tap < taps_per_phase; ++tap) {
+				const int filter_index         = phase + upsampling_factor * (taps_per_phase - 1 - tap);
+				m_polyphase_kernel[phase][tap] = filter_index < filter_kernel_length ? (float)filter_kernel[filter_index] : 0.0f;
+			}
+		}
 	}
 
 	~ym2151_interface()
@@ -184,41 +200,40 @@ public:
 			pregenerate(samples_needed - m_backbuffer_used);
 		}
 
-		uint32_t samples_used = 0;
-
-		// iterate over output samples
-		int16_t *out_streams[2] = {&buffers[0], &buffers[1]};
-		for (uint32_t s = 0; s < samples; s++) {
-			// which sample in the upsampled, filtered signal will we use for the given output sample?
-			int32_t pick_index = (int32_t)(((float)(s * m_chip_sample_rate * upsampling_factor)) / sample_rate);
-			// now, compute this sample (L/R)
-			for (int i = 0; i < 2; i++) {
-				double sum = 0.0f;
-				int32_t source_sample = pick_index / upsampling_factor;
-				int32_t k = 0;
-				for (int32_t filter_index = pick_index % upsampling_factor; filter_index < filter_kernel_length; filter_index += upsampling_factor) {
-					if (source_sample - k >= 0) {
-						sum += filter_kernel[filter_index] * m_backbuffer[source_sample - k].data[i];
-					} else {
-						sum += filter_kernel[filter_index] * m_filter_memory[k - source_sample - 1].data[i];
-					}
-					k++;
-				}
-				*out_streams[i] = (int16_t)(sum);
-				out_streams[i] += 2;
+		if (samples != m_pick_samples || sample_rate != m_pick_sample_rate) {
+			// which sample in the upsampled, filtered signal will we use for each output sample?
+			m_pick_indices.resize(samples);
+			for (uint32_t s = 0; s < samples; s++) {
+				m_pick_indices[s] = (int32_t)(((float)(s * m_chip_sample_rate * upsampling_factor)) / sample_rate);
 			}
+			m_pick_samples     = samples;
+			m_pick_sample_rate = sample_rate;
 		}
 
-		// fill filter memory with the last few input samples
-		for (int32_t s = 0; s < filter_memory_length; s++) {
-			m_filter_memory[s] = m_backbuffer[samples_needed - 1 - s];
+		// append the new source samples to the history already in the delay lines
+		for (uint32_t s = 0; s < samples_needed; s++) {
+			m_delay_line[0][filter_history + s] = (float)m_backbuffer[s].data[0];
+			m_delay_line[1][filter_history + s] = (float)m_backbuffer[s].data[1];
 		}
 
-		samples_used = samples_needed;
+		// each output sample is the inner product of one kernel phase with the source samples up to the picked one
+		for (uint32_t s = 0; s < samples; s++) {
+			const int32_t pick_index = m_pick_indices[s];
+			const float  *kernel     = m_polyphase_kernel[pick_index % upsampling_factor];
+			const int32_t first      = filter_history + pick_index / upsampling_factor - (taps_per_phase - 1);
+
+			buffers[s * 2 + 0] = (int16_t)(int32_t)inner_product(kernel, &m_delay_line[0][first]);
+			buffers[s * 2 + 1] = (int16_t)(int32_t)inner_product(kernel, &m_delay_line[1][first]);
+		}
 
-		if (samples_used < m_backbuffer_used) {
-			memmove(&m_backbuffer[0], &m_backbuffer[samples_used], sizeof(ymfm::ym2151::output_data) * (m_backbuffer_used - samples_used));
-			m_backbuffer_used -= samples;
+		// keep the newest source samples as history for the next call
+		for (int i = 0; i < 2; i++) {
+			memmove(&m_delay_line[i][0], &m_delay_line[i][samples_needed], sizeof(float) * filter_history);
+		}
+
+		if (samples_needed < m_backbuffer_used) {
+			memmove(&m_backbuffer[0], &m_backbuffer[samples_needed], sizeof(ymfm::ym2151::output_data) * (m_backbuffer_used - samples_needed));
+			m_backbuffer_used -= samples_needed;
 		} else {
 			m_backbuffer_used = 0;
 		}
@@ -324,6 +339,110 @@ public:
 		return m_chip_sample_rate;
 	}
 
+	void save_state(snapshot_writer &w)
+	{
+		std::vector<uint8_t> chip_state;
+		ymfm::ymfm_saved_state saver(chip_state, true);
+		m_chip.save_restore(saver);
+		w.write((uint32_t)chip_state.size());
+		w.write_bytes(chip_state.data(), chip_state.size());
+
+		w.write(m_timers);
+		w.write(m_busy_timer);
+		w.write(m_irq_status);
+
+		std::queue<std::tuple<uint8_t, uint8_t>> write_queue = m_write_queue;
+		w.write((uint32_t)write_queue.size());
+		while (!write_queue.empty()) {
+			auto [addr, value] = write_queue.front();
+			w.write(addr);
+			w.write(value);
+			write_queue.pop();
+		}
+
+		w.write(m_backbuffer_used);
+		w.write_bytes(m_backbuffer, sizeof(m_backbuffer[0]) * m_backbuffer_used);
+		for (int i = 0; i < 2; ++i) {
+			w.write_bytes(m_delay_line[i], sizeof(float) * filter_history);
+		}
+	}
+
+	bool check_state(snapshot_reader &r)
+	{
+		std::vector<uint8_t> chip_state;
+		ymfm::ymfm_saved_state saver(chip_state, true);
+		m_chip.save_restore(saver);
+		if (!r.expect((uint32_t)chip_state.size()) || !r.skip(chip_state.size())) {
+			return false;
+		}
+
+		uint32_t num_writes = 0;
+		r.skip(sizeof(m_timers) + sizeof(m_busy_timer) + sizeof(m_irq_status));
+		r.read(num_writes);
+		if (!r.ok() || num_writes > r.remaining() / 2) {
+			return false;
+		}
+		r.skip(num_writes * 2);
+
+		uint32_t backbuffer_used = 0;
+		if (!r.read(backbuffer_used) || backbuffer_used > m_backbuffer_size) {
+			return false;
+		}
+		return r.skip(sizeof(m_backbuffer[0]) * backbuffer_used + 2 * sizeof(float) * filter_history);
+	}
+
+	bool load_state(snapshot_reader &r)
+	{
+		// ymfm reads zeroes past the end of its buffer instead of failing, so the size has to match
+		// what this build of ymfm saves.
+		std::vector<uint8_t> chip_state;
+		ymfm::ymfm_saved_state saver(chip_state, true);
+		m_chip.save_restore(saver);
+		if (!r.expect((uint32_t)chip_state.size()) || !r.read_bytes(chip_state.data(), chip_state.size())) {
+			return false;
+		}
+
+		int32_t  timers[2];
+		int32_t  busy_timer = 0;
+		bool     irq_status = false;
+		uint32_t num_writes = 0;
+		r.read(timers);
+		r.read(busy_timer);
+		r.read(irq_status);
+		r.read(num_writes);
+
+		std::queue<std::tuple<uint8_t, uint8_t>> write_queue;
+		for (uint32_t i = 0; i < num_writes && r.ok(); ++i) {
+			uint8_t addr  = 0;
+			uint8_t value = 0;
+			r.read(addr);
+			r.read(value);
+			write_queue.push({ addr, value });
+		}
+
+		uint32_t backbuffer_used = 0;
+		if (!r.read(backbuffer_used) || backbuffer_used > m_backbuffer_size) {
+			return false;
+		}
+		r.read_bytes(m_backbuffer, sizeof(m_backbuffer[0]) * backbuffer_used);
+		for (int i = 0; i < 2; ++i) {
+			r.read_bytes(m_delay_line[i], sizeof(float) * filter_history);
+		}
+		if (!r.ok()) {
+			return false;
+		}
+
+		ymfm::ymfm_saved_state restorer(chip_state, false);
+		m_chip.save_restore(restorer);
+		m_timers[0]       = timers[0];
+		m_timers[1]       = timers[1];
+		m_busy_timer      = busy_timer;
+		m_irq_status      = irq_status;
+		m_write_queue     = std::move(write_queue);
+		m_backbuffer_used = backbuffer_used;
+		return true;
+	}
+
 private:
 	ymfm::ym2151 m_chip;
 	uint32_t     m_chip_sample_rate;
@@ -346,8 +465,56 @@ private:
 
 #include "resampling_filter_kernel.inl"
 	
-	static constexpr int filter_memory_length = filter_kernel_length / upsampling_factor + 1;
-	ymfm::ym2151::output_data m_filter_memory[filter_kernel_length];
+	// filter_kernel split into its upsampling_factor phases, each reversed (and zero-padded to
+	// the same length), so that the output for a pick index is a single inner product over
+	// consecutive source samples ending at the picked one
+	static constexpr int taps_per_phase = (filter_kernel_length + upsampling_factor - 1) / upsampling_factor;
+	static constexpr int filter_history = taps_per_phase - 1;
+	static_assert(taps_per_phase % 4 == 0, "inner_product works on groups of 4 taps");
+
+	alignas(16) float m_polyphase_kernel[upsampling_factor][taps_per_phase];
+
+	// per channel: the last filter_history source samples of the previous call, then this call's
+	float m_delay_line[2][filter_history + YM_SAMPLE_RATE];
+
+	std::vector<int32_t> m_pick_indices;
+	uint32_t             m_pick_samples     = 0;
+	uint32_t             m_pick_sample_rate = 0;
+
+	static float inner_product(const float *kernel, const float *samples)
+	{
+		int tap = 0;
+#if defined(__AVX__)
+		__m256 sum8 = _mm256_setzero_ps();
+		for (; tap + 8 <= taps_per_phase; tap += 8) {
+			sum8 = _mm256_add_ps(sum8, _mm256_mul_ps(_mm256_loadu_ps(kernel + tap), _mm256_loadu_ps(samples + tap)));
+		}
+		__m128 sum = _mm_add_ps(_mm256_castps256_ps128(sum8), _mm256_extractf128_ps(sum8, 1));
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+		__m128 sum = _mm_setzero_ps();
+#endif
+#if defined(__AVX__) || defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+		for (; tap < taps_per_phase; tap += 4) {
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load_ps(kernel + tap), _mm_loadu_ps(samples + tap)));
+		}
+		sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+		sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+		return _mm_cvtss_f32(sum);
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+		float32x4_t sum = vdupq_n_f32(0.0f);
+		for (; tap < taps_per_phase; tap += 4) {
+			sum = vmlaq_f32(sum, vld1q_f32(kernel + tap), vld1q_f32(samples + tap));
+		}
+		const float32x2_t half = vadd_f32(vget_low_f32(sum), vget_high_f32(sum));
+		return vget_lane_f32(vpadd_f32(half, half), 0);
+#else
+		float sum = 0.0f;
+		for (; tap < taps_per_phase; ++tap) {
+			sum += kernel[tap] * samples[tap];
+		}
+		return sum;
+#endif
+	}
 };
 
 static ym2151_interface Ym_interface;
@@ -356,19 +523,30 @@ static uint8_t          Last_data    = 0;
 static uint8_t          Ym_registers[256];
 static bool             Ym_irq_enabled = false;
 static bool             Ym_strict_busy = false;
+static uint32_t         Clocks_elapsed = 0;
 
 void YM_prerender(uint32_t clocks)
 {
-	static uint32_t clocks_elapsed = 0;
-	clocks_elapsed += clocks;
+	Clocks_elapsed += clocks;
 
 	const uint32_t clocks_per_sample = 8000000 / Ym_interface.get_sample_rate();
-	const uint32_t samples_to_render = clocks_elapsed / clocks_per_sample;
+	const uint32_t samples_to_render = Clocks_elapsed / clocks_per_sample;
 
 	if (samples_to_render > 0) {
 		Ym_interface.pregenerate(samples_to_render);
-		clocks_elapsed -= samples_to_render * clocks_per_sample;
+		Clocks_elapsed -= samples_to_render * clocks_per_sample;
+	}
+}
+
+uint32_t YM_clocks_until_event()
+{
+	if (!Ym_irq_enabled) {
+		return UINT32_MAX;
 	}
+
+	// Timers (and so the IRQ line) only advance when a sample is generated.
+	const uint32_t clocks_per_sample = 8000000 / Ym_interface.get_sample_rate();
+	return clocks_per_sample > Clocks_elapsed ? clocks_per_sample - Clocks_elapsed : 1;
 }
 
 void YM_render(int16_t *buffer, uint32_t samples, uint32_t sample_rate)
@@ -436,6 +614,35 @@ void YM_reset()
 	memset(&Ym_registers[0x20], 0xc0, 8);
 }
 
+void YM_save_state(snapshot_writer &w)
+{
+	Ym_interface.save_state(w);
+	w.write(Last_address);
+	w.write(Last_data);
+	w.write(Ym_registers);
+	w.write(Clocks_elapsed);
+}
+
+bool YM_check_state(snapshot_reader &r)
+{
+	if (!Ym_interface.check_state(r)) {
+		return false;
+	}
+	return r.skip(sizeof(Last_address) + sizeof(Last_data) + sizeof(Ym_registers) + sizeof(Clocks_elapsed));
+}
+
+bool YM_load_state(snapshot_reader &r)
+{
+	if (!Ym_interface.load_state(r)) {
+		return false;
+	}
+	r.read(Last_address);
+	r.read(Last_data);
+	r.read(Ym_registers);
+	r.read(Clocks_elapsed);
+	return r.ok();
+}
+
 void YM_debug_write(uint8_t addr, uint8_t value)
 {
 	Ym_registers[addr] = value;
@@ -29,7 +29,11 @@
 #	define YM_CLOCK_RATE (3579545)
 #	define YM_SAMPLE_RATE (YM_CLOCK_RATE >> 6)
 
+class snapshot_reader;
+class snapshot_writer;
+
 void     YM_prerender(uint32_t clocks);
+uint32_t YM_clocks_until_event();
 void     YM_render(int16_t *buffers, uint32_t samples, uint32_t sample_rate);
 void     YM_clear_backbuffer();
 uint32_t YM_get_sample_rate();
@@ -45,6 +49,11 @@ uint8_t YM_read_status();
 bool    YM_irq();
 void    YM_reset();
 
+// Ym_irq_enabled and Ym_strict_busy are options rather than machine state, so they aren't saved.
+void YM_save_state(snapshot_writer &w);
+bool YM_check_state(snapshot_reader &r);
+bool YM_load_state(snapshot_reader &r);
+
 // debug stuff
 void    YM_debug_write(uint8_t addr, uint8_t value);
 uint8_t YM_debug_read(uint8_t addr);
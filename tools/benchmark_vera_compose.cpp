@@ -0,0 +1,190 @@
+// Commander X16 Emulator
+// Copyright (c) 2021-2023 Stephen Horn, et al.
+// All rights reserved. License: 2-clause BSD
+
+// Compares the line composition in src/vera/vera_video_compose.cpp against the per-pixel
+// code render_line used before it, checking that both produce the same pixels.
+//
+// Build from the repository root, adding -mavx2 to measure the AVX2 path:
+//   g++ -std=c++20 -O2 tools/benchmark_vera_compose.cpp src/vera/vera_video_compose.cpp -o benchmark_vera_compose
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string.h>
+
+#include "../src/vera/vera_video_compose.h"
+
+using namespace std;
+
+#define SCREEN_WIDTH 640
+#define SCREEN_HEIGHT 480
+#define TITLE_SAFE_X 0.067
+#define TITLE_SAFE_Y 0.05
+
+#define NUM_LINES 480
+#define NUM_FRAMES 200
+
+struct line_inputs {
+	uint8_t  sprite_z[SCREEN_WIDTH];
+	uint8_t  sprite_col[SCREEN_WIDTH];
+	uint8_t  layer0[SCREEN_WIDTH];
+	uint8_t  layer1[SCREEN_WIDTH];
+	uint16_t hstart;
+	uint16_t hstop;
+	uint8_t  border_color;
+};
+
+static line_inputs Lines[NUM_LINES];
+static uint32_t    Palette[256];
+static uint32_t    Framebuffer[SCREEN_WIDTH * NUM_LINES];
+
+static uint8_t calculate_line_col_index(uint8_t spr_zindex, uint8_t spr_col_index, uint8_t l1_col_index, uint8_t l2_col_index)
+{
+	uint8_t col_index = 0;
+	switch (spr_zindex) {
+		case 3:
+			col_index = spr_col_index ? spr_col_index : (l2_col_index ? l2_col_index : l1_col_index);
+			break;
+		case 2:
+			col_index = l2_col_index ? l2_col_index : (spr_col_index ? spr_col_index : l1_col_index);
+			break;
+		case 1:
+			col_index = l2_col_index ? l2_col_index : (l1_col_index ? l1_col_index : spr_col_index);
+			break;
+		case 0:
+			col_index = l2_col_index ? l2_col_index : l1_col_index;
+			break;
+	}
+	return col_index;
+}
+
+// The composition, lookup, and overscan stages of render_line before vectorization.
+static void reference_line(const line_inputs &in, uint16_t y, uint32_t *framebuffer4_begin)
+{
+	uint8_t col_line[SCREEN_WIDTH];
+
+	const uint16_t xstart = in.hstart < 640 ? in.hstart : 640;
+	const uint16_t xstop  = in.hstop < 640 ? in.hstop : 640;
+
+	for (uint16_t x = 0; x < xstart; ++x) {
+		col_line[x] = in.border_color;
+	}
+	const uint16_t xwidth = xstop - xstart;
+	for (uint16_t x = 0; x < xwidth; ++x) {
+		col_line[xstart + x] = calculate_line_col_index(in.sprite_z[x], in.sprite_col[x], in.layer0[x], in.layer1[x]);
+	}
+	for (uint16_t x = xstop; x < SCREEN_WIDTH; ++x) {
+		col_line[x] = in.border_color;
+	}
+
+	uint32_t *framebuffer4 = framebuffer4_begin;
+	for (uint16_t x = 0; x < SCREEN_WIDTH; x++) {
+		*framebuffer4++ = Palette[col_line[x]];
+	}
+
+	framebuffer4 = framebuffer4_begin;
+	for (uint16_t x = 0; x < SCREEN_WIDTH; x++) {
+		if (x < SCREEN_WIDTH * TITLE_SAFE_X ||
+		    x > SCREEN_WIDTH * (1 - TITLE_SAFE_X) ||
+		    y < SCREEN_HEIGHT * TITLE_SAFE_Y ||
+		    y > SCREEN_HEIGHT * (1 - TITLE_SAFE_Y)) {
+			*framebuffer4 &= 0x00fcfcfc;
+			*framebuffer4 >>= 2;
+		}
+		framebuffer4++;
+	}
+}
+
+static uint16_t title_safe_start()
+{
+	uint16_t x = 0;
+	while (x < SCREEN_WIDTH * TITLE_SAFE_X) {
+		++x;
+	}
+	return x;
+}
+
+static uint16_t title_safe_stop()
+{
+	uint16_t x = SCREEN_WIDTH;
+	while (x > 0 && x - 1 > SCREEN_WIDTH * (1 - TITLE_SAFE_X)) {
+		--x;
+	}
+	return x;
+}
+
+static void vector_line(const line_inputs &in, uint16_t y, uint32_t *framebuffer4)
+{
+	static const uint16_t title_safe_left  = title_safe_start();
+	static const uint16_t title_safe_right = title_safe_stop();
+
+	uint8_t col_line[SCREEN_WIDTH];
+	vera_video_compose_line(col_line, SCREEN_WIDTH, in.hstart, in.hstop, in.border_color, in.sprite_z, in.sprite_col, in.layer0, in.layer1);
+	vera_video_palette_lookup(framebuffer4, col_line, Palette, SCREEN_WIDTH);
+
+	if (y < SCREEN_HEIGHT * TITLE_SAFE_Y || y > SCREEN_HEIGHT * (1 - TITLE_SAFE_Y)) {
+		vera_video_darken(framebuffer4, SCREEN_WIDTH);
+	} else {
+		vera_video_darken(framebuffer4, title_safe_left);
+		vera_video_darken(framebuffer4 + title_safe_right, SCREEN_WIDTH - title_safe_right);
+	}
+}
+
+template <typename F>
+static double time_frames(F &&render)
+{
+	const auto start = chrono::steady_clock::now();
+	for (int f = 0; f < NUM_FRAMES; ++f) {
+		for (uint16_t y = 0; y < NUM_LINES; ++y) {
+			render(Lines[y], y, Framebuffer + y * SCREEN_WIDTH);
+		}
+	}
+	const chrono::duration<double, micro> elapsed = chrono::steady_clock::now() - start;
+	return elapsed.count() / NUM_FRAMES;
+}
+
+int main()
+{
+	mt19937 rng(16);
+
+	for (uint32_t &c : Palette) {
+		c = 0xff000000 | (rng() & 0xffffff);
+	}
+
+	// Mostly transparent layers and sparse sprites, roughly like a tile-based game.
+	for (line_inputs &in : Lines) {
+		for (int x = 0; x < SCREEN_WIDTH; ++x) {
+			in.sprite_z[x]   = (rng() % 4 == 0) ? (1 + rng() % 3) : 0;
+			in.sprite_col[x] = in.sprite_z[x] ? (uint8_t)rng() : 0;
+			in.layer0[x]     = (uint8_t)rng();
+			in.layer1[x]     = (rng() % 2) ? (uint8_t)rng() : 0;
+		}
+		in.hstart       = (rng() % 8 == 0) ? (rng() % 64) * 4 : 0;
+		in.hstop        = (rng() % 8 == 0) ? 640 - (rng() % 64) * 4 : 640;
+		in.border_color = (uint8_t)rng();
+	}
+
+	static uint32_t expected[SCREEN_WIDTH * NUM_LINES];
+	for (uint16_t y = 0; y < NUM_LINES; ++y) {
+		reference_line(Lines[y], y, expected + y * SCREEN_WIDTH);
+		vector_line(Lines[y], y, Framebuffer + y * SCREEN_WIDTH);
+	}
+	if (memcmp(expected, Framebuffer, sizeof(expected)) != 0) {
+		cout << "Mismatch between reference and vectorized composition" << endl;
+		return 1;
+	}
+
+	// Warm up, then take the best of a few runs of each.
+	double reference_us = 1e9;
+	double vector_us    = 1e9;
+	for (int run = 0; run < 5; ++run) {
+		reference_us = min(reference_us, time_frames(reference_line));
+		vector_us    = min(vector_us, time_frames(vector_line));
+	}
+
+	cout << "reference:  " << reference_us << " us/frame" << endl;
+	cout << "vectorized: " << vector_us << " us/frame" << endl;
+	cout << "speedup:    " << reference_us / vector_us << "x" << endl;
+	return 0;
+}